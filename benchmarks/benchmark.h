@@ -0,0 +1,438 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ===== OPTIMIZATION BARRIERS =====
+//
+// A benchmark whose result is never used can be deleted by the optimizer.
+// do_not_optimize(x) makes the compiler believe x is read (and, for
+// non-const lvalues, modified) by code it cannot see; clobber_memory()
+// makes it assume all memory was read and written, so pending stores must
+// happen; escape(p) publishes a pointer so stores through it stay alive.
+// None of them emits an instruction.
+
+#if defined(__GNUC__)
+template<typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template<typename T>
+inline void do_not_optimize(T& value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+inline void clobber_memory() { asm volatile("" : : : "memory"); }
+
+inline void escape(const void* p) { asm volatile("" : : "g"(p) : "memory"); }
+#else
+#include <atomic>
+template<typename T>
+inline void do_not_optimize(const T& value) {
+    static volatile const void* sink;
+    sink = &value;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+inline void clobber_memory() { std::atomic_signal_fence(std::memory_order_seq_cst); }
+inline void escape(const void* p) { do_not_optimize(p); }
+#endif
+
+// ===== STATISTICS =====
+
+// Summary of per-iteration times in nanoseconds, after outliers outside
+// the Tukey fences (1.5 interquartile ranges beyond the quartiles) were
+// dropped. [ci_low, ci_high] is the 95% confidence interval of the mean.
+struct BenchmarkStats {
+    double mean = 0, median = 0, stddev = 0, ci_low = 0, ci_high = 0, min = 0, max = 0;
+    std::size_t samples = 0, outliers = 0;
+};
+
+// Two-sided 95% critical value of Student's t with df degrees of freedom
+inline double student_t_975(std::size_t df) {
+    static const double table[] = {0,     12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179,  2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086, 2.080,
+                                   2.074, 2.069,  2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df == 0) return INFINITY;
+    if (df <= 30) return table[df];
+    return df <= 60 ? 2.000 : df <= 120 ? 1.980 : 1.960;
+}
+
+// Linear-interpolated quantile of sorted values
+inline double sorted_quantile(const std::vector<double>& sorted, double q) {
+    double pos = q * static_cast<double>(sorted.size() - 1);
+    std::size_t lo = static_cast<std::size_t>(pos);
+    std::size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - static_cast<double>(lo));
+}
+
+inline BenchmarkStats summarize(std::vector<double> values) {
+    BenchmarkStats s;
+    if (values.empty()) return s;
+    std::sort(values.begin(), values.end());
+    const double q1 = sorted_quantile(values, 0.25), q3 = sorted_quantile(values, 0.75);
+    const double fence = 1.5 * (q3 - q1);
+    std::vector<double> kept;
+    for (double v : values) {
+        if (v >= q1 - fence && v <= q3 + fence) kept.push_back(v);
+    }
+    s.outliers = values.size() - kept.size();
+    s.samples = kept.size();
+    s.min = kept.front();
+    s.max = kept.back();
+    s.median = sorted_quantile(kept, 0.5);
+    s.mean = std::accumulate(kept.begin(), kept.end(), 0.0) / static_cast<double>(kept.size());
+    double squares = 0;
+    for (double v : kept) squares += (v - s.mean) * (v - s.mean);
+    s.stddev = kept.size() > 1 ? std::sqrt(squares / static_cast<double>(kept.size() - 1)) : 0.0;
+    const double half = kept.size() > 1 ? student_t_975(kept.size() - 1) * s.stddev / std::sqrt(double(kept.size())) : 0.0;
+    s.ci_low = s.mean - half;
+    s.ci_high = s.mean + half;
+    return s;
+}
+
+// ===== BENCHMARK REGISTRY =====
+
+struct BenchmarkOptions {
+    double min_sample_ms = 5;   // iterations per sample grow until a sample takes this long
+    std::size_t samples = 25;
+    double warmup_ms = 50;
+    std::string filter;         // run only names containing this
+};
+
+class Benchmark {
+public:
+    Benchmark(std::string name, std::function<void(std::uint64_t)> run) : name_(std::move(name)), run_(std::move(run)) {}
+
+    // Work per iteration, reported as GB/s or M items/s
+    Benchmark& bytes_per_iteration(double bytes) {
+        bytes_ = bytes;
+        return *this;
+    }
+    Benchmark& items_per_iteration(double items) {
+        items_ = items;
+        return *this;
+    }
+
+    const std::string& name() const { return name_; }
+    double bytes() const { return bytes_; }
+    double items() const { return items_; }
+    void run(std::uint64_t iterations) const { run_(iterations); }
+
+private:
+    std::string name_;
+    std::function<void(std::uint64_t)> run_;
+    double bytes_ = 0, items_ = 0;
+};
+
+class BenchmarkSuite {
+public:
+    // body() is one iteration. It is called in a loop instantiated here,
+    // so the std::function indirection happens once per sample, not per
+    // iteration.
+    template<typename F>
+    Benchmark& add(std::string name, F body) {
+        return benchmarks_.emplace_back(std::move(name), [body](std::uint64_t iterations) mutable {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                body();
+                clobber_memory();
+            }
+        });
+    }
+
+    const std::deque<Benchmark>& benchmarks() const { return benchmarks_; }
+
+private:
+    std::deque<Benchmark> benchmarks_;   // stable references for the fluent setters
+};
+
+struct BenchmarkResult {
+    std::string name;
+    std::uint64_t iterations = 0;   // per sample
+    BenchmarkStats ns;              // per iteration
+    double bytes_per_iteration = 0, items_per_iteration = 0;
+
+    double gb_per_s() const { return bytes_per_iteration / ns.median; }
+    double mitems_per_s() const { return items_per_iteration / ns.median * 1e3; }
+};
+
+// ===== RUNNER =====
+
+inline double benchmark_time_ns(const Benchmark& b, std::uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    b.run(iterations);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Calibrates the iterations per sample, warms up, then times
+// options.samples samples
+inline BenchmarkResult run_benchmark(const Benchmark& b, const BenchmarkOptions& options) {
+    const double target = options.min_sample_ms * 1e6;
+    std::uint64_t iterations = 1;
+    for (;;) {
+        double t = benchmark_time_ns(b, iterations);
+        if (t >= target) break;
+        // Aim 20% past the target, growing at most 10x per probe
+        double factor = t > 0 ? std::min(10.0, std::max(2.0, 1.2 * target / t)) : 10.0;
+        iterations = static_cast<std::uint64_t>(static_cast<double>(iterations) * factor);
+    }
+
+    auto warm_start = std::chrono::steady_clock::now();
+    do {
+        b.run(iterations);
+    } while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warm_start).count() <
+             options.warmup_ms);
+
+    std::vector<double> per_iteration;
+    per_iteration.reserve(options.samples);
+    for (std::size_t s = 0; s < options.samples; ++s) {
+        per_iteration.push_back(benchmark_time_ns(b, iterations) / static_cast<double>(iterations));
+    }
+
+    BenchmarkResult r;
+    r.name = b.name();
+    r.iterations = iterations;
+    r.ns = summarize(std::move(per_iteration));
+    r.bytes_per_iteration = b.bytes();
+    r.items_per_iteration = b.items();
+    return r;
+}
+
+inline std::vector<BenchmarkResult> run_benchmarks(const BenchmarkSuite& suite, const BenchmarkOptions& options,
+                                                   std::ostream* progress = nullptr) {
+    std::vector<BenchmarkResult> results;
+    for (const Benchmark& b : suite.benchmarks()) {
+        if (b.name().find(options.filter) == std::string::npos) continue;
+        if (progress) *progress << "running " << b.name() << "..." << std::flush;
+        results.push_back(run_benchmark(b, options));
+        if (progress) *progress << "\r\033[K" << std::flush;
+    }
+    return results;
+}
+
+// ===== REPORTING =====
+
+// Nanoseconds with a unit that keeps 3-4 significant digits
+inline std::string format_duration(double ns) {
+    char buffer[32];
+    if (ns < 1e3) std::snprintf(buffer, sizeof buffer, "%.2f ns", ns);
+    else if (ns < 1e6) std::snprintf(buffer, sizeof buffer, "%.2f us", ns / 1e3);
+    else if (ns < 1e9) std::snprintf(buffer, sizeof buffer, "%.2f ms", ns / 1e6);
+    else std::snprintf(buffer, sizeof buffer, "%.2f s", ns / 1e9);
+    return buffer;
+}
+
+inline void print_results(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    char line[256];
+    std::snprintf(line, sizeof line, "%-40s %12s %12s %10s %7s %4s %14s\n", "benchmark", "median", "mean", "+/- 95%",
+                  "cv", "out", "throughput");
+    out << line;
+    for (const BenchmarkResult& r : results) {
+        char throughput[32] = "";
+        if (r.bytes_per_iteration > 0) std::snprintf(throughput, sizeof throughput, "%.2f GB/s", r.gb_per_s());
+        else if (r.items_per_iteration > 0) std::snprintf(throughput, sizeof throughput, "%.1f M/s", r.mitems_per_s());
+        std::snprintf(line, sizeof line, "%-40s %12s %12s %10s %6.1f%% %4zu %14s\n", r.name.c_str(),
+                      format_duration(r.ns.median).c_str(), format_duration(r.ns.mean).c_str(),
+                      format_duration(r.ns.ci_high - r.ns.mean).c_str(), 100.0 * r.ns.stddev / r.ns.mean,
+                      r.ns.outliers, throughput);
+        out << line;
+    }
+}
+
+inline void write_csv(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << "name,iterations,samples,outliers,median_ns,mean_ns,stddev_ns,ci_low_ns,ci_high_ns,min_ns,max_ns,"
+           "bytes_per_iteration,items_per_iteration\n";
+    char line[512];
+    for (const BenchmarkResult& r : results) {
+        std::snprintf(line, sizeof line, "%s,%llu,%zu,%zu,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g\n",
+                      r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.ns.samples, r.ns.outliers,
+                      r.ns.median, r.ns.mean, r.ns.stddev, r.ns.ci_low, r.ns.ci_high, r.ns.min, r.ns.max,
+                      r.bytes_per_iteration, r.items_per_iteration);
+        out << line;
+    }
+}
+
+inline void write_json(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << "{\n  \"benchmarks\": [";
+    char line[640];
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        std::string name;
+        for (char c : r.name) {
+            if (c == '"' || c == '\\') name += '\\';
+            name += c;
+        }
+        std::snprintf(line, sizeof line,
+                      "%s\n    {\"name\": \"%s\", \"iterations\": %llu, \"samples\": %zu, \"outliers\": %zu, "
+                      "\"median_ns\": %.6g, \"mean_ns\": %.6g, \"stddev_ns\": %.6g, \"ci_low_ns\": %.6g, "
+                      "\"ci_high_ns\": %.6g, \"min_ns\": %.6g, \"max_ns\": %.6g, \"bytes_per_iteration\": %.6g, "
+                      "\"items_per_iteration\": %.6g}",
+                      i ? "," : "", name.c_str(), static_cast<unsigned long long>(r.iterations), r.ns.samples,
+                      r.ns.outliers, r.ns.median, r.ns.mean, r.ns.stddev, r.ns.ci_low, r.ns.ci_high, r.ns.min,
+                      r.ns.max, r.bytes_per_iteration, r.items_per_iteration);
+        out << line;
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Reads what write_csv wrote; benchmark names must not contain commas
+inline std::vector<BenchmarkResult> read_csv(std::istream& in) {
+    std::vector<BenchmarkResult> results;
+    std::string line;
+    std::getline(in, line);   // header
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        std::vector<std::string> fields;
+        std::stringstream row(line);
+        for (std::string field; std::getline(row, field, ',');) fields.push_back(field);
+        if (fields.size() < 13) continue;
+        BenchmarkResult r;
+        r.name = fields[0];
+        r.iterations = std::strtoull(fields[1].c_str(), nullptr, 10);
+        r.ns.samples = std::strtoull(fields[2].c_str(), nullptr, 10);
+        r.ns.outliers = std::strtoull(fields[3].c_str(), nullptr, 10);
+        double* stats[] = {&r.ns.median, &r.ns.mean, &r.ns.stddev, &r.ns.ci_low, &r.ns.ci_high, &r.ns.min,
+                           &r.ns.max, &r.bytes_per_iteration, &r.items_per_iteration};
+        for (std::size_t i = 0; i < 9; ++i) *stats[i] = std::strtod(fields[4 + i].c_str(), nullptr);
+        results.push_back(r);
+    }
+    return results;
+}
+
+// ===== BASELINE COMPARISON =====
+
+enum class BaselineVerdict { Unchanged, Regression, Improvement, New };
+
+struct BaselineComparison {
+    std::string name;
+    double baseline_ns = 0, current_ns = 0;   // medians
+    double change = 0;                        // current / baseline - 1
+    BaselineVerdict verdict = BaselineVerdict::New;
+};
+
+// A benchmark regressed when its median is more than threshold slower and
+// the confidence intervals of the two runs don't overlap, so noise alone
+// doesn't flag it; improvements are judged the same way
+inline std::vector<BaselineComparison> compare_to_baseline(const std::vector<BenchmarkResult>& current,
+                                                           const std::vector<BenchmarkResult>& baseline,
+                                                           double threshold) {
+    std::map<std::string, const BenchmarkResult*> by_name;
+    for (const BenchmarkResult& r : baseline) by_name[r.name] = &r;
+    std::vector<BaselineComparison> out;
+    for (const BenchmarkResult& r : current) {
+        BaselineComparison c;
+        c.name = r.name;
+        c.current_ns = r.ns.median;
+        auto it = by_name.find(r.name);
+        if (it != by_name.end()) {
+            const BenchmarkStats& b = it->second->ns;
+            c.baseline_ns = b.median;
+            c.change = r.ns.median / b.median - 1.0;
+            if (c.change > threshold && r.ns.ci_low > b.ci_high) c.verdict = BaselineVerdict::Regression;
+            else if (c.change < -threshold && r.ns.ci_high < b.ci_low) c.verdict = BaselineVerdict::Improvement;
+            else c.verdict = BaselineVerdict::Unchanged;
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+inline void print_comparison(std::ostream& out, const std::vector<BaselineComparison>& comparisons) {
+    char line[256];
+    std::snprintf(line, sizeof line, "%-40s %12s %12s %9s  %s\n", "benchmark", "baseline", "current", "change", "");
+    out << line;
+    for (const BaselineComparison& c : comparisons) {
+        const char* verdict = c.verdict == BaselineVerdict::Regression    ? "REGRESSION"
+                              : c.verdict == BaselineVerdict::Improvement ? "improved"
+                              : c.verdict == BaselineVerdict::New         ? "new"
+                                                                          : "";
+        std::snprintf(line, sizeof line, "%-40s %12s %12s %+8.1f%%  %s\n", c.name.c_str(),
+                      c.verdict == BaselineVerdict::New ? "-" : format_duration(c.baseline_ns).c_str(),
+                      format_duration(c.current_ns).c_str(), 100.0 * c.change, verdict);
+        out << line;
+    }
+}
+
+// ===== COMMAND LINE =====
+
+// Runs the suite with
+//   --filter=<substring>  --samples=<n>  --min-time=<ms per sample>
+//   --warmup=<ms>  --json=<file>  --csv=<file>  --list
+//   --baseline=<csv from an earlier --csv>  --threshold=<fraction, default 0.05>
+// and returns 1 when a baseline comparison finds a regression
+inline int benchmark_main(int argc, char** argv, const BenchmarkSuite& suite) {
+    BenchmarkOptions options;
+    std::string json_path, csv_path, baseline_path;
+    double threshold = 0.05;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = [&](std::string_view flag) -> const char* {
+            return arg.starts_with(flag) && arg.size() > flag.size() && arg[flag.size()] == '='
+                       ? argv[i] + flag.size() + 1
+                       : nullptr;
+        };
+        if (arg == "--list") {
+            for (const Benchmark& b : suite.benchmarks()) std::cout << b.name() << "\n";
+            return 0;
+        } else if (const char* v = value("--filter")) {
+            options.filter = v;
+        } else if (const char* v = value("--samples")) {
+            options.samples = std::max(2, std::atoi(v));
+        } else if (const char* v = value("--min-time")) {
+            options.min_sample_ms = std::atof(v);
+        } else if (const char* v = value("--warmup")) {
+            options.warmup_ms = std::atof(v);
+        } else if (const char* v = value("--json")) {
+            json_path = v;
+        } else if (const char* v = value("--csv")) {
+            csv_path = v;
+        } else if (const char* v = value("--baseline")) {
+            baseline_path = v;
+        } else if (const char* v = value("--threshold")) {
+            threshold = std::atof(v);
+        } else {
+            std::cerr << "unknown argument " << arg << "\n"
+                      << "usage: " << argv[0]
+                      << " [--list] [--filter=S] [--samples=N] [--min-time=MS] [--warmup=MS] [--json=FILE] [--csv=FILE]"
+                         " [--baseline=CSV] [--threshold=F]\n";
+            return 2;
+        }
+    }
+
+    std::vector<BenchmarkResult> results = run_benchmarks(suite, options, &std::cerr);
+    print_results(std::cout, results);
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        write_json(out, results);
+    }
+    if (!csv_path.empty()) {
+        std::ofstream out(csv_path);
+        write_csv(out, results);
+    }
+    if (baseline_path.empty()) return 0;
+
+    std::ifstream in(baseline_path);
+    if (!in) {
+        std::cerr << "cannot read baseline " << baseline_path << "\n";
+        return 2;
+    }
+    std::vector<BaselineComparison> comparisons = compare_to_baseline(results, read_csv(in), threshold);
+    std::cout << "\n";
+    print_comparison(std::cout, comparisons);
+    bool regressed = std::any_of(comparisons.begin(), comparisons.end(),
+                                 [](const BaselineComparison& c) { return c.verdict == BaselineVerdict::Regression; });
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory_resource>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include "aligned_allocator.h"
+#include "async_logger.h"
+#include "benchmark.h"
+#include "event_bus.h"
+#include "gemm.h"
+#include "generator.h"
+#include "layout.h"
+#include "parallel.h"
+#include "particle_system.h"
+#include "profiler.h"
+#include "simd.h"
+#include "simd_filter.h"
+#include "simd_math.h"
+#include "simd_sort.h"
+#include "sorting.h"
+
+// The comparisons the demos time once with a single clock read, as a
+// repeatable suite: every benchmark here is calibrated, warmed up and
+// sampled by benchmark.h. Names are <area>/<case>, so --filter=perf/
+// selects one area.
+
+using floatv = native_simd<float>;
+using intv = native_simd<std::int32_t>;
+
+std::vector<float> random_floats(std::size_t n, float lo, float hi, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(lo, hi);
+    std::vector<float> out(n);
+    for (float& x : out) x = dist(rng);
+    return out;
+}
+
+std::vector<std::int32_t> random_ints(std::size_t n, std::int32_t lo, std::int32_t hi, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::int32_t> dist(lo, hi);
+    std::vector<std::int32_t> out(n);
+    for (std::int32_t& x : out) x = dist(rng);
+    return out;
+}
+
+// ===== PERFORMANCE OPTIMIZATION =====
+
+struct ParticleAOS {
+    float x, y, z, vx, vy, vz, mass;
+};
+
+void add_data_layout(BenchmarkSuite& suite) {
+    const std::size_t n = 1 << 20;
+    static std::vector<ParticleAOS> aos(n);
+    static aligned_vector<float> soa_x(n);
+    for (std::size_t i = 0; i < n; ++i) aos[i].x = soa_x[i] = float(i % 1000);
+
+    suite.add("perf/aos_sum_x", [] {
+        float sum = 0;
+        for (const ParticleAOS& p : aos) sum += p.x;
+        do_not_optimize(sum);
+    }).bytes_per_iteration(n * sizeof(ParticleAOS));
+    suite.add("perf/soa_sum_x", [] {
+        float sum = 0;
+        for (float x : soa_x) sum += x;
+        do_not_optimize(sum);
+    }).bytes_per_iteration(n * sizeof(float));
+    suite.add("perf/soa_sum_x_simd", [] {
+        floatv lanes(0.0f);
+        for (std::size_t i = 0; i < n; i += floatv::size) lanes += floatv::load_aligned(&soa_x[i]);
+        float sum = reduce_add(lanes);
+        do_not_optimize(sum);
+    }).bytes_per_iteration(n * sizeof(float));
+}
+
+void add_branch_prediction(BenchmarkSuite& suite) {
+    const std::size_t n = 1 << 20;
+    static std::vector<std::int32_t> data = random_ints(n, -1000, 1000, 1);
+    suite.add("perf/abs_sum_branchy", [] {
+        std::int32_t sum = 0;
+        for (std::int32_t x : data) {
+            if (x > 0) sum += x;
+            else sum -= x;
+            do_not_optimize(sum);   // keeps the branch: no cmov, no vectorization
+        }
+    }).items_per_iteration(n);
+    suite.add("perf/abs_sum_branchless", [] {
+        std::uint32_t sum = 0;
+        for (std::int32_t x : data) sum += static_cast<std::uint32_t>(x > 0 ? x : -x);
+        do_not_optimize(sum);
+    }).items_per_iteration(n);
+    suite.add("perf/abs_sum_simd", [] {
+        intv lanes(0);
+        for (std::size_t i = 0; i < n; i += intv::size) {
+            intv x = intv::load(&data[i]);
+            lanes += select(x > intv(0), x, -x);
+        }
+        std::int32_t sum = reduce_add(lanes);
+        do_not_optimize(sum);
+    }).items_per_iteration(n);
+}
+
+void add_memory_access(BenchmarkSuite& suite) {
+    // 64 MB: well past the last-level cache
+    const std::size_t n = 16 << 20;
+    static std::vector<std::int32_t> data(n, 1);
+    suite.add("perf/sequential_sum", [] {
+        long long sum = 0;
+        for (std::int32_t x : data) sum += x;
+        do_not_optimize(sum);
+    }).bytes_per_iteration(n * sizeof(std::int32_t));
+    // One int per 64-byte line: 1/16 of the additions, every line still fetched
+    suite.add("perf/strided_sum_16", [] {
+        long long sum = 0;
+        for (std::size_t i = 0; i < n; i += 16) sum += data[i];
+        do_not_optimize(sum);
+    }).bytes_per_iteration(n * sizeof(std::int32_t));
+}
+
+void add_layout(BenchmarkSuite& suite) {
+    // 16 MB each way; bytes counted as read + written
+    const std::size_t n = 2048;
+    static Matrix<float> in(n, n), out(n, n);
+    std::vector<float> values = random_floats(n * n, 0.0f, 1.0f, 5);
+    std::copy(values.begin(), values.end(), in.data());
+    suite.add("layout/transpose_naive_2048", [] {
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t j = 0; j < n; ++j) out(j, i) = in(i, j);
+        }
+        escape(out.data());
+    }).bytes_per_iteration(2 * n * n * sizeof(float));
+    suite.add("layout/transpose_2048", [] {
+        transpose(in, out);
+        escape(out.data());
+    }).bytes_per_iteration(2 * n * n * sizeof(float));
+
+    const std::size_t frames = 1 << 22;
+    static aligned_vector<float> stereo(2 * frames, 1.0f), planar(2 * frames);
+    suite.add("layout/deinterleave2_naive_4M", [] {
+        for (std::size_t f = 0; f < frames; ++f) {
+            planar[f] = stereo[2 * f];
+            planar[frames + f] = stereo[2 * f + 1];
+        }
+        escape(planar.data());
+    }).bytes_per_iteration(4 * frames * sizeof(float));
+    suite.add("layout/deinterleave2_4M", [] {
+        deinterleave(std::span<const float>(stereo), 2, std::span<float>(planar));
+        escape(planar.data());
+    }).bytes_per_iteration(4 * frames * sizeof(float));
+}
+
+void add_matrix(BenchmarkSuite& suite) {
+    const std::size_t n = 256;
+    static Matrix<float> a(n, n), b(n, n), c(n, n);
+    std::vector<float> values = random_floats(n * n, 0.0f, 1.0f, 2);
+    std::copy(values.begin(), values.end(), a.data());
+    std::reverse(values.begin(), values.end());
+    std::copy(values.begin(), values.end(), b.data());
+    const double flops = 2.0 * n * n * n;
+
+    suite.add("perf/matmul_naive_256", [] {
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t j = 0; j < n; ++j) {
+                float sum = 0;
+                for (std::size_t k = 0; k < n; ++k) sum += a(i, k) * b(k, j);
+                c(i, j) = sum;
+            }
+        }
+        escape(c.data());
+    }).items_per_iteration(flops);
+    suite.add("perf/matmul_ikj_256", [] {
+        std::fill(c.data(), c.data() + n * n, 0.0f);
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t k = 0; k < n; ++k) {
+                const float aik = a(i, k);
+                for (std::size_t j = 0; j < n; ++j) c(i, j) += aik * b(k, j);
+            }
+        }
+        escape(c.data());
+    }).items_per_iteration(flops);
+    suite.add("perf/gemm_256", [] {
+        gemm(a, b, c);
+        escape(c.data());
+    }).items_per_iteration(flops);
+}
+
+void add_particles(BenchmarkSuite& suite) {
+    const std::size_t n = 1 << 20;
+    static ParticleSystem system({0.0f, 0.0f, 0.0f}, {100.0f, 100.0f, 100.0f});
+    system.resize(n);
+    std::vector<float> position = random_floats(3 * n, 0.0f, 100.0f, 3), velocity = random_floats(3 * n, -10.0f, 10.0f, 4);
+    for (std::size_t i = 0; i < n; ++i) {
+        system.x()[i] = position[3 * i];
+        system.y()[i] = position[3 * i + 1];
+        system.z()[i] = position[3 * i + 2];
+        system.vx()[i] = velocity[3 * i];
+        system.vy()[i] = velocity[3 * i + 1];
+        system.vz()[i] = velocity[3 * i + 2];
+    }
+    suite.add("perf/particle_step_1M", [] { system.step(0.001f); }).items_per_iteration(n);
+}
+
+void add_instrumentation(BenchmarkSuite& suite) {
+    // Reset before the buffer fills up, or the cheaper drop path is measured
+    suite.add("perf/trace_scope", [] {
+        { TRACE_SCOPE("benchmark"); }
+        if (TraceRegistry::local().size() == TraceBuffer::block_size * 64) trace_reset();
+    }).items_per_iteration(1);
+    suite.add("perf/tsc_read", [] {
+        std::uint64_t t = TscClock::now();
+        do_not_optimize(t);
+    }).items_per_iteration(1);
+}
+
+// ===== SIMD OPERATIONS =====
+
+void add_simd(BenchmarkSuite& suite) {
+    const std::size_t n = 1 << 16;   // 3 x 256 KB: fits L2/L3, so the ALUs are measured
+    static aligned_vector<float> a(n), b(n), c(n);
+    std::vector<float> values = random_floats(n, -10.0f, 10.0f, 5);
+    std::copy(values.begin(), values.end(), a.begin());
+    std::copy(values.rbegin(), values.rend(), b.begin());
+
+    suite.add("simd/add_scalar", [] {
+        for (std::size_t i = 0; i < n; ++i) {
+            c[i] = a[i] + b[i];
+            do_not_optimize(c[i]);   // one element per iteration, as written
+        }
+    }).bytes_per_iteration(3 * n * sizeof(float));
+    suite.add("simd/add_simd", [] {
+        for (std::size_t i = 0; i < n; i += floatv::size) {
+            (floatv::load_aligned(&a[i]) + floatv::load_aligned(&b[i])).store_aligned(&c[i]);
+        }
+        escape(c.data());
+    }).bytes_per_iteration(3 * n * sizeof(float));
+    suite.add("simd/sin_libm", [] {
+        for (std::size_t i = 0; i < n; ++i) c[i] = std::sin(a[i]);
+        escape(c.data());
+    }).items_per_iteration(n);
+    suite.add("simd/sin_vsin", [] {
+        vsin(std::span<const float>(a.data(), n), std::span<float>(c.data(), n));
+        escape(c.data());
+    }).items_per_iteration(n);
+
+    // Half the elements pass: the worst case for a branchy filter
+    suite.add("simd/filter_branchy_50pct", [] {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (a[i] > 0.0f) c[count++] = a[i];
+        }
+        do_not_optimize(count);
+        escape(c.data());
+    }).items_per_iteration(n);
+    suite.add("simd/filter_simd_50pct", [] {
+        std::size_t count = simd_filter<float>(a, c, [](auto x) { return x > decltype(x)(0.0f); });
+        do_not_optimize(count);
+        escape(c.data());
+    }).items_per_iteration(n);
+}
+
+// ===== SORTING =====
+
+void add_sorting(BenchmarkSuite& suite) {
+    const std::size_t n = 100000;
+    static const std::vector<std::int32_t> input = random_ints(n, INT32_MIN, INT32_MAX, 6);
+    static std::vector<std::int32_t> work(n);
+    // Copying the input back is part of every iteration, for every sort
+    suite.add("sort/std_sort_100k", [] {
+        std::copy(input.begin(), input.end(), work.begin());
+        std::sort(work.begin(), work.end());
+        escape(work.data());
+    }).items_per_iteration(n);
+    suite.add("sort/simd_hybrid_sort_100k", [] {
+        std::copy(input.begin(), input.end(), work.begin());
+        simd_hybrid_sort<std::int32_t>(work);
+        escape(work.data());
+    }).items_per_iteration(n);
+    suite.add("sort/pdqsort_100k", [] {
+        std::copy(input.begin(), input.end(), work.begin());
+        pdqsort(std::span<std::int32_t>(work));
+        escape(work.data());
+    }).items_per_iteration(n);
+    suite.add("sort/std_stable_sort_100k", [] {
+        std::copy(input.begin(), input.end(), work.begin());
+        std::stable_sort(work.begin(), work.end());
+        escape(work.data());
+    }).items_per_iteration(n);
+    suite.add("sort/stable_merge_sort_100k", [] {
+        static std::vector<std::int32_t> buffer;
+        std::copy(input.begin(), input.end(), work.begin());
+        stable_merge_sort(std::span<std::int32_t>(work), buffer);
+        escape(work.data());
+    }).items_per_iteration(n);
+
+    // Adaptive selection on the distributions it tells apart: full-range
+    // keys go to radix sort, a permutation of 0..n-1 to counting sort
+    static const std::vector<std::int32_t> nearly_sorted = [] {
+        std::vector<std::int32_t> v(n);
+        std::iota(v.begin(), v.end(), 0);
+        std::mt19937 rng(8);
+        for (std::size_t k = 0; k < n / 100; ++k) std::swap(v[rng() % n], v[rng() % n]);
+        return v;
+    }();
+    suite.add("sort/adaptive_sort_100k", [] {
+        std::copy(input.begin(), input.end(), work.begin());
+        adaptive_sort(std::span<std::int32_t>(work));
+        escape(work.data());
+    }).items_per_iteration(n);
+    suite.add("sort/std_sort_nearly_sorted_100k", [] {
+        std::copy(nearly_sorted.begin(), nearly_sorted.end(), work.begin());
+        std::sort(work.begin(), work.end());
+        escape(work.data());
+    }).items_per_iteration(n);
+    suite.add("sort/adaptive_sort_nearly_sorted_100k", [] {
+        std::copy(nearly_sorted.begin(), nearly_sorted.end(), work.begin());
+        adaptive_sort(std::span<std::int32_t>(work));
+        escape(work.data());
+    }).items_per_iteration(n);
+
+    static const std::vector<std::int32_t> small = random_ints(simd_sort_network_max, -1000, 1000, 7);
+    static std::vector<std::int32_t> small_work(simd_sort_network_max);
+    suite.add("sort/std_sort_64", [] {
+        std::copy(small.begin(), small.end(), small_work.begin());
+        std::sort(small_work.begin(), small_work.end());
+        escape(small_work.data());
+    }).items_per_iteration(simd_sort_network_max);
+    suite.add("sort/simd_sort_small_64", [] {
+        std::copy(small.begin(), small.end(), small_work.begin());
+        simd_sort_small(small_work.data(), small_work.size());
+        escape(small_work.data());
+    }).items_per_iteration(simd_sort_network_max);
+}
+
+// ===== PARALLEL ALGORITHMS =====
+
+void add_parallel(BenchmarkSuite& suite) {
+    const std::size_t n = 1 << 20;
+    static const std::vector<float> values = random_floats(n, -10.0f, 10.0f, 9);
+    static const std::vector<std::int32_t> ints = random_ints(n, -1000, 1000, 10);
+    static const std::vector<std::int32_t> keys = random_ints(n, INT32_MIN, INT32_MAX, 11);
+    static std::vector<float> float_out(n);
+    static std::vector<std::int32_t> int_out(n);
+
+    suite.add("parallel/sum_plain_1M", [] {
+        float sum = par_sum(values);
+        do_not_optimize(sum);
+    }).bytes_per_iteration(n * sizeof(float));
+    suite.add("parallel/sum_kahan_1M", [] {
+        float sum = par_sum(values, Summation::Kahan);
+        do_not_optimize(sum);
+    }).bytes_per_iteration(n * sizeof(float));
+
+    suite.add("parallel/std_inclusive_scan_1M", [] {
+        std::inclusive_scan(ints.begin(), ints.end(), int_out.begin());
+        escape(int_out.data());
+    }).items_per_iteration(n);
+    suite.add("parallel/inclusive_scan_1M", [] {
+        par_inclusive_scan(ints, int_out);
+        escape(int_out.data());
+    }).items_per_iteration(n);
+    suite.add("parallel/exclusive_scan_1M", [] {
+        par_exclusive_scan(ints, int_out, 0);
+        escape(int_out.data());
+    }).items_per_iteration(n);
+
+    // Half the elements pass; GreaterThan takes the compress-store path
+    suite.add("parallel/copy_if_lambda_50pct_1M", [] {
+        std::size_t count = par_copy_if(default_pool(), std::span<const float>(values), std::span<float>(float_out),
+                                        [](float x) { return x > 0.0f; });
+        do_not_optimize(count);
+        escape(float_out.data());
+    }).items_per_iteration(n);
+    suite.add("parallel/copy_if_simd_50pct_1M", [] {
+        std::size_t count = par_copy_if(default_pool(), std::span<const float>(values), std::span<float>(float_out),
+                                        GreaterThan<float>{0.0f});
+        do_not_optimize(count);
+        escape(float_out.data());
+    }).items_per_iteration(n);
+
+    // Copying the keys back is part of every iteration
+    suite.add("parallel/radix_sort_1M", [] {
+        std::copy(keys.begin(), keys.end(), int_out.begin());
+        par_radix_sort(std::span<std::int32_t>(int_out));
+        escape(int_out.data());
+    }).items_per_iteration(n);
+
+    suite.add("parallel/pipeline_filter_map_1M", [] {
+        auto out = Pipeline(values)
+                       .filter([](float x) { return x > 0.0f; })
+                       .map([](float x) { return x * x; })
+                       .run();
+        escape(out.data());
+    }).items_per_iteration(n);
+    suite.add("parallel/pipeline_filter_map_sorted_1M", [] {
+        auto out = Pipeline(values)
+                       .filter([](float x) { return x > 0.0f; })
+                       .map([](float x) { return x * x; })
+                       .sorted()
+                       .run();
+        escape(out.data());
+    }).items_per_iteration(n);
+}
+
+// ===== DESIGN PATTERNS =====
+
+void add_logging(BenchmarkSuite& suite) {
+    // Both write to /dev/null, so the producer's cost is measured, not the
+    // disk. Block keeps the async logger from taking the cheaper drop path.
+    static std::FILE* sync_file = std::fopen("/dev/null", "w");
+    static AsyncLogger log("/dev/null", {.overflow = LogOverflow::Block});
+    static int i = 0;
+    suite.add("logging/fprintf_flush", [] {
+        std::fprintf(sync_file, "request %d took %d us\n", i, i % 977);
+        std::fflush(sync_file);
+        ++i;
+    }).items_per_iteration(1);
+    suite.add("logging/async_text", [] {
+        char line[64];
+        std::snprintf(line, sizeof line, "request %d took %d us", i, i % 977);
+        log.log(line);
+        ++i;
+    }).items_per_iteration(1);
+    // Same line, formatted by the writer thread: the producer only copies
+    // the format id and the two arguments
+    suite.add("logging/async_deferred", [] {
+        LOG_DEFERRED(log, "request {} took {} us", i, i % 977);
+        ++i;
+    }).items_per_iteration(1);
+}
+
+struct PriceTick {
+    std::int64_t instrument;
+    double price;
+};
+
+void add_events(BenchmarkSuite& suite) {
+    // One bus per subscriber count; handlers only read the event, so the
+    // delivery itself is measured
+    static EventBus<PriceTick> bus_1, bus_8;
+    static std::vector<Subscription<PriceTick>> subscriptions;
+    auto handler = [](const PriceTick& tick) { do_not_optimize(tick.price); };
+    subscriptions.push_back(bus_1.subscribe<PriceTick>(handler));
+    for (int s = 0; s < 8; ++s) subscriptions.push_back(bus_8.subscribe<PriceTick>(handler));
+
+    suite.add("events/publish_1", [] { bus_1.publish(PriceTick{1, 101.5}); }).items_per_iteration(1);
+    suite.add("events/publish_8", [] { bus_8.publish(PriceTick{1, 101.5}); }).items_per_iteration(8);
+
+    // 1000 events queued on the pool, then waited for
+    static EventBus<PriceTick> async_bus(default_pool());
+    for (int s = 0; s < 8; ++s) subscriptions.push_back(async_bus.subscribe<PriceTick>(handler));
+    suite.add("events/publish_async_8_x1000", [] {
+        for (std::int64_t k = 0; k < 1000; ++k) async_bus.publish_async(PriceTick{k, 101.5});
+        async_bus.flush();
+    }).items_per_iteration(8 * 1000);
+}
+
+// ===== MEMORY POOLS =====
+
+struct PoolObject {
+    std::int64_t id;
+    double payload[7];
+};
+
+void add_memory_pools(BenchmarkSuite& suite) {
+    const std::size_t n = 10000;
+    static std::vector<PoolObject*> objects(n);
+    suite.add("memory/new_delete_10k", [] {
+        for (std::size_t i = 0; i < n; ++i) objects[i] = new PoolObject{static_cast<std::int64_t>(i), {}};
+        escape(objects.data());
+        for (PoolObject* p : objects) delete p;
+    }).items_per_iteration(n);
+    static std::pmr::unsynchronized_pool_resource pool;
+    suite.add("memory/pmr_pool_10k", [] {
+        std::pmr::polymorphic_allocator<PoolObject> alloc(&pool);
+        for (std::size_t i = 0; i < n; ++i) {
+            objects[i] = alloc.allocate(1);
+            alloc.construct(objects[i], PoolObject{static_cast<std::int64_t>(i), {}});
+        }
+        escape(objects.data());
+        for (PoolObject* p : objects) alloc.deallocate(p, 1);
+    }).items_per_iteration(n);
+    suite.add("memory/monotonic_arena_10k", [] {
+        alignas(64) static std::byte buffer[n * sizeof(PoolObject) + 4096];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof buffer);
+        std::pmr::polymorphic_allocator<PoolObject> alloc(&arena);
+        for (std::size_t i = 0; i < n; ++i) {
+            objects[i] = alloc.allocate(1);
+            alloc.construct(objects[i], PoolObject{static_cast<std::int64_t>(i), {}});
+        }
+        escape(objects.data());
+    }).items_per_iteration(n);
+}
+
+// ===== COROUTINES =====
+
+Generator<int> numbers(int first, int last) {
+    for (int i = first; i <= last; ++i) co_yield i;
+}
+
+Generator<int> evens(Generator<int>& input) {
+    for (int value : input) {
+        if (value % 2 == 0) co_yield value;
+    }
+}
+
+Generator<int> squares(Generator<int>& input) {
+    for (int value : input) co_yield value * value;
+}
+
+void add_coroutines(BenchmarkSuite& suite) {
+    const int n = 100000;
+    suite.add("coroutines/loop_pipeline_100k", [] {
+        std::vector<int> results;
+        for (int i = 1; i <= n; ++i) {
+            if (i % 2 == 0) results.push_back(i * i);
+        }
+        do_not_optimize(results.back());
+    }).items_per_iteration(n);
+    suite.add("coroutines/generator_pipeline_100k", [] {
+        auto source = numbers(1, n);
+        auto filtered = evens(source);
+        auto squared = squares(filtered);
+        std::vector<int> results;
+        for (int value : squared) results.push_back(value);
+        do_not_optimize(results.back());
+    }).items_per_iteration(n);
+}
+
+int main(int argc, char** argv) {
+    BenchmarkSuite suite;
+    add_data_layout(suite);
+    add_branch_prediction(suite);
+    add_memory_access(suite);
+    add_layout(suite);
+    add_matrix(suite);
+    add_particles(suite);
+    add_instrumentation(suite);
+    add_simd(suite);
+    add_sorting(suite);
+    add_parallel(suite);
+    add_logging(suite);
+    add_events(suite);
+    add_memory_pools(suite);
+    add_coroutines(suite);
+    return benchmark_main(argc, argv, suite);
+}
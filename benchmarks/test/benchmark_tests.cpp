@@ -0,0 +1,120 @@
+#include <cassert>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+
+// Statistics against hand-computed values, CSV round trips, and the
+// baseline verdicts; the runner only for calibration and filtering, since
+// its timings depend on the machine
+
+bool near(double a, double b, double tolerance = 1e-9) { return std::fabs(a - b) <= tolerance; }
+
+void test_summarize() {
+    // 1..9: mean 5, median 5, sample stddev sqrt(7.5)
+    [[maybe_unused]] BenchmarkStats s = summarize({9, 1, 8, 2, 7, 3, 6, 4, 5});
+    assert(s.samples == 9 && s.outliers == 0);
+    assert(near(s.mean, 5) && near(s.median, 5) && near(s.min, 1) && near(s.max, 9));
+    assert(near(s.stddev, std::sqrt(7.5)));
+    [[maybe_unused]] const double half = 2.306 * std::sqrt(7.5) / 3.0;
+    assert(near(s.ci_low, 5 - half) && near(s.ci_high, 5 + half));
+
+    // A preempted sample is dropped by the fences, the rest is untouched
+    [[maybe_unused]] BenchmarkStats noisy = summarize({10, 11, 10, 12, 11, 10, 11, 250});
+    assert(noisy.outliers == 1 && noisy.samples == 7);
+    assert(near(noisy.max, 12));
+    assert(noisy.mean < 12);
+
+    [[maybe_unused]] BenchmarkStats single = summarize({42});
+    assert(single.samples == 1 && near(single.ci_low, 42) && near(single.ci_high, 42));
+    assert(summarize({}).samples == 0);
+
+    assert(near(student_t_975(1), 12.706) && near(student_t_975(30), 2.042) && near(student_t_975(1000), 1.96));
+}
+
+BenchmarkResult result(const std::string& name, double median, double half_width) {
+    BenchmarkResult r;
+    r.name = name;
+    r.iterations = 1000;
+    r.ns.samples = 25;
+    r.ns.median = r.ns.mean = median;
+    r.ns.ci_low = median - half_width;
+    r.ns.ci_high = median + half_width;
+    r.ns.min = median - 2 * half_width;
+    r.ns.max = median + 2 * half_width;
+    r.bytes_per_iteration = 4096;
+    return r;
+}
+
+void test_csv_round_trip() {
+    std::vector<BenchmarkResult> results = {result("area/first", 12.5, 0.25), result("area/second", 3e6, 1e4)};
+    std::stringstream csv;
+    write_csv(csv, results);
+    std::vector<BenchmarkResult> back = read_csv(csv);
+    assert(back.size() == 2);
+    assert(back[0].name == "area/first" && back[0].iterations == 1000 && back[0].ns.samples == 25);
+    assert(near(back[0].ns.median, 12.5) && near(back[0].ns.ci_high, 12.75) && near(back[0].bytes_per_iteration, 4096));
+    assert(near(back[1].ns.median, 3e6, 1) && near(back[1].ns.ci_low, 2.99e6, 1));
+
+    std::ostringstream json;
+    write_json(json, results);
+    assert(json.str().find("\"name\": \"area/first\"") != std::string::npos);
+    assert(json.str().find("\"median_ns\": 12.5") != std::string::npos);
+    assert(near(results[0].gb_per_s(), 4096 / 12.5));
+}
+
+void test_baseline() {
+    std::vector<BenchmarkResult> baseline = {result("slower", 100, 1), result("noisy", 100, 20), result("faster", 100, 1),
+                                             result("same", 100, 1)};
+    std::vector<BenchmarkResult> current = {result("slower", 120, 1), result("noisy", 120, 20), result("faster", 80, 1),
+                                            result("same", 101, 1), result("added", 5, 0.1)};
+    std::vector<BaselineComparison> c = compare_to_baseline(current, baseline, 0.05);
+    assert(c.size() == 5);
+    assert(c[0].verdict == BaselineVerdict::Regression && near(c[0].change, 0.2));
+    // 20% slower, but the intervals overlap: not flagged
+    assert(c[1].verdict == BaselineVerdict::Unchanged);
+    assert(c[2].verdict == BaselineVerdict::Improvement);
+    assert(c[3].verdict == BaselineVerdict::Unchanged);
+    assert(c[4].verdict == BaselineVerdict::New);
+
+    std::ostringstream out;
+    print_comparison(out, c);
+    assert(out.str().find("REGRESSION") != std::string::npos);
+}
+
+void test_runner() {
+    BenchmarkSuite suite;
+    int calls = 0;
+    suite.add("counted/increment", [&] {
+        ++calls;
+        do_not_optimize(calls);
+    }).items_per_iteration(1);
+    suite.add("other/noop", [] {});
+
+    BenchmarkOptions options;
+    options.min_sample_ms = 1;
+    options.samples = 5;
+    options.warmup_ms = 1;
+    options.filter = "counted/";
+    std::vector<BenchmarkResult> results = run_benchmarks(suite, options);
+    assert(results.size() == 1 && results[0].name == "counted/increment");
+    // Calibration grew the batch until a sample took at least 1 ms
+    assert(results[0].iterations > 1000);
+    assert(calls >= static_cast<long long>(results[0].iterations * 5));
+    assert(results[0].ns.samples + results[0].ns.outliers == 5);
+    assert(results[0].ns.median > 0 && results[0].ns.min <= results[0].ns.median);
+    assert(results[0].items_per_iteration == 1);
+
+    std::ostringstream table;
+    print_results(table, results);
+    assert(table.str().find("counted/increment") != std::string::npos);
+}
+
+int main() {
+    test_summarize();
+    test_csv_round_trip();
+    test_baseline();
+    test_runner();
+    return 0;
+}
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cassert>
 #include <vector>
 #include "../thread_pool.h"
@@ -16,5 +17,14 @@ int main() {
         for (int i = 0; i < 20; ++i) results.push_back(pool.submit([i]{ return i; }));
         for (int i = 0; i < 20; ++i) assert(results[i].get() == i);
     }
+    {
+        // Work queued with post() is drained before the destructor returns
+        std::atomic<int> done{0};
+        {
+            ThreadPool pool(2);
+            for (int i = 0; i < 100; ++i) pool.post([&done]{ done.fetch_add(1); });
+        }
+        assert(done.load() == 100);
+    }
     return 0;
 }
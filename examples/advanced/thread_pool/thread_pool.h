@@ -22,7 +22,9 @@ public:
             stopping = true;
         }
         cv.notify_all();
-        // jthreads will stop via stop_token
+        // Workers drain the queue and exit; join them before the queue,
+        // mutex and condition variable they use are destroyed
+        for (auto& worker : workers) worker.join();
     }
 
     template<typename F, typename... Args>
@@ -30,14 +32,24 @@ public:
         using R = std::invoke_result_t<F, Args...>;
         auto task = std::make_shared<std::packaged_task<R()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
         std::future<R> res = task->get_future();
+        post([task]() { (*task)(); });
+        return res;
+    }
+
+    // Fire-and-forget variant of submit() for callers that track completion themselves
+    void post(std::function<void()> job) {
         {
             std::lock_guard<std::mutex> lk(m);
-            tasks.push([task]() { (*task)(); });
+            tasks.push(std::move(job));
         }
         cv.notify_one();
-        return res;
     }
 
+    size_t size() const { return workers.size(); }
+
+    // True when called from one of this pool's worker threads
+    bool on_worker_thread() const { return current_pool() == this; }
+
 private:
     std::vector<std::jthread> workers;
     std::queue<std::function<void()>> tasks;
@@ -45,13 +57,19 @@ private:
     std::condition_variable_any cv;
     bool stopping = false;
 
+    static const ThreadPool*& current_pool() {
+        thread_local const ThreadPool* pool = nullptr;
+        return pool;
+    }
+
     void worker_loop(std::stop_token st) {
-        while (!st.stop_requested()) {
+        current_pool() = this;
+        while (true) {
             std::function<void()> job;
             {
                 std::unique_lock<std::mutex> lk(m);
                 cv.wait(lk, [&]{ return stopping || !tasks.empty() || st.stop_requested(); });
-                if (tasks.empty()) continue;
+                if (tasks.empty()) return;
                 job = std::move(tasks.front()); tasks.pop();
             }
             if (job) job();
@@ -0,0 +1,487 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "parallel.h"
+
+// ===== INSERTION SORT =====
+//
+// The base case of every sort below: for a couple of dozen elements
+// nothing beats shifting each one left into place. It is stable, and the
+// unguarded variant drops the bounds check when the element just before
+// first is known to be no greater than anything in the range.
+
+template<typename T, typename Compare>
+void insertion_sort(T* first, T* last, Compare comp) {
+    if (first == last) return;
+    for (T* cur = first + 1; cur != last; ++cur) {
+        T* sift = cur;
+        T* sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (sift != first && comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+        }
+    }
+}
+
+template<typename T, typename Compare>
+void unguarded_insertion_sort(T* first, T* last, Compare comp) {
+    if (first == last) return;
+    for (T* cur = first + 1; cur != last; ++cur) {
+        T* sift = cur;
+        T* sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+        }
+    }
+}
+
+// ===== PATTERN-DEFEATING QUICKSORT =====
+//
+// pdqsort (Orson Peters): introsort with three additions that make it
+// O(n) on the inputs real data is full of and never worse than
+// O(n log n):
+//
+//   - A partition that did no swaps is retried as an insertion sort that
+//     gives up after 8 moves, so sorted and nearly sorted runs cost O(n).
+//   - A pivot equal to the element left of the range (so equal to
+//     everything it could be compared with) puts all equal keys on the
+//     left in one pass: few distinct keys cost O(n k).
+//   - A badly unbalanced partition swaps a few elements around to break
+//     the pattern that caused it; after log2(n) of them the range is
+//     heapsorted.
+//
+// For arithmetic keys with the standard comparators the partition is
+// BlockQuicksort's: comparisons fill a block of 64 offsets with
+// branch-free stores, then the misplaced elements are swapped in bulk.
+// That removes the branch mispredictions that dominate a random
+// partition. Not stable.
+
+inline constexpr std::ptrdiff_t pdq_insertion_threshold = 24;
+inline constexpr std::ptrdiff_t pdq_ninther_threshold = 128;
+inline constexpr std::size_t pdq_partial_insertion_limit = 8;
+inline constexpr std::size_t pdq_block = 64;
+
+// Insertion sort that gives up after pdq_partial_insertion_limit moves;
+// true if the range ended up sorted
+template<typename T, typename Compare>
+bool partial_insertion_sort(T* first, T* last, Compare comp) {
+    if (first == last) return true;
+    std::size_t moves = 0;
+    for (T* cur = first + 1; cur != last; ++cur) {
+        if (moves > pdq_partial_insertion_limit) return false;
+        T* sift = cur;
+        T* sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (sift != first && comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+            moves += static_cast<std::size_t>(cur - sift);
+        }
+    }
+    return true;
+}
+
+template<typename T, typename Compare>
+void sort3(T* a, T* b, T* c, Compare comp) {
+    if (comp(*b, *a)) std::iter_swap(a, b);
+    if (comp(*c, *b)) std::iter_swap(b, c);
+    if (comp(*b, *a)) std::iter_swap(a, b);
+}
+
+// Comparators whose result is a plain compare instruction, so evaluating
+// them for every element of a block costs less than one misprediction
+template<typename T, typename Compare>
+inline constexpr bool pdq_branchless =
+    std::is_arithmetic_v<T> && (std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<T>> ||
+                                std::is_same_v<Compare, std::greater<>> || std::is_same_v<Compare, std::greater<T>>);
+
+// Swaps first + offsets_l[i] with last - offsets_r[i]; when the blocks
+// differ in size a cyclic rotation moves each element once instead of twice
+template<typename T>
+void pdq_swap_offsets(T* first, T* last, const unsigned char* offsets_l, const unsigned char* offsets_r,
+                      std::size_t num, bool use_swaps) {
+    if (use_swaps) {
+        for (std::size_t i = 0; i < num; ++i) std::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+    } else if (num > 0) {
+        T* l = first + offsets_l[0];
+        T* r = last - offsets_r[0];
+        T tmp = std::move(*l);
+        *l = std::move(*r);
+        for (std::size_t i = 1; i < num; ++i) {
+            l = first + offsets_l[i];
+            *r = std::move(*l);
+            r = last - offsets_r[i];
+            *l = std::move(*r);
+        }
+        *r = std::move(tmp);
+    }
+}
+
+// Partitions [begin, end) around *begin into < pivot | pivot | >= pivot.
+// Returns the pivot's position and whether the range was already
+// partitioned. Needs an element >= pivot somewhere right of begin, which
+// the median-of-3 pivot choice guarantees.
+template<typename T, typename Compare>
+std::pair<T*, bool> pdq_partition_right(T* begin, T* end, Compare comp) {
+    T pivot = std::move(*begin);
+    T* first = begin;
+    T* last = end;
+
+    while (comp(*++first, pivot)) {}
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot)) {}
+    } else {
+        while (!comp(*--last, pivot)) {}
+    }
+    const bool already_partitioned = first >= last;
+
+    if constexpr (pdq_branchless<T, Compare>) {
+        if (!already_partitioned) {
+            std::iter_swap(first, last);
+            ++first;
+
+            alignas(64) unsigned char offsets_l_storage[pdq_block];
+            alignas(64) unsigned char offsets_r_storage[pdq_block];
+            unsigned char* offsets_l = offsets_l_storage;
+            unsigned char* offsets_r = offsets_r_storage;
+            T* offsets_l_base = first;
+            T* offsets_r_base = last;
+            std::size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+            while (first < last) {
+                // Refill whichever block is empty, from the unknown middle
+                const std::size_t unknown = static_cast<std::size_t>(last - first);
+                const std::size_t left_split = num_l == 0 ? (num_r == 0 ? unknown / 2 : unknown) : 0;
+                const std::size_t right_split = num_r == 0 ? unknown - left_split : 0;
+
+                // Every offset is stored; the count only advances past the
+                // ones on the wrong side
+                for (std::size_t i = 0, n = std::min(left_split, pdq_block); i < n; ++i) {
+                    offsets_l[num_l] = static_cast<unsigned char>(i);
+                    num_l += !comp(*first, pivot);
+                    ++first;
+                }
+                for (std::size_t i = 0, n = std::min(right_split, pdq_block); i < n;) {
+                    offsets_r[num_r] = static_cast<unsigned char>(++i);
+                    num_r += comp(*--last, pivot);
+                }
+
+                const std::size_t num = std::min(num_l, num_r);
+                pdq_swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r, num,
+                                 num_l == num_r);
+                num_l -= num;
+                num_r -= num;
+                start_l += num;
+                start_r += num;
+                if (num_l == 0) {
+                    start_l = 0;
+                    offsets_l_base = first;
+                }
+                if (num_r == 0) {
+                    start_r = 0;
+                    offsets_r_base = last;
+                }
+            }
+
+            // One block may still hold misplaced elements; move them to
+            // the boundary
+            if (num_l) {
+                offsets_l += start_l;
+                while (num_l--) std::iter_swap(offsets_l_base + offsets_l[num_l], --last);
+                first = last;
+            }
+            if (num_r) {
+                offsets_r += start_r;
+                while (num_r--) std::iter_swap(offsets_r_base - offsets_r[num_r], first++);
+                last = first;
+            }
+        }
+    } else {
+        while (first < last) {
+            std::iter_swap(first, last);
+            while (comp(*++first, pivot)) {}
+            while (!comp(*--last, pivot)) {}
+        }
+    }
+
+    T* pivot_pos = first - 1;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return {pivot_pos, already_partitioned};
+}
+
+// Partitions into <= pivot | > pivot, for a pivot equal to the element
+// before the range: everything on the left then equals the pivot and is
+// done
+template<typename T, typename Compare>
+T* pdq_partition_left(T* begin, T* end, Compare comp) {
+    T pivot = std::move(*begin);
+    T* first = begin;
+    T* last = end;
+
+    while (comp(pivot, *--last)) {}
+    if (last + 1 == end) {
+        while (first < last && !comp(pivot, *++first)) {}
+    } else {
+        while (!comp(pivot, *++first)) {}
+    }
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(pivot, *--last)) {}
+        while (!comp(pivot, *++first)) {}
+    }
+
+    T* pivot_pos = last;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return pivot_pos;
+}
+
+template<typename T, typename Compare>
+void pdqsort_loop(T* begin, T* end, Compare comp, int bad_allowed, bool leftmost) {
+    for (;;) {
+        const std::ptrdiff_t size = end - begin;
+        if (size < pdq_insertion_threshold) {
+            if (leftmost) {
+                insertion_sort(begin, end, comp);
+            } else {
+                unguarded_insertion_sort(begin, end, comp);
+            }
+            return;
+        }
+
+        // Pivot to *begin: median of 3, or Tukey's ninther for large ranges
+        const std::ptrdiff_t s2 = size / 2;
+        if (size > pdq_ninther_threshold) {
+            sort3(begin, begin + s2, end - 1, comp);
+            sort3(begin + 1, begin + (s2 - 1), end - 2, comp);
+            sort3(begin + 2, begin + (s2 + 1), end - 3, comp);
+            sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), comp);
+            std::iter_swap(begin, begin + s2);
+        } else {
+            sort3(begin + s2, begin, end - 1, comp);
+        }
+
+        // The pivot equals an element already placed to its left: take
+        // the whole run of equal keys out in one partition
+        if (!leftmost && !comp(begin[-1], *begin)) {
+            begin = pdq_partition_left(begin, end, comp) + 1;
+            continue;
+        }
+
+        auto [pivot_pos, already_partitioned] = pdq_partition_right(begin, end, comp);
+        const std::ptrdiff_t l_size = pivot_pos - begin;
+        const std::ptrdiff_t r_size = end - (pivot_pos + 1);
+
+        if (l_size < size / 8 || r_size < size / 8) {
+            if (--bad_allowed == 0) {
+                std::make_heap(begin, end, comp);
+                std::sort_heap(begin, end, comp);
+                return;
+            }
+            // Break the pattern with a few swaps on each side
+            if (l_size >= pdq_insertion_threshold) {
+                std::iter_swap(begin, begin + l_size / 4);
+                std::iter_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+                if (l_size > pdq_ninther_threshold) {
+                    std::iter_swap(begin + 1, begin + (l_size / 4 + 1));
+                    std::iter_swap(begin + 2, begin + (l_size / 4 + 2));
+                    std::iter_swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                    std::iter_swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= pdq_insertion_threshold) {
+                std::iter_swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                std::iter_swap(end - 1, end - r_size / 4);
+                if (r_size > pdq_ninther_threshold) {
+                    std::iter_swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                    std::iter_swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                    std::iter_swap(end - 2, end - (1 + r_size / 4));
+                    std::iter_swap(end - 3, end - (2 + r_size / 4));
+                }
+            }
+        } else if (already_partitioned && partial_insertion_sort(begin, pivot_pos, comp) &&
+                   partial_insertion_sort(pivot_pos + 1, end, comp)) {
+            return;
+        }
+
+        // Recurse into the left part, loop on the right one
+        pdqsort_loop(begin, pivot_pos, comp, bad_allowed, leftmost);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+template<typename T, typename Compare = std::less<>>
+void pdqsort(std::span<T> data, Compare comp = {}) {
+    if (data.size() < 2) return;
+    pdqsort_loop(data.data(), data.data() + data.size(), comp, static_cast<int>(std::bit_width(data.size())), true);
+}
+
+// ===== STABLE MERGE SORT =====
+//
+// Top-down merge sort, insertion sort below 24 elements. Only the left
+// half of a merge is moved out, into a buffer of n / 2 elements that the
+// caller owns, so sorting many arrays allocates once. Halves that are
+// already in order aren't merged at all, which makes sorted input O(n),
+// and elements already in place at either end of a merge stay put.
+
+inline constexpr std::ptrdiff_t merge_sort_insertion_threshold = 24;
+
+template<typename T, typename Compare>
+void merge_sort_range(T* first, T* last, T* buffer, Compare comp) {
+    const std::ptrdiff_t size = last - first;
+    if (size <= merge_sort_insertion_threshold) {
+        insertion_sort(first, last, comp);
+        return;
+    }
+    T* middle = first + size / 2;
+    merge_sort_range(first, middle, buffer, comp);
+    merge_sort_range(middle, last, buffer, comp);
+    if (!comp(*middle, middle[-1])) return;
+
+    // Elements already in their final place at either end aren't moved:
+    // the left prefix not greater than the first right element, and the
+    // right suffix not less than the last left element
+    first = std::upper_bound(first, middle, *middle, comp);
+    last = std::lower_bound(middle, last, middle[-1], comp);
+
+    T* left = buffer;
+    T* left_end = std::move(first, middle, buffer);
+    T* right = middle;
+    T* out = first;
+    // Ties take the left element, which keeps the sort stable. The branch
+    // is left in: on partly ordered input, where a stable sort usually
+    // runs, it predicts well, and a branch-free select would serialize
+    // every step on the previous load.
+    while (left < left_end && right < last) *out++ = comp(*right, *left) ? std::move(*right++) : std::move(*left++);
+    // Whatever is left of the right half is already in place
+    std::move(left, left_end, out);
+}
+
+template<typename T, typename Compare = std::less<>>
+void stable_merge_sort(std::span<T> data, std::vector<T>& buffer, Compare comp = {}) {
+    if (data.size() < 2) return;
+    if (buffer.size() < data.size() / 2) buffer.resize(data.size() / 2);
+    merge_sort_range(data.data(), data.data() + data.size(), buffer.data(), comp);
+}
+
+template<typename T, typename Compare = std::less<>>
+void stable_merge_sort(std::span<T> data, Compare comp = {}) {
+    std::vector<T> buffer;
+    stable_merge_sort(data, buffer, comp);
+}
+
+// ===== ADAPTIVE SORT =====
+//
+// Looks at the input before sorting it: the number of elements, the
+// fraction of descents among up to 256 sampled neighbour pairs, and for
+// integers the key range (one vectorizable min/max pass). Then:
+//
+//   tiny                          insertion sort
+//   no sampled descent            checked in full; O(n) if sorted
+//   every sampled pair descends   checked in full; reversed if so
+//   integers, range <= n          counting sort, O(n + range)
+//   >= 64K keys                   LSD radix sort (skips bytes all keys share)
+//   otherwise                     pdqsort
+//
+// Ascending order by operator<. Not stable.
+
+enum class SortAlgorithm { Insertion, AlreadySorted, Reverse, Counting, Radix, Pdq };
+
+inline const char* sort_algorithm_name(SortAlgorithm a) {
+    switch (a) {
+        case SortAlgorithm::Insertion: return "insertion sort";
+        case SortAlgorithm::AlreadySorted: return "already sorted";
+        case SortAlgorithm::Reverse: return "reverse";
+        case SortAlgorithm::Counting: return "counting sort";
+        case SortAlgorithm::Radix: return "radix sort";
+        default: return "pdqsort";
+    }
+}
+
+inline constexpr std::size_t adaptive_insertion_max = 32;
+inline constexpr std::size_t adaptive_radix_min = std::size_t(1) << 16;
+inline constexpr std::size_t adaptive_samples = 256;
+
+template<typename T>
+SortAlgorithm choose_sort_algorithm(std::span<const T> data) {
+    const std::size_t n = data.size();
+    if (n <= adaptive_insertion_max) return SortAlgorithm::Insertion;
+
+    std::size_t descents = 0, ascents = 0;
+    const std::size_t pairs = std::min(adaptive_samples, n - 1);
+    for (std::size_t s = 0; s < pairs; ++s) {
+        const std::size_t i = s * (n - 1) / pairs;
+        descents += data[i + 1] < data[i];
+        ascents += data[i] < data[i + 1];
+    }
+    if (descents == 0 && std::is_sorted(data.begin(), data.end())) return SortAlgorithm::AlreadySorted;
+    if (ascents == 0 && std::is_sorted(data.rbegin(), data.rend())) return SortAlgorithm::Reverse;
+
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+        auto [lo, hi] = std::minmax_element(data.begin(), data.end());
+        const auto range = static_cast<std::uint64_t>(std::make_unsigned_t<T>(*hi) - std::make_unsigned_t<T>(*lo));
+        if (range < n) return SortAlgorithm::Counting;
+    }
+    if constexpr (RadixSortable<T>) {
+        if (n >= adaptive_radix_min) return SortAlgorithm::Radix;
+    }
+    return SortAlgorithm::Pdq;
+}
+
+// Counting sort for integers whose range is small enough to count
+template<typename T>
+void counting_sort(std::span<T> data) {
+    static_assert(std::is_integral_v<T>, "counting_sort: integer keys");
+    if (data.size() < 2) return;
+    auto [lo_it, hi_it] = std::minmax_element(data.begin(), data.end());
+    const T lo = *lo_it;
+    const auto range = static_cast<std::size_t>(std::make_unsigned_t<T>(*hi_it) - std::make_unsigned_t<T>(lo));
+    std::vector<std::size_t> counts(range + 1);
+    for (T x : data) ++counts[static_cast<std::size_t>(std::make_unsigned_t<T>(x) - std::make_unsigned_t<T>(lo))];
+    T* out = data.data();
+    for (std::size_t k = 0; k <= range; ++k) {
+        out = std::fill_n(out, counts[k], static_cast<T>(std::make_unsigned_t<T>(lo) + k));
+    }
+}
+
+// Sorts data and returns the algorithm it picked
+template<typename T>
+SortAlgorithm adaptive_sort(ThreadPool& pool, std::span<T> data) {
+    const SortAlgorithm algorithm = choose_sort_algorithm(std::span<const T>(data));
+    switch (algorithm) {
+        case SortAlgorithm::Insertion: insertion_sort(data.data(), data.data() + data.size(), std::less<>()); break;
+        case SortAlgorithm::AlreadySorted: break;
+        case SortAlgorithm::Reverse: std::reverse(data.begin(), data.end()); break;
+        case SortAlgorithm::Counting:
+            if constexpr (std::is_integral_v<T>) counting_sort(data);
+            break;
+        case SortAlgorithm::Radix:
+            if constexpr (RadixSortable<T>) par_radix_sort(pool, data);
+            break;
+        case SortAlgorithm::Pdq: pdqsort(data); break;
+    }
+    return algorithm;
+}
+
+template<typename T>
+SortAlgorithm adaptive_sort(std::span<T> data) {
+    return adaptive_sort(default_pool(), data);
+}
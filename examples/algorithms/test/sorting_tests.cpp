@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "../sorting.h"
+
+// Every sort against std::sort / std::stable_sort on the input patterns
+// pdqsort and the adaptive selection special-case, at sizes around the
+// insertion-sort thresholds and the 64-element partition blocks
+
+std::vector<std::vector<int>> inputs(std::size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> random(n), sorted(n), reversed(n), nearly(n), few(n), organ(n), sawtooth(n), wide(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        random[i] = static_cast<int>(rng() % 1000000) - 500000;
+        sorted[i] = static_cast<int>(i);
+        reversed[i] = static_cast<int>(n - i);
+        few[i] = static_cast<int>(rng() % 4);
+        organ[i] = static_cast<int>(i < n / 2 ? i : n - i);
+        sawtooth[i] = static_cast<int>(i % 37);
+        wide[i] = static_cast<int>(rng());
+    }
+    nearly = sorted;
+    for (std::size_t k = 0; k < n / 100 + 1 && n > 1; ++k) std::swap(nearly[rng() % n], nearly[rng() % n]);
+    return {random, sorted, reversed, nearly, few, organ, sawtooth, wide};
+}
+
+void test_insertion_sort() {
+    for (std::size_t n : {0, 1, 2, 5, 24, 40}) {
+        for (auto input : inputs(n, 1)) {
+            std::vector<int> expected = input;
+            std::sort(expected.begin(), expected.end());
+            insertion_sort(input.data(), input.data() + input.size(), std::less<>());
+            assert(input == expected);
+        }
+    }
+}
+
+void test_pdqsort() {
+    for (std::size_t n : {0, 1, 2, 3, 23, 24, 25, 64, 129, 1000, 4097, 100000}) {
+        for (auto input : inputs(n, static_cast<unsigned>(n))) {
+            std::vector<int> expected = input, descending = input;
+            std::sort(expected.begin(), expected.end());
+            pdqsort(std::span<int>(input));
+            assert(input == expected);
+
+            // The generic (branchy) partition through a comparator lambda
+            pdqsort(std::span<int>(descending), [](int a, int b) { return a > b; });
+            assert(std::equal(descending.begin(), descending.end(), expected.rbegin()));
+        }
+    }
+
+    // Doubles use the block partition too; strings the branchy one
+    std::mt19937 rng(7);
+    std::vector<double> doubles(50000);
+    for (double& d : doubles) d = std::uniform_real_distribution<double>(-1, 1)(rng);
+    std::vector<double> expected = doubles;
+    std::sort(expected.begin(), expected.end());
+    pdqsort(std::span<double>(doubles), std::greater<>());
+    assert(std::equal(doubles.begin(), doubles.end(), expected.rbegin()));
+
+    std::vector<std::string> words(3000);
+    for (std::string& w : words) w = std::to_string(rng() % 500);
+    std::vector<std::string> sorted_words = words;
+    std::sort(sorted_words.begin(), sorted_words.end());
+    pdqsort(std::span<std::string>(words));
+    assert(words == sorted_words);
+}
+
+// Equal keys keep their order: sort (key, original index) pairs by key only
+void test_stable_merge_sort() {
+    std::vector<std::pair<int, int>> buffer;
+    for (std::size_t n : {0, 1, 2, 24, 25, 100, 1000, 50000}) {
+        for (const auto& keys : inputs(n, static_cast<unsigned>(n) + 3)) {
+            std::vector<std::pair<int, int>> items(n);
+            for (std::size_t i = 0; i < n; ++i) items[i] = {keys[i] % 16, static_cast<int>(i)};
+            std::vector<std::pair<int, int>> expected = items;
+            auto by_key = [](const auto& a, const auto& b) { return a.first < b.first; };
+            std::stable_sort(expected.begin(), expected.end(), by_key);
+            stable_merge_sort(std::span<std::pair<int, int>>(items), buffer, by_key);
+            assert(items == expected);
+        }
+    }
+    // The buffer grew once to half the largest input and was reused
+    assert(buffer.size() == 25000);
+
+    for (auto input : inputs(10000, 11)) {
+        std::vector<int> expected = input;
+        std::sort(expected.begin(), expected.end());
+        stable_merge_sort(std::span<int>(input));
+        assert(input == expected);
+    }
+}
+
+void test_adaptive_sort() {
+    ThreadPool pool(3);
+    const std::size_t n = 100000;
+    std::vector<std::vector<int>> all = inputs(n, 5);
+    // Nearly sorted is a permutation of 0..n-1, so its keys are dense
+    [[maybe_unused]] const SortAlgorithm picked[] = {
+        SortAlgorithm::Radix,    SortAlgorithm::AlreadySorted, SortAlgorithm::Reverse,  SortAlgorithm::Counting,
+        SortAlgorithm::Counting, SortAlgorithm::Counting,      SortAlgorithm::Counting, SortAlgorithm::Radix};
+    for (std::size_t k = 0; k < all.size(); ++k) {
+        std::vector<int> input = all[k], expected = all[k];
+        std::sort(expected.begin(), expected.end());
+        assert(choose_sort_algorithm(std::span<const int>(input)) == picked[k]);
+        [[maybe_unused]] const SortAlgorithm used = adaptive_sort(pool, std::span<int>(input));
+        assert(used == picked[k]);
+        assert(input == expected);
+    }
+
+    // Below the radix threshold the comparison sort is used
+    std::vector<int> small = inputs(5000, 6)[0], expected = small;
+    std::sort(expected.begin(), expected.end());
+    [[maybe_unused]] SortAlgorithm used = adaptive_sort(std::span<int>(small));
+    assert(used == SortAlgorithm::Pdq);
+    assert(small == expected);
+
+    std::vector<int> tiny = {3, 1, 2};
+    used = adaptive_sort(std::span<int>(tiny));
+    assert(used == SortAlgorithm::Insertion);
+    assert((tiny == std::vector<int>{1, 2, 3}));
+
+    // Extreme keys don't overflow the range computation
+    std::vector<std::int64_t> extremes(1000);
+    for (std::size_t i = 0; i < extremes.size(); ++i) extremes[i] = (i % 2 ? INT64_MAX : INT64_MIN) - std::int64_t(i % 2 ? i : -i);
+    std::vector<std::int64_t> sorted_extremes = extremes;
+    std::sort(sorted_extremes.begin(), sorted_extremes.end());
+    used = adaptive_sort(std::span<std::int64_t>(extremes));
+    assert(used == SortAlgorithm::Pdq);
+    assert(extremes == sorted_extremes);
+
+    std::vector<float> floats(n);
+    std::mt19937 rng(9);
+    for (float& f : floats) f = std::uniform_real_distribution<float>(-5, 5)(rng);
+    std::vector<float> sorted_floats = floats;
+    std::sort(sorted_floats.begin(), sorted_floats.end());
+    used = adaptive_sort(pool, std::span<float>(floats));
+    assert(used == SortAlgorithm::Radix);
+    assert(floats == sorted_floats);
+
+    std::vector<std::uint8_t> bytes(n);
+    for (std::uint8_t& b : bytes) b = static_cast<std::uint8_t>(rng());
+    used = adaptive_sort(pool, std::span<std::uint8_t>(bytes));
+    assert(used == SortAlgorithm::Counting);
+    assert(std::is_sorted(bytes.begin(), bytes.end()));
+}
+
+int main() {
+    test_insertion_sort();
+    test_pdqsort();
+    test_stable_merge_sort();
+    test_adaptive_sort();
+    return 0;
+}
@@ -0,0 +1,477 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "frame_pool.h"
+#include "thread_pool.h"
+
+// ===== EXECUTORS =====
+
+// Anything that can resume a suspended coroutine later
+class Executor {
+public:
+    virtual ~Executor() = default;
+    virtual void post(std::coroutine_handle<> handle) = 0;
+
+    // co_await executor.schedule() continues the coroutine on this executor
+    auto schedule() {
+        struct ScheduleAwaiter {
+            Executor& executor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { executor.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return ScheduleAwaiter{*this};
+    }
+};
+
+// Single-threaded run queue: run() resumes posted coroutines on the calling
+// thread until nothing is left. Other threads may post into it.
+class EventLoop : public Executor {
+public:
+    void post(std::coroutine_handle<> handle) override {
+        std::lock_guard<std::mutex> lk(m);
+        ready.push_back(handle);
+    }
+
+    void run() {
+        while (std::coroutine_handle<> handle = pop()) {
+            handle.resume();
+        }
+    }
+
+private:
+    std::mutex m;
+    std::deque<std::coroutine_handle<>> ready;
+
+    std::coroutine_handle<> pop() {
+        std::lock_guard<std::mutex> lk(m);
+        if (ready.empty()) return {};
+        std::coroutine_handle<> handle = ready.front();
+        ready.pop_front();
+        return handle;
+    }
+};
+
+// Resumes coroutines on ThreadPool workers
+class PoolExecutor : public Executor {
+public:
+    explicit PoolExecutor(ThreadPool& pool) : pool(pool) {}
+
+    void post(std::coroutine_handle<> handle) override {
+        pool.post([handle] { handle.resume(); });
+    }
+
+private:
+    ThreadPool& pool;
+};
+
+// ===== TASK =====
+
+template<typename T = void>
+class Task;
+
+// On completion control is transferred straight back to whoever awaited the task
+struct TaskFinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+        return h.promise().continuation;
+    }
+    void await_resume() const noexcept {}
+};
+
+// Shared part of Task promises: lazy start, symmetric transfer on completion
+struct TaskPromiseBase : PooledPromise {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr exception;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    TaskFinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    void return_value(T result) { value.emplace(std::move(result)); }
+
+    T result() {
+        if (exception) std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    void return_void() noexcept {}
+
+    void result() {
+        if (exception) std::rethrow_exception(exception);
+    }
+};
+
+// Lazily started coroutine producing a T. Nothing runs until it is awaited.
+template<typename T>
+class Task {
+public:
+    struct promise_type : TaskPromise<T> {
+        Task get_return_object() { return Task{handle_type::from_promise(*this)}; }
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+    using value_type = T;
+
+    Task() = default;
+    explicit Task(handle_type h) : handle(h) {}
+    Task(const Task&) = delete;
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task& operator=(Task other) noexcept {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    ~Task() { if (handle) handle.destroy(); }
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            handle_type handle;
+            bool await_ready() const noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().result(); }
+        };
+        return Awaiter{handle};
+    }
+
+private:
+    handle_type handle;
+};
+
+// Fire-and-forget coroutine whose frame frees itself when it finishes
+struct Detached {
+    struct promise_type : PooledPromise {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+template<typename T>
+Detached start_task(Task<T> task, std::promise<T>& done) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+            done.set_value();
+        } else {
+            done.set_value(co_await task);
+        }
+    } catch (...) {
+        done.set_exception(std::current_exception());
+    }
+}
+
+// Blocks the calling thread until `task` has finished. The task runs inline
+// until its first suspension and then wherever it schedules itself.
+template<typename T>
+T sync_wait(Task<T> task) {
+    std::promise<T> done;
+    std::future<T> result = done.get_future();
+    start_task(std::move(task), done);
+    return result.get();
+}
+
+// Runs `task` on `loop`, driving the loop on the calling thread until it is idle
+template<typename T>
+T sync_wait(Task<T> task, EventLoop& loop) {
+    std::promise<T> done;
+    std::future<T> result = done.get_future();
+    start_task(std::move(task), done);
+    loop.run();
+    if (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        throw std::logic_error("event loop went idle before the task finished");
+    }
+    return result.get();
+}
+
+// ===== WHEN_ALL / WHEN_ANY =====
+
+// Starts every task concurrently and resumes once all of them have finished.
+// Results come back in input order; the first exception is rethrown.
+template<typename T>
+Task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<Task<T>> tasks) {
+    struct State {
+        // One extra count for the awaiting coroutine, so that children which
+        // finish while they are still being started can't resume it early
+        std::atomic<std::size_t> pending;
+        std::coroutine_handle<> continuation;
+        std::vector<std::optional<std::conditional_t<std::is_void_v<T>, bool, T>>> results;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        void finish_one() {
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) continuation.resume();
+        }
+    };
+
+    struct Child {
+        static Detached run(Task<T> task, State& state, std::size_t index) {
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    co_await task;
+                    state.results[index].emplace(true);
+                } else {
+                    state.results[index].emplace(co_await task);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(state.error_mutex);
+                if (!state.error) state.error = std::current_exception();
+            }
+            state.finish_one();
+        }
+    };
+
+    struct JoinAwaiter {
+        State& state;
+        std::vector<Task<T>>& tasks;
+
+        bool await_ready() const noexcept { return tasks.empty(); }
+        bool await_suspend(std::coroutine_handle<> h) {
+            state.continuation = h;
+            for (std::size_t i = 0; i < tasks.size(); ++i) {
+                Child::run(std::move(tasks[i]), state, i);
+            }
+            return state.pending.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    State state{};
+    state.pending.store(tasks.size() + 1);
+    state.results.resize(tasks.size());
+    co_await JoinAwaiter{state, tasks};
+
+    if (state.error) std::rethrow_exception(state.error);
+    if constexpr (!std::is_void_v<T>) {
+        std::vector<T> results;
+        results.reserve(state.results.size());
+        for (auto& result : state.results) results.push_back(std::move(*result));
+        co_return results;
+    }
+}
+
+// Starts the tasks and resumes as soon as the first one finishes, with its
+// index (and value). Losing tasks keep running to completion in the
+// background and their results are discarded; tasks not yet started when a
+// winner is known are never started.
+template<typename T>
+Task<std::conditional_t<std::is_void_v<T>, std::size_t, std::pair<std::size_t, T>>>
+when_any(std::vector<Task<T>> tasks) {
+    if (tasks.empty()) {
+        throw std::invalid_argument("when_any needs at least one task");
+    }
+
+    struct State {
+        std::atomic<bool> decided{false};
+        // Released once by the winner and once by the awaiting coroutine
+        std::atomic<int> gate{2};
+        std::coroutine_handle<> continuation;
+        std::size_t index = 0;
+        std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> value;
+        std::exception_ptr error;
+
+        void open_gate() {
+            if (gate.fetch_sub(1, std::memory_order_acq_rel) == 1) continuation.resume();
+        }
+    };
+
+    struct Child {
+        static Detached run(Task<T> task, std::shared_ptr<State> state, std::size_t index) {
+            std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> value;
+            std::exception_ptr error;
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    co_await task;
+                    value.emplace(true);
+                } else {
+                    value.emplace(co_await task);
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (!state->decided.exchange(true, std::memory_order_acq_rel)) {
+                state->index = index;
+                state->value = std::move(value);
+                state->error = error;
+                state->open_gate();
+            }
+        }
+    };
+
+    // Holds only references: GCC 12 destroys non-trivial members of
+    // brace-initialized awaiter temporaries twice
+    struct RaceAwaiter {
+        const std::shared_ptr<State>& state;
+        std::vector<Task<T>>& tasks;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            state->continuation = h;
+            for (std::size_t i = 0; i < tasks.size() && !state->decided.load(std::memory_order_acquire); ++i) {
+                Child::run(std::move(tasks[i]), state, i);
+            }
+            return state->gate.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    auto state = std::make_shared<State>();
+    co_await RaceAwaiter{state, tasks};
+
+    if (state->error) std::rethrow_exception(state->error);
+    if constexpr (std::is_void_v<T>) {
+        co_return state->index;
+    } else {
+        co_return std::pair<std::size_t, T>{state->index, std::move(*state->value)};
+    }
+}
+
+// ===== CHANNEL =====
+
+// Bounded multi-producer/multi-consumer channel between coroutines.
+// `co_await ch.send(x)` suspends while the buffer is full and yields false
+// if the channel was closed; `co_await ch.recv()` suspends while it is empty
+// and yields std::nullopt once it is closed and drained. Suspended
+// coroutines are resumed through the channel's executor, never inline.
+template<typename T>
+class Channel {
+public:
+    Channel(std::size_t capacity, Executor& executor)
+        : capacity(capacity ? capacity : 1), executor(executor) {}
+
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    class SendAwaiter {
+    public:
+        SendAwaiter(Channel& channel, T value) : channel(channel), value(std::move(value)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            std::unique_lock<std::mutex> lk(channel.m);
+            if (channel.closed) {
+                return false;
+            }
+            if (!channel.receivers.empty()) {
+                RecvAwaiter* receiver = channel.receivers.front();
+                channel.receivers.pop_front();
+                receiver->value.emplace(std::move(value));
+                accepted = true;
+                lk.unlock();
+                channel.executor.post(receiver->handle);
+                return false;
+            }
+            if (channel.buffer.size() < channel.capacity) {
+                channel.buffer.push_back(std::move(value));
+                accepted = true;
+                return false;
+            }
+            handle = h;
+            channel.senders.push_back(this);
+            return true;
+        }
+
+        bool await_resume() const noexcept { return accepted; }
+
+    private:
+        friend class Channel;
+        Channel& channel;
+        T value;
+        std::coroutine_handle<> handle;
+        bool accepted = false;
+    };
+
+    class RecvAwaiter {
+    public:
+        explicit RecvAwaiter(Channel& channel) : channel(channel) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            std::unique_lock<std::mutex> lk(channel.m);
+            if (!channel.buffer.empty()) {
+                value.emplace(std::move(channel.buffer.front()));
+                channel.buffer.pop_front();
+                // A slot just opened up: move one waiting sender's value in
+                if (!channel.senders.empty()) {
+                    SendAwaiter* sender = channel.senders.front();
+                    channel.senders.pop_front();
+                    channel.buffer.push_back(std::move(sender->value));
+                    sender->accepted = true;
+                    lk.unlock();
+                    channel.executor.post(sender->handle);
+                }
+                return false;
+            }
+            if (channel.closed) {
+                return false;
+            }
+            handle = h;
+            channel.receivers.push_back(this);
+            return true;
+        }
+
+        std::optional<T> await_resume() { return std::move(value); }
+
+    private:
+        friend class Channel;
+        Channel& channel;
+        std::optional<T> value;
+        std::coroutine_handle<> handle;
+    };
+
+    SendAwaiter send(T value) { return SendAwaiter{*this, std::move(value)}; }
+    RecvAwaiter recv() { return RecvAwaiter{*this}; }
+
+    // Wakes every waiting receiver (with nullopt) and sender (with false).
+    // Values already buffered can still be received.
+    void close() {
+        std::deque<SendAwaiter*> waiting_senders;
+        std::deque<RecvAwaiter*> waiting_receivers;
+        {
+            std::lock_guard<std::mutex> lk(m);
+            closed = true;
+            waiting_senders.swap(senders);
+            waiting_receivers.swap(receivers);
+        }
+        for (SendAwaiter* sender : waiting_senders) executor.post(sender->handle);
+        for (RecvAwaiter* receiver : waiting_receivers) executor.post(receiver->handle);
+    }
+
+private:
+    std::size_t capacity;
+    Executor& executor;
+    std::mutex m;
+    std::deque<T> buffer;
+    std::deque<SendAwaiter*> senders;
+    std::deque<RecvAwaiter*> receivers;
+    bool closed = false;
+};
@@ -4,6 +4,13 @@
 #include <chrono>
 #include <future>
 #include <vector>
+#include <memory>
+#include <string>
+#include <ranges>
+#include <array>
+#include <span>
+#include "generator.h"
+#include "async.h"
 using namespace std;
 using namespace chrono_literals;
 
@@ -20,39 +27,8 @@ struct CoroutineTask {
     };
 };
 
-// Generator coroutine for yielding values
-template<typename T>
-struct Generator {
-    struct promise_type {
-        T current_value;
-        Generator get_return_object() { return Generator{handle_type::from_promise(*this)}; }
-        suspend_always initial_suspend() { return {}; }
-        suspend_always final_suspend() noexcept { return {}; }
-        suspend_always yield_value(T value) {
-            current_value = value;
-            return {};
-        }
-        void return_void() {}
-        void unhandled_exception() {}
-    };
-
-    using handle_type = coroutine_handle<promise_type>;
-
-    handle_type handle;
-
-    Generator(handle_type h) : handle(h) {}
-    ~Generator() { if (handle) handle.destroy(); }
-
-    bool next() {
-        if (!handle.done()) {
-            handle.resume();
-            return !handle.done();
-        }
-        return false;
-    }
-
-    T value() const { return handle.promise().current_value; }
-};
+// Generator<T> lives in generator.h: it yields by reference, supports
+// move-only types, models std::ranges::input_range and pools its frames.
 
 // ===== ASYNC TASK COROUTINE =====
 
@@ -96,6 +72,17 @@ Generator<int> even_numbers(int max) {
     }
 }
 
+// Same sequence, but with the frame carved from a caller-provided arena
+Generator<int> fibonacci_generator(FrameArena&, int count) {
+    int a = 0, b = 1;
+    for (int i = 0; i < count; ++i) {
+        co_yield a;
+        int temp = a;
+        a = b;
+        b = temp + b;
+    }
+}
+
 // ===== ASYNC OPERATIONS =====
 
 // Simulate async file I/O
@@ -103,6 +90,7 @@ AsyncTask async_file_operation() {
     cout << "Starting async file operation..." << endl;
     this_thread::sleep_for(100ms);
     cout << "File operation completed" << endl;
+    co_return;
 }
 
 // Simulate async network request
@@ -110,6 +98,7 @@ AsyncTask async_network_request() {
     cout << "Starting network request..." << endl;
     this_thread::sleep_for(200ms);
     cout << "Network request completed" << endl;
+    co_return;
 }
 
 // ===== COROUTINE WITH THREADING =====
@@ -165,6 +154,119 @@ Generator<int> square_numbers(Generator<int>& input) {
     }
 }
 
+// ===== CHANNEL PIPELINE =====
+
+// Same pipeline as above, but every stage is its own coroutine running
+// concurrently on an executor, connected by bounded channels (push-based)
+Task<> produce_numbers(Executor& executor, int start, int end, Channel<int>& out) {
+    co_await executor.schedule();
+    for (int i = start; i <= end; ++i) {
+        co_await out.send(i);
+    }
+    out.close();
+}
+
+Task<> filter_even_stage(Executor& executor, Channel<int>& in, Channel<int>& out) {
+    co_await executor.schedule();
+    while (auto value = co_await in.recv()) {
+        if (*value % 2 == 0) {
+            co_await out.send(*value);
+        }
+    }
+    out.close();
+}
+
+Task<> square_stage(Executor& executor, Channel<int>& in, Channel<long long>& out) {
+    co_await executor.schedule();
+    while (auto value = co_await in.recv()) {
+        co_await out.send(static_cast<long long>(*value) * *value);
+    }
+    out.close();
+}
+
+Task<> collect_stage(Executor& executor, Channel<long long>& in, vector<long long>& results) {
+    co_await executor.schedule();
+    while (auto value = co_await in.recv()) {
+        results.push_back(*value);
+    }
+}
+
+Task<vector<long long>> channel_pipeline(Executor& executor, int start, int end, size_t capacity) {
+    Channel<int> numbers(capacity, executor);
+    Channel<int> evens(capacity, executor);
+    Channel<long long> squares(capacity, executor);
+    vector<long long> results;
+
+    vector<Task<>> stages;
+    stages.push_back(produce_numbers(executor, start, end, numbers));
+    stages.push_back(filter_even_stage(executor, numbers, evens));
+    stages.push_back(square_stage(executor, evens, squares));
+    stages.push_back(collect_stage(executor, squares, results));
+    co_await when_all(std::move(stages));
+
+    co_return results;
+}
+
+// ===== WHEN_ALL / WHEN_ANY =====
+
+// Gives up the executor `hops` times before producing its value
+Task<int> value_after(Executor& executor, int value, int hops) {
+    for (int i = 0; i < hops; ++i) {
+        co_await executor.schedule();
+    }
+    co_return value;
+}
+
+Task<> gather_and_race(Executor& executor) {
+    vector<Task<int>> all;
+    all.push_back(value_after(executor, 10, 3));
+    all.push_back(value_after(executor, 20, 1));
+    all.push_back(value_after(executor, 30, 2));
+    vector<int> values = co_await when_all(std::move(all));
+    cout << "when_all results: ";
+    for (int v : values) {
+        cout << v << " ";
+    }
+    cout << endl;
+
+    vector<Task<int>> race;
+    race.push_back(value_after(executor, 1, 5));
+    race.push_back(value_after(executor, 2, 1));
+    race.push_back(value_after(executor, 3, 3));
+    auto [index, value] = co_await when_any(std::move(race));
+    cout << "when_any winner: task " << index << " with value " << value << endl;
+}
+
+// ===== ZERO-COPY GENERATORS =====
+
+// Yields a named local: the consumer reads it in place, nothing is copied
+Generator<string> long_lines(int count) {
+    string line;
+    for (int i = 0; i < count; ++i) {
+        line.assign(1024, static_cast<char>('a' + i % 26));
+        co_yield line;
+    }
+}
+
+// Move-only values are handed out by reference and can be moved from
+Generator<unique_ptr<int>> boxed_numbers(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield make_unique<int>(i);
+    }
+}
+
+// Fills a local buffer and yields it in one suspension per batch
+Generator<int> batched_numbers(int start, int end) {
+    array<int, 256> buffer;
+    while (start <= end) {
+        size_t n = 0;
+        while (n < buffer.size() && start <= end) {
+            buffer[n++] = start++;
+        }
+        co_yield Batch{span(buffer).first(n)};
+    }
+}
+
 // ===== DEMONSTRATION =====
 
 void demonstrate_basic_coroutines() {
@@ -228,18 +330,42 @@ void demonstrate_pipeline() {
 
     cout << "Processing pipeline: generate -> filter even -> square" << endl;
 
-    // Create pipeline
+    // Pull-based: each stage resumes the one before it on demand
     auto numbers = generate_numbers(1, 10);
     auto evens = filter_even(numbers);
     auto squares = square_numbers(evens);
 
-    cout << "Results: ";
+    cout << "Generator chain results: ";
     while (squares.next()) {
         cout << squares.value() << " ";
     }
+    cout << endl;
+
+    // Push-based: stages run concurrently and talk through channels
+    EventLoop loop;
+    cout << "Channel pipeline (event loop): ";
+    for (long long v : sync_wait(channel_pipeline(loop, 1, 10, 4), loop)) {
+        cout << v << " ";
+    }
+    cout << endl;
+
+    ThreadPool pool(4);
+    PoolExecutor executor(pool);
+    cout << "Channel pipeline (thread pool): ";
+    for (long long v : sync_wait(channel_pipeline(executor, 1, 10, 4))) {
+        cout << v << " ";
+    }
     cout << endl << endl;
 }
 
+void demonstrate_when_all_when_any() {
+    cout << "=== when_all / when_any ===\n" << endl;
+
+    EventLoop loop;
+    sync_wait(gather_and_race(loop), loop);
+    cout << endl;
+}
+
 void demonstrate_performance_comparison() {
     cout << "=== Performance Comparison ===\n" << endl;
 
@@ -279,8 +405,118 @@ void demonstrate_performance_comparison() {
     cout << "Time: " << duration_coroutine.count() << " microseconds" << endl;
     cout << "Results count: " << count << endl;
 
+    // Channel pipeline approach
+    auto time_channels = [&](const char* label, auto&& run) {
+        auto start = chrono::steady_clock::now();
+        size_t count = run().size();
+        auto end = chrono::steady_clock::now();
+        cout << "\n" << label << ":" << endl;
+        cout << "Time: " << chrono::duration_cast<chrono::microseconds>(end - start).count()
+             << " microseconds" << endl;
+        cout << "Results count: " << count << endl;
+    };
+
+    EventLoop loop;
+    time_channels("Channel pipeline on event loop", [&] {
+        return sync_wait(channel_pipeline(loop, 1, COUNT, 256), loop);
+    });
+
+    ThreadPool pool(max(2u, thread::hardware_concurrency()));
+    PoolExecutor executor(pool);
+    time_channels("Channel pipeline on thread pool", [&] {
+        return sync_wait(channel_pipeline(executor, 1, COUNT, 256));
+    });
+
     cout << "\nNote: Coroutines may be slower for simple operations due to overhead," << endl;
-    cout << "but they excel at complex async workflows and lazy evaluation." << endl << endl;
+    cout << "but they excel at complex async workflows and lazy evaluation." << endl;
+    cout << "Channels pay a lock and a reschedule per element; they win once the" << endl;
+    cout << "stages do real work or wait on I/O and can overlap." << endl << endl;
+}
+
+void demonstrate_zero_copy_generators() {
+    cout << "=== Zero-Copy Generators ===\n" << endl;
+
+    size_t total_chars = 0;
+    for (const string& line : long_lines(100)) {
+        total_chars += line.size();  // read in place, no string copy
+    }
+    cout << "Read " << total_chars << " characters from 100 yielded lines" << endl;
+
+    vector<unique_ptr<int>> boxes;
+    for (auto& box : boxed_numbers(5)) {
+        boxes.push_back(std::move(box));
+    }
+    cout << "Moved " << boxes.size() << " unique_ptrs out of a generator" << endl;
+
+    cout << "Even Fibonacci numbers squared (views::filter | views::transform): ";
+    for (int v : fibonacci_generator(15)
+                     | views::filter([](int n) { return n % 2 == 0; })
+                     | views::transform([](int n) { return n * n; })) {
+        cout << v << " ";
+    }
+    cout << endl;
+
+    const int COUNT = 10000000;
+    auto time_sum = [&](const char* label, Generator<int> gen) {
+        auto start = chrono::steady_clock::now();
+        long long sum = 0;
+        for (int v : gen) {
+            sum += v;
+        }
+        auto end = chrono::steady_clock::now();
+        double ns = chrono::duration<double, nano>(end - start).count() / COUNT;
+        cout << label << ": " << ns << " ns/element (sum " << sum << ")" << endl;
+    };
+
+    cout << endl;
+    time_sum("One resume per element", generate_numbers(1, COUNT));
+    time_sum("One resume per batch  ", batched_numbers(1, COUNT));
+    cout << endl;
+}
+
+void demonstrate_frame_allocation() {
+    cout << "=== Coroutine Frame Allocation ===\n" << endl;
+
+    const int GENERATORS = 200000;
+    const int BATCH = 256;
+
+    auto run = [&](const char* label, auto&& make_generator, auto&& after_batch) {
+        FramePool::reset_stats();
+        long long checksum = 0;
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < GENERATORS; ++i) {
+            auto gen = make_generator();
+            while (gen.next()) {
+                checksum += gen.value();
+            }
+            if (i % BATCH == BATCH - 1) {
+                after_batch();
+            }
+        }
+        auto end = chrono::steady_clock::now();
+
+        auto stats = FramePool::stats();
+        double ns = chrono::duration<double, nano>(end - start).count() / GENERATORS;
+        cout << label << ": " << ns << " ns/generator, "
+             << stats.heap_allocations << " heap, "
+             << stats.pool_allocations << " pooled, "
+             << stats.arena_allocations << " arena allocations"
+             << " (checksum " << checksum << ")" << endl;
+    };
+
+    FramePool::set_enabled(false);
+    run("Global heap ", [] { return fibonacci_generator(8); }, [] {});
+
+    FramePool::set_enabled(true);
+    run("Frame pool  ", [] { return fibonacci_generator(8); }, [] {});
+
+    // Every frame of a batch is gone before the arena is reset
+    FrameArena arena(64 * 1024);
+    run("Frame arena ", [&] { return fibonacci_generator(arena, 8); }, [&] { arena.reset(); });
+
+    cout << "\nPooled frames hit the heap only until each bucket is warm;" << endl;
+    cout << "arena frames never touch the heap at all." << endl << endl;
 }
 
 int main() {
@@ -291,13 +527,19 @@ int main() {
     demonstrate_async_operations();
     demonstrate_threading();
     demonstrate_pipeline();
+    demonstrate_when_all_when_any();
     demonstrate_performance_comparison();
+    demonstrate_frame_allocation();
+    demonstrate_zero_copy_generators();
 
     cout << "=== Coroutines Summary ===" << endl;
     cout << "• Coroutines enable cooperative multitasking" << endl;
     cout << "• Generators provide lazy evaluation of sequences" << endl;
     cout << "• Async operations can be written synchronously" << endl;
     cout << "• Pipelines enable functional-style data processing" << endl;
+    cout << "• Custom promise operator new removes per-frame heap allocations" << endl;
+    cout << "• Yielding by reference avoids copies; batching amortizes resumes" << endl;
+    cout << "• when_all/when_any and channels compose concurrent coroutines" << endl;
     cout << "• Best for I/O-bound operations and complex workflows" << endl;
 
     return 0;
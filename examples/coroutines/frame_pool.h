@@ -0,0 +1,161 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <numeric>
+
+// Monotonic arena that coroutine frames can be carved from. Pass it as the
+// first argument of a coroutine and the promise's operator new picks it up;
+// frames are released all at once with reset().
+class FrameArena {
+public:
+    static constexpr std::size_t ALIGNMENT = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    explicit FrameArena(std::size_t capacity)
+        : buffer(std::make_unique<std::byte[]>(capacity)), capacity(capacity) {}
+
+    void* allocate(std::size_t size) {
+        size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        if (offset + size > capacity) {
+            throw std::bad_alloc();
+        }
+        void* memory = buffer.get() + offset;
+        offset += size;
+        return memory;
+    }
+
+    void reset() { offset = 0; }
+    std::size_t used() const { return offset; }
+
+private:
+    std::unique_ptr<std::byte[]> buffer;
+    std::size_t capacity;
+    std::size_t offset = 0;
+};
+
+// Thread-local, size-bucketed free lists for coroutine frames. Frames are
+// rounded up to a multiple of GRANULARITY; anything larger than the last
+// bucket goes straight to the global heap. A frame returns to the free list
+// of the thread that frees it, which need not be the one that allocated it
+// (a Task resumed on a pool worker ends there), so each list keeps at most
+// MAX_CACHED_PER_BUCKET frames and hands the rest back to the heap.
+class FramePool {
+public:
+    static constexpr std::size_t GRANULARITY = 64;
+    static constexpr std::size_t BUCKET_COUNT = 16;  // frames up to 1 KiB are recycled
+    static constexpr std::size_t NO_BUCKET = BUCKET_COUNT;
+    static constexpr std::size_t MAX_CACHED_PER_BUCKET = 64;
+
+    struct Stats {
+        std::size_t heap_allocations = 0;
+        std::size_t pool_allocations = 0;
+        std::size_t arena_allocations = 0;
+    };
+
+    // Returns a block of at least `size` bytes and the bucket it belongs to
+    static void* allocate(std::size_t size, std::size_t& bucket) {
+        LocalState& state = local();
+        bucket = (size + GRANULARITY - 1) / GRANULARITY - 1;
+        if (!state.enabled || bucket >= BUCKET_COUNT) {
+            bucket = NO_BUCKET;
+            ++state.stats.heap_allocations;
+            return ::operator new(size);
+        }
+
+        if (FreeBlock* block = state.free_lists[bucket]) {
+            state.free_lists[bucket] = block->next;
+            --state.cached[bucket];
+            ++state.stats.pool_allocations;
+            return block;
+        }
+
+        ++state.stats.heap_allocations;
+        return ::operator new((bucket + 1) * GRANULARITY);
+    }
+
+    static void deallocate(void* memory, std::size_t bucket) noexcept {
+        if (bucket == NO_BUCKET) {
+            ::operator delete(memory);
+            return;
+        }
+        LocalState& state = local();
+        if (state.cached[bucket] == MAX_CACHED_PER_BUCKET) {
+            ::operator delete(memory);
+            return;
+        }
+        ++state.cached[bucket];
+        FreeBlock* block = static_cast<FreeBlock*>(memory);
+        block->next = state.free_lists[bucket];
+        state.free_lists[bucket] = block;
+    }
+
+    static void count_arena_allocation() { ++local().stats.arena_allocations; }
+    static void set_enabled(bool enabled) { local().enabled = enabled; }
+    static Stats stats() { return local().stats; }
+    static void reset_stats() { local().stats = {}; }
+    // Frames on the calling thread's free lists
+    static std::size_t cached_frames() {
+        const LocalState& state = local();
+        return std::accumulate(state.cached.begin(), state.cached.end(), std::size_t{0});
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct LocalState {
+        std::array<FreeBlock*, BUCKET_COUNT> free_lists{};
+        std::array<std::size_t, BUCKET_COUNT> cached{};
+        Stats stats;
+        bool enabled = true;
+
+        ~LocalState() {
+            for (FreeBlock* head : free_lists) {
+                while (head) {
+                    FreeBlock* next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+        }
+    };
+
+    static LocalState& local() {
+        thread_local LocalState state;
+        return state;
+    }
+};
+
+// Base for promise types: routes frame allocation through the arena when
+// one is the first coroutine argument, and through FramePool otherwise.
+// A small header in front of the frame remembers where it came from so
+// that operator delete can hand it back.
+struct PooledPromise {
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) FrameHeader {
+        FrameArena* arena;
+        std::size_t bucket;
+    };
+
+    static void* operator new(std::size_t size) {
+        std::size_t bucket;
+        void* memory = FramePool::allocate(size + sizeof(FrameHeader), bucket);
+        return new (memory) FrameHeader{nullptr, bucket} + 1;
+    }
+
+    template<typename... Args>
+    static void* operator new(std::size_t size, FrameArena& arena, const Args&...) {
+        void* memory = arena.allocate(size + sizeof(FrameHeader));
+        FramePool::count_arena_allocation();
+        return new (memory) FrameHeader{&arena, FramePool::NO_BUCKET} + 1;
+    }
+
+    static void operator delete(void* frame) noexcept {
+        FrameHeader* header = static_cast<FrameHeader*>(frame) - 1;
+        if (!header->arena) {
+            FramePool::deallocate(header, header->bucket);
+        }
+        // Arena frames are released by FrameArena::reset()
+    }
+};
@@ -0,0 +1,172 @@
+#pragma once
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "frame_pool.h"
+
+// Yield a whole span from a Generator<T> in one suspension. The consumer
+// walks the span before the coroutine is resumed again, so the resume cost
+// is paid once per batch instead of once per element.
+template<typename T>
+struct Batch {
+    std::span<T> elements;
+};
+
+template<typename T>
+Batch(std::span<T>) -> Batch<T>;
+
+// Lazy generator that never copies what it yields: the promise keeps a
+// pointer to the object named in `co_yield`, which stays alive in the
+// coroutine frame while it is suspended. Move-only types work, and the
+// generator models std::ranges::input_range so it composes with views.
+template<typename T>
+class Generator : public std::ranges::view_interface<Generator<T>> {
+public:
+    struct promise_type : PooledPromise {
+        T* current = nullptr;
+        T* last = nullptr;
+        std::exception_ptr exception;
+
+        Generator get_return_object() { return Generator{handle_type::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        std::suspend_always yield_value(T& value) noexcept {
+            current = std::addressof(value);
+            last = current + 1;
+            return {};
+        }
+
+        std::suspend_always yield_value(T&& value) noexcept {
+            current = std::addressof(value);
+            last = current + 1;
+            return {};
+        }
+
+        // A const lvalue cannot be handed out as T&, so it is copied into
+        // the awaiter, which lives in the frame across the suspension.
+        auto yield_value(const T& value) requires std::copy_constructible<T> {
+            struct CopyAwaiter {
+                T copy;
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(handle_type h) noexcept {
+                    h.promise().current = std::addressof(copy);
+                    h.promise().last = h.promise().current + 1;
+                }
+                void await_resume() const noexcept {}
+            };
+            return CopyAwaiter{value};
+        }
+
+        auto yield_value(Batch<T> batch) noexcept {
+            current = batch.elements.data();
+            last = current + batch.elements.size();
+            // An empty batch has nothing to hand out, so don't suspend
+            struct BatchAwaiter : std::suspend_always {
+                bool empty;
+                bool await_ready() const noexcept { return empty; }
+            };
+            return BatchAwaiter{{}, batch.elements.empty()};
+        }
+
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        // Don't allow co_await inside a generator
+        void await_transform() = delete;
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = std::remove_cv_t<T>;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(handle_type handle) : handle(handle) { load(); }
+
+        T& operator*() const { return *current; }
+        T* operator->() const { return current; }
+
+        // Batch elements are stepped through locally; the coroutine is only
+        // resumed once the batch is used up
+        iterator& operator++() {
+            if (++current == last) {
+                resume(handle);
+                load();
+            }
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) {
+            return it.handle.done();
+        }
+
+    private:
+        handle_type handle;
+        T* current = nullptr;
+        T* last = nullptr;
+
+        void load() {
+            current = handle.promise().current;
+            last = handle.promise().last;
+        }
+    };
+
+    Generator() = default;
+    explicit Generator(handle_type h) : handle(h) {}
+    Generator(const Generator&) = delete;
+    Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Generator& operator=(Generator other) noexcept {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    ~Generator() { if (handle) handle.destroy(); }
+
+    iterator begin() {
+        resume(handle);
+        return iterator{handle};
+    }
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+    // Pull-style interface: next() moves to the next element, value() reads it
+    bool next() {
+        if (handle.done()) {
+            return false;
+        }
+        advance(handle);
+        return !handle.done();
+    }
+
+    const T& value() const { return *handle.promise().current; }
+    T& value() { return *handle.promise().current; }
+
+private:
+    handle_type handle;
+
+    static void resume(handle_type handle) {
+        handle.resume();
+        if (handle.promise().exception) {
+            std::rethrow_exception(std::exchange(handle.promise().exception, {}));
+        }
+    }
+
+    // Steps through the current batch, resuming the coroutine once it is used up
+    static void advance(handle_type handle) {
+        promise_type& promise = handle.promise();
+        if (promise.current != promise.last && ++promise.current != promise.last) {
+            return;
+        }
+        resume(handle);
+    }
+};
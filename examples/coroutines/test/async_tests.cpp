@@ -0,0 +1,139 @@
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include "../async.h"
+
+Task<int> value_after(Executor& executor, int value, int hops) {
+    for (int i = 0; i < hops; ++i) co_await executor.schedule();
+    co_return value;
+}
+
+Task<int> fail_after(Executor& executor, int hops) {
+    for (int i = 0; i < hops; ++i) co_await executor.schedule();
+    throw std::runtime_error("failed");
+}
+
+Task<> produce(Executor& executor, Channel<int>& out, int count) {
+    co_await executor.schedule();
+    for (int i = 0; i < count; ++i) {
+        [[maybe_unused]] bool sent = co_await out.send(i);
+        assert(sent);
+    }
+    out.close();
+}
+
+Task<long long> consume(Executor& executor, Channel<int>& in) {
+    co_await executor.schedule();
+    long long sum = 0;
+    while (auto value = co_await in.recv()) sum += *value;
+    co_return sum;
+}
+
+Task<long long> fan_in(Executor& executor, int producers, int count) {
+    Channel<int> channel(8, executor);
+    std::vector<Task<>> senders;
+    for (int p = 0; p < producers; ++p) {
+        senders.push_back([](Executor& executor, Channel<int>& out, int count) -> Task<> {
+            co_await executor.schedule();
+            for (int i = 0; i < count; ++i) co_await out.send(i);
+        }(executor, channel, count));
+    }
+    auto close_when_done = [](std::vector<Task<>> senders, Channel<int>& channel) -> Task<> {
+        co_await when_all(std::move(senders));
+        channel.close();
+    };
+
+    std::vector<Task<>> work;
+    work.push_back(close_when_done(std::move(senders), channel));
+    long long sum = 0;
+    work.push_back([](Executor& executor, Channel<int>& in, long long& sum) -> Task<> {
+        sum = co_await consume(executor, in);
+    }(executor, channel, sum));
+    co_await when_all(std::move(work));
+    co_return sum;
+}
+
+int main() {
+    {
+        EventLoop loop;
+        std::vector<Task<int>> tasks;
+        tasks.push_back(value_after(loop, 1, 3));
+        tasks.push_back(value_after(loop, 2, 0));
+        tasks.push_back(value_after(loop, 3, 1));
+        auto values = sync_wait(when_all(std::move(tasks)), loop);
+        assert((values == std::vector<int>{1, 2, 3}));
+    }
+    {
+        EventLoop loop;
+        std::vector<Task<int>> tasks;
+        tasks.push_back(value_after(loop, 1, 1));
+        tasks.push_back(fail_after(loop, 2));
+        [[maybe_unused]] bool thrown = false;
+        try {
+            sync_wait(when_all(std::move(tasks)), loop);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    {
+        EventLoop loop;
+        std::vector<Task<int>> tasks;
+        tasks.push_back(value_after(loop, 1, 4));
+        tasks.push_back(value_after(loop, 2, 2));
+        tasks.push_back(value_after(loop, 3, 6));
+        [[maybe_unused]] auto [index, value] = sync_wait(when_any(std::move(tasks)), loop);
+        assert(index == 1 && value == 2);
+    }
+    {
+        EventLoop loop;
+        Channel<int> channel(4, loop);
+        long long sum = 0;
+        std::vector<Task<>> both;
+        both.push_back(produce(loop, channel, 1000));
+        both.push_back([](Executor& ex, Channel<int>& in, long long& sum) -> Task<> {
+            sum = co_await consume(ex, in);
+        }(loop, channel, sum));
+        sync_wait(when_all(std::move(both)), loop);
+        assert(sum == 999LL * 1000 / 2);
+    }
+    {
+        EventLoop loop;
+        Channel<int> channel(2, loop);
+        auto closed_send = [](Channel<int>& channel) -> Task<bool> {
+            channel.close();
+            co_return co_await channel.send(1);
+        };
+        [[maybe_unused]] const bool sent = sync_wait(closed_send(channel), loop);
+        assert(!sent);
+    }
+    {
+        EventLoop loop;
+        [[maybe_unused]] const long long sum = sync_wait(fan_in(loop, 4, 500), loop);
+        assert(sum == 4LL * (499LL * 500 / 2));
+    }
+    {
+        ThreadPool pool(4);
+        PoolExecutor executor(pool);
+        for (int round = 0; round < 20; ++round) {
+            [[maybe_unused]] const long long sum = sync_wait(fan_in(executor, 4, 2000));
+            assert(sum == 4LL * (1999LL * 2000 / 2));
+        }
+    }
+    {
+        // Frames allocated here and freed on the worker, where the tasks
+        // finish: the worker's free lists stay capped however many arrive
+        ThreadPool pool(1);
+        PoolExecutor executor(pool);
+        for (int round = 0; round < 10; ++round) {
+            std::vector<Task<int>> tasks;
+            for (int i = 0; i < 1000; ++i) tasks.push_back(value_after(executor, i, 1));
+            [[maybe_unused]] const auto values = sync_wait(when_all(std::move(tasks)));
+            assert(values.size() == 1000 && values[999] == 999);
+        }
+        [[maybe_unused]] const std::size_t cached = pool.submit([] { return FramePool::cached_frames(); }).get();
+        assert(cached > 0 && cached <= FramePool::MAX_CACHED_PER_BUCKET * FramePool::BUCKET_COUNT);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <cassert>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../generator.h"
+
+static_assert(std::ranges::input_range<Generator<int>>);
+static_assert(std::ranges::view<Generator<int>>);
+
+Generator<int> iota(int n) {
+    for (int i = 0; i < n; ++i) co_yield i;
+}
+
+Generator<std::string> names() {
+    std::string name = "first";
+    co_yield name;
+    const std::string constant = "second";
+    co_yield constant;
+    co_yield std::string("third");
+}
+
+Generator<std::unique_ptr<int>> boxes(int n) {
+    for (int i = 0; i < n; ++i) co_yield std::make_unique<int>(i);
+}
+
+Generator<int> batches() {
+    int first[] = {1, 2, 3};
+    co_yield Batch{std::span<int>(first)};
+    co_yield Batch{std::span<int>()};
+    co_yield 4;
+    int second[] = {5, 6};
+    co_yield Batch{std::span<int>(second)};
+}
+
+Generator<int> throws_after(int n) {
+    for (int i = 0; i < n; ++i) co_yield i;
+    throw std::runtime_error("done");
+}
+
+Generator<int> from_arena(FrameArena&, int n) {
+    for (int i = 0; i < n; ++i) co_yield i;
+}
+
+int main() {
+    {
+        std::vector<int> values;
+        for (int v : iota(5)) values.push_back(v);
+        assert((values == std::vector<int>{0, 1, 2, 3, 4}));
+    }
+    {
+        auto gen = iota(3);
+        int sum = 0;
+        while (gen.next()) sum += gen.value();
+        assert(sum == 3);
+        [[maybe_unused]] const bool more = gen.next();
+        assert(!more);
+    }
+    {
+        std::vector<std::string> values;
+        for (const std::string& s : names()) values.push_back(s);
+        assert((values == std::vector<std::string>{"first", "second", "third"}));
+    }
+    {
+        std::vector<std::unique_ptr<int>> values;
+        for (auto& box : boxes(3)) values.push_back(std::move(box));
+        assert(values.size() == 3 && *values[2] == 2);
+    }
+    {
+        std::vector<int> values;
+        for (int v : batches()) values.push_back(v);
+        assert((values == std::vector<int>{1, 2, 3, 4, 5, 6}));
+
+        auto gen = batches();
+        int count = 0;
+        while (gen.next()) ++count;
+        assert(count == 6);
+    }
+    {
+        std::vector<int> values;
+        for (int v : iota(10) | std::views::filter([](int v) { return v % 3 == 0; })
+                              | std::views::transform([](int v) { return v * 10; })) {
+            values.push_back(v);
+        }
+        assert((values == std::vector<int>{0, 30, 60, 90}));
+    }
+    {
+        [[maybe_unused]] bool thrown = false;
+        int seen = 0;
+        try {
+            for (int v : throws_after(2)) seen += v + 1;
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && seen == 3);
+    }
+    {
+        FramePool::reset_stats();
+        FrameArena arena(4096);
+        {
+            auto gen = from_arena(arena, 4);
+            int sum = 0;
+            for (int v : gen) sum += v;
+            assert(sum == 6);
+        }
+        assert(arena.used() > 0);
+        assert(FramePool::stats().arena_allocations == 1);
+        assert(FramePool::stats().heap_allocations == 0);
+    }
+    {
+        for (int i = 0; i < 2; ++i) {
+            FramePool::reset_stats();
+            for (int v : iota(1)) (void)v;
+        }
+        // The second generator reuses the first one's frame
+        assert(FramePool::stats().pool_allocations == 1);
+    }
+    return 0;
+}
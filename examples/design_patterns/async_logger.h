@@ -0,0 +1,497 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "log_format.h"
+
+// ===== SPSC LOG RING =====
+//
+// A byte ring with one producer (the logging thread) and one consumer (the
+// logger's writer thread). Records are variable length and may wrap around
+// the end. The producer and consumer positions only ever grow and live on
+// separate cache lines; each side keeps a cached copy of the other's
+// position and reloads it only when the cached one says the ring is full
+// (or empty), so a push normally touches no shared cache line except for
+// the release store that publishes it.
+
+class LogRing {
+public:
+    // capacity is rounded up to a power of two
+    LogRing(std::size_t capacity, std::uint32_t thread_index)
+        : capacity_(std::bit_ceil(std::max<std::size_t>(capacity, 64))), mask_(capacity_ - 1),
+          data_(std::make_unique<std::byte[]>(capacity_)), thread_index_(thread_index) {}
+
+    std::size_t capacity() const { return capacity_; }
+    std::uint32_t thread_index() const { return thread_index_; }
+
+    // ----- producer -----
+
+    // Start position of `bytes` free bytes, or false if the ring is full
+    bool try_reserve(std::size_t bytes, std::uint64_t& pos) {
+        pos = head_.load(std::memory_order_relaxed);
+        if (pos + bytes - cached_tail_ > capacity_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (pos + bytes - cached_tail_ > capacity_) return false;
+        }
+        return true;
+    }
+
+    // Where n bytes at pos can be written in place, or null if they wrap
+    std::byte* contiguous(std::uint64_t pos, std::size_t n) {
+        const std::size_t offset = pos & mask_;
+        return offset + n <= capacity_ ? data_.get() + offset : nullptr;
+    }
+
+    void write(std::uint64_t pos, const void* src, std::size_t n) {
+        const std::size_t offset = pos & mask_, first = std::min(n, capacity_ - offset);
+        std::memcpy(data_.get() + offset, src, first);
+        std::memcpy(data_.get(), static_cast<const std::byte*>(src) + first, n - first);
+    }
+
+    // Publishes everything written before end
+    void commit(std::uint64_t end) { head_.store(end, std::memory_order_release); }
+
+    void count_drop() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Called when the producing thread exits; the consumer drains what is
+    // left and then forgets the ring
+    void close() { closed_.store(true, std::memory_order_release); }
+
+    // ----- consumer -----
+
+    // Bytes published and not yet consumed, starting at read_position()
+    std::size_t readable() {
+        if (cached_head_ == consumer_tail_) cached_head_ = head_.load(std::memory_order_acquire);
+        return static_cast<std::size_t>(cached_head_ - consumer_tail_);
+    }
+    std::uint64_t read_position() const { return consumer_tail_; }
+
+    void read(std::uint64_t pos, void* dst, std::size_t n) const {
+        const std::size_t offset = pos & mask_, first = std::min(n, capacity_ - offset);
+        std::memcpy(dst, data_.get() + offset, first);
+        std::memcpy(static_cast<std::byte*>(dst) + first, data_.get(), n - first);
+    }
+
+    // Hands n consumed bytes back to the producer
+    void release(std::size_t n) {
+        consumer_tail_ += n;
+        tail_.store(consumer_tail_, std::memory_order_release);
+    }
+
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    const std::size_t capacity_, mask_;
+    std::unique_ptr<std::byte[]> data_;
+    const std::uint32_t thread_index_;
+
+    alignas(64) std::atomic<std::uint64_t> head_{0};
+    std::uint64_t cached_tail_ = 0;   // producer's view of tail_
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<bool> closed_{false};
+
+    alignas(64) std::atomic<std::uint64_t> tail_{0};
+    std::uint64_t cached_head_ = 0;   // consumer's view of head_
+    std::uint64_t consumer_tail_ = 0;
+};
+
+// ===== ASYNC LOGGER =====
+//
+// log() copies the record into the calling thread's ring and returns: no
+// lock, no system call, no formatting beyond a timestamp. One writer
+// thread polls the rings, formats each record as
+//
+//   2026-10-18 14:03:07.123456 [t2] message
+//
+// into a batch buffer and hands the batch to the file in one write() once
+// it is full or the rings run dry. Order is preserved per thread; lines
+// from different threads are interleaved as the writer finds them.
+//
+// A full ring either drops the record (counted in dropped()) or makes the
+// caller wait for the writer, depending on LogOverflow; a waiting caller
+// wakes the writer, which then drains without sleeping until no one waits.
+// Records longer than half a ring are truncated.
+//
+// log_deferred() (through LOG_DEFERRED) does not format at all: it stores
+// the call site's format id and the raw arguments, and the writer expands
+// them. With LogFileFormat::Binary the writer does not format either; it
+// copies the records to the file and decode_binary_log() (or the
+// log_decoder tool) turns them into the same lines later.
+
+enum class LogOverflow { Drop, Block };
+enum class LogFileFormat { Text, Binary };
+
+struct AsyncLoggerOptions {
+    std::size_t ring_bytes = 256 * 1024;   // per logging thread
+    std::size_t batch_bytes = 64 * 1024;   // target size of one write()
+    LogOverflow overflow = LogOverflow::Drop;
+    std::chrono::microseconds poll_interval{1000};   // writer's sleep when idle
+    LogFileFormat file_format = LogFileFormat::Text;
+};
+
+// Precedes every record in a ring; records are padded to 8 bytes
+struct LogRecordHeader {
+    std::uint32_t size;   // header + payload, without padding
+    LogRecordKind kind;
+    std::uint16_t reserved;
+    std::int64_t timestamp_ns;   // system_clock, since the epoch
+};
+
+inline constexpr std::size_t log_record_align = 8;
+
+class AsyncLogger {
+public:
+    explicit AsyncLogger(const std::string& path, AsyncLoggerOptions options = {})
+        : options_(options), id_(next_id()) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) throw std::runtime_error("AsyncLogger: cannot open " + path + ": " + std::strerror(errno));
+        if (options_.file_format == LogFileFormat::Binary) {
+            batch_.assign(binary_log_magic);
+            write_batch();
+        }
+        writer_ = std::thread([this] { writer_loop(); });
+    }
+
+    // Drains every ring, writes the rest and closes the file
+    ~AsyncLogger() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        writer_.join();
+        ::close(fd_);
+    }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // False if the record was dropped
+    bool log(std::string_view message) {
+        return push(LogRecordKind::Text, message.size(), [&](LogRing& ring, std::uint64_t pos) {
+            ring.write(pos, message.data(), std::min(message.size(), max_payload()));
+        });
+    }
+
+    // Stores the format id of a LOG_DEFERRED call site and the encoded
+    // arguments; strings are cut to fit the record. False if the record was
+    // dropped (or cannot fit even with every string empty).
+    template<typename... Args>
+    bool log_deferred(std::uint32_t format_id, const Args&... args) {
+        constexpr std::size_t fixed = sizeof format_id + (log_arg_fixed_size<Args> + ... + 0);
+        if (fixed > max_payload()) {
+            local_ring().count_drop();
+            return false;
+        }
+        const std::size_t budget = max_payload() - fixed;
+        [[maybe_unused]] std::size_t size_budget = budget;
+        const std::size_t size = sizeof format_id + (log_arg_size(args, size_budget) + ... + 0);
+        auto encode = [&](std::byte* out) {
+            [[maybe_unused]] std::size_t write_budget = budget;
+            std::memcpy(out, &format_id, sizeof format_id);
+            out += sizeof format_id;
+            (log_arg_write(out, args, write_budget), ...);
+        };
+        return push(LogRecordKind::Deferred, size, [&](LogRing& ring, std::uint64_t pos) {
+            if (std::byte* p = ring.contiguous(pos, size)) {
+                encode(p);
+            } else {
+                // Once per lap of the ring
+                std::vector<std::byte> wrapped(size);
+                encode(wrapped.data());
+                ring.write(pos, wrapped.data(), size);
+            }
+        });
+    }
+
+    // Returns once everything logged before the call is in the file
+    void flush() {
+        std::unique_lock<std::mutex> lk(m_);
+        const std::uint64_t ticket = ++flush_requested_;
+        cv_.notify_all();
+        done_cv_.wait(lk, [&] { return flush_completed_ >= ticket; });
+    }
+
+    // Records dropped because a ring was full, over every thread so far
+    std::uint64_t dropped() const {
+        std::lock_guard<std::mutex> lk(rings_m_);
+        std::uint64_t dropped = dropped_by_retired_;
+        for (const auto& ring : rings_) dropped += ring->dropped();
+        return dropped;
+    }
+
+    // Rings the calling thread holds for loggers that still exist (and for
+    // any destroyed since it last created a ring)
+    static std::size_t thread_ring_count() { return thread_rings().slots.size(); }
+
+    // Records written to the file
+    std::uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+    std::size_t max_payload() const {
+        return std::max<std::size_t>(options_.ring_bytes, 64) / 2 - sizeof(LogRecordHeader);
+    }
+
+    // Reserves a record of `payload` bytes in the calling thread's ring,
+    // lets fill(ring, payload_position) write the payload and publishes
+    // it; applies the overflow policy when the ring is full
+    template<typename Fill>
+    bool push(LogRecordKind kind, std::size_t payload, Fill&& fill) {
+        LogRing& ring = local_ring();
+        payload = std::min(payload, max_payload());
+        const auto size = static_cast<std::uint32_t>(sizeof(LogRecordHeader) + payload);
+        const std::size_t bytes = (size + log_record_align - 1) & ~(log_record_align - 1);
+        std::uint64_t pos;
+        if (!ring.try_reserve(bytes, pos)) {
+            if (options_.overflow == LogOverflow::Drop) {
+                ring.count_drop();
+                return false;
+            }
+            // Counted under m_, so the writer either sees it before it
+            // sleeps or is already asleep for the notify; it keeps draining
+            // without sleeping until the count is back to zero
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                ++producers_waiting_;
+            }
+            cv_.notify_one();
+            while (!ring.try_reserve(bytes, pos)) std::this_thread::yield();
+            std::lock_guard<std::mutex> lk(m_);
+            --producers_waiting_;
+        }
+        // Stamped once there is room, so a dropped record costs no clock read
+        const LogRecordHeader header{size, kind, 0, now_ns()};
+        ring.write(pos, &header, sizeof header);
+        fill(ring, pos + sizeof header);
+        ring.commit(pos + bytes);
+        return true;
+    }
+
+private:
+    static std::uint64_t next_id() {
+        static std::atomic<std::uint64_t> id{0};
+        return ++id;
+    }
+
+    static std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // A thread's rings, one slot per logger it has logged to. Loggers are
+    // told apart by id, never by address, so a new logger at a freed one's
+    // address gets fresh rings. A slot also watches its logger's token and
+    // is dropped, ring and all, once that logger is gone.
+    struct ThreadRingSlot {
+        std::uint64_t logger_id;
+        std::weak_ptr<const bool> alive;
+        std::shared_ptr<LogRing> ring;
+    };
+    struct ThreadRings {
+        std::vector<ThreadRingSlot> slots;
+        ~ThreadRings() {
+            for (ThreadRingSlot& s : slots) s.ring->close();
+        }
+    };
+
+    static ThreadRings& thread_rings() {
+        thread_local ThreadRings rings;
+        return rings;
+    }
+
+    // The calling thread's ring for this logger, created on first use;
+    // slots of destroyed loggers are pruned whenever one is added
+    LogRing& local_ring() {
+        ThreadRings& rings = thread_rings();
+        for (ThreadRingSlot& s : rings.slots) {
+            if (s.logger_id == id_) return *s.ring;
+        }
+        std::erase_if(rings.slots, [](const ThreadRingSlot& s) { return s.alive.expired(); });
+        std::shared_ptr<LogRing> ring;
+        {
+            std::lock_guard<std::mutex> lk(rings_m_);
+            ring = std::make_shared<LogRing>(options_.ring_bytes, next_thread_index_++);
+            rings_.push_back(ring);
+        }
+        rings.slots.push_back({id_, alive_, ring});
+        return *ring;
+    }
+
+    // Moves every published record of one ring into the batch; returns
+    // whether there was any
+    bool drain(LogRing& ring) {
+        std::size_t available = ring.readable();
+        if (available == 0) return false;
+        while (available >= sizeof(LogRecordHeader)) {
+            const std::uint64_t pos = ring.read_position();
+            LogRecordHeader header;
+            ring.read(pos, &header, sizeof header);
+            const std::size_t bytes = (header.size + log_record_align - 1) & ~(log_record_align - 1);
+            payload_.resize(header.size - sizeof header);
+            ring.read(pos + sizeof header, payload_.data(), payload_.size());
+            ring.release(bytes);
+            available -= bytes;
+
+            if (options_.file_format == LogFileFormat::Binary) {
+                append_binary(header, ring.thread_index());
+            } else {
+                prefix_.append(batch_, header.timestamp_ns, ring.thread_index());
+                format_log_record(header.kind, payload_, [this](std::uint32_t id) { return find_site(id); }, batch_);
+                batch_ += '\n';
+            }
+            ++batch_records_;
+            if (batch_.size() >= options_.batch_bytes) write_batch();
+        }
+        return true;
+    }
+
+    // The site of a deferred record's format id; sites registered since the
+    // last miss are fetched from the registry
+    const LogFormatSite* find_site(std::uint32_t id) {
+        if (id >= sites_.size()) LogFormatRegistry::update(sites_);
+        return id < sites_.size() ? sites_[id] : nullptr;
+    }
+
+    // The record as it is, preceded by its format the first time that
+    // format appears in this session
+    void append_binary(const LogRecordHeader& header, std::uint32_t thread) {
+        std::uint32_t id;
+        if (header.kind == LogRecordKind::Deferred && payload_.size() >= sizeof id) {
+            std::memcpy(&id, payload_.data(), sizeof id);
+            if (id >= site_written_.size()) site_written_.resize(id + 1, false);
+            const LogFormatSite* site = find_site(id);
+            if (site && !site_written_[id]) {
+                append_binary_format(batch_, id, *site);
+                site_written_[id] = true;
+            }
+        }
+        append_binary_record(batch_, header.kind, thread, header.timestamp_ns, payload_);
+    }
+
+    void write_batch() {
+        const char* p = batch_.data();
+        std::size_t left = batch_.size();
+        while (left > 0) {
+            const ssize_t n = ::write(fd_, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                // Nowhere to report it; the batch is lost
+                break;
+            }
+            p += n;
+            left -= static_cast<std::size_t>(n);
+        }
+        batch_.clear();
+        written_.fetch_add(batch_records_, std::memory_order_relaxed);
+        batch_records_ = 0;
+    }
+
+    void writer_loop() {
+        batch_.reserve(options_.batch_bytes * 2);
+        std::vector<std::shared_ptr<LogRing>> rings;
+        for (;;) {
+            std::uint64_t flush_ticket;
+            bool stopping;
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                flush_ticket = flush_requested_;
+                stopping = stopping_;
+            }
+
+            // Drain until a full pass finds nothing; rings whose thread has
+            // exited are dropped once they are empty
+            bool found;
+            do {
+                {
+                    std::lock_guard<std::mutex> lk(rings_m_);
+                    rings = rings_;
+                }
+                found = false;
+                for (const auto& ring : rings) {
+                    const bool closed = ring->closed();
+                    found |= drain(*ring);
+                    if (closed && ring->readable() == 0) retire(ring);
+                }
+            } while (found);
+            if (!batch_.empty()) write_batch();
+
+            std::unique_lock<std::mutex> lk(m_);
+            if (flush_ticket > flush_completed_) {
+                flush_completed_ = flush_ticket;
+                done_cv_.notify_all();
+            }
+            if (stopping) return;
+            cv_.wait_for(lk, options_.poll_interval,
+                         [&] { return stopping_ || flush_requested_ != flush_completed_ || producers_waiting_ > 0; });
+        }
+    }
+
+    void retire(const std::shared_ptr<LogRing>& ring) {
+        std::lock_guard<std::mutex> lk(rings_m_);
+        auto it = std::find(rings_.begin(), rings_.end(), ring);
+        if (it == rings_.end()) return;
+        dropped_by_retired_ += ring->dropped();
+        rings_.erase(it);
+    }
+
+    const AsyncLoggerOptions options_;
+    const std::uint64_t id_;
+    // Expires when the logger is destroyed, after the writer has stopped
+    const std::shared_ptr<const bool> alive_ = std::make_shared<const bool>(true);
+    int fd_ = -1;
+
+    mutable std::mutex rings_m_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    std::uint32_t next_thread_index_ = 0;
+    std::uint64_t dropped_by_retired_ = 0;
+
+    std::mutex m_;
+    std::condition_variable cv_, done_cv_;
+    bool stopping_ = false;
+    std::uint64_t flush_requested_ = 0, flush_completed_ = 0;
+    int producers_waiting_ = 0;   // blocked in push() on a full ring
+
+    // Writer thread only
+    std::string batch_;
+    std::size_t batch_records_ = 0;
+    std::vector<std::byte> payload_;
+    LogLinePrefix prefix_;
+    std::vector<const LogFormatSite*> sites_;
+    std::vector<bool> site_written_;
+    std::atomic<std::uint64_t> written_{0};
+
+    std::thread writer_;
+};
+
+// Logs through logger.log_deferred(): the format string is checked against
+// the argument count at compile time and registered on the call site's
+// first use, so later calls store only its id and the arguments.
+//
+//   LOG_DEFERRED(log, "request {} served in {} us", id, micros);
+#define LOG_DEFERRED(logger, format, ...)                                                                      \
+    [&](const auto&... log_args) {                                                                            \
+        static_assert(log_placeholder_count(format) == sizeof...(log_args), "LOG_DEFERRED: one {} per argument"); \
+        static const LogFormatSite log_site{format, __FILE__, __LINE__,                                       \
+                                            log_arg_types<std::remove_cvref_t<decltype(log_args)>...>};       \
+        static const std::uint32_t log_format_id = LogFormatRegistry::add(log_site);                          \
+        return (logger).log_deferred(log_format_id, log_args...);                                             \
+    }(__VA_ARGS__)
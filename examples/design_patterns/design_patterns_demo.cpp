@@ -5,40 +5,64 @@
 #include <functional>
 #include <unordered_map>
 #include <mutex>
+#include <thread>
+#include <fstream>
+#include <cstdio>
+#include <ctime>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <span>
+#include "simd_sort.h"
+#include "sorting.h"
+#include "async_logger.h"
+#include "event_bus.h"
 using namespace std;
 
 // ===== SINGLETON PATTERN =====
+// The instance is a function-local static, so C++ initialises it once and
+// thread-safely without a lock on every later getInstance(). log() copies
+// the line into the calling thread's ring and returns; a background thread
+// writes the lines to the file in batches (see async_logger.h).
 class Logger {
 private:
-    static Logger* instance;
-    static mutex mtx;
     string log_file;
+    AsyncLogger backend;
 
-    Logger() : log_file("application.log") {
+    Logger() : log_file("application.log"), backend(log_file) {
         cout << "Logger instance created" << endl;
     }
 
 public:
     static Logger* getInstance() {
-        lock_guard<mutex> lock(mtx);
-        if (instance == nullptr) {
-            instance = new Logger();
-        }
-        return instance;
+        static Logger instance;
+        return &instance;
+    }
+
+    void log(string_view message) {
+        backend.log(message);
+    }
+
+    // Target of LOG_DEFERRED: stores the call site's format id and the raw
+    // arguments; the writer thread formats them
+    template<typename... Args>
+    bool log_deferred(uint32_t formatId, const Args&... args) {
+        return backend.log_deferred(formatId, args...);
     }
 
-    void log(const string& message) {
-        cout << "[LOG] " << message << endl;
+    // Waits until everything logged so far is in the file
+    void flush() {
+        backend.flush();
     }
 
+    const string& file() const { return log_file; }
+
     // Prevent copying
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 };
 
-Logger* Logger::instance = nullptr;
-mutex Logger::mtx;
-
 // ===== FACTORY PATTERN =====
 class Shape {
 public:
@@ -82,94 +106,153 @@ public:
 };
 
 // ===== OBSERVER PATTERN =====
-class Observer {
-public:
-    virtual void update(const string& message) = 0;
-    virtual ~Observer() = default;
+// Observers subscribe to a typed event on an EventBus (see event_bus.h)
+// instead of deriving from an Observer interface and handing the subject
+// raw pointers. Handlers get the event by const reference and the headline
+// is a view of the publisher's string, so nothing is copied per subscriber;
+// the Subscription unsubscribes when the subscriber goes away.
+struct NewsPublished {
+    string_view headline;
 };
 
-class Subject {
+class NewsAgency {
 private:
-    vector<Observer*> observers;
+    EventBus<NewsPublished> bus;
 
 public:
-    void addObserver(Observer* observer) {
-        observers.push_back(observer);
-    }
+    EventBus<NewsPublished>& events() { return bus; }
 
-    void removeObserver(Observer* observer) {
-        observers.erase(remove(observers.begin(), observers.end(), observer), observers.end());
-    }
-
-    void notifyObservers(const string& message) {
-        for (Observer* observer : observers) {
-            observer->update(message);
-        }
-    }
-};
-
-class NewsAgency : public Subject {
-public:
     void publishNews(const string& news) {
         cout << "News Agency: Publishing - " << news << endl;
-        notifyObservers(news);
+        bus.publish(NewsPublished{news});
     }
 };
 
-class NewsSubscriber : public Observer {
+class NewsSubscriber {
 private:
     string name;
+    Subscription<NewsPublished> subscription;
 
 public:
     NewsSubscriber(const string& n) : name(n) {}
 
-    void update(const string& message) override {
-        cout << name << " received news: " << message << endl;
+    void follow(NewsAgency& agency) {
+        subscription = agency.events().subscribe<NewsPublished>([this](const NewsPublished& news) {
+            cout << name << " received news: " << news.headline << endl;
+        });
+    }
+
+    void unfollow() {
+        subscription.reset();
     }
+
+    // The handler points back at this object
+    NewsSubscriber(const NewsSubscriber&) = delete;
+    NewsSubscriber& operator=(const NewsSubscriber&) = delete;
 };
 
 // ===== STRATEGY PATTERN =====
 class SortingStrategy {
 public:
     virtual void sort(vector<int>& data) = 0;
+    virtual const char* name() const = 0;
     virtual ~SortingStrategy() = default;
 };
 
 class BubbleSort : public SortingStrategy {
 public:
+    const char* name() const override { return "Bubble Sort"; }
+
     void sort(vector<int>& data) override {
-        cout << "Using Bubble Sort" << endl;
-        // Simplified bubble sort implementation
-        for (size_t i = 0; i < data.size() - 1; ++i) {
-            for (size_t j = 0; j < data.size() - i - 1; ++j) {
+        // Each pass bubbles the largest remaining element to the end; a
+        // pass without swaps means the rest is sorted
+        for (size_t end = data.size(); end > 1; --end) {
+            bool swapped = false;
+            for (size_t j = 0; j + 1 < end; ++j) {
                 if (data[j] > data[j + 1]) {
                     swap(data[j], data[j + 1]);
+                    swapped = true;
                 }
             }
+            if (!swapped) break;
         }
     }
 };
 
 class QuickSort : public SortingStrategy {
 public:
-    void sort(vector<int>& data) override {
-        cout << "Using Quick Sort" << endl;
-        // Simplified quick sort implementation
-        if (data.size() <= 1) return;
+    const char* name() const override { return "Quick Sort"; }
 
-        int pivot = data[data.size() / 2];
-        vector<int> left, right;
+    void sort(vector<int>& data) override {
+        if (!data.empty()) quickSort(data.data(), data.data() + data.size() - 1);
+    }
 
-        for (size_t i = 0; i < data.size(); ++i) {
-            if (i != data.size() / 2) {
-                if (data[i] < pivot) left.push_back(data[i]);
-                else right.push_back(data[i]);
+private:
+    // Textbook in-place quicksort: Hoare partition around the middle
+    // element, recursing into the smaller side
+    static void quickSort(int* lo, int* hi) {
+        while (lo < hi) {
+            int pivot = lo[(hi - lo) / 2];
+            int* i = lo - 1;
+            int* j = hi + 1;
+            for (;;) {
+                do ++i; while (*i < pivot);
+                do --j; while (*j > pivot);
+                if (i >= j) break;
+                swap(*i, *j);
+            }
+            if (j - lo < hi - j) {
+                quickSort(lo, j);
+                lo = j + 1;
+            } else {
+                quickSort(j + 1, hi);
+                hi = j;
             }
         }
+    }
+};
+
+class PdqSort : public SortingStrategy {
+public:
+    const char* name() const override { return "Pattern-Defeating Quicksort"; }
+
+    // Block partitioning without branch mispredictions, O(n) on sorted
+    // runs and repeated keys (see sorting.h)
+    void sort(vector<int>& data) override { pdqsort(span<int>(data)); }
+};
+
+class MergeSort : public SortingStrategy {
+public:
+    const char* name() const override { return "Stable Merge Sort"; }
+
+    // The buffer is kept between calls, so only the first sort allocates
+    void sort(vector<int>& data) override { stable_merge_sort(span<int>(data), buffer); }
 
-        left.push_back(pivot);
-        left.insert(left.end(), right.begin(), right.end());
-        data = left;
+private:
+    vector<int> buffer;
+};
+
+class AdaptiveSort : public SortingStrategy {
+public:
+    const char* name() const override { return "Adaptive Sort"; }
+
+    // Samples size, order and key range, then picks the algorithm
+    void sort(vector<int>& data) override { last = adaptive_sort(span<int>(data)); }
+
+    SortAlgorithm lastChoice() const { return last; }
+
+private:
+    SortAlgorithm last = SortAlgorithm::Pdq;
+};
+
+class SimdHybridSort : public SortingStrategy {
+public:
+    const char* name() const override { return "SIMD Hybrid Sort"; }
+
+    void sort(vector<int>& data) override {
+        // Introsort; partitions of up to 64 elements go to AVX2 bitonic
+        // sorting networks instead of insertion sort (see simd_sort.h)
+        simd_hybrid_sort<int>(data);
     }
 };
 
@@ -187,6 +270,8 @@ public:
             strategy->sort(data);
         }
     }
+
+    const char* strategyName() const { return strategy ? strategy->name() : "none"; }
 };
 
 // ===== DECORATOR PATTERN =====
@@ -343,6 +428,112 @@ void demonstrateSingleton() {
 
     logger1->log("Application started");
     logger2->log("User logged in");
+    LOG_DEFERRED(*logger1, "Session {} opened for {}", 1042, "alice");
+    logger1->flush();
+    cout << "Logged 3 lines to " << logger1->file() << endl;
+
+    // ns per log() call with 1-8 threads logging at once, against the usual
+    // mutex around an ofstream with endl. Each side writes its own scratch
+    // file, removed afterwards.
+    cout << "\nns per log call under contention (" << thread::hardware_concurrency() << " hardware threads):" << endl;
+    cout << setw(9) << "threads" << setw(16) << "mutex + endl" << setw(16) << "async (drop)" << setw(10)
+         << "dropped" << setw(16) << "async (block)" << endl;
+    const int perThread = 50'000;
+    const string_view message = "request served: GET /api/v1/items status=200 bytes=5123";
+
+    auto timeThreads = [&](int threads, auto&& body) {
+        vector<thread> workers;
+        auto start = chrono::high_resolution_clock::now();
+        for (int t = 0; t < threads; ++t) workers.emplace_back(body);
+        for (auto& w : workers) w.join();
+        auto end = chrono::high_resolution_clock::now();
+        return chrono::duration<double, nano>(end - start).count() / (double(threads) * perThread);
+    };
+
+    for (int threads : {1, 2, 4, 8}) {
+        const char* syncPath = "application_sync_bench.log";
+        double syncNs;
+        {
+            ofstream out(syncPath);
+            mutex m;
+            syncNs = timeThreads(threads, [&] {
+                for (int i = 0; i < perThread; ++i) {
+                    lock_guard<mutex> lock(m);
+                    out << message << endl;
+                }
+            });
+        }
+        remove(syncPath);
+
+        const char* asyncPath = "application_async_bench.log";
+        double dropNs, blockNs;
+        uint64_t dropped;
+        {
+            AsyncLogger async(asyncPath);
+            dropNs = timeThreads(threads, [&] {
+                for (int i = 0; i < perThread; ++i) async.log(message);
+            });
+            dropped = async.dropped();
+        }
+        {
+            AsyncLogger async(asyncPath, {.overflow = LogOverflow::Block});
+            blockNs = timeThreads(threads, [&] {
+                for (int i = 0; i < perThread; ++i) async.log(message);
+            });
+        }
+        remove(asyncPath);
+
+        cout << setw(9) << threads << fixed << setprecision(1) << setw(16) << syncNs << setw(16) << dropNs
+             << setw(10) << dropped << setw(16) << blockNs << defaultfloat << endl;
+    }
+    // What the calling thread pays for one formatted line: building the
+    // string first and logging it, against LOG_DEFERRED storing the format
+    // id and the raw arguments. Counted in the caller's CPU time, with rings
+    // large enough that nothing waits or is dropped, so the writer's share
+    // of the core is left out.
+    cout << "\nCaller CPU ns per formatted line (1 thread, " << perThread << " lines):" << endl;
+    auto threadCpuNs = [] {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return double(ts.tv_sec) * 1e9 + double(ts.tv_nsec);
+    };
+    const string host = "edge-07.example.net";
+    const AsyncLoggerOptions roomy{.ring_bytes = 16 * 1024 * 1024};
+    auto timeCaller = [&](const char* name, const char* path, AsyncLoggerOptions options, auto&& logOne) {
+        AsyncLogger async(path, options);
+        logOne(async, 0);   // creates this thread's ring outside the timing
+        double ns;
+        {
+            double start = threadCpuNs();
+            for (int i = 0; i < perThread; ++i) logOne(async, i);
+            ns = (threadCpuNs() - start) / perThread;
+        }
+        async.flush();
+        ifstream file(path, ios::binary | ios::ate);
+        cout << "  " << left << setw(34) << name << right << fixed << setprecision(1) << setw(8) << ns << " ns"
+             << setw(12) << file.tellg() << " bytes in file" << defaultfloat << endl;
+        file.close();
+        remove(path);
+    };
+
+    timeCaller("log(to_string + concatenation)", "application_pre_bench.log", roomy, [&](AsyncLogger& log, int i) {
+        log.log("request " + to_string(i) + " served in " + to_string(i % 977) + " us from " + host +
+                " load " + to_string(0.5 + i % 10 * 0.125));
+    });
+    timeCaller("log(snprintf into a buffer)", "application_pre_bench.log", roomy, [&](AsyncLogger& log, int i) {
+        char line[128];
+        int n = snprintf(line, sizeof line, "request %d served in %d us from %s load %g", i, i % 977, host.c_str(),
+                         0.5 + i % 10 * 0.125);
+        log.log(string_view(line, size_t(n)));
+    });
+    timeCaller("LOG_DEFERRED, text file", "application_deferred_bench.log", roomy, [&](AsyncLogger& log, int i) {
+        LOG_DEFERRED(log, "request {} served in {} us from {} load {}", i, i % 977, host, 0.5 + i % 10 * 0.125);
+    });
+    AsyncLoggerOptions binary = roomy;
+    binary.file_format = LogFileFormat::Binary;
+    timeCaller("LOG_DEFERRED, binary file", "application_deferred_bench.blog", binary, [&](AsyncLogger& log, int i) {
+        LOG_DEFERRED(log, "request {} served in {} us from {} load {}", i, i % 977, host, 0.5 + i % 10 * 0.125);
+    });
 }
 
 void demonstrateFactory() {
@@ -365,15 +556,81 @@ void demonstrateObserver() {
     NewsSubscriber subscriber2("Bob");
     NewsSubscriber subscriber3("Charlie");
 
-    agency.addObserver(&subscriber1);
-    agency.addObserver(&subscriber2);
-    agency.addObserver(&subscriber3);
+    subscriber1.follow(agency);
+    subscriber2.follow(agency);
+    subscriber3.follow(agency);
 
     agency.publishNews("Breaking: C++ 23 Released!");
     agency.publishNews("Update: Design Patterns are Essential!");
 
-    agency.removeObserver(&subscriber2);
+    subscriber2.unfollow();
     agency.publishNews("Final: Stay tuned for more updates!");
+
+    // Publish throughput: the classic virtual update() over a vector of raw
+    // observer pointers, against the event bus on the calling thread and
+    // batched onto a thread pool. Every run makes about 2M handler calls.
+    struct PriceTick {
+        string_view symbol;
+        double price;
+    };
+    struct PriceObserver {
+        virtual void update(const PriceTick& tick) = 0;
+        virtual ~PriceObserver() = default;
+    };
+    // Same work as the bus handlers below
+    struct PriceSum : PriceObserver {
+        vector<double>& sums;
+        size_t index;
+        PriceSum(vector<double>& s, size_t i) : sums(s), index(i) {}
+        void update(const PriceTick& tick) override { sums[index] += tick.price; }
+    };
+
+    ThreadPool pool(max(1u, thread::hardware_concurrency()));
+    cout << "\nPublish throughput, million handler calls/s (" << pool.size() << " pool workers):" << endl;
+    cout << setw(12) << "subscribers" << setw(18) << "virtual update" << setw(14) << "bus publish" << setw(14)
+         << "bus async" << endl;
+    auto millionsPerSecond = [](size_t calls, auto start) {
+        auto end = chrono::high_resolution_clock::now();
+        return double(calls) / chrono::duration<double, micro>(end - start).count();
+    };
+
+    for (size_t subscribers : {1, 10, 100, 1000}) {
+        const size_t events = 2'000'000 / subscribers, calls = events * subscribers;
+        vector<double> sums(subscribers, 0.0);
+
+        vector<unique_ptr<PriceSum>> observers;
+        vector<PriceObserver*> raw;
+        for (size_t s = 0; s < subscribers; ++s) {
+            observers.push_back(make_unique<PriceSum>(sums, s));
+            raw.push_back(observers.back().get());
+        }
+        auto start = chrono::high_resolution_clock::now();
+        for (size_t e = 0; e < events; ++e) {
+            const PriceTick tick{"ACME", double(e)};
+            for (PriceObserver* observer : raw) observer->update(tick);
+        }
+        const double classic = millionsPerSecond(calls, start);
+
+        EventBus<PriceTick> bus(pool);
+        vector<Subscription<PriceTick>> subscriptions;
+        for (size_t s = 0; s < subscribers; ++s) {
+            subscriptions.push_back(bus.subscribe<PriceTick>([&sums, s](const PriceTick& tick) { sums[s] += tick.price; }));
+        }
+        start = chrono::high_resolution_clock::now();
+        for (size_t e = 0; e < events; ++e) bus.publish(PriceTick{"ACME", double(e)});
+        const double sync = millionsPerSecond(calls, start);
+
+        start = chrono::high_resolution_clock::now();
+        for (size_t e = 0; e < events; ++e) bus.publish_async(PriceTick{"ACME", double(e)});
+        bus.flush();
+        const double async = millionsPerSecond(calls, start);
+
+        // All three runs added the same prices
+        const double expected = 3 * double(events) * double(events - 1) / 2;
+        bool consistent = all_of(sums.begin(), sums.end(), [&](double sum) { return sum == expected; });
+        cout << setw(12) << subscribers << fixed << setprecision(1) << setw(18) << classic << setw(14) << sync
+             << setw(14) << async << (consistent ? "" : "  (mismatch!)") << defaultfloat << endl;
+    }
 }
 
 void demonstrateStrategy() {
@@ -386,21 +643,73 @@ void demonstrateStrategy() {
     for (int n : data) cout << n << " ";
     cout << endl;
 
-    // Use bubble sort
-    sorter.setStrategy(make_unique<BubbleSort>());
-    vector<int> bubble_data = data;
-    sorter.sort(bubble_data);
-    cout << "After bubble sort: ";
-    for (int n : bubble_data) cout << n << " ";
-    cout << endl;
+    auto makeStrategies = [] {
+        vector<unique_ptr<SortingStrategy>> strategies;
+        strategies.push_back(make_unique<BubbleSort>());
+        strategies.push_back(make_unique<QuickSort>());
+        strategies.push_back(make_unique<PdqSort>());
+        strategies.push_back(make_unique<MergeSort>());
+        strategies.push_back(make_unique<AdaptiveSort>());
+        strategies.push_back(make_unique<SimdHybridSort>());
+        return strategies;
+    };
+
+    // Every strategy sorts a copy through the same interface
+    for (auto& strategy : makeStrategies()) {
+        sorter.setStrategy(move(strategy));
+        vector<int> sorted = data;
+        sorter.sort(sorted);
+        cout << "After " << sorter.strategyName() << ": ";
+        for (int n : sorted) cout << n << " ";
+        cout << endl;
+    }
 
-    // Use quick sort
-    sorter.setStrategy(make_unique<QuickSort>());
-    vector<int> quick_data = data;
-    sorter.sort(quick_data);
-    cout << "After quick sort: ";
-    for (int n : quick_data) cout << n << " ";
-    cout << endl;
+    // The strategy is swappable, so each one can be benchmarked against
+    // std::sort on the input distributions that tell them apart
+    const int SIZE = 1000000;
+    mt19937 rng(42);
+    vector<int> random_input(SIZE), sorted_input(SIZE), reversed_input(SIZE), nearly_sorted_input(SIZE),
+        few_unique_input(SIZE), small_range_input(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        random_input[i] = static_cast<int>(rng());
+        sorted_input[i] = i;
+        reversed_input[i] = SIZE - i;
+        few_unique_input[i] = static_cast<int>(rng() % 8);
+        small_range_input[i] = static_cast<int>(rng() % 100000);
+    }
+    nearly_sorted_input = sorted_input;
+    for (int k = 0; k < SIZE / 100; ++k) swap(nearly_sorted_input[rng() % SIZE], nearly_sorted_input[rng() % SIZE]);
+
+    struct Input { const char* name; const vector<int>* values; };
+    const Input inputs[] = {{"random", &random_input},         {"sorted", &sorted_input},
+                            {"reversed", &reversed_input},     {"nearly sorted", &nearly_sorted_input},
+                            {"few unique", &few_unique_input}, {"small range", &small_range_input}};
+
+    cout << "\nSorting " << SIZE << " ints, microseconds (" << (simd_sort_uses_network() ? "AVX2 networks" : "insertion sort leaves")
+         << " in the SIMD hybrid):" << endl;
+    vector<unique_ptr<SortingStrategy>> strategies = makeStrategies();
+    cout << left << setw(15) << "input" << right << setw(11) << "std::sort";
+    for (const char* column : {"quick", "pdqsort", "merge", "adaptive", "simd hybrid"}) cout << setw(12) << column;
+    cout << "   adaptive choice" << endl;
+
+    for (const Input& input : inputs) {
+        vector<int> expected = *input.values;
+        auto start = chrono::steady_clock::now();
+        std::sort(expected.begin(), expected.end());
+        auto std_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        cout << left << setw(15) << input.name << right << setw(11) << std_us;
+
+        // Bubble sort is O(n^2): skipped at this size
+        for (size_t k = 1; k < strategies.size(); ++k) {
+            vector<int> values = *input.values;
+            start = chrono::steady_clock::now();
+            strategies[k]->sort(values);
+            auto us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+            cout << setw(12) << (values == expected ? to_string(us) : "MISMATCH");
+        }
+        const auto& adaptive = static_cast<const AdaptiveSort&>(*strategies[4]);
+        cout << "   " << sort_algorithm_name(adaptive.lastChoice()) << endl;
+    }
 }
 
 void demonstrateDecorator() {
@@ -460,9 +769,13 @@ int main() {
 
     cout << "\n=== Summary ===" << endl;
     cout << "• Singleton: Ensures single instance of a class" << endl;
+    cout << "• Async logging: per-thread lock-free rings, one writer thread batching write() calls" << endl;
+    cout << "• Deferred logging: call sites store a format id and raw arguments; formatting happens later" << endl;
     cout << "• Factory: Creates objects without specifying exact classes" << endl;
     cout << "• Observer: Notifies multiple objects of state changes" << endl;
+    cout << "• Event bus: typed events by reference, copy-on-write subscriber lists, batched async delivery" << endl;
     cout << "• Strategy: Encapsulates algorithms for interchangeable use" << endl;
+    cout << "• Sorting strategies: pdqsort, a buffered stable merge sort, and an adaptive pick by input shape" << endl;
     cout << "• Decorator: Adds functionality to objects dynamically" << endl;
     cout << "• Command: Encapsulates requests as objects" << endl;
     cout << "• Adapter: Allows incompatible interfaces to work together" << endl;
@@ -0,0 +1,329 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+// ===== EVENT CHANNEL =====
+//
+// The subscribers of one event type. The list is copy-on-write: publishers
+// load the current snapshot (an atomic shared_ptr) and call every handler
+// in it, with no lock; subscribe and unsubscribe build a new list under a
+// mutex of their own and swap it in, so they never hold up a publisher.
+//
+// Once unsubscribe() returns, the handler is not running and will not run
+// again: it sleeps until the publishers still walking the previous
+// snapshot have let it go (an RCU grace period). Two callers cannot wait
+// and skip the grace period, so the handler may still run for events
+// already being delivered:
+// - a handler, which could be waiting for its own thread's publish;
+// - a worker of the pool the channel delivers on, since the batch
+//   holding the old snapshot may be queued behind it on that pool.
+//
+// Handlers get each event by const reference. publish() delivers on the
+// calling thread, in subscription order. publish_async() moves the event
+// into a batch; one batch at a time is handed to the pool, split by
+// subscriber across its workers, and each subscriber gets the whole batch
+// in publish order.
+
+// Number of deliveries (of any event type) the calling thread is inside;
+// unsubscribe() skips the grace period when it is nonzero, since it could
+// end up waiting for itself
+inline int& event_delivery_depth() {
+    thread_local int depth = 0;
+    return depth;
+}
+
+template<typename E>
+class EventChannel {
+public:
+    using Handler = std::function<void(const E&)>;
+
+    EventChannel() : list_(std::make_shared<const Snapshot>()) {}
+
+    // Delivers everything published asynchronously before going away
+    ~EventChannel() {
+        std::unique_lock<std::mutex> lk(async_m_);
+        idle_cv_.wait(lk, [&] { return delivered_ >= queued_; });
+    }
+
+    EventChannel(const EventChannel&) = delete;
+    EventChannel& operator=(const EventChannel&) = delete;
+
+    std::uint64_t subscribe(Handler handler) {
+        std::lock_guard<std::mutex> lk(write_m_);
+        auto list = std::make_shared<Snapshot>();
+        list->entries = list_.load(std::memory_order_acquire)->entries;
+        const std::uint64_t id = ++last_id_;
+        list->entries.push_back({id, std::move(handler)});   // ids grow, so the list stays sorted
+        list_.store(std::move(list), std::memory_order_release);
+        return id;
+    }
+
+    // False if id is not subscribed (any more)
+    bool unsubscribe(std::uint64_t id) {
+        std::shared_ptr<const Snapshot> old;
+        {
+            std::lock_guard<std::mutex> lk(write_m_);
+            const auto current = list_.load(std::memory_order_acquire);
+            const List& entries = current->entries;
+            auto it = std::lower_bound(entries.begin(), entries.end(), id,
+                                       [](const Entry& e, std::uint64_t key) { return e.id < key; });
+            if (it == entries.end() || it->id != id) return false;
+            auto list = std::make_shared<Snapshot>();
+            list->entries.reserve(entries.size() - 1);
+            list->entries.insert(list->entries.end(), entries.begin(), it);
+            list->entries.insert(list->entries.end(), it + 1, entries.end());
+            old = list_.exchange(std::move(list), std::memory_order_acq_rel);
+        }
+        // Grace period: every publisher walking the old snapshot holds a
+        // reference to it, and whoever drops the last one wakes us. The
+        // flag is shared, so it outlives whichever side finishes first.
+        const ThreadPool* pool = pool_.load(std::memory_order_acquire);
+        if (event_delivery_depth() == 0 && !(pool && pool->on_worker_thread())) {
+            auto released = std::make_shared<std::atomic<bool>>(false);
+            // Only the thread that drops the last reference reads it, and
+            // that drop is ordered after this store
+            old->released = released;
+            old.reset();
+            released->wait(false, std::memory_order_acquire);
+        }
+        return true;
+    }
+
+    std::size_t subscriber_count() const { return list_.load(std::memory_order_acquire)->entries.size(); }
+
+    void publish(const E& event) const {
+        const auto list = list_.load(std::memory_order_acquire);
+        DeliveryScope scope;
+        for (const Entry& entry : list->entries) entry.handler(event);
+    }
+
+    template<typename Event>
+    void publish_async(ThreadPool& pool, Event&& event) {
+        if (pool.size() == 0) {
+            // No workers to hand the batch to
+            publish(event);
+            return;
+        }
+        pool_.store(&pool, std::memory_order_release);
+        std::unique_lock<std::mutex> lk(async_m_);
+        pending_.push_back(std::forward<Event>(event));
+        ++queued_;
+        if (!in_flight_) {
+            in_flight_ = true;
+            start_batch(pool, lk);
+        }
+    }
+
+    // Waits until every event published asynchronously so far has been
+    // delivered; rethrows the first exception a handler threw there
+    void flush() {
+        std::unique_lock<std::mutex> lk(async_m_);
+        const std::uint64_t target = queued_;
+        idle_cv_.wait(lk, [&] { return delivered_ >= target; });
+        if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+private:
+    struct Entry {
+        std::uint64_t id;
+        Handler handler;
+    };
+    using List = std::vector<Entry>;
+
+    // What publishers load; wakes a waiting unsubscribe() when the last
+    // reference goes
+    struct Snapshot {
+        List entries;
+        mutable std::shared_ptr<std::atomic<bool>> released;
+
+        ~Snapshot() {
+            if (released) {
+                released->store(true, std::memory_order_release);
+                released->notify_one();
+            }
+        }
+    };
+
+    struct DeliveryScope {
+        DeliveryScope() { ++event_delivery_depth(); }
+        ~DeliveryScope() { --event_delivery_depth(); }
+    };
+
+    struct Batch {
+        std::vector<E> events;
+        std::shared_ptr<const Snapshot> list;
+        std::atomic<std::size_t> jobs_left;
+    };
+
+    // Below this many subscribers per worker, splitting costs more than it saves
+    static constexpr std::size_t subscribers_per_job = 32;
+
+    // Takes the pending events as one batch and posts it; called with
+    // async_m_ held and in_flight_ set
+    void start_batch(ThreadPool& pool, std::unique_lock<std::mutex>& lk) {
+        auto batch = std::make_shared<Batch>();
+        batch->events.swap(pending_);
+        batch->list = list_.load(std::memory_order_acquire);
+        const std::size_t subscribers = batch->list->entries.size();
+        const std::size_t jobs =
+            std::clamp<std::size_t>((subscribers + subscribers_per_job - 1) / subscribers_per_job, 1, pool.size());
+        batch->jobs_left.store(jobs, std::memory_order_relaxed);
+        lk.unlock();
+        for (std::size_t j = 0; j < jobs; ++j) {
+            const std::size_t begin = subscribers * j / jobs, end = subscribers * (j + 1) / jobs;
+            pool.post([this, &pool, batch, begin, end] {
+                try {
+                    DeliveryScope scope;
+                    for (std::size_t s = begin; s < end; ++s) {
+                        const Handler& handler = batch->list->entries[s].handler;
+                        for (const E& event : batch->events) handler(event);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lk(async_m_);
+                    if (!error_) error_ = std::current_exception();
+                }
+                if (batch->jobs_left.fetch_sub(1, std::memory_order_acq_rel) == 1) finish_batch(pool, *batch);
+            });
+        }
+        lk.lock();
+    }
+
+    // Run by the batch's last job: starts the next batch or goes idle
+    void finish_batch(ThreadPool& pool, Batch& batch) {
+        // The snapshot is let go before anyone is told the batch is done
+        batch.list.reset();
+        std::unique_lock<std::mutex> lk(async_m_);
+        delivered_ += batch.events.size();
+        if (pending_.empty()) {
+            in_flight_ = false;
+        } else {
+            start_batch(pool, lk);
+        }
+        idle_cv_.notify_all();
+    }
+
+    std::mutex write_m_;
+    std::atomic<std::shared_ptr<const Snapshot>> list_;
+    std::uint64_t last_id_ = 0;
+
+    std::atomic<const ThreadPool*> pool_{nullptr};   // the pool of the latest publish_async()
+    std::mutex async_m_;
+    std::condition_variable idle_cv_;
+    std::vector<E> pending_;
+    bool in_flight_ = false;
+    std::uint64_t queued_ = 0, delivered_ = 0;
+    std::exception_ptr error_;
+};
+
+// ===== EVENT BUS =====
+//
+// One channel per event type, picked at compile time: publishing is a
+// tuple lookup and a snapshot load, with no map, no RTTI and no virtual
+// call besides the handlers themselves.
+//
+//   EventBus<OrderPlaced, PriceChanged> bus(pool);
+//   auto sub = bus.subscribe<PriceChanged>([](const PriceChanged& p) { ... });
+//   bus.publish(PriceChanged{"ACME", 12.5});        // on this thread
+//   bus.publish_async(PriceChanged{"ACME", 12.75});  // on the pool
+//
+// subscribe() returns a Subscription that unsubscribes when destroyed.
+
+template<typename E>
+class Subscription {
+public:
+    Subscription() = default;
+    Subscription(std::weak_ptr<EventChannel<E>> channel, std::uint64_t id) : channel_(std::move(channel)), id_(id) {}
+    ~Subscription() { reset(); }
+
+    Subscription(Subscription&& other) noexcept
+        : channel_(std::move(other.channel_)), id_(std::exchange(other.id_, 0)) {}
+    Subscription& operator=(Subscription&& other) noexcept {
+        if (this != &other) {
+            reset();
+            channel_ = std::move(other.channel_);
+            id_ = std::exchange(other.id_, 0);
+        }
+        return *this;
+    }
+
+    // Unsubscribes now; a no-op if already done or the bus is gone
+    void reset() {
+        if (id_ == 0) return;
+        if (auto channel = channel_.lock()) channel->unsubscribe(id_);
+        channel_.reset();
+        id_ = 0;
+    }
+
+    explicit operator bool() const { return id_ != 0; }
+
+private:
+    std::weak_ptr<EventChannel<E>> channel_;
+    std::uint64_t id_ = 0;
+};
+
+template<typename... Events>
+class EventBus {
+public:
+    // Without a pool, publish_async() delivers on the calling thread
+    EventBus() : EventBus(nullptr) {}
+    explicit EventBus(ThreadPool& pool) : EventBus(&pool) {}
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    template<typename E, typename F>
+    [[nodiscard]] Subscription<E> subscribe(F&& handler) {
+        auto& ch = std::get<std::shared_ptr<EventChannel<E>>>(channels_);
+        return Subscription<E>(ch, ch->subscribe(std::forward<F>(handler)));
+    }
+
+    template<typename E>
+    void publish(const E& event) const {
+        channel<E>().publish(event);
+    }
+
+    template<typename Event>
+    void publish_async(Event&& event) {
+        using E = std::remove_cvref_t<Event>;
+        if (pool_) {
+            channel<E>().publish_async(*pool_, std::forward<Event>(event));
+        } else {
+            channel<E>().publish(event);
+        }
+    }
+
+    // Waits for every asynchronous delivery so far, of every event type
+    void flush() {
+        (channel<Events>().flush(), ...);
+    }
+
+    template<typename E>
+    std::size_t subscriber_count() const {
+        return channel<E>().subscriber_count();
+    }
+
+private:
+    explicit EventBus(ThreadPool* pool) : pool_(pool), channels_(std::make_shared<EventChannel<Events>>()...) {}
+
+    template<typename E>
+    EventChannel<E>& channel() const {
+        static_assert((std::is_same_v<E, Events> || ...), "EventBus: event type not on this bus");
+        return *std::get<std::shared_ptr<EventChannel<E>>>(channels_);
+    }
+
+    ThreadPool* pool_;
+    std::tuple<std::shared_ptr<EventChannel<Events>>...> channels_;
+};
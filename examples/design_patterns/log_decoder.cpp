@@ -0,0 +1,29 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include "log_format.h"
+
+// Prints a binary log (AsyncLogger with LogFileFormat::Binary) as the text
+// lines a text-mode logger would have written
+//
+//   log_decoder application.blog > application.log
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <binary log file>" << std::endl;
+        return 1;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    try {
+        decode_binary_log(in, std::cout);
+    } catch (const std::runtime_error& e) {
+        std::cout.flush();
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,431 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// ===== LOG RECORD KINDS =====
+
+// How the bytes after a record's header are to be read
+enum class LogRecordKind : std::uint16_t {
+    Text = 0,       // the message itself
+    Deferred = 1,   // u32 format id, then the encoded arguments
+};
+
+// ===== LINE PREFIX =====
+//
+// "2026-10-18 14:03:07.123456 [t2] ". The date and time part is cached per
+// second and the rest written digit by digit; the async writer and the
+// binary log decoder share it, so both print the same lines.
+
+class LogLinePrefix {
+public:
+    void append(std::string& out, std::int64_t ns, std::uint32_t thread) {
+        const std::int64_t seconds = ns / 1'000'000'000;
+        if (seconds != second_) {
+            const std::time_t t = static_cast<std::time_t>(seconds);
+            std::tm tm;
+            localtime_r(&t, &tm);
+            std::strftime(date_, sizeof date_, "%Y-%m-%d %H:%M:%S", &tm);
+            second_ = seconds;
+        }
+        char prefix[48];
+        std::memcpy(prefix, date_, 19);
+        prefix[19] = '.';
+        std::uint32_t micros = static_cast<std::uint32_t>(ns % 1'000'000'000 / 1000);
+        for (int i = 25; i >= 20; --i, micros /= 10) prefix[i] = static_cast<char>('0' + micros % 10);
+        char* p = prefix + 26;
+        *p++ = ' ';
+        *p++ = '[';
+        *p++ = 't';
+        p = std::to_chars(p, prefix + sizeof prefix, thread).ptr;
+        *p++ = ']';
+        *p++ = ' ';
+        out.append(prefix, static_cast<std::size_t>(p - prefix));
+    }
+
+private:
+    std::int64_t second_ = -1;
+    char date_[32] = {};
+};
+
+// ===== DEFERRED FORMATTING =====
+//
+// A deferred record carries no text: only the id of its call site's format
+// descriptor and the raw bytes of the arguments. The format string is
+// expanded later, on the logger's writer thread or offline by the decoder.
+// Placeholders are "{}", one per argument; "{{" and "}}" are literal braces.
+//
+// Arguments are encoded by kind, not by exact type: every signed integer
+// as 8 bytes, every unsigned one as 8 bytes, floating point as a double,
+// strings as a u32 length and the bytes (copied, so the caller's buffer
+// may go away right after the call).
+
+enum class LogArgType : std::uint8_t { Int, UInt, Double, Bool, Char, String };
+
+template<typename T>
+consteval LogArgType log_arg_type() {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool>) return LogArgType::Bool;
+    else if constexpr (std::is_same_v<U, char>) return LogArgType::Char;
+    else if constexpr (std::is_enum_v<U>) return log_arg_type<std::underlying_type_t<U>>();
+    else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) return LogArgType::Int;
+    else if constexpr (std::is_integral_v<U>) return LogArgType::UInt;
+    else if constexpr (std::is_floating_point_v<U>) return LogArgType::Double;
+    else if constexpr (std::is_convertible_v<const U&, std::string_view>) return LogArgType::String;
+    else static_assert(!sizeof(U), "deferred log arguments are integers, floats, bool, char and strings");
+}
+
+template<typename... Args>
+inline constexpr std::array<LogArgType, sizeof...(Args)> log_arg_types{log_arg_type<Args>()...};
+
+// Number of "{}" in a format string
+consteval std::size_t log_placeholder_count(std::string_view format) {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < format.size(); ++i) {
+        if (format[i] == '{' && i + 1 < format.size() && format[i + 1] == '{') ++i;
+        else if (format[i] == '}' && i + 1 < format.size() && format[i + 1] == '}') ++i;
+        else if (format[i] == '{' && i + 1 < format.size() && format[i + 1] == '}') ++count, ++i;
+    }
+    return count;
+}
+
+// One per call site; lives in static storage
+struct LogFormatSite {
+    std::string_view format;
+    std::string_view file;
+    std::uint32_t line;
+    std::span<const LogArgType> args;
+};
+
+// Append-only table of call sites, shared by every logger in the process.
+// A site registers once, on its first call, and is known by its index
+// from then on.
+class LogFormatRegistry {
+public:
+    static std::uint32_t add(const LogFormatSite& site) {
+        std::lock_guard<std::mutex> lk(mutex());
+        sites().push_back(&site);
+        return static_cast<std::uint32_t>(sites().size() - 1);
+    }
+
+    // Appends the sites registered after the first cache.size() to cache
+    static void update(std::vector<const LogFormatSite*>& cache) {
+        std::lock_guard<std::mutex> lk(mutex());
+        cache.insert(cache.end(), sites().begin() + static_cast<std::ptrdiff_t>(cache.size()), sites().end());
+    }
+
+private:
+    static std::mutex& mutex() {
+        static std::mutex m;
+        return m;
+    }
+    static std::vector<const LogFormatSite*>& sites() {
+        static std::vector<const LogFormatSite*> s;
+        return s;
+    }
+};
+
+// ----- encoding, on the logging thread -----
+
+template<typename T>
+inline constexpr std::size_t log_arg_fixed_size = [] {
+    switch (log_arg_type<T>()) {
+        case LogArgType::Bool:
+        case LogArgType::Char: return std::size_t{1};
+        case LogArgType::String: return sizeof(std::uint32_t);
+        default: return std::size_t{8};
+    }
+}();
+
+template<typename T>
+std::string_view log_arg_string(const T& value) {
+    if constexpr (std::is_convertible_v<const T&, const char*>) {
+        const char* s = value;
+        return s ? std::string_view(s) : std::string_view();
+    } else {
+        return std::string_view(value);
+    }
+}
+
+// Encoded size of one argument. Strings share what is left of budget and
+// are cut to fit; writing with a fresh copy of the same budget cuts them
+// the same way.
+template<typename T>
+std::size_t log_arg_size(const T& value, std::size_t& budget) {
+    if constexpr (log_arg_type<T>() == LogArgType::String) {
+        const std::size_t n = std::min(log_arg_string(value).size(), budget);
+        budget -= n;
+        return sizeof(std::uint32_t) + n;
+    } else {
+        return log_arg_fixed_size<T>;
+    }
+}
+
+template<typename T>
+void log_arg_write(std::byte*& out, const T& value, std::size_t& budget) {
+    constexpr LogArgType type = log_arg_type<T>();
+    auto put = [&](const auto& v) {
+        std::memcpy(out, &v, sizeof v);
+        out += sizeof v;
+    };
+    if constexpr (type == LogArgType::String) {
+        const std::string_view s = log_arg_string(value);
+        const auto n = static_cast<std::uint32_t>(std::min(s.size(), budget));
+        budget -= n;
+        put(n);
+        if (n > 0) std::memcpy(out, s.data(), n);
+        out += n;
+    } else if constexpr (type == LogArgType::Int) {
+        put(static_cast<std::int64_t>(value));
+    } else if constexpr (type == LogArgType::UInt) {
+        put(static_cast<std::uint64_t>(value));
+    } else if constexpr (type == LogArgType::Double) {
+        put(static_cast<double>(value));
+    } else {
+        put(static_cast<std::uint8_t>(value));
+    }
+}
+
+// ----- formatting, on the writer thread or in the decoder -----
+
+// Expands site.format with the encoded arguments; false if args is not a
+// valid encoding for the site's argument types
+inline bool format_deferred(const LogFormatSite& site, std::span<const std::byte> args, std::string& out) {
+    std::size_t at = 0, next_arg = 0;
+    auto take = [&](auto& v) {
+        if (args.size() - at < sizeof v) return false;
+        std::memcpy(&v, args.data() + at, sizeof v);
+        at += sizeof v;
+        return true;
+    };
+    auto append_arg = [&](LogArgType type) {
+        char buf[32];
+        switch (type) {
+            case LogArgType::Int: {
+                std::int64_t v;
+                if (!take(v)) return false;
+                out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+                return true;
+            }
+            case LogArgType::UInt: {
+                std::uint64_t v;
+                if (!take(v)) return false;
+                out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+                return true;
+            }
+            case LogArgType::Double: {
+                double v;
+                if (!take(v)) return false;
+                out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+                return true;
+            }
+            case LogArgType::Bool: {
+                std::uint8_t v;
+                if (!take(v)) return false;
+                out += v ? "true" : "false";
+                return true;
+            }
+            case LogArgType::Char: {
+                char v;
+                if (!take(v)) return false;
+                out += v;
+                return true;
+            }
+            case LogArgType::String: {
+                std::uint32_t n;
+                if (!take(n) || args.size() - at < n) return false;
+                out.append(reinterpret_cast<const char*>(args.data() + at), n);
+                at += n;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const std::string_view f = site.format;
+    for (std::size_t i = 0; i < f.size(); ++i) {
+        const char c = f[i];
+        const bool pair = i + 1 < f.size();
+        if (c == '{' && pair && f[i + 1] == '{') {
+            out += '{';
+            ++i;
+        } else if (c == '}' && pair && f[i + 1] == '}') {
+            out += '}';
+            ++i;
+        } else if (c == '{' && pair && f[i + 1] == '}' && next_arg < site.args.size()) {
+            if (!append_arg(site.args[next_arg++])) return false;
+            ++i;
+        } else {
+            out += c;
+        }
+    }
+    return next_arg == site.args.size() && at == args.size();
+}
+
+// Appends the text of one record, without the line prefix or newline.
+// find_site(id) returns the site for a deferred record's format id, or
+// null if it is unknown.
+template<typename FindSite>
+void format_log_record(LogRecordKind kind, std::span<const std::byte> payload, FindSite&& find_site, std::string& out) {
+    switch (kind) {
+        case LogRecordKind::Text: out.append(reinterpret_cast<const char*>(payload.data()), payload.size()); return;
+        case LogRecordKind::Deferred: {
+            std::uint32_t id;
+            if (payload.size() < sizeof id) break;
+            std::memcpy(&id, payload.data(), sizeof id);
+            const LogFormatSite* site = find_site(id);
+            if (!site) {
+                out += "<unknown log format " + std::to_string(id) + '>';
+                return;
+            }
+            const std::size_t mark = out.size();
+            if (format_deferred(*site, payload.subspan(sizeof id), out)) return;
+            out.resize(mark);
+            out += "<malformed arguments for \"";
+            out += site->format;
+            out += "\">";
+            return;
+        }
+    }
+    out += "<unknown record kind " + std::to_string(static_cast<unsigned>(kind)) + '>';
+}
+
+// ===== BINARY LOG FILES =====
+//
+// In binary mode the writer copies records to the file as they are and
+// leaves all formatting to decode_binary_log(). The file is a sequence of
+//
+//   session:  "CPPBLOG\x01"                 one per logger that opened the file
+//   format:   'F' u32 id, u32 line, u8 n, n x u8 arg type,
+//             u16 file length, file, u32 format length, format
+//   record:   'R' u16 kind, u32 thread, i64 timestamp ns, u32 size, payload
+//
+// in native byte order. A format entry precedes the first record that uses
+// it; ids are only meaningful within their session, since a new process
+// may register its sites in another order.
+
+inline constexpr std::string_view binary_log_magic{"CPPBLOG\x01", 8};
+
+inline void append_binary_format(std::string& out, std::uint32_t id, const LogFormatSite& site) {
+    auto put = [&](const auto& v) { out.append(reinterpret_cast<const char*>(&v), sizeof v); };
+    out += 'F';
+    put(id);
+    put(site.line);
+    put(static_cast<std::uint8_t>(site.args.size()));
+    for (LogArgType t : site.args) put(t);
+    put(static_cast<std::uint16_t>(site.file.size()));
+    out += site.file;
+    put(static_cast<std::uint32_t>(site.format.size()));
+    out += site.format;
+}
+
+inline void append_binary_record(std::string& out, LogRecordKind kind, std::uint32_t thread, std::int64_t timestamp_ns,
+                                 std::span<const std::byte> payload) {
+    auto put = [&](const auto& v) { out.append(reinterpret_cast<const char*>(&v), sizeof v); };
+    out += 'R';
+    put(kind);
+    put(thread);
+    put(timestamp_ns);
+    put(static_cast<std::uint32_t>(payload.size()));
+    out.append(reinterpret_cast<const char*>(payload.data()), payload.size());
+}
+
+// Writes the text form of a binary log, one line per record, exactly as a
+// text-mode logger would have written it. Throws std::runtime_error on a
+// file that is not a binary log or is cut short.
+inline void decode_binary_log(std::istream& in, std::ostream& out) {
+    struct DecodedSite {
+        std::string format, file;
+        std::vector<LogArgType> args;
+        LogFormatSite site;
+    };
+    std::deque<DecodedSite> storage;   // stable addresses for the sites
+    std::unordered_map<std::uint32_t, const LogFormatSite*> sites;
+    LogLinePrefix prefix;
+    std::string line;
+    std::vector<std::byte> payload;
+
+    auto fail = [](const char* what) { throw std::runtime_error(std::string("decode_binary_log: ") + what); };
+    auto read = [&](void* dst, std::size_t n) {
+        if (!in.read(static_cast<char*>(dst), static_cast<std::streamsize>(n))) fail("file is cut short");
+    };
+    auto get = [&](auto& v) { read(&v, sizeof v); };
+    // Sizes come from the file, so a corrupt one must not allocate more
+    // than the file actually holds: grow in steps, a step per read
+    auto read_sized = [&](auto& container, std::size_t n) {
+        constexpr std::size_t step = 64 * 1024;
+        container.clear();
+        for (std::size_t done = 0; done < n;) {
+            const std::size_t chunk = std::min(step, n - done);
+            container.resize(done + chunk);
+            read(container.data() + done, chunk);
+            done += chunk;
+        }
+    };
+
+    char magic[8];
+    if (!in.read(magic, sizeof magic) || std::string_view(magic, sizeof magic) != binary_log_magic) {
+        fail("not a binary log");
+    }
+    for (int tag; (tag = in.get()) != std::char_traits<char>::eof();) {
+        if (tag == binary_log_magic[0]) {
+            read(magic + 1, sizeof magic - 1);
+            if (std::string_view(magic + 1, sizeof magic - 1) != binary_log_magic.substr(1)) fail("bad session header");
+            sites.clear();
+        } else if (tag == 'F') {
+            std::uint32_t id, line_number, format_size;
+            std::uint8_t n;
+            std::uint16_t file_size;
+            get(id);
+            get(line_number);
+            get(n);
+            DecodedSite& d = storage.emplace_back();
+            read_sized(d.args, n);
+            for (LogArgType t : d.args) {
+                if (t > LogArgType::String) fail("bad argument type");
+            }
+            get(file_size);
+            read_sized(d.file, file_size);
+            get(format_size);
+            read_sized(d.format, format_size);
+            d.site = {d.format, d.file, line_number, d.args};
+            sites[id] = &d.site;
+        } else if (tag == 'R') {
+            LogRecordKind kind;
+            std::uint32_t thread, size;
+            std::int64_t timestamp;
+            get(kind);
+            get(thread);
+            get(timestamp);
+            get(size);
+            read_sized(payload, size);
+            line.clear();
+            prefix.append(line, timestamp, thread);
+            format_log_record(kind, payload,
+                              [&](std::uint32_t id) {
+                                  const auto it = sites.find(id);
+                                  return it != sites.end() ? it->second : nullptr;
+                              },
+                              line);
+            line += '\n';
+            out.write(line.data(), static_cast<std::streamsize>(line.size()));
+        } else {
+            fail("bad entry tag");
+        }
+    }
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../async_logger.h"
+
+// Lines are read back from the file the logger wrote; every test uses its
+// own file and removes it afterwards
+
+std::vector<std::string> read_lines(const std::string& path) {
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    return lines;
+}
+
+// "2026-10-18 14:03:07.123456 [t2] message" -> {2, "message"}
+std::pair<unsigned, std::string> split(const std::string& line) {
+    assert(line.size() > 30 && line[4] == '-' && line[10] == ' ' && line[19] == '.' && line[26] == ' ');
+    assert(line[27] == '[' && line[28] == 't');
+    const std::size_t close = line.find("] ", 29);
+    assert(close != std::string::npos);
+    return {unsigned(std::stoul(line.substr(29, close - 29))), line.substr(close + 2)};
+}
+
+void test_single_thread_and_flush() {
+    const std::string path = "async_logger_test_single.log";
+    std::remove(path.c_str());
+    AsyncLogger log(path);
+    for (int i = 0; i < 1000; ++i) {
+        [[maybe_unused]] const bool logged = log.log("line " + std::to_string(i));
+        assert(logged);
+    }
+    log.flush();
+    assert(log.written() == 1000 && log.dropped() == 0);
+
+    // flush() returned, so everything is in the file already
+    const auto lines = read_lines(path);
+    assert(lines.size() == 1000);
+    for (int i = 0; i < 1000; ++i) assert(split(lines[i]).second == "line " + std::to_string(i));
+
+    // Empty records and a flush with nothing pending
+    [[maybe_unused]] const bool logged = log.log("");
+    assert(logged);
+    log.flush();
+    log.flush();
+    assert(read_lines(path).size() == 1001 && split(read_lines(path).back()).second.empty());
+    std::remove(path.c_str());
+}
+
+void test_many_threads_block() {
+    const std::string path = "async_logger_test_block.log";
+    std::remove(path.c_str());
+    const int threads = 4, per_thread = 20'000;
+    {
+        // Small rings so producers regularly find them full and wait
+        AsyncLogger log(path, {.ring_bytes = 4096, .batch_bytes = 8192, .overflow = LogOverflow::Block});
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&log, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    std::string line = "w";
+                    line += std::to_string(t);
+                    line += ' ';
+                    line += std::to_string(i);
+                    [[maybe_unused]] const bool logged = log.log(line);
+                    assert(logged);
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        // The destructor drains rings whose threads have already exited
+    }
+
+    // Every line arrives, in order per producer, and each producer keeps
+    // one thread index
+    const auto lines = read_lines(path);
+    assert(lines.size() == std::size_t(threads * per_thread));
+    std::map<int, int> next;
+    std::map<int, unsigned> index_of;
+    for (const auto& line : lines) {
+        const auto [index, text] = split(line);
+        const std::size_t space = text.find(' ');
+        const int t = std::stoi(text.substr(1, space - 1));
+        [[maybe_unused]] const int i = std::stoi(text.substr(space + 1));
+        assert(i == next[t]);
+        ++next[t];
+        assert(!index_of.contains(t) || index_of[t] == index);
+        index_of[t] = index;
+    }
+    for (int t = 0; t < threads; ++t) assert(next[t] == per_thread);
+    std::remove(path.c_str());
+}
+
+void test_drop() {
+    const std::string path = "async_logger_test_drop.log";
+    std::remove(path.c_str());
+    const int total = 50'000;
+    std::uint64_t accepted = 0;
+    [[maybe_unused]] std::uint64_t dropped = 0;
+    {
+        // A long poll interval and a tiny ring: most records find it full
+        AsyncLogger log(path, {.ring_bytes = 256, .poll_interval = std::chrono::microseconds(100'000)});
+        for (int i = 0; i < total; ++i) accepted += log.log("record " + std::to_string(i));
+        log.flush();
+        dropped = log.dropped();
+        assert(log.written() == accepted);
+    }
+    assert(dropped > 0 && accepted + dropped == std::uint64_t(total));
+
+    // What was kept is in order
+    const auto lines = read_lines(path);
+    assert(lines.size() == accepted);
+    [[maybe_unused]] int previous = -1;
+    for (const auto& line : lines) {
+        [[maybe_unused]] const int i = std::stoi(split(line).second.substr(7));
+        assert(i > previous);
+        previous = i;
+    }
+    std::remove(path.c_str());
+}
+
+void test_truncation() {
+    const std::string path = "async_logger_test_truncate.log";
+    std::remove(path.c_str());
+    AsyncLogger log(path, {.ring_bytes = 1024});
+    const std::string longer(5000, 'x');
+    assert(log.max_payload() < 1024 / 2);
+    [[maybe_unused]] const bool logged_longer = log.log(longer), logged_after = log.log("after");
+    assert(logged_longer && logged_after);
+    log.flush();
+    const auto lines = read_lines(path);
+    assert(lines.size() == 2);
+    assert(split(lines[0]).second == std::string(log.max_payload(), 'x'));
+    assert(split(lines[1]).second == "after");
+    std::remove(path.c_str());
+}
+
+void test_threads_come_and_go() {
+    // Threads that exit leave their rings to be drained and retired; new
+    // threads get new rings
+    const std::string path = "async_logger_test_churn.log";
+    std::remove(path.c_str());
+    AsyncLogger log(path, {.overflow = LogOverflow::Block});
+    for (int round = 0; round < 20; ++round) {
+        std::thread([&log, round] {
+            for (int i = 0; i < 100; ++i) log.log("round " + std::to_string(round));
+        }).join();
+    }
+    log.flush();
+    assert(log.written() == 2000 && read_lines(path).size() == 2000);
+    std::remove(path.c_str());
+}
+
+void test_blocked_producer_wakes_writer() {
+    // A producer blocked on a full ring wakes the writer at once instead of
+    // waiting out its poll interval: with a 200 ms interval, no log() call
+    // may stall for anywhere near that long
+    const std::string path = "async_logger_test_wake.log";
+    std::remove(path.c_str());
+    const int total = 200;
+    [[maybe_unused]] std::chrono::steady_clock::duration worst{};
+    {
+        AsyncLogger log(path, {.ring_bytes = 256, .overflow = LogOverflow::Block,
+                               .poll_interval = std::chrono::microseconds(200'000)});
+        for (int i = 0; i < total; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            log.log("a record long enough to fill the ring in a few calls " + std::to_string(i));
+            worst = std::max(worst, std::chrono::steady_clock::now() - start);
+        }
+        log.flush();
+        assert(log.written() == std::uint64_t(total) && log.dropped() == 0);
+    }
+    assert(worst < std::chrono::milliseconds(100));
+    std::remove(path.c_str());
+}
+
+void test_destroyed_loggers_release_rings() {
+    // One logger per "rotation": a thread keeps rings only for loggers that
+    // still exist, not one per logger it ever used (the earlier tests' dead
+    // loggers go as soon as this thread creates a ring)
+    const std::string path = "async_logger_test_rotate.log";
+    std::remove(path.c_str());
+    for (int rotation = 0; rotation < 20; ++rotation) {
+        AsyncLogger log(path, {.ring_bytes = 1 << 20});
+        log.log("rotation " + std::to_string(rotation));
+        assert(AsyncLogger::thread_ring_count() == 1);
+    }
+    {
+        AsyncLogger first(path), second(path);
+        first.log("a");
+        second.log("b");
+        first.flush();
+        second.flush();
+        assert(AsyncLogger::thread_ring_count() == 2);
+    }
+    assert(read_lines(path).size() == 22);
+    std::remove(path.c_str());
+}
+
+void test_bad_path() {
+    [[maybe_unused]] bool threw = false;
+    try {
+        AsyncLogger log("/nonexistent-directory/async.log");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+int main() {
+    test_single_thread_and_flush();
+    test_many_threads_block();
+    test_drop();
+    test_truncation();
+    test_threads_come_and_go();
+    test_blocked_producer_wakes_writer();
+    test_destroyed_loggers_release_rings();
+    test_bad_path();
+    return 0;
+}
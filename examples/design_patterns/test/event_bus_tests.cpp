@@ -0,0 +1,224 @@
+#include <atomic>
+#include <cassert>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../event_bus.h"
+
+struct Ping {
+    int value;
+};
+
+// Counts copies, to check that delivery never makes any
+struct Tracked {
+    static inline std::atomic<int> copies{0};
+    std::string text;
+    int sequence = 0;
+
+    Tracked(std::string t, int s) : text(std::move(t)), sequence(s) {}
+    Tracked(const Tracked& other) : text(other.text), sequence(other.sequence) { ++copies; }
+    Tracked(Tracked&&) noexcept = default;
+    Tracked& operator=(const Tracked& other) {
+        text = other.text;
+        sequence = other.sequence;
+        ++copies;
+        return *this;
+    }
+    Tracked& operator=(Tracked&&) noexcept = default;
+};
+
+void test_sync() {
+    EventBus<Ping, Tracked> bus;
+    std::vector<std::string> seen;
+    auto a = bus.subscribe<Ping>([&](const Ping& p) {
+        std::string s = "a";
+        s += std::to_string(p.value);
+        seen.push_back(std::move(s));
+    });
+    auto b = bus.subscribe<Ping>([&](const Ping& p) {
+        std::string s = "b";
+        s += std::to_string(p.value);
+        seen.push_back(std::move(s));
+    });
+    auto t = bus.subscribe<Tracked>([&](const Tracked& e) { seen.push_back(e.text); });
+    assert(bus.subscriber_count<Ping>() == 2 && bus.subscriber_count<Tracked>() == 1);
+
+    bus.publish(Ping{1});
+    const Tracked event("tracked", 0);
+    bus.publish(event);
+    assert((seen == std::vector<std::string>{"a1", "b1", "tracked"}));
+    assert(Tracked::copies == 0);
+
+    // Subscriptions end with reset(), destruction or being moved over
+    seen.clear();
+    a.reset();
+    assert(!a && b);
+    bus.publish(Ping{2});
+    {
+        Subscription<Ping> moved = std::move(b);
+        assert(!b && moved);
+        bus.publish(Ping{3});
+    }
+    bus.publish(Ping{4});
+    assert((seen == std::vector<std::string>{"b2", "b3"}));
+    assert(bus.subscriber_count<Ping>() == 0);
+
+    // A subscription may outlive its bus
+    Subscription<Ping> orphan;
+    {
+        EventBus<Ping> short_lived;
+        orphan = short_lived.subscribe<Ping>([](const Ping&) {});
+    }
+    orphan.reset();
+}
+
+void test_changes_during_publish() {
+    EventBus<Ping> bus;
+    int self_removing_calls = 0, added_calls = 0, other_calls = 0;
+    Subscription<Ping> self, added;
+    self = bus.subscribe<Ping>([&](const Ping&) {
+        ++self_removing_calls;
+        self.reset();   // must not wait for this very publish
+        added = bus.subscribe<Ping>([&](const Ping&) { ++added_calls; });
+    });
+    auto other = bus.subscribe<Ping>([&](const Ping&) { ++other_calls; });
+
+    // The publish in progress keeps its snapshot: the new subscriber is not
+    // called for it, the removed one not for the next
+    bus.publish(Ping{1});
+    assert(self_removing_calls == 1 && added_calls == 0 && other_calls == 1);
+    bus.publish(Ping{2});
+    assert(self_removing_calls == 1 && added_calls == 1 && other_calls == 2);
+}
+
+void test_concurrent_churn() {
+    // Publishers never stop while another thread subscribes and
+    // unsubscribes; once reset() returns the handler is never called again
+    EventBus<Ping> bus;
+    std::atomic<bool> stop{false};
+    std::atomic<long> calls{0};
+    auto steady = bus.subscribe<Ping>([&](const Ping&) { calls.fetch_add(1, std::memory_order_relaxed); });
+
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < 3; ++t) {
+        publishers.emplace_back([&, t] {
+            while (!stop.load(std::memory_order_relaxed)) bus.publish(Ping{t});
+        });
+    }
+    for (int round = 0; round < 100; ++round) {
+        auto gone = std::make_shared<std::atomic<bool>>(false);
+        auto sub = bus.subscribe<Ping>([gone](const Ping&) { assert(!gone->load()); });
+        if (round % 2 == 0) std::this_thread::yield();
+        sub.reset();
+        gone->store(true);
+    }
+    stop = true;
+    for (auto& p : publishers) p.join();
+    assert(calls > 0 && bus.subscriber_count<Ping>() == 1);
+}
+
+void test_async(ThreadPool& pool) {
+    // Every subscriber sees every event, in publish order, across batches
+    const int subscribers = 1000, events = 2000;
+    EventBus<Ping, Tracked> bus(pool);
+    std::vector<std::vector<int>> seen(subscribers);
+    std::vector<Subscription<Ping>> subs;
+    for (int s = 0; s < subscribers; ++s) {
+        subs.push_back(bus.subscribe<Ping>([&seen, s](const Ping& p) { seen[s].push_back(p.value); }));
+    }
+    for (int i = 0; i < events; ++i) bus.publish_async(Ping{i});
+    bus.flush();
+    for ([[maybe_unused]] const auto& v : seen) {
+        assert(int(v.size()) == events);
+        for (int i = 0; i < events; ++i) assert(v[i] == i);
+    }
+
+    // Moved-in events are delivered without copies
+    Tracked::copies = 0;
+    std::atomic<int> tracked_calls{0};
+    auto t1 = bus.subscribe<Tracked>([&](const Tracked& e) { tracked_calls += e.text.size() == 5; });
+    auto t2 = bus.subscribe<Tracked>([&](const Tracked& e) { tracked_calls += e.sequence >= 0; });
+    for (int i = 0; i < 100; ++i) bus.publish_async(Tracked("event", i));
+    bus.flush();
+    assert(tracked_calls == 200 && Tracked::copies == 0);
+
+    // A handler's exception comes back out of flush(), once
+    auto thrower = bus.subscribe<Ping>([](const Ping& p) {
+        if (p.value == 7) throw std::runtime_error("seven");
+    });
+    // Without workers the handler runs inside publish_async() and the
+    // exception comes straight out of it
+    [[maybe_unused]] bool threw = false;
+    try {
+        for (int i = 0; i < 10; ++i) bus.publish_async(Ping{i});
+        bus.flush();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    bus.flush();
+}
+
+void test_async_unsubscribe_and_shutdown() {
+    ThreadPool pool(2);
+    std::atomic<long> delivered{0};
+    {
+        // Declared before the bus so that it is still subscribed while the
+        // bus drains its queue on destruction
+        Subscription<Ping> counter;
+        EventBus<Ping> bus(pool);
+        auto gone = std::make_shared<std::atomic<bool>>(false);
+        auto sub = bus.subscribe<Ping>([&delivered, gone](const Ping&) {
+            assert(!gone->load());
+            delivered.fetch_add(1, std::memory_order_relaxed);
+        });
+        for (int i = 0; i < 5000; ++i) bus.publish_async(Ping{i});
+        // Waits for a batch in flight, if there is one
+        sub.reset();
+        gone->store(true);
+        counter = bus.subscribe<Ping>([&delivered](const Ping&) { delivered.fetch_add(1000000); });
+        for (int i = 0; i < 10; ++i) bus.publish_async(Ping{i});
+        // ~EventBus delivers the 10 queued events to counter before the
+        // channel goes away; counter is reset after that, against a bus
+        // that no longer exists
+    }
+    assert(delivered >= 10 * 1000000 && delivered % 1000000 <= 5000);
+}
+
+void test_unsubscribe_on_pool_worker() {
+    // A job on the bus's only worker unsubscribes while a batch holding
+    // the old snapshot is queued behind it: it must not wait for that batch
+    ThreadPool pool(1);
+    EventBus<Ping> bus(pool);
+    std::atomic<int> calls{0};
+    auto sub = bus.subscribe<Ping>([&calls](const Ping&) { ++calls; });
+    std::promise<void> published;
+    auto job = pool.submit([&] {
+        published.get_future().wait();
+        sub.reset();
+    });
+    bus.publish_async(Ping{1});   // queued behind the job
+    published.set_value();
+    job.get();
+    bus.flush();
+    [[maybe_unused]] const int delivered = calls;
+    assert(delivered <= 1);
+    bus.publish_async(Ping{2});
+    bus.flush();
+    assert(calls == delivered);
+}
+
+int main() {
+    test_sync();
+    test_changes_during_publish();
+    test_concurrent_churn();
+    ThreadPool none(0), pool(3);
+    test_async(pool);
+    test_async(none);
+    test_async_unsubscribe_and_shutdown();
+    test_unsubscribe_on_pool_worker();
+    return 0;
+}
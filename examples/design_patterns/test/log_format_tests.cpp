@@ -0,0 +1,203 @@
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../async_logger.h"
+
+// Deferred records are checked through both ends: the writer formatting
+// them into a text log, and a binary log decoded afterwards. Each test
+// uses its own file and removes it.
+
+static_assert(log_placeholder_count("") == 0);
+static_assert(log_placeholder_count("{} and {}") == 2);
+static_assert(log_placeholder_count("{{}} {{{}}} {") == 1);
+static_assert(log_arg_types<int, const char*, std::string, double, bool, char, unsigned char>
+              == std::array{LogArgType::Int, LogArgType::String, LogArgType::String, LogArgType::Double,
+                            LogArgType::Bool, LogArgType::Char, LogArgType::UInt});
+
+std::vector<std::string> read_lines(std::istream& in) {
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    return lines;
+}
+
+std::vector<std::string> read_lines(const std::string& path) {
+    std::ifstream in(path);
+    return read_lines(in);
+}
+
+// The message part of "2026-10-18 14:03:07.123456 [t2] message"
+std::string message(const std::string& line) {
+    const std::size_t close = line.find("] ", 27);
+    assert(line.size() > 30 && line[19] == '.' && line[27] == '[' && close != std::string::npos);
+    return line.substr(close + 2);
+}
+
+enum class Color : std::uint8_t { Red = 1, Blue = 7 };
+
+// Every argument kind, escapes, strings that may not outlive the call
+void log_everything(AsyncLogger& log) {
+    const std::string temporary = "temp" + std::to_string(42);
+    const char* null_string = nullptr;
+    LOG_DEFERRED(log, "no arguments");
+    LOG_DEFERRED(log, "ints {} {} {} {}", -5, 7u, std::int64_t(-9'000'000'000), std::uint16_t(65535));
+    LOG_DEFERRED(log, "floats {} {}", 0.25, 1.5f);
+    LOG_DEFERRED(log, "strings [{}] [{}] [{}] [{}]", "literal", temporary, std::string_view("view"), null_string);
+    LOG_DEFERRED(log, "bool {} char {} enum {}", false, 'x', Color::Blue);
+    LOG_DEFERRED(log, "{{literal}} {{{}}}", 3);
+    log.log("plain text between deferred records");
+    for (int i = 0; i < 3; ++i) LOG_DEFERRED(log, "loop {}", i);
+}
+
+const std::vector<std::string> everything = {
+    "no arguments",
+    "ints -5 7 -9000000000 65535",
+    "floats 0.25 1.5",
+    "strings [literal] [temp42] [view] []",
+    "bool false char x enum 7",
+    "{literal} {3}",
+    "plain text between deferred records",
+    "loop 0",
+    "loop 1",
+    "loop 2",
+};
+
+void test_text_mode() {
+    const std::string path = "log_format_test_text.log";
+    std::remove(path.c_str());
+    AsyncLogger log(path);
+    log_everything(log);
+    log.flush();
+    const auto lines = read_lines(path);
+    assert(lines.size() == everything.size());
+    for (std::size_t i = 0; i < lines.size(); ++i) assert(message(lines[i]) == everything[i]);
+    std::remove(path.c_str());
+}
+
+void test_binary_mode() {
+    const std::string path = "log_format_test_binary.blog", text_path = "log_format_test_binary.log";
+    std::remove(path.c_str());
+    std::remove(text_path.c_str());
+    {
+        AsyncLogger log(path, {.file_format = LogFileFormat::Binary});
+        log_everything(log);
+    }
+    // A second session appends to the same file and starts its own
+    // format table
+    {
+        AsyncLogger log(path, {.file_format = LogFileFormat::Binary});
+        LOG_DEFERRED(log, "second session {}", "ok");
+        log_everything(log);
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream decoded;
+    decode_binary_log(in, decoded);
+    const auto lines = read_lines(decoded);
+    assert(lines.size() == 2 * everything.size() + 1);
+    for (std::size_t i = 0; i < everything.size(); ++i) {
+        assert(message(lines[i]) == everything[i]);
+        assert(message(lines[everything.size() + 1 + i]) == everything[i]);
+    }
+    assert(message(lines[everything.size()]) == "second session ok");
+
+    // Cut short, or not a binary log at all
+    std::ifstream whole(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(whole)), std::istreambuf_iterator<char>());
+    // Corrupt sizes and ids: a record claiming 4 GB and a format with a
+    // huge id, both followed by a few bytes only. These must fail on the
+    // missing bytes, not try to allocate what they claim.
+    auto field = [](auto v) { return std::string(reinterpret_cast<const char*>(&v), sizeof v); };
+    const std::string huge_record = std::string(binary_log_magic) + 'R' + field(LogRecordKind::Text) +
+                                    field(std::uint32_t(0)) + field(std::int64_t(0)) + field(std::uint32_t(0xffff'fff0)) +
+                                    "short";
+    const std::string huge_format = std::string(binary_log_magic) + 'F' + field(std::uint32_t(0xffff'fff0)) +
+                                    field(std::uint32_t(1)) + field(std::uint8_t(0)) + field(std::uint16_t(4)) +
+                                    "file" + field(std::uint32_t(0x7fff'ffff)) + "fmt";
+    for (std::string broken : {bytes.substr(0, bytes.size() - 3), std::string("plain text\n"), huge_record, huge_format}) {
+        std::istringstream cut(broken);
+        std::ostringstream out;
+        [[maybe_unused]] bool threw = false;
+        try {
+            decode_binary_log(cut, out);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::remove(path.c_str());
+}
+
+void test_long_strings_and_threads() {
+    const std::string path = "log_format_test_threads.log";
+    std::remove(path.c_str());
+    {
+        // Strings share what is left of max_payload() and are cut in order
+        AsyncLogger log(path, {.ring_bytes = 1024});
+        const std::string a(400, 'a'), b(400, 'b');
+        [[maybe_unused]] const bool logged = LOG_DEFERRED(log, "{}|{}|{}", a, 1, b);
+        assert(logged);
+        log.flush();
+        const std::string text = message(read_lines(path).at(0));
+        [[maybe_unused]] const std::size_t budget = log.max_payload() - 4 - (4 + 8 + 4);
+        assert(text == a + "|1|" + std::string(budget - a.size(), 'b'));
+    }
+    std::remove(path.c_str());
+
+    // Many threads sharing call sites, with rings that wrap often
+    const int threads = 4, per_thread = 10'000;
+    {
+        AsyncLogger log(path, {.ring_bytes = 4096, .overflow = LogOverflow::Block});
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&log, t] {
+                for (int i = 0; i < per_thread; ++i) LOG_DEFERRED(log, "thread {} record {} of {}", t, i, "many");
+            });
+        }
+        for (auto& w : workers) w.join();
+    }
+    const auto lines = read_lines(path);
+    assert(lines.size() == std::size_t(threads * per_thread));
+    std::vector<int> next(threads, 0);
+    for (const auto& line : lines) {
+        int t, i;
+        char of[8];
+        [[maybe_unused]] const int fields = std::sscanf(message(line).c_str(), "thread %d record %d of %4s", &t, &i, of);
+        assert(fields == 3 && std::string(of) == "many");
+        assert(i == next[t]);
+        ++next[t];
+    }
+    std::remove(path.c_str());
+}
+
+void test_malformed_records() {
+    static const LogFormatSite site{"value {}", "test", 1, log_arg_types<int>};
+    auto find = [](std::uint32_t id) { return id == 7 ? &site : nullptr; };
+    std::vector<std::byte> payload(4 + 8);
+    const std::uint32_t id = 7;
+    const std::int64_t value = -3;
+    std::memcpy(payload.data(), &id, 4);
+    std::memcpy(payload.data() + 4, &value, 8);
+
+    std::string out;
+    format_log_record(LogRecordKind::Deferred, payload, find, out);
+    assert(out == "value -3");
+    out.clear();
+    format_log_record(LogRecordKind::Deferred, std::span(payload).first(10), find, out);
+    assert(out == "<malformed arguments for \"value {}\">");
+    out.clear();
+    payload[0] = std::byte{8};
+    format_log_record(LogRecordKind::Deferred, payload, find, out);
+    assert(out == "<unknown log format 8>");
+}
+
+int main() {
+    test_text_mode();
+    test_binary_mode();
+    test_long_strings_and_threads();
+    test_malformed_records();
+    return 0;
+}
@@ -0,0 +1,1097 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "simd.h"
+#include "thread_pool.h"
+
+// ===== THREAD POOL AND CHUNKING =====
+
+// Process-wide pool used when no pool is passed explicitly. The calling
+// thread always takes part in the work, so the pool has one thread fewer
+// than the machine has cores.
+inline ThreadPool& default_pool() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+// Number of threads that work on a parallel call (pool workers + caller)
+inline std::size_t par_concurrency(const ThreadPool& pool) {
+    return pool.size() + 1;
+}
+
+// Allocator that leaves trivially constructible elements uninitialized on
+// resize(), so output buffers aren't zero-filled just to be overwritten
+template<typename T>
+struct DefaultInitAllocator : std::allocator<T> {
+    template<typename U>
+    struct rebind { using other = DefaultInitAllocator<U>; };
+
+    DefaultInitAllocator() = default;
+    template<typename U>
+    DefaultInitAllocator(const DefaultInitAllocator<U>&) noexcept {}
+
+    template<typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template<typename T>
+using ParallelBuffer = std::vector<T, DefaultInitAllocator<T>>;
+
+// Runs body(chunk, begin, end) for each of the ceil(n / chunk_size) chunks
+// of [0, n), on the pool and on the calling thread, and returns once all of
+// them are done. Chunk boundaries depend only on n and chunk_size, never on
+// scheduling. The first exception thrown by a chunk is rethrown here.
+template<typename Body>
+void par_for_chunks(ThreadPool& pool, std::size_t n, std::size_t chunk_size, Body&& body) {
+    if (n == 0) return;
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+    const std::size_t chunks = (n + chunk_size - 1) / chunk_size;
+
+    auto run_chunk = [&](std::size_t chunk) {
+        std::size_t begin = chunk * chunk_size;
+        body(chunk, begin, std::min(n, begin + chunk_size));
+    };
+    if (chunks == 1 || pool.size() == 0) {
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) run_chunk(chunk);
+        return;
+    }
+
+    // Helpers may only get to run after this call has returned; they then
+    // find no chunk left and touch nothing but this shared state
+    struct State {
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> finished{0};
+        std::size_t chunks = 0;
+        std::function<void(std::size_t)> run_chunk;
+        std::mutex m;
+        std::condition_variable cv;
+        std::exception_ptr error;
+
+        void work() {
+            std::size_t chunk;
+            while ((chunk = next.fetch_add(1, std::memory_order_relaxed)) < chunks) {
+                try {
+                    run_chunk(chunk);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lk(m);
+                    if (!error) error = std::current_exception();
+                }
+                if (finished.fetch_add(1, std::memory_order_acq_rel) + 1 == chunks) {
+                    std::lock_guard<std::mutex> lk(m);
+                    cv.notify_all();
+                }
+            }
+        }
+    };
+
+    auto state = std::make_shared<State>();
+    state->chunks = chunks;
+    state->run_chunk = run_chunk;
+
+    const std::size_t helpers = std::min(pool.size(), chunks - 1);
+    for (std::size_t i = 0; i < helpers; ++i) {
+        pool.post([state] { state->work(); });
+    }
+    state->work();
+
+    std::unique_lock<std::mutex> lk(state->m);
+    state->cv.wait(lk, [&] { return state->finished.load(std::memory_order_acquire) == chunks; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+// Chunk size that gives every participating thread one contiguous chunk
+inline std::size_t chunk_per_thread(const ThreadPool& pool, std::size_t n) {
+    std::size_t threads = par_concurrency(pool);
+    return std::max<std::size_t>(1, (n + threads - 1) / threads);
+}
+
+// ===== PARALLEL ALGORITHMS =====
+
+// Chunk size used when an algorithm is given grain 0. It depends only on
+// n, so chunk boundaries, and the order per-chunk results are combined
+// in, are the same for every pool size.
+inline std::size_t default_grain(std::size_t n) {
+    return std::max<std::size_t>(4096, (n + 255) / 256);
+}
+
+inline std::size_t resolve_grain(std::size_t n, std::size_t grain) {
+    return grain ? grain : default_grain(n);
+}
+
+template<typename Range>
+concept ParallelRange = std::ranges::random_access_range<Range> && std::ranges::sized_range<Range>;
+
+// f(element) for every element; f may modify elements through a reference
+template<ParallelRange Range, typename F>
+void par_for_each(ThreadPool& pool, Range&& range, F f, std::size_t grain = 0) {
+    const std::size_t n = std::ranges::size(range);
+    auto first = std::ranges::begin(range);
+    par_for_chunks(pool, n, resolve_grain(n, grain), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) f(first[i]);
+    });
+}
+
+template<ParallelRange Range, typename F>
+void par_for_each(Range&& range, F f, std::size_t grain = 0) {
+    par_for_each(default_pool(), std::forward<Range>(range), f, grain);
+}
+
+// out[i] = f(in[i]); out must be at least as long as in
+template<ParallelRange In, ParallelRange Out, typename F>
+void par_transform(ThreadPool& pool, const In& in, Out&& out, F f, std::size_t grain = 0) {
+    const std::size_t n = std::ranges::size(in);
+    if (std::ranges::size(out) < n) {
+        throw std::invalid_argument("par_transform: output range is shorter than input");
+    }
+    auto src = std::ranges::begin(in);
+    auto dst = std::ranges::begin(out);
+    par_for_chunks(pool, n, resolve_grain(n, grain), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) dst[i] = f(src[i]);
+    });
+}
+
+template<ParallelRange In, ParallelRange Out, typename F>
+void par_transform(const In& in, Out&& out, F f, std::size_t grain = 0) {
+    par_transform(default_pool(), in, std::forward<Out>(out), f, grain);
+}
+
+// init combined with transform(element) for every element, using reduce.
+// Each chunk folds its elements left to right and the chunk results are
+// then folded in chunk order, so for a given grain the result is the same
+// on every run and every pool size, even for non-associative reduce.
+template<ParallelRange Range, typename T, typename Reduce, typename Transform>
+T par_transform_reduce(ThreadPool& pool, const Range& range, T init, Reduce reduce, Transform transform,
+                       std::size_t grain = 0) {
+    const std::size_t n = std::ranges::size(range);
+    grain = resolve_grain(n, grain);
+    auto first = std::ranges::begin(range);
+
+    std::vector<std::optional<T>> partials((n + grain - 1) / grain);
+    par_for_chunks(pool, n, grain, [&](std::size_t c, std::size_t begin, std::size_t end) {
+        T acc = transform(first[begin]);
+        for (std::size_t i = begin + 1; i < end; ++i) acc = reduce(std::move(acc), transform(first[i]));
+        partials[c] = std::move(acc);
+    });
+    for (auto& partial : partials) init = reduce(std::move(init), std::move(*partial));
+    return init;
+}
+
+template<ParallelRange Range, typename T, typename Reduce, typename Transform>
+T par_transform_reduce(const Range& range, T init, Reduce reduce, Transform transform, std::size_t grain = 0) {
+    return par_transform_reduce(default_pool(), range, std::move(init), reduce, transform, grain);
+}
+
+template<ParallelRange Range, typename T, typename Reduce = std::plus<>>
+T par_reduce(ThreadPool& pool, const Range& range, T init, Reduce reduce = {}, std::size_t grain = 0) {
+    return par_transform_reduce(pool, range, std::move(init), reduce,
+                                [](const auto& x) -> T { return x; }, grain);
+}
+
+template<ParallelRange Range, typename T, typename Reduce = std::plus<>>
+T par_reduce(const Range& range, T init, Reduce reduce = {}, std::size_t grain = 0) {
+    return par_reduce(default_pool(), range, std::move(init), reduce, grain);
+}
+
+template<ParallelRange Range, typename Pred>
+std::size_t par_count_if(ThreadPool& pool, const Range& range, Pred pred, std::size_t grain = 0) {
+    return par_transform_reduce(pool, range, std::size_t{0}, std::plus<>{},
+                                [&](const auto& x) { return static_cast<std::size_t>(pred(x) ? 1 : 0); }, grain);
+}
+
+template<ParallelRange Range, typename Pred>
+std::size_t par_count_if(const Range& range, Pred pred, std::size_t grain = 0) {
+    return par_count_if(default_pool(), range, pred, grain);
+}
+
+// Iterator to the FIRST element satisfying pred, or end. Chunks are
+// claimed in order, and a chunk stops as soon as a match is known to
+// exist before it, so the search ends shortly after the first hit instead
+// of scanning the whole range.
+template<ParallelRange Range, typename Pred>
+auto par_find_if(ThreadPool& pool, Range&& range, Pred pred, std::size_t grain = 0) {
+    const std::size_t n = std::ranges::size(range);
+    auto first = std::ranges::begin(range);
+    constexpr std::size_t CHECK_EVERY = 1024;
+
+    std::atomic<std::size_t> found{n};
+    par_for_chunks(pool, n, resolve_grain(n, grain), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if ((i - begin) % CHECK_EVERY == 0 && found.load(std::memory_order_relaxed) < begin) return;
+            if (pred(first[i])) {
+                std::size_t current = found.load(std::memory_order_relaxed);
+                while (i < current && !found.compare_exchange_weak(current, i, std::memory_order_relaxed)) {
+                }
+                return;
+            }
+        }
+    });
+    return first + static_cast<std::ranges::range_difference_t<Range>>(found.load());
+}
+
+template<ParallelRange Range, typename Pred>
+auto par_find_if(Range&& range, Pred pred, std::size_t grain = 0) {
+    return par_find_if(default_pool(), std::forward<Range>(range), pred, grain);
+}
+
+template<ParallelRange Range, typename Pred>
+bool par_any_of(ThreadPool& pool, const Range& range, Pred pred, std::size_t grain = 0) {
+    return par_find_if(pool, range, pred, grain) != std::ranges::end(range);
+}
+
+template<ParallelRange Range, typename Pred>
+bool par_any_of(const Range& range, Pred pred, std::size_t grain = 0) {
+    return par_any_of(default_pool(), range, pred, grain);
+}
+
+// ===== DETERMINISTIC SUMMATION =====
+
+enum class Summation {
+    Plain,     // lane-wise adds, fastest
+    Kahan,     // Kahan compensation per lane
+    Neumaier,  // Kahan-Babuska-Neumaier, also exact when a term outweighs the sum
+};
+
+// Running sum plus the rounding error collected so far
+template<std::floating_point T>
+struct CompensatedSum {
+    T sum = 0;
+    T error = 0;
+
+    T value() const { return sum + error; }
+};
+
+template<Summation Mode, std::floating_point T>
+CompensatedSum<T> combine_sums(const CompensatedSum<T>& a, const CompensatedSum<T>& b) {
+    T sum = a.sum + b.sum;
+    if constexpr (Mode == Summation::Plain) {
+        return {sum, 0};
+    } else {
+        // Two-sum: the exact rounding error of the addition above
+        T error = std::abs(a.sum) >= std::abs(b.sum) ? (a.sum - sum) + b.sum : (b.sum - sum) + a.sum;
+        return {sum, a.error + b.error + error};
+    }
+}
+
+// Combines parts[0..n) as a balanced binary tree whose shape depends only on n
+template<Summation Mode, std::floating_point T>
+CompensatedSum<T> tree_combine(CompensatedSum<T>* parts, std::size_t n) {
+    if (n == 0) return {};
+    while (n > 1) {
+        for (std::size_t i = 0; i < n / 2; ++i) parts[i] = combine_sums<Mode>(parts[2 * i], parts[2 * i + 1]);
+        if (n % 2) parts[n / 2] = parts[n - 1];
+        n = (n + 1) / 2;
+    }
+    return parts[0];
+}
+
+// Sums data[0..n) in 8 independent lanes (element i goes to lane i % 8).
+// The lanes map onto SSE/AVX registers when the compiler vectorizes the
+// inner loop, and give the same bits when it doesn't. Compensation is only
+// meaningful without -ffast-math, which would optimise it away.
+template<Summation Mode, std::floating_point T>
+CompensatedSum<T> sum_chunk(const T* data, std::size_t n) {
+    constexpr std::size_t LANES = 8;
+    T sum[LANES] = {};
+    T comp[LANES] = {};
+
+    auto add = [&](std::size_t j, T x) {
+        if constexpr (Mode == Summation::Plain) {
+            sum[j] += x;
+        } else if constexpr (Mode == Summation::Kahan) {
+            T y = x - comp[j];
+            T t = sum[j] + y;
+            comp[j] = (t - sum[j]) - y;
+            sum[j] = t;
+        } else {
+            // Selecting operands rather than expressions keeps this branch-free
+            bool sum_larger = std::abs(sum[j]) >= std::abs(x);
+            T big = sum_larger ? sum[j] : x;
+            T small = sum_larger ? x : sum[j];
+            T t = sum[j] + x;
+            comp[j] += (big - t) + small;
+            sum[j] = t;
+        }
+    };
+
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (std::size_t j = 0; j < LANES; ++j) add(j, data[i + j]);
+    }
+    for (std::size_t j = 0; i < n; ++i, ++j) add(j, data[i]);
+
+    CompensatedSum<T> lanes[LANES];
+    for (std::size_t j = 0; j < LANES; ++j) {
+        // Kahan keeps the error with the opposite sign
+        lanes[j] = {sum[j], Mode == Summation::Kahan ? -comp[j] : comp[j]};
+    }
+    return tree_combine<Mode>(lanes, LANES);
+}
+
+template<Summation Mode, std::floating_point T>
+T par_sum_impl(ThreadPool& pool, std::span<const T> data, std::size_t grain) {
+    const std::size_t n = data.size();
+    grain = resolve_grain(n, grain);
+    std::vector<CompensatedSum<T>> partials(n ? (n + grain - 1) / grain : 0);
+    par_for_chunks(pool, n, grain, [&](std::size_t c, std::size_t begin, std::size_t end) {
+        partials[c] = sum_chunk<Mode>(data.data() + begin, end - begin);
+    });
+    return tree_combine<Mode>(partials.data(), partials.size()).value();
+}
+
+// Deterministic parallel sum of floating-point values. Chunks are fixed by
+// n and grain, each chunk is summed in fixed lanes, and chunk results are
+// combined in a fixed pairwise tree, so the result is bit-identical for any
+// number of threads (unlike std::reduce(execution::par, ...)).
+template<std::ranges::contiguous_range Range>
+    requires std::floating_point<std::ranges::range_value_t<Range>>
+auto par_sum(ThreadPool& pool, const Range& range, Summation mode = Summation::Plain, std::size_t grain = 0) {
+    using T = std::ranges::range_value_t<Range>;
+    std::span<const T> data(std::ranges::data(range), std::ranges::size(range));
+    switch (mode) {
+        case Summation::Kahan:
+            return par_sum_impl<Summation::Kahan>(pool, data, grain);
+        case Summation::Neumaier:
+            return par_sum_impl<Summation::Neumaier>(pool, data, grain);
+        default:
+            return par_sum_impl<Summation::Plain>(pool, data, grain);
+    }
+}
+
+template<std::ranges::contiguous_range Range>
+    requires std::floating_point<std::ranges::range_value_t<Range>>
+auto par_sum(const Range& range, Summation mode = Summation::Plain, std::size_t grain = 0) {
+    return par_sum(default_pool(), range, mode, grain);
+}
+
+// ===== PREFIX SCAN =====
+
+// In-register log-step (Hillis-Steele) scans: each vector of lanes is
+// scanned with log2(lanes) shift+add steps, then the running carry from
+// earlier vectors is added and the last lane becomes the new carry. The
+// float versions add in a different order than a sequential loop, so they
+// can differ from it in the last bits.
+#if defined(__AVX2__)
+inline __m256i scan_lanes(__m256i x) {
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    // Each 128-bit half is scanned; add the low half's total to the high half
+    __m256i low_total = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_add_epi32(x, _mm256_permute2x128_si256(low_total, low_total, 0x08));
+}
+
+inline __m256 scan_lanes(__m256 x) {
+    x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+    x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 8)));
+    __m256 low_total = _mm256_permute_ps(x, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_add_ps(x, _mm256_permute2f128_ps(low_total, low_total, 0x08));
+}
+
+inline int simd_scan(const int* in, int* out, std::size_t n, int carry) {
+    __m256i running = _mm256_set1_epi32(carry);
+    for (std::size_t i = 0; i + 8 <= n; i += 8) {
+        __m256i x = scan_lanes(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)));
+        x = _mm256_add_epi32(x, running);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+        running = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7));
+    }
+    return _mm256_cvtsi256_si32(running);
+}
+
+inline float simd_scan(const float* in, float* out, std::size_t n, float carry) {
+    __m256 running = _mm256_set1_ps(carry);
+    for (std::size_t i = 0; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_add_ps(scan_lanes(_mm256_loadu_ps(in + i)), running);
+        _mm256_storeu_ps(out + i, x);
+        running = _mm256_permutevar8x32_ps(x, _mm256_set1_epi32(7));
+    }
+    return _mm256_cvtss_f32(running);
+}
+
+constexpr std::size_t SCAN_LANES = 8;
+#elif defined(__SSE2__)
+inline int simd_scan(const int* in, int* out, std::size_t n, int carry) {
+    __m128i running = _mm_set1_epi32(carry);
+    for (std::size_t i = 0; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, running);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), x);
+        running = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    return _mm_cvtsi128_si32(running);
+}
+
+inline float simd_scan(const float* in, float* out, std::size_t n, float carry) {
+    __m128 running = _mm_set1_ps(carry);
+    for (std::size_t i = 0; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(in + i);
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+        x = _mm_add_ps(x, running);
+        _mm_storeu_ps(out + i, x);
+        running = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    return _mm_cvtss_f32(running);
+}
+
+constexpr std::size_t SCAN_LANES = 4;
+#else
+constexpr std::size_t SCAN_LANES = 1;
+#endif
+
+template<typename T, typename Op>
+concept SimdScannable = requires(const T* in, T* out, T carry) {
+    requires std::is_same_v<Op, std::plus<>> || std::is_same_v<Op, std::plus<T>>;
+    { simd_scan(in, out, std::size_t{0}, carry) } -> std::same_as<T>;
+};
+
+// Inclusive scan of in[0..n) into out (which may be in), continuing from
+// carry; returns the last value written
+template<typename T, typename Op>
+T scan_chunk(const T* in, T* out, std::size_t n, T carry, Op op) {
+    std::size_t i = 0;
+    if constexpr (SimdScannable<T, Op>) {
+        i = n - n % SCAN_LANES;
+        carry = simd_scan(in, out, i, carry);
+    }
+    for (; i < n; ++i) out[i] = carry = op(carry, in[i]);
+    return carry;
+}
+
+// Two-pass parallel scan: every chunk reduces its elements, the chunk
+// totals are scanned on the calling thread, and every chunk then scans
+// itself starting from the total of the chunks before it. Exclusive scans
+// start from init; inclusive ones fold init (if any) in front of in[0].
+// out may be in itself, but must not otherwise overlap it.
+template<typename T, typename Op>
+void par_scan_impl(ThreadPool& pool, const T* in, T* out, std::size_t n, std::optional<T> init, Op op,
+                   bool exclusive, std::size_t grain) {
+    if (n == 0) return;
+    // Without helpers the reduce pass is pure overhead, so scan in one
+    // chunk. Only for exact types: float results must not depend on the
+    // pool size.
+    grain = std::floating_point<T> || pool.size() > 0 ? resolve_grain(n, grain) : n;
+    const std::size_t chunks = (n + grain - 1) / grain;
+
+    // Pass 1: chunk totals; the last chunk's is never needed
+    std::vector<std::optional<T>> carry(chunks);
+    par_for_chunks(pool, n, grain, [&](std::size_t c, std::size_t begin, std::size_t end) {
+        if (c + 1 == chunks) return;
+        if constexpr (SimdScannable<T, Op> && std::floating_point<T>) {
+            carry[c + 1] = sum_chunk<Summation::Plain>(in + begin, end - begin).value();
+        } else {
+            carry[c + 1] = std::accumulate(in + begin + 1, in + end, in[begin], op);
+        }
+    });
+
+    // carry[c] becomes everything before chunk c
+    carry[0] = init;
+    for (std::size_t c = 1; c < chunks; ++c) {
+        if (carry[c - 1]) carry[c] = op(*carry[c - 1], *carry[c]);
+    }
+
+    // Pass 2: every chunk scans itself from its carry
+    par_for_chunks(pool, n, grain, [&](std::size_t c, std::size_t begin, std::size_t end) {
+        const std::size_t len = end - begin;
+        if (exclusive && in != out) {
+            out[begin] = *carry[c];
+            scan_chunk(in + begin, out + begin + 1, len - 1, *carry[c], op);
+        } else if (exclusive) {
+            // In place, each input must be read before its slot is overwritten
+            T running = *carry[c];
+            for (std::size_t i = begin; i < end; ++i) {
+                T x = in[i];
+                out[i] = running;
+                running = op(running, x);
+            }
+        } else if (carry[c]) {
+            scan_chunk(in + begin, out + begin, len, *carry[c], op);
+        } else {
+            out[begin] = in[begin];
+            scan_chunk(in + begin + 1, out + begin + 1, len - 1, in[begin], op);
+        }
+    });
+}
+
+// out[i] = in[0] op ... op in[i]. For int and float with std::plus the
+// per-chunk pass uses the in-register SIMD scan.
+template<std::ranges::contiguous_range In, std::ranges::contiguous_range Out, typename Op = std::plus<>>
+void par_inclusive_scan(ThreadPool& pool, const In& in, Out&& out, Op op = {}, std::size_t grain = 0) {
+    using T = std::ranges::range_value_t<In>;
+    static_assert(std::is_same_v<T, std::ranges::range_value_t<Out>>, "input and output element types differ");
+    if (std::ranges::size(out) < std::ranges::size(in)) {
+        throw std::invalid_argument("par_inclusive_scan: output range is shorter than input");
+    }
+    par_scan_impl<T>(pool, std::ranges::data(in), std::ranges::data(out), std::ranges::size(in), std::nullopt,
+                     op, false, grain);
+}
+
+template<std::ranges::contiguous_range In, std::ranges::contiguous_range Out, typename Op = std::plus<>>
+void par_inclusive_scan(const In& in, Out&& out, Op op = {}, std::size_t grain = 0) {
+    par_inclusive_scan(default_pool(), in, std::forward<Out>(out), op, grain);
+}
+
+// out[i] = init op in[0] op ... op in[i - 1]
+template<std::ranges::contiguous_range In, std::ranges::contiguous_range Out, typename T, typename Op = std::plus<>>
+void par_exclusive_scan(ThreadPool& pool, const In& in, Out&& out, T init, Op op = {}, std::size_t grain = 0) {
+    using V = std::ranges::range_value_t<In>;
+    static_assert(std::is_same_v<V, std::ranges::range_value_t<Out>>, "input and output element types differ");
+    if (std::ranges::size(out) < std::ranges::size(in)) {
+        throw std::invalid_argument("par_exclusive_scan: output range is shorter than input");
+    }
+    par_scan_impl<V>(pool, std::ranges::data(in), std::ranges::data(out), std::ranges::size(in),
+                     static_cast<V>(init), op, true, grain);
+}
+
+template<std::ranges::contiguous_range In, std::ranges::contiguous_range Out, typename T, typename Op = std::plus<>>
+void par_exclusive_scan(const In& in, Out&& out, T init, Op op = {}, std::size_t grain = 0) {
+    par_exclusive_scan(default_pool(), in, std::forward<Out>(out), init, op, grain);
+}
+
+// ===== PARALLEL SORT =====
+
+// Merges the sorted `runs` into `out` (which must hold all their elements)
+// in parallel. Splitter values sampled from the runs cut the output into
+// one slice per thread; each slice is found by binary search in every run
+// and then produced by a k-way merge, so each element is moved exactly once.
+template<typename T, typename Compare>
+void par_multiway_merge(ThreadPool& pool, const std::vector<std::span<const T>>& runs,
+                        std::span<T> out, Compare comp) {
+    const std::size_t k = runs.size();
+    const std::size_t parts = std::min<std::size_t>(par_concurrency(pool), std::max<std::size_t>(out.size() / 4096, 1));
+
+    // Evenly spaced samples from every run, then evenly spaced splitters
+    std::vector<T> samples;
+    const std::size_t per_run = 8 * parts;
+    for (const auto& run : runs) {
+        for (std::size_t s = 1; s < per_run && !run.empty(); ++s) {
+            samples.push_back(run[s * run.size() / per_run]);
+        }
+    }
+    std::sort(samples.begin(), samples.end(), comp);
+    std::vector<T> splitters;
+    for (std::size_t p = 1; p < parts && !samples.empty(); ++p) {
+        splitters.push_back(samples[p * samples.size() / parts]);
+    }
+    const std::size_t slices = splitters.size() + 1;
+
+    // cut[p][r]: where slice p starts in run r
+    std::vector<std::vector<std::size_t>> cut(slices + 1, std::vector<std::size_t>(k));
+    for (std::size_t r = 0; r < k; ++r) {
+        cut[0][r] = 0;
+        cut[slices][r] = runs[r].size();
+        for (std::size_t p = 1; p < slices; ++p) {
+            cut[p][r] = std::lower_bound(runs[r].begin(), runs[r].end(), splitters[p - 1], comp) - runs[r].begin();
+        }
+    }
+    std::vector<std::size_t> offset(slices + 1, 0);
+    for (std::size_t p = 0; p < slices; ++p) {
+        std::size_t size = 0;
+        for (std::size_t r = 0; r < k; ++r) size += cut[p + 1][r] - cut[p][r];
+        offset[p + 1] = offset[p] + size;
+    }
+
+    par_for_chunks(pool, slices, 1, [&](std::size_t p, std::size_t, std::size_t) {
+        // Min-heap of run cursors ordered by their current head element
+        std::vector<std::pair<const T*, const T*>> heads;
+        for (std::size_t r = 0; r < k; ++r) {
+            if (cut[p][r] < cut[p + 1][r]) {
+                heads.emplace_back(runs[r].data() + cut[p][r], runs[r].data() + cut[p + 1][r]);
+            }
+        }
+        auto later = [&](const auto& a, const auto& b) { return comp(*b.first, *a.first); };
+        std::make_heap(heads.begin(), heads.end(), later);
+
+        T* dest = out.data() + offset[p];
+        while (!heads.empty()) {
+            std::pop_heap(heads.begin(), heads.end(), later);
+            auto& head = heads.back();
+            *dest++ = *head.first++;
+            if (head.first == head.second) {
+                heads.pop_back();
+            } else {
+                std::push_heap(heads.begin(), heads.end(), later);
+            }
+        }
+    });
+}
+
+// Sorts each thread's chunk with std::sort, then merges the runs in parallel
+template<typename T, typename Compare = std::less<>>
+void par_sort(ThreadPool& pool, std::span<T> data, Compare comp = {}) {
+    const std::size_t chunk = chunk_per_thread(pool, data.size());
+    if (chunk >= data.size() || data.size() < 32768) {
+        std::sort(data.begin(), data.end(), comp);
+        return;
+    }
+
+    std::vector<std::span<const T>> runs;
+    for (std::size_t begin = 0; begin < data.size(); begin += chunk) {
+        runs.push_back(std::span<const T>(data.data() + begin, std::min(chunk, data.size() - begin)));
+    }
+    par_for_chunks(pool, data.size(), chunk, [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::sort(data.begin() + begin, data.begin() + end, comp);
+    });
+
+    ParallelBuffer<T> merged(data.size());
+    par_multiway_merge<T>(pool, runs, std::span<T>(merged), comp);
+    par_for_chunks(pool, data.size(), chunk, [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::copy(merged.begin() + begin, merged.begin() + end, data.begin() + begin);
+    });
+}
+
+template<typename T, typename Compare = std::less<>>
+void par_sort(std::span<T> data, Compare comp = {}) {
+    par_sort(default_pool(), data, comp);
+}
+
+// ===== RADIX SORT =====
+
+// Maps a key to an unsigned integer of the same width whose natural order
+// is the key's order: signed integers get their sign bit flipped, IEEE
+// floats get the sign bit set when positive and all bits inverted when
+// negative. -0.0 sorts before +0.0 and NaNs sort to the ends by sign.
+template<typename T>
+concept RadixSortable = (std::is_integral_v<T> && !std::is_same_v<T, bool>) || std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+template<RadixSortable T>
+auto radix_key(T value) {
+    using U = std::make_unsigned_t<std::conditional_t<std::is_same_v<T, float>, std::int32_t,
+                                   std::conditional_t<std::is_same_v<T, double>, std::int64_t, T>>>;
+    constexpr U sign = U{1} << (sizeof(U) * 8 - 1);
+    if constexpr (std::is_floating_point_v<T>) {
+        U bits = std::bit_cast<U>(value);
+        return (bits & sign) ? U(~bits) : U(bits | sign);
+    } else if constexpr (std::is_signed_v<T>) {
+        return U(U(value) ^ sign);
+    } else {
+        return U(value);
+    }
+}
+
+// Placeholder value type for key-only sorts
+struct NoValues {};
+
+template<typename K, typename V>
+void radix_sort_impl(ThreadPool& pool, std::span<K> keys, V* values) {
+    constexpr bool with_values = !std::is_same_v<V, NoValues>;
+    constexpr std::size_t RADIX = 256;
+    // Scatter goes through a small per-bucket staging buffer that is
+    // flushed one cache line at a time, so 256 output streams don't thrash
+    // the TLB and cache with single-element writes
+    constexpr std::size_t LINE = std::max<std::size_t>(64 / sizeof(K), 4);
+    using Hist = std::array<std::size_t, RADIX>;
+
+    const std::size_t n = keys.size();
+    const std::size_t chunk_size = std::max<std::size_t>(chunk_per_thread(pool, n), 1 << 14);
+    const std::size_t chunks = (n + chunk_size - 1) / chunk_size;
+
+    ParallelBuffer<K> key_scratch(n);
+    ParallelBuffer<std::conditional_t<with_values, V, char>> value_scratch(with_values ? n : 0);
+    K* key_src = keys.data();
+    K* key_dst = key_scratch.data();
+    auto* value_src = values;
+    auto* value_dst = value_scratch.data();
+
+    std::vector<Hist> hist(chunks);
+    for (unsigned shift = 0; shift < sizeof(K) * 8; shift += 8) {
+        auto digit = [shift](const K& key) { return static_cast<std::size_t>((radix_key(key) >> shift) & 0xFF); };
+
+        // Per-thread histograms of this digit
+        par_for_chunks(pool, n, chunk_size, [&](std::size_t c, std::size_t begin, std::size_t end) {
+            Hist& h = hist[c];
+            h.fill(0);
+            for (std::size_t i = begin; i < end; ++i) ++h[digit(key_src[i])];
+        });
+
+        // Skip digits every key shares (e.g. the high bytes of small ints)
+        bool trivial = false;
+        for (std::size_t b = 0; b < RADIX && !trivial; ++b) {
+            std::size_t total = 0;
+            for (const Hist& h : hist) total += h[b];
+            trivial = total == n;
+        }
+        if (trivial) continue;
+
+        // Turn counts into each chunk's starting position per bucket:
+        // bucket-major, then chunk order, which keeps the pass stable
+        std::size_t pos = 0;
+        for (std::size_t b = 0; b < RADIX; ++b) {
+            for (Hist& h : hist) {
+                std::size_t count = h[b];
+                h[b] = pos;
+                pos += count;
+            }
+        }
+
+        par_for_chunks(pool, n, chunk_size, [&](std::size_t c, std::size_t begin, std::size_t end) {
+            Hist& next = hist[c];
+            std::vector<K> key_buf(RADIX * LINE);
+            std::vector<std::conditional_t<with_values, V, char>> value_buf(with_values ? RADIX * LINE : 0);
+            std::array<std::uint8_t, RADIX> fill{};
+
+            auto flush = [&](std::size_t b, std::size_t count) {
+                std::copy_n(key_buf.data() + b * LINE, count, key_dst + next[b]);
+                if constexpr (with_values) {
+                    std::copy_n(value_buf.data() + b * LINE, count, value_dst + next[b]);
+                }
+                next[b] += count;
+            };
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t b = digit(key_src[i]);
+                key_buf[b * LINE + fill[b]] = key_src[i];
+                if constexpr (with_values) value_buf[b * LINE + fill[b]] = value_src[i];
+                if (++fill[b] == LINE) {
+                    flush(b, LINE);
+                    fill[b] = 0;
+                }
+            }
+            for (std::size_t b = 0; b < RADIX; ++b) flush(b, fill[b]);
+        });
+
+        std::swap(key_src, key_dst);
+        if constexpr (with_values) std::swap(value_src, value_dst);
+    }
+
+    // An odd number of passes leaves the result in the scratch buffers
+    if (key_src != keys.data()) {
+        par_for_chunks(pool, n, chunk_size, [&](std::size_t, std::size_t begin, std::size_t end) {
+            std::copy(key_src + begin, key_src + end, keys.data() + begin);
+            if constexpr (with_values) std::copy(value_src + begin, value_src + end, values + begin);
+        });
+    }
+}
+
+// Parallel LSD radix sort of integer or floating-point keys: one pass per
+// key byte (passes where every key has the same byte are skipped), each
+// with per-thread histograms and a buffered parallel scatter
+template<RadixSortable K>
+void par_radix_sort(ThreadPool& pool, std::span<K> keys) {
+    if (keys.size() < 2048) {
+        std::sort(keys.begin(), keys.end(), [](K a, K b) { return radix_key(a) < radix_key(b); });
+        return;
+    }
+    radix_sort_impl<K, NoValues>(pool, keys, nullptr);
+}
+
+template<RadixSortable K>
+void par_radix_sort(std::span<K> keys) {
+    par_radix_sort(default_pool(), keys);
+}
+
+// Sorts keys and applies the same permutation to values (which must be
+// the same length); stable, so equal keys keep their value order
+template<RadixSortable K, typename V>
+void par_radix_sort(ThreadPool& pool, std::span<K> keys, std::span<V> values) {
+    if (keys.size() != values.size()) {
+        throw std::invalid_argument("par_radix_sort: keys and values differ in length");
+    }
+    radix_sort_impl<K, V>(pool, keys, values.data());
+}
+
+template<RadixSortable K, typename V>
+void par_radix_sort(std::span<K> keys, std::span<V> values) {
+    par_radix_sort(default_pool(), keys, values);
+}
+
+// ===== STREAM COMPACTION =====
+
+// Arithmetic predicates that the compaction kernels recognise: for element
+// types that native_simd<T> maps onto intrinsics they are evaluated a whole
+// vector at a time and the matches packed with compress_store (simd.h).
+// Any other callable works too and takes the branchless scalar path.
+template<typename T>
+struct GreaterThan {
+    T value;
+    bool operator()(const T& x) const { return x > value; }
+    template<int N>
+    simd_mask<T, N> operator()(const simd<T, N>& x) const { return x > simd<T, N>(value); }
+};
+
+template<typename T>
+struct LessThan {
+    T value;
+    bool operator()(const T& x) const { return x < value; }
+    template<int N>
+    simd_mask<T, N> operator()(const simd<T, N>& x) const { return x < simd<T, N>(value); }
+};
+
+// The predicate is one of the above and native_simd<T> is not the scalar
+// fallback of simd_traits
+template<typename T, typename Pred>
+concept SimdPredicate =
+    (std::is_same_v<Pred, GreaterThan<T>> || std::is_same_v<Pred, LessThan<T>>) &&
+    !std::is_same_v<typename simd_traits<T, native_simd<T>::size>::reg, std::array<T, native_simd<T>::size>>;
+
+// Number of elements in [first, last) that satisfy pred
+template<typename T, typename Pred>
+std::size_t count_matches(const T* first, const T* last, Pred pred) {
+    std::size_t count = 0;
+    if constexpr (SimdPredicate<T, Pred>) {
+        using V = native_simd<T>;
+        for (; last - first >= V::size; first += V::size) {
+            count += static_cast<std::size_t>(pred(V::load(first)).count());
+        }
+    }
+    for (; first != last; ++first) {
+        count += static_cast<std::size_t>(pred(*first));
+    }
+    return count;
+}
+
+// Copies the elements of [first, last) that satisfy pred to out, preserving
+// order. out_end must be exactly where the last match lands (out plus
+// count_matches()), so nothing is ever written past it.
+template<typename T, typename Pred>
+void copy_matches(const T* first, const T* last, T* out, T* out_end, Pred pred) {
+    if constexpr (SimdPredicate<T, Pred>) {
+        using V = native_simd<T>;
+        // Full-vector compress stores while they can't spill past out_end...
+        for (; last - first >= V::size && out_end - out >= V::size; first += V::size) {
+            const V v = V::load(first);
+            out += compress_store(v, pred(v), out);
+        }
+        // ...then one element at a time
+        for (; last - first >= V::size && out != out_end; first += V::size) {
+            unsigned mask = pred(V::load(first)).bits();
+            while (mask) {
+                *out++ = first[__builtin_ctz(mask)];
+                mask &= mask - 1;
+            }
+        }
+    }
+    for (; first != last && out != out_end; ++first) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            // Branchless: always store, only advance on a match. The store
+            // stays in bounds because a match is still to come.
+            *out = *first;
+            out += pred(*first);
+        } else if (pred(*first)) {
+            *out++ = *first;
+        }
+    }
+}
+
+// Parallel copy_if into a presized output: every chunk counts its matches,
+// an exclusive scan of the counts gives each chunk its output offset, and
+// the chunks then scatter their matches in parallel. `out` must be able to
+// hold every match (input.size() is always enough). Returns the match count.
+template<typename T, typename Pred>
+std::size_t par_copy_if(ThreadPool& pool, std::span<const T> input, std::span<T> out, Pred pred,
+                        std::size_t chunk_size = 0) {
+    const std::size_t n = input.size();
+    if (chunk_size == 0) chunk_size = chunk_per_thread(pool, n);
+    const std::size_t chunks = n ? (n + chunk_size - 1) / chunk_size : 0;
+
+    std::vector<std::size_t> offsets(chunks + 1, 0);
+    par_for_chunks(pool, n, chunk_size, [&](std::size_t c, std::size_t begin, std::size_t end) {
+        offsets[c] = count_matches(input.data() + begin, input.data() + end, pred);
+    });
+    std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(), std::size_t{0});
+
+    par_for_chunks(pool, n, chunk_size, [&](std::size_t c, std::size_t begin, std::size_t end) {
+        copy_matches(input.data() + begin, input.data() + end, out.data() + offsets[c],
+                     out.data() + offsets[c + 1], pred);
+    });
+    return offsets[chunks];
+}
+
+// Parallel copy_if for any contiguous range; returns the matches in order
+template<std::ranges::contiguous_range Range, typename Pred>
+auto par_copy_if(ThreadPool& pool, const Range& range, Pred pred) {
+    using T = std::ranges::range_value_t<Range>;
+    std::span<const T> input(std::ranges::data(range), std::ranges::size(range));
+    ParallelBuffer<T> out(input.size());
+    out.resize(par_copy_if(pool, input, std::span<T>(out), pred));
+    return out;
+}
+
+template<std::ranges::contiguous_range Range, typename Pred>
+auto par_copy_if(const Range& range, Pred pred) {
+    return par_copy_if(default_pool(), range, pred);
+}
+
+// Parallel, stable remove_if over contiguous storage. Chunks compact
+// themselves in place in parallel; the surviving prefixes are then slid
+// down to their scanned offsets. Returns the new logical size.
+template<typename T, typename Pred>
+std::size_t par_remove_if(ThreadPool& pool, std::span<T> data, Pred pred) {
+    const std::size_t n = data.size();
+    const std::size_t chunk_size = chunk_per_thread(pool, n);
+    const std::size_t chunks = n ? (n + chunk_size - 1) / chunk_size : 0;
+    if (chunks == 0) return 0;
+
+    std::vector<std::size_t> kept(chunks, 0);
+    par_for_chunks(pool, n, chunk_size, [&](std::size_t c, std::size_t begin, std::size_t end) {
+        auto last = std::remove_if(data.begin() + begin, data.begin() + end, pred);
+        kept[c] = static_cast<std::size_t>(last - (data.begin() + begin));
+    });
+
+    // Chunk c only ever moves left, onto space already vacated by chunks < c
+    std::size_t size = kept[0];
+    for (std::size_t c = 1; c < chunks; ++c) {
+        auto begin = data.begin() + c * chunk_size;
+        std::move(begin, begin + kept[c], data.begin() + size);
+        size += kept[c];
+    }
+    return size;
+}
+
+// ===== FUSED PIPELINE =====
+
+// Builder for element-wise pipelines that run as ONE chunked pass per
+// thread instead of one full pass (and one temporary vector) per stage:
+//
+//   auto out = Pipeline<double>(data)
+//                  .filter([](double x) { return x > 0; })
+//                  .map([](double x) { return std::sin(x); })
+//                  .map([](double x) { return std::abs(x); })
+//                  .sorted()
+//                  .run();
+//
+// Each thread evaluates every stage for its chunk and writes the survivors
+// into a scratch buffer; an exclusive scan of the per-chunk counts gives each
+// chunk its output offset. Without a sort the chunks are then copied to
+// their offsets in parallel; with a sort each chunk is sorted while it is
+// still in cache and the sorted runs are merged straight into the output.
+//
+// The scratch buffer costs n elements and one extra copy of the survivors.
+// Counting first and writing at the scanned offsets would avoid both, but
+// it has to run every stage twice, because a filter may test a mapped
+// value; for any map heavier than a copy that costs more than the copy.
+// The merge needs its runs outside the output anyway.
+template<typename In, typename Out = In, typename Stage = void>
+class Pipeline {
+public:
+    Pipeline(std::span<const In> input, Stage stage, bool sort_output = false)
+        : input(input), stage(std::move(stage)), sort_output(sort_output) {}
+
+    // Keeps the elements for which pred(value) is true
+    template<typename Pred>
+    auto filter(Pred pred) const {
+        auto next = [stage = stage, pred](const In& in, Out& out) {
+            return stage(in, out) && pred(std::as_const(out));
+        };
+        return Pipeline<In, Out, decltype(next)>(input, std::move(next), sort_output);
+    }
+
+    // Replaces every value with f(value); f may change the element type
+    template<typename F>
+    auto map(F f) const {
+        using Next = std::decay_t<std::invoke_result_t<F, const Out&>>;
+        auto next = [stage = stage, f](const In& in, Next& out) {
+            Out value;
+            if (!stage(in, value)) return false;
+            out = f(std::as_const(value));
+            return true;
+        };
+        return Pipeline<In, Next, decltype(next)>(input, std::move(next), sort_output);
+    }
+
+    // Sorts the final output in ascending order
+    Pipeline sorted() const { return Pipeline(input, stage, true); }
+
+    ParallelBuffer<Out> run(ThreadPool& pool = default_pool()) const {
+        const std::size_t n = input.size();
+        const std::size_t chunk = chunk_per_thread(pool, n);
+        const std::size_t chunks = n ? (n + chunk - 1) / chunk : 0;
+
+        ParallelBuffer<Out> scratch(n);
+        std::vector<std::size_t> counts(chunks + 1, 0);
+
+        par_for_chunks(pool, n, chunk, [&](std::size_t c, std::size_t begin, std::size_t end) {
+            Out* dest = scratch.data() + begin;
+            std::size_t kept = 0;
+            for (std::size_t i = begin; i < end; ++i) {
+                kept += stage(input[i], dest[kept]);
+            }
+            if (sort_output) std::sort(dest, dest + kept);
+            counts[c] = kept;
+        });
+
+        // counts[c] becomes the output offset of chunk c, counts[chunks] the total
+        std::exclusive_scan(counts.begin(), counts.end(), counts.begin(), std::size_t{0});
+        ParallelBuffer<Out> result(counts[chunks]);
+
+        if (sort_output) {
+            std::vector<std::span<const Out>> runs;
+            for (std::size_t c = 0; c < chunks; ++c) {
+                runs.push_back(std::span<const Out>(scratch.data() + c * chunk, counts[c + 1] - counts[c]));
+            }
+            par_multiway_merge<Out>(pool, runs, std::span<Out>(result), std::less<>{});
+        } else {
+            par_for_chunks(pool, n, chunk, [&](std::size_t c, std::size_t begin, std::size_t) {
+                std::copy_n(scratch.data() + begin, counts[c + 1] - counts[c], result.data() + counts[c]);
+            });
+        }
+        return result;
+    }
+
+private:
+    std::span<const In> input;
+    Stage stage;
+    bool sort_output;
+};
+
+// Starting point: the identity stage that keeps every element
+template<typename In>
+class Pipeline<In, In, void> {
+public:
+    explicit Pipeline(std::span<const In> input) : input(input) {}
+
+    template<typename Pred>
+    auto filter(Pred pred) const { return start().filter(std::move(pred)); }
+
+    template<typename F>
+    auto map(F f) const { return start().map(std::move(f)); }
+
+    auto sorted() const { return start().sorted(); }
+
+    ParallelBuffer<In> run(ThreadPool& pool = default_pool()) const { return start().run(pool); }
+
+private:
+    std::span<const In> input;
+
+    auto start() const {
+        auto identity = [](const In& in, In& out) {
+            out = in;
+            return true;
+        };
+        return Pipeline<In, In, decltype(identity)>(input, identity);
+    }
+};
+
+template<typename T>
+Pipeline(const std::vector<T>&) -> Pipeline<T>;
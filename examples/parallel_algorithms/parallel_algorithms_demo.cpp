@@ -6,7 +6,16 @@
 #include <chrono>
 #include <random>
 #include <functional>
+#include <bit>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include "parallel.h"
+#include "simd_math.h"
 using namespace std;
 using namespace chrono;
 
@@ -54,6 +63,72 @@ void demonstrate_parallel_sort() {
     cout << "Speedup: " << speedup << "x" << endl << endl;
 }
 
+// LSD radix sort vs comparison sorts on fixed-width keys. 10M keys keep
+// the demo quick; the sort targets 10M-1B keys, so raise SIZE (memory
+// permitting, ~3x the key array) for the larger runs.
+template<typename T>
+void benchmark_radix_sort(const string& name, const vector<T>& data) {
+    auto time_sort = [&](const string& label, auto&& sort_fn) {
+        vector<T> keys = data;
+        auto start = high_resolution_clock::now();
+        sort_fn(keys);
+        auto end = high_resolution_clock::now();
+        cout << "  " << label << ": " << duration_cast<microseconds>(end - start).count() / 1000.0 << "ms" << endl;
+        return keys;
+    };
+
+    cout << name << " (" << data.size() << " keys):" << endl;
+    auto expected = time_sort("std::sort", [](vector<T>& v) { sort(v.begin(), v.end()); });
+    time_sort("std::sort(par)", [](vector<T>& v) { sort(execution::par, v.begin(), v.end()); });
+    time_sort("par_sort", [](vector<T>& v) { par_sort(span<T>(v)); });
+    auto radix = time_sort("par_radix_sort", [](vector<T>& v) { par_radix_sort(span<T>(v)); });
+    cout << "  Radix result matches: " << (radix == expected ? "Yes" : "No") << endl;
+}
+
+void demonstrate_radix_sort() {
+    cout << "=== Parallel Radix Sort ===\n" << endl;
+
+    const size_t SIZE = 10'000'000;
+    mt19937_64 gen(7);
+    cout << "Threads: " << par_concurrency(default_pool()) << endl;
+
+    vector<int> ints(SIZE);
+    uniform_int_distribution<int> int_dis(numeric_limits<int>::min(), numeric_limits<int>::max());
+    generate(ints.begin(), ints.end(), [&]() { return int_dis(gen); });
+    benchmark_radix_sort("int32", ints);
+
+    vector<double> doubles(SIZE);
+    normal_distribution<double> double_dis(0.0, 1e3);
+    generate(doubles.begin(), doubles.end(), [&]() { return double_dis(gen); });
+    benchmark_radix_sort("double", doubles);
+
+    // Key-value: sort record ids by a float score
+    vector<float> scores(SIZE);
+    vector<uint32_t> ids(SIZE);
+    uniform_real_distribution<float> score_dis(-1.0f, 1.0f);
+    for (size_t i = 0; i < SIZE; ++i) {
+        scores[i] = score_dis(gen);
+        ids[i] = static_cast<uint32_t>(i);
+    }
+    vector<pair<float, uint32_t>> pairs(SIZE);
+    for (size_t i = 0; i < SIZE; ++i) pairs[i] = {scores[i], ids[i]};
+
+    auto start = high_resolution_clock::now();
+    sort(execution::par, pairs.begin(), pairs.end());
+    auto end = high_resolution_clock::now();
+    cout << "float -> uint32 pairs:" << endl;
+    cout << "  std::sort(par) on pairs: " << duration_cast<microseconds>(end - start).count() / 1000.0 << "ms" << endl;
+
+    start = high_resolution_clock::now();
+    par_radix_sort(span<float>(scores), span<uint32_t>(ids));
+    end = high_resolution_clock::now();
+    cout << "  par_radix_sort(keys, values): " << duration_cast<microseconds>(end - start).count() / 1000.0 << "ms" << endl;
+
+    bool match = true;
+    for (size_t i = 0; i < SIZE && match; ++i) match = scores[i] == pairs[i].first;
+    cout << "  Keys match: " << (match ? "Yes" : "No") << endl << endl;
+}
+
 // ===== PARALLEL TRANSFORM =====
 
 // Parallel transform operations
@@ -93,8 +168,17 @@ void demonstrate_parallel_transform() {
 
     cout << "Parallel transform: " << par_duration.count() << "μs" << endl;
 
+    // Project backend on the ThreadPool
+    vector<double> output_pool(SIZE);
+    start = high_resolution_clock::now();
+    par_transform(input, output_pool, [](double x) { return sqrt(x * x + 1.0); });
+    end = high_resolution_clock::now();
+    auto pool_duration = duration_cast<microseconds>(end - start);
+
+    cout << "par_transform (ThreadPool): " << pool_duration.count() << "μs" << endl;
+
     // Verify results
-    bool results_match = true;
+    bool results_match = output_pool == output_seq;
     for (size_t i = 0; i < SIZE; ++i) {
         if (abs(output_seq[i] - output_par[i]) > 1e-10) {
             results_match = false;
@@ -138,13 +222,20 @@ void demonstrate_parallel_reduce() {
 
     // Parallel reduce
     start = high_resolution_clock::now();
-    int par_sum = reduce(execution::par, data.begin(), data.end(), 0);
+    int par_reduce_sum = reduce(execution::par, data.begin(), data.end(), 0);
     end = high_resolution_clock::now();
     auto par_duration = duration_cast<microseconds>(end - start);
 
-    cout << "Parallel reduce: " << par_duration.count() << "μs, sum = " << par_sum << endl;
+    cout << "Parallel reduce: " << par_duration.count() << "μs, sum = " << par_reduce_sum << endl;
+
+    start = high_resolution_clock::now();
+    int pool_sum = par_reduce(data, 0);
+    end = high_resolution_clock::now();
+    auto pool_duration = duration_cast<microseconds>(end - start);
+
+    cout << "par_reduce (ThreadPool): " << pool_duration.count() << "μs, sum = " << pool_sum << endl;
 
-    cout << "Results match: " << (seq_sum == par_sum ? "Yes" : "No") << endl;
+    cout << "Results match: " << (seq_sum == par_reduce_sum && seq_sum == pool_sum ? "Yes" : "No") << endl;
 
     // Custom reduction with multiplication
     start = high_resolution_clock::now();
@@ -162,7 +253,48 @@ void demonstrate_parallel_reduce() {
     par_duration = duration_cast<microseconds>(end - start);
 
     cout << "Parallel custom reduce (first 1000 elements): " << par_duration.count() << "μs" << endl;
-    cout << "Results match: " << (seq_product == par_product ? "Yes" : "No") << endl << endl;
+
+    // Chunk results are combined in chunk order, so op only has to be
+    // associative, not commutative
+    long long pool_product = par_transform_reduce(span<const int>(data.data(), 1000), 1LL, multiplies<>{},
+                                                  [](int x) { return static_cast<long long>(x % 10 + 1); }, 100);
+    cout << "Results match: " << (seq_product == par_product && seq_product == pool_product ? "Yes" : "No")
+         << endl;
+
+    // Floating-point sums: std::reduce(par) may combine partial sums in a
+    // different order on every run and thread count; par_sum never does
+    const size_t FP_SIZE = 10'000'000;
+    vector<double> values(FP_SIZE);
+    uniform_real_distribution<double> value_dis(-1.0, 1.0);
+    generate(values.begin(), values.end(), [&]() { return value_dis(gen) * pow(10.0, value_dis(gen) * 8); });
+
+    long double reference = 0.0L;
+    for (double v : values) reference += v;
+
+    cout << "\nSumming " << FP_SIZE << " doubles of mixed magnitude:" << endl;
+    auto time_sum = [&](const string& label, auto&& sum_fn) {
+        auto start = high_resolution_clock::now();
+        double sum = sum_fn();
+        auto end = high_resolution_clock::now();
+        cout << "  " << label << ": " << duration_cast<microseconds>(end - start).count() << "μs, error vs long double = "
+             << static_cast<double>(abs(static_cast<long double>(sum) - reference)) << endl;
+        return sum;
+    };
+    time_sum("std::reduce(par)", [&] { return reduce(execution::par, values.begin(), values.end(), 0.0); });
+    time_sum("par_sum (plain)", [&] { return par_sum(values); });
+    time_sum("par_sum (Kahan)", [&] { return par_sum(values, Summation::Kahan); });
+    time_sum("par_sum (Neumaier)", [&] { return par_sum(values, Summation::Neumaier); });
+
+    // Same bits whatever the thread count
+    bool identical = true;
+    double first_sum = 0.0;
+    for (size_t workers : {0u, 1u, 3u, 7u}) {
+        ThreadPool pool(workers);
+        double sum = par_sum(pool, values, Summation::Neumaier);
+        if (workers == 0) first_sum = sum;
+        identical = identical && bit_cast<uint64_t>(sum) == bit_cast<uint64_t>(first_sum);
+    }
+    cout << "  Bit-identical on 1, 2, 4 and 8 threads: " << (identical ? "Yes" : "No") << endl << endl;
 }
 
 // ===== PARALLEL FOR_EACH =====
@@ -202,8 +334,19 @@ void demonstrate_parallel_for_each() {
 
     cout << "Parallel for_each: " << par_duration.count() << "μs" << endl;
 
+    vector<int> pool_results(SIZE);
+    start = high_resolution_clock::now();
+    par_for_each(data, [&](int x) {
+        pool_results[x] = x * x + 1;
+    });
+    end = high_resolution_clock::now();
+    auto pool_duration = duration_cast<microseconds>(end - start);
+
+    cout << "par_for_each (ThreadPool): " << pool_duration.count() << "μs" << endl;
+
     // Verify results
-    bool results_match = equal(seq_results.begin(), seq_results.end(), par_results.begin());
+    bool results_match = equal(seq_results.begin(), seq_results.end(), par_results.begin()) &&
+                         pool_results == seq_results;
     cout << "Results match: " << (results_match ? "Yes" : "No") << endl;
 
     cout << "Sample results:" << endl;
@@ -258,7 +401,158 @@ void demonstrate_parallel_count_find() {
     par_duration = duration_cast<microseconds>(end - start);
 
     cout << "Parallel any_of (values > 95): " << par_duration.count() << "μs, result = "
-         << (has_large ? "Yes" : "No") << endl << endl;
+         << (has_large ? "Yes" : "No") << endl;
+
+    // Project backend: find_if stops chunks that start after a known match
+    start = high_resolution_clock::now();
+    auto pool_count = par_count_if(data, [](int x) { return x % 2 == 0; });
+    end = high_resolution_clock::now();
+    cout << "par_count_if (ThreadPool): " << duration_cast<microseconds>(end - start).count()
+         << "μs, count = " << pool_count << endl;
+
+    start = high_resolution_clock::now();
+    auto pool_found = par_find_if(data, [](int x) { return x == 42; });
+    end = high_resolution_clock::now();
+    cout << "par_find_if (ThreadPool): " << duration_cast<microseconds>(end - start).count()
+         << "μs, same position = " << (pool_found - data.begin() == found - data.begin() ? "Yes" : "No") << endl;
+
+    start = high_resolution_clock::now();
+    bool pool_large = par_any_of(data, [](int x) { return x > 95; });
+    end = high_resolution_clock::now();
+    cout << "par_any_of (ThreadPool): " << duration_cast<microseconds>(end - start).count()
+         << "μs, result = " << (pool_large ? "Yes" : "No") << endl << endl;
+}
+
+// ===== PREFIX SCAN =====
+
+// Two-pass parallel scan with an in-register SIMD scan per chunk, against
+// the standard library's inclusive_scan
+void demonstrate_prefix_scan() {
+    cout << "=== Parallel Prefix Scan ===\n" << endl;
+
+    const size_t SIZE = 10'000'000;
+    vector<int> ints(SIZE);
+    vector<float> floats(SIZE);
+    mt19937 gen(3);
+    uniform_int_distribution<int> dis(0, 100);
+    for (size_t i = 0; i < SIZE; ++i) {
+        ints[i] = dis(gen);
+        floats[i] = ints[i] * 0.01f;
+    }
+
+    auto benchmark = [&](const string& name, const auto& data) {
+        using T = typename decay_t<decltype(data)>::value_type;
+        vector<T> expected(SIZE);
+        vector<T> out(SIZE);
+        cout << name << " (" << SIZE << " elements):" << endl;
+
+        auto start = high_resolution_clock::now();
+        inclusive_scan(data.begin(), data.end(), expected.begin());
+        auto end = high_resolution_clock::now();
+        auto seq_duration = duration_cast<microseconds>(end - start);
+        cout << "  std::inclusive_scan: " << seq_duration.count() << "μs" << endl;
+
+        start = high_resolution_clock::now();
+        inclusive_scan(execution::par, data.begin(), data.end(), out.begin());
+        end = high_resolution_clock::now();
+        cout << "  std::inclusive_scan(par): " << duration_cast<microseconds>(end - start).count() << "μs" << endl;
+
+        start = high_resolution_clock::now();
+        par_inclusive_scan(data, out);
+        end = high_resolution_clock::now();
+        auto pool_duration = duration_cast<microseconds>(end - start);
+        cout << "  par_inclusive_scan: " << pool_duration.count() << "μs ("
+             << (double)seq_duration.count() / max<long long>(1, pool_duration.count()) << "x)" << endl;
+
+        // Floats add in a different order, so compare with a tolerance
+        double max_error = 0.0;
+        for (size_t i = 0; i < SIZE; ++i) {
+            max_error = max(max_error, abs(static_cast<double>(out[i]) - static_cast<double>(expected[i])) /
+                                           max(1.0, abs(static_cast<double>(expected[i]))));
+        }
+        cout << "  Max relative difference: " << max_error << endl;
+
+        start = high_resolution_clock::now();
+        par_exclusive_scan(data, out, T{});
+        end = high_resolution_clock::now();
+        cout << "  par_exclusive_scan: " << duration_cast<microseconds>(end - start).count() << "μs" << endl;
+    };
+
+    benchmark("int32", ints);
+    benchmark("float", floats);
+    cout << endl;
+}
+
+// ===== STREAM COMPACTION =====
+
+// copy_if scaling: count per chunk, exclusive scan, parallel scatter.
+// 10M floats keep the demo quick; the kernel is meant for 10M-1B elements,
+// so raise SIZE (memory permitting) to measure the DRAM-bound regime.
+void demonstrate_stream_compaction() {
+    cout << "=== Parallel Stream Compaction ===\n" << endl;
+
+    const size_t SIZE = 10'000'000;
+    vector<float> data(SIZE);
+    mt19937 gen(42);
+    uniform_real_distribution<float> dis(0.0f, 1.0f);
+    generate(data.begin(), data.end(), [&]() { return dis(gen); });
+
+    cout << "copy_if(x > 0.5) on " << SIZE << " floats" << endl;
+
+    auto start = high_resolution_clock::now();
+    vector<float> seq_result;
+    copy_if(data.begin(), data.end(), back_inserter(seq_result), [](float x) { return x > 0.5f; });
+    auto end = high_resolution_clock::now();
+    auto seq_duration = duration_cast<microseconds>(end - start);
+    cout << "std::copy_if (sequential): " << seq_duration.count() / 1000.0 << "ms, kept = " << seq_result.size() << endl;
+
+    start = high_resolution_clock::now();
+    vector<float> policy_result(SIZE);
+    auto policy_end = copy_if(execution::par, data.begin(), data.end(), policy_result.begin(),
+                              [](float x) { return x > 0.5f; });
+    policy_result.erase(policy_end, policy_result.end());
+    end = high_resolution_clock::now();
+    cout << "std::copy_if (execution::par): " << duration_cast<microseconds>(end - start).count() / 1000.0
+         << "ms" << endl;
+
+    // One pool per thread count; the calling thread is the extra worker
+    vector<unsigned> thread_counts;
+    unsigned hw = max(1u, thread::hardware_concurrency());
+    for (unsigned t = 1; t < hw; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(hw);
+
+    cout << "threads   lambda(ms)   GreaterThan(ms)   speedup vs sequential" << endl;
+    bool all_match = true;
+    for (unsigned threads : thread_counts) {
+        ThreadPool pool(threads - 1);
+
+        start = high_resolution_clock::now();
+        auto by_lambda = par_copy_if(pool, data, [](float x) { return x > 0.5f; });
+        end = high_resolution_clock::now();
+        auto lambda_duration = duration_cast<microseconds>(end - start);
+
+        start = high_resolution_clock::now();
+        auto by_threshold = par_copy_if(pool, data, GreaterThan<float>{0.5f});
+        end = high_resolution_clock::now();
+        auto threshold_duration = duration_cast<microseconds>(end - start);
+
+        all_match = all_match &&
+                    equal(seq_result.begin(), seq_result.end(), by_lambda.begin(), by_lambda.end()) &&
+                    equal(seq_result.begin(), seq_result.end(), by_threshold.begin(), by_threshold.end());
+
+        cout << "  " << threads << "\t  " << lambda_duration.count() / 1000.0
+             << "\t       " << threshold_duration.count() / 1000.0
+             << "\t\t   " << (double)seq_duration.count() / max<long long>(1, threshold_duration.count()) << "x" << endl;
+    }
+    cout << "Results match sequential: " << (all_match ? "Yes" : "No") << endl;
+
+    start = high_resolution_clock::now();
+    auto remaining = data;
+    remaining.resize(par_remove_if(default_pool(), span<float>(remaining), [](float x) { return x > 0.5f; }));
+    end = high_resolution_clock::now();
+    cout << "par_remove_if (in place, " << par_concurrency(default_pool()) << " threads): "
+         << duration_cast<microseconds>(end - start).count() / 1000.0 << "ms, kept = " << remaining.size() << endl;
+    cout << endl;
 }
 
 // ===== COMPLEX PARALLEL PIPELINE =====
@@ -324,6 +618,50 @@ void demonstrate_parallel_pipeline() {
 
     cout << "Parallel pipeline: " << par_duration.count() << "ms, results = " << par_result.size() << endl;
 
+    // Fused pipeline: one chunked pass per thread, prefix-sum compaction,
+    // parallel merge of the per-chunk sorted runs
+    start = high_resolution_clock::now();
+
+    auto fused_result = Pipeline(data)
+                            .filter([](double x) { return x > 0; })
+                            .map([](double x) { return sin(x); })
+                            .map([](double x) { return abs(x); })
+                            .sorted()
+                            .run();
+
+    end = high_resolution_clock::now();
+    auto fused_duration = duration_cast<milliseconds>(end - start);
+
+    cout << "Fused pipeline (" << par_concurrency(default_pool()) << " threads): "
+         << fused_duration.count() << "ms, results = " << fused_result.size() << endl;
+    cout << "Fused result matches sequential: "
+         << (equal(seq_result.begin(), seq_result.end(), fused_result.begin(), fused_result.end()) ? "Yes" : "No")
+         << endl;
+
+    // Batched pipeline: the sin stage runs vsin over each chunk instead of
+    // calling libm per element, so it vectorizes like the other stages
+    start = high_resolution_clock::now();
+
+    auto batched_result = par_copy_if(data, [](double x) { return x > 0; });
+    const size_t kept = batched_result.size();
+    par_for_chunks(default_pool(), kept, default_grain(kept), [&](size_t, size_t begin, size_t end) {
+        span<double> chunk(batched_result.data() + begin, end - begin);
+        vsin(chunk, chunk);
+        for (double& v : chunk) v = abs(v);
+    });
+    par_sort(span<double>(batched_result.data(), kept));
+
+    end = high_resolution_clock::now();
+    auto batched_duration = duration_cast<milliseconds>(end - start);
+
+    // vsin is within 1.5 ULP of libm, so compare with a tolerance
+    double max_diff = 0.0;
+    for (size_t i = 0; i < min(kept, seq_result.size()); ++i) {
+        max_diff = max(max_diff, abs(batched_result[i] - seq_result[i]));
+    }
+    cout << "Batched vsin pipeline: " << batched_duration.count() << "ms, results = " << kept
+         << ", max difference from sequential = " << max_diff << endl;
+
     // Verify results are approximately the same (sorting may differ for equal elements)
     bool sizes_match = seq_result.size() == par_result.size();
     cout << "Result sizes match: " << (sizes_match ? "Yes" : "No") << endl;
@@ -350,13 +688,22 @@ void demonstrate_parallel_pipeline() {
 void demonstrate_execution_policies() {
     cout << "=== Execution Policy Comparison ===\n" << endl;
 
-    const int SIZE = 100000;
+    const int SIZE = 1000000;
     vector<int> data(SIZE);
     iota(data.begin(), data.end(), 0);
 
     vector<long long> results_seq(SIZE);
     vector<long long> results_par(SIZE);
     vector<long long> results_par_unseq(SIZE);
+    vector<long long> results_pool(SIZE);
+
+    // libstdc++ only runs execution::par in parallel when built against TBB
+#if defined(_PSTL_PAR_BACKEND_TBB) || defined(__PSTL_PAR_BACKEND_TBB)
+    cout << "Standard library parallel backend: TBB" << endl;
+#else
+    cout << "Standard library parallel backend: none (execution::par runs sequentially)" << endl;
+#endif
+    cout << "Project ThreadPool backend: " << par_concurrency(default_pool()) << " threads" << endl;
 
     auto computation = [](int x) -> long long {
         long long result = 1;
@@ -392,12 +739,23 @@ void demonstrate_execution_policies() {
 
     cout << "Parallel unsequenced: " << par_unseq_duration.count() << "ms" << endl;
 
+    // Project backend
+    start = high_resolution_clock::now();
+    par_transform(data, results_pool, computation);
+    end = high_resolution_clock::now();
+    auto pool_duration = duration_cast<milliseconds>(end - start);
+
+    cout << "par_transform (ThreadPool): " << pool_duration.count() << "ms, speedup "
+         << (double)seq_duration.count() / max<long long>(1, pool_duration.count()) << "x" << endl;
+
     // Verify results
     bool par_match = equal(results_seq.begin(), results_seq.end(), results_par.begin());
     bool par_unseq_match = equal(results_seq.begin(), results_seq.end(), results_par_unseq.begin());
+    bool pool_match = results_pool == results_seq;
 
     cout << "Parallel results match: " << (par_match ? "Yes" : "No") << endl;
     cout << "Parallel unsequenced results match: " << (par_unseq_match ? "Yes" : "No") << endl;
+    cout << "ThreadPool results match: " << (pool_match ? "Yes" : "No") << endl;
 
     cout << "Sample results (x -> f(x)):" << endl;
     for (int i = 0; i < 5; ++i) {
@@ -410,10 +768,13 @@ int main() {
     cout << "=== C++17 Parallel Algorithms Demo ===\n" << endl;
 
     demonstrate_parallel_sort();
+    demonstrate_radix_sort();
     demonstrate_parallel_transform();
     demonstrate_parallel_reduce();
     demonstrate_parallel_for_each();
     demonstrate_parallel_count_find();
+    demonstrate_prefix_scan();
+    demonstrate_stream_compaction();
     demonstrate_parallel_pipeline();
     demonstrate_execution_policies();
 
@@ -424,6 +785,13 @@ int main() {
     cout << "• Not all algorithms benefit from parallelization" << endl;
     cout << "• Thread safety is guaranteed for parallel algorithms" << endl;
     cout << "• Results are identical to sequential versions" << endl;
+    cout << "• Fusing element-wise stages saves a memory pass per stage" << endl;
+    cout << "• Count, scan, scatter turns copy_if into two parallel passes" << endl;
+    cout << "• Radix sort beats comparison sorts on fixed-width keys" << endl;
+    cout << "• The par_* ThreadPool backend runs in parallel with or without TBB" << endl;
+    cout << "• A fixed chunk tree makes floating-point sums reproducible" << endl;
+    cout << "• Prefix scans vectorize with log-step shifts inside a register" << endl;
+    cout << "• Batched vsin keeps transcendental stages vectorized" << endl;
 
     return 0;
 }
\ No newline at end of file
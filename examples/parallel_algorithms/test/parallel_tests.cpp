@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../parallel.h"
+
+std::vector<double> random_doubles(std::size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<> dis(-10.0, 10.0);
+    std::vector<double> data(n);
+    for (auto& x : data) x = dis(gen);
+    return data;
+}
+
+void test_chunks(ThreadPool& pool) {
+    std::vector<int> hits(1001, 0);
+    par_for_chunks(pool, hits.size(), 64, [&]([[maybe_unused]] std::size_t chunk, std::size_t begin, std::size_t end) {
+        assert(begin == chunk * 64);
+        for (std::size_t i = begin; i < end; ++i) ++hits[i];
+    });
+    assert(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }));
+
+    [[maybe_unused]] bool thrown = false;
+    try {
+        par_for_chunks(pool, 100, 10, [](std::size_t chunk, std::size_t, std::size_t) {
+            if (chunk == 3) throw std::runtime_error("chunk failed");
+        });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_algorithms(ThreadPool& pool) {
+    for (std::size_t n : {0u, 1u, 5000u, 1000003u}) {
+        std::vector<int> data(n);
+        std::iota(data.begin(), data.end(), 0);
+
+        std::vector<long long> squares(n);
+        par_transform(pool, data, squares, [](int x) { return static_cast<long long>(x) * x; }, 1000);
+        for (std::size_t i = 0; i < n; ++i) assert(squares[i] == static_cast<long long>(i) * static_cast<long long>(i));
+
+        auto copy = data;
+        par_for_each(pool, copy, [](int& x) { x = -x; });
+        for (std::size_t i = 0; i < n; ++i) assert(copy[i] == -static_cast<int>(i));
+
+        [[maybe_unused]] long long sum = par_reduce(pool, data, 0LL);
+        assert(sum == static_cast<long long>(n) * (static_cast<long long>(n) - 1) / 2);
+        assert(par_count_if(pool, data, [](int x) { return x % 3 == 0; }) == (n + 2) / 3);
+
+        // First match wins even when later chunks also match
+        [[maybe_unused]] auto it = par_find_if(pool, data, [](int x) { return x >= 4321 && x % 2 == 1; }, 512);
+        assert(n > 4321 ? *it == 4321 : it == data.end());
+        assert(par_find_if(pool, data, [](int x) { return x < 0; }) == data.end());
+        assert(par_any_of(pool, data, [&](int x) { return x == static_cast<int>(n) - 1; }) == (n > 0));
+    }
+
+    // Chunk-order combination: a non-associative, non-commutative reduce
+    // gives the same answer for any pool size at a fixed grain
+    std::vector<std::string> words(10000);
+    for (std::size_t i = 0; i < words.size(); ++i) words[i] = std::to_string(i % 10);
+    std::string expected = std::accumulate(words.begin(), words.end(), std::string());
+    assert(par_reduce(pool, words, std::string(), std::plus<>{}, 64) == expected);
+
+    [[maybe_unused]] bool thrown = false;
+    try {
+        std::vector<int> in(10);
+        std::vector<int> out(5);
+        par_transform(pool, in, out, [](int x) { return x; });
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_deterministic_sum() {
+    auto data = random_doubles(1000003, 23);
+    for (auto& x : data) x *= std::pow(10.0, static_cast<int>(std::abs(x)) - 5);
+
+    for (Summation mode : {Summation::Plain, Summation::Kahan, Summation::Neumaier}) {
+        ThreadPool serial(0);
+        [[maybe_unused]] const double expected = par_sum(serial, data, mode);
+        for (std::size_t workers : {1u, 2u, 7u}) {
+            ThreadPool pool(workers);
+            assert(std::bit_cast<std::uint64_t>(par_sum(pool, data, mode)) == std::bit_cast<std::uint64_t>(expected));
+        }
+    }
+
+    // Compensation recovers what plain summation loses
+    // (lane 0 sees 1e100, 1, -1e100 over and over)
+    std::vector<double> cancelling(24000, 1.0);
+    for (std::size_t i = 0; i < cancelling.size(); i += 24) {
+        cancelling[i] = 1e100;
+        cancelling[i + 16] = -1e100;
+    }
+    ThreadPool pool(3);
+    assert(par_sum(pool, cancelling, Summation::Plain) != 22000.0);
+    assert(par_sum(pool, cancelling, Summation::Neumaier) == 22000.0);
+
+    std::vector<float> small(1 << 20, 0.1f);
+    [[maybe_unused]] const double exact = 0.1f * static_cast<double>(small.size());
+    [[maybe_unused]] float plain = par_sum(pool, small, Summation::Plain, small.size());
+    [[maybe_unused]] float kahan = par_sum(pool, small, Summation::Kahan, small.size());
+    assert(std::abs(kahan - exact) < std::abs(plain - exact));
+    assert(std::abs(kahan - exact) / exact < 1e-6);
+
+    assert(par_sum(pool, std::vector<double>{}, Summation::Kahan) == 0.0);
+}
+
+void test_scan(ThreadPool& pool) {
+    for (std::size_t n : {0u, 1u, 3u, 17u, 4096u, 100003u}) {
+        std::vector<int> ints(n);
+        for (std::size_t i = 0; i < n; ++i) ints[i] = static_cast<int>(i * 7919 % 201) - 100;
+
+        std::vector<int> expected(n);
+        std::inclusive_scan(ints.begin(), ints.end(), expected.begin());
+        std::vector<int> out(n);
+        par_inclusive_scan(pool, ints, out, std::plus<>{}, 1000);
+        assert(out == expected);
+
+        auto in_place = ints;
+        par_inclusive_scan(pool, in_place, in_place);
+        assert(in_place == expected);
+
+        std::exclusive_scan(ints.begin(), ints.end(), expected.begin(), 5);
+        par_exclusive_scan(pool, ints, out, 5, std::plus<>{}, 1000);
+        assert(out == expected);
+        in_place = ints;
+        par_exclusive_scan(pool, in_place, in_place, 5, std::plus<>{}, 1000);
+        assert(in_place == expected);
+
+        // Non-SIMD element type and operator
+        std::vector<long long> longs(ints.begin(), ints.end());
+        std::vector<long long> max_expected(n);
+        auto max_op = [](long long a, long long b) { return std::max(a, b); };
+        std::inclusive_scan(longs.begin(), longs.end(), max_expected.begin(), max_op);
+        std::vector<long long> max_out(n);
+        par_inclusive_scan(pool, longs, max_out, max_op, 100);
+        assert(max_out == max_expected);
+
+        // Floats: multiples of 0.25 add exactly in any order
+        std::vector<float> floats(ints.begin(), ints.end());
+        for (auto& x : floats) x *= 0.25f;
+        std::vector<float> float_expected(n);
+        std::inclusive_scan(floats.begin(), floats.end(), float_expected.begin());
+        std::vector<float> float_out(n);
+        par_inclusive_scan(pool, floats, float_out);
+        for (std::size_t i = 0; i < n; ++i) assert(float_out[i] == float_expected[i]);
+    }
+}
+
+void test_sort(ThreadPool& pool) {
+    for (std::size_t n : {0u, 1u, 1000u, 100000u, 250001u}) {
+        auto data = random_doubles(n, 7);
+        auto expected = data;
+        std::sort(expected.begin(), expected.end());
+        par_sort(pool, std::span<double>(data));
+        assert(data == expected);
+    }
+    std::vector<int> few_unique(200000);
+    for (std::size_t i = 0; i < few_unique.size(); ++i) few_unique[i] = static_cast<int>(i * 7919 % 5);
+    auto expected = few_unique;
+    std::sort(expected.begin(), expected.end());
+    par_sort(pool, std::span<int>(few_unique));
+    assert(few_unique == expected);
+}
+
+void test_pipeline(ThreadPool& pool) {
+    auto data = random_doubles(300000, 11);
+    std::vector<double> expected;
+    for (double x : data) {
+        if (x > 0) expected.push_back(std::abs(std::sin(x)));
+    }
+
+    auto unsorted = Pipeline(data)
+                        .filter([](double x) { return x > 0; })
+                        .map([](double x) { return std::sin(x); })
+                        .map([](double x) { return std::abs(x); })
+                        .run(pool);
+    assert(std::equal(expected.begin(), expected.end(), unsorted.begin(), unsorted.end()));
+
+    std::sort(expected.begin(), expected.end());
+    auto sorted = Pipeline(data)
+                      .filter([](double x) { return x > 0; })
+                      .map([](double x) { return std::abs(std::sin(x)); })
+                      .sorted()
+                      .run(pool);
+    assert(std::equal(expected.begin(), expected.end(), sorted.begin(), sorted.end()));
+
+    // Type-changing map followed by a filter on the new type
+    auto ints = Pipeline(data)
+                    .map([](double x) { return static_cast<int>(x); })
+                    .filter([](int v) { return v % 2 == 0; })
+                    .run(pool);
+    [[maybe_unused]] std::size_t even = std::count_if(data.begin(), data.end(), [](double x) { return static_cast<int>(x) % 2 == 0; });
+    assert(ints.size() == even);
+}
+
+// The count/copy kernels behind par_copy_if, with the recognised
+// predicates; copies go into an output of exactly the match count with
+// guard values behind it, so a vector store past out_end would show
+template<typename T, typename Pred>
+void check_match_kernels(const std::vector<T>& data, Pred pred) {
+    std::vector<T> expected;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(expected), pred);
+    const T* first = data.data();
+    const T* last = first + data.size();
+    assert(count_matches(first, last, pred) == expected.size());
+
+    const T guard = T(12345);
+    std::vector<T> out(expected.size() + 8, guard);
+    copy_matches(first, last, out.data(), out.data() + expected.size(), pred);
+    assert(std::equal(expected.begin(), expected.end(), out.begin()));
+    assert(std::all_of(out.begin() + expected.size(), out.end(), [&](T x) { return x == guard; }));
+}
+
+void test_match_kernels() {
+    for (std::size_t n : {0u, 5u, 8u, 13u, 64u, 1003u}) {
+        const auto data = random_doubles(n, 17);
+        std::vector<float> floats(data.begin(), data.end());
+        std::vector<int> ints(n);
+        std::transform(data.begin(), data.end(), ints.begin(), [](double x) { return static_cast<int>(x * 100); });
+        for (float v : {-11.0f, -1.0f, 0.0f, 9.5f, 11.0f}) {
+            check_match_kernels(floats, GreaterThan<float>{v});
+            check_match_kernels(floats, LessThan<float>{v});
+        }
+        std::vector<std::int64_t> longs(ints.begin(), ints.end());
+        for (int v : {-1100, -100, 0, 950, 1100}) {
+            check_match_kernels(ints, GreaterThan<int>{v});
+            check_match_kernels(ints, LessThan<int>{v});
+            check_match_kernels(longs, GreaterThan<std::int64_t>{v});
+            check_match_kernels(data, LessThan<double>{v / 100.0});
+        }
+    }
+}
+
+void test_compaction(ThreadPool& pool) {
+    for (std::size_t n : {0u, 1u, 7u, 1000u, 100003u}) {
+        auto data = random_doubles(n, 13);
+        std::vector<double> expected;
+        std::copy_if(data.begin(), data.end(), std::back_inserter(expected), [](double x) { return x > 2.5; });
+
+        auto lambda = par_copy_if(pool, data, [](double x) { return x > 2.5; });
+        assert(std::equal(expected.begin(), expected.end(), lambda.begin(), lambda.end()));
+
+        // Recognised arithmetic predicates (vectorized for float and int)
+        std::vector<float> floats(data.begin(), data.end());
+        std::vector<int> ints(n);
+        std::transform(data.begin(), data.end(), ints.begin(), [](double x) { return static_cast<int>(x * 100); });
+        auto floats_kept = par_copy_if(pool, floats, LessThan<float>{-1.0f});
+        auto ints_kept = par_copy_if(pool, ints, GreaterThan<int>{250});
+        assert(floats_kept.size() == static_cast<std::size_t>(std::count_if(floats.begin(), floats.end(), [](float x) { return x < -1.0f; })));
+        std::vector<int> ints_expected;
+        std::copy_if(ints.begin(), ints.end(), std::back_inserter(ints_expected), [](int v) { return v > 250; });
+        assert(std::equal(ints_expected.begin(), ints_expected.end(), ints_kept.begin(), ints_kept.end()));
+
+        // Small explicit chunks exercise the scan across many chunks
+        std::vector<double> out(n);
+        [[maybe_unused]] std::size_t kept = par_copy_if(pool, std::span<const double>(data), std::span<double>(out),
+                                       [](double x) { return x > 2.5; }, 100);
+        assert(kept == expected.size());
+        assert(std::equal(expected.begin(), expected.end(), out.begin()));
+
+        auto removed = data;
+        removed.erase(std::remove_if(removed.begin(), removed.end(), [](double x) { return x > 2.5; }), removed.end());
+        auto in_place = data;
+        in_place.resize(par_remove_if(pool, std::span<double>(in_place), [](double x) { return x > 2.5; }));
+        assert(in_place == removed);
+    }
+}
+
+void test_radix_sort(ThreadPool& pool) {
+    std::mt19937 gen(5);
+    for (std::size_t n : {0u, 1u, 1000u, 100000u, 300007u}) {
+        std::vector<int> ints(n);
+        std::uniform_int_distribution<int> int_dis(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+        for (auto& v : ints) v = int_dis(gen);
+        auto expected_ints = ints;
+        std::sort(expected_ints.begin(), expected_ints.end());
+        par_radix_sort(pool, std::span<int>(ints));
+        assert(ints == expected_ints);
+
+        // Small non-negative keys: the high-byte passes are skipped
+        std::vector<std::uint64_t> small(n);
+        for (auto& v : small) v = gen() % 1000;
+        auto expected_small = small;
+        std::sort(expected_small.begin(), expected_small.end());
+        par_radix_sort(pool, std::span<std::uint64_t>(small));
+        assert(small == expected_small);
+
+        auto doubles = random_doubles(n, 17);
+        if (n > 4) {
+            doubles[0] = -0.0;
+            doubles[1] = 0.0;
+            doubles[2] = -std::numeric_limits<double>::infinity();
+            doubles[3] = std::numeric_limits<double>::infinity();
+        }
+        auto expected_doubles = doubles;
+        std::sort(expected_doubles.begin(), expected_doubles.end());
+        par_radix_sort(pool, std::span<double>(doubles));
+        assert(doubles == expected_doubles);
+
+        std::vector<float> floats(n);
+        std::uniform_real_distribution<float> float_dis(-1e6f, 1e6f);
+        for (auto& v : floats) v = float_dis(gen);
+        auto expected_floats = floats;
+        std::sort(expected_floats.begin(), expected_floats.end());
+        par_radix_sort(pool, std::span<float>(floats));
+        assert(floats == expected_floats);
+
+        // Key-value: stable, so equal keys keep their original order
+        std::vector<std::int16_t> keys(n);
+        std::vector<std::size_t> values(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            keys[i] = static_cast<std::int16_t>(static_cast<int>(gen() % 200) - 100);
+            values[i] = i;
+        }
+        std::vector<std::pair<std::int16_t, std::size_t>> expected_pairs;
+        for (std::size_t i = 0; i < n; ++i) expected_pairs.emplace_back(keys[i], values[i]);
+        std::stable_sort(expected_pairs.begin(), expected_pairs.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        par_radix_sort(pool, std::span<std::int16_t>(keys), std::span<std::size_t>(values));
+        for (std::size_t i = 0; i < n; ++i) {
+            assert(keys[i] == expected_pairs[i].first && values[i] == expected_pairs[i].second);
+        }
+    }
+
+    [[maybe_unused]] bool thrown = false;
+    try {
+        std::vector<int> keys(3);
+        std::vector<int> values(2);
+        par_radix_sort(pool, std::span<int>(keys), std::span<int>(values));
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+int main() {
+    // Variants built for a wider ISA skip (exit code 77, SKIP_RETURN_CODE
+    // in CMake) on a CPU that can't run them
+    if (const char* missing = simd_missing_build_feature()) {
+        std::printf("%s not supported, skipping\n", missing);
+        return 77;
+    }
+    for (std::size_t workers : {0u, 3u}) {
+        ThreadPool pool(workers);
+        test_chunks(pool);
+        test_algorithms(pool);
+        test_scan(pool);
+        test_sort(pool);
+        test_pipeline(pool);
+        test_compaction(pool);
+        test_radix_sort(pool);
+    }
+    test_deterministic_sum();
+    test_match_kernels();
+    return 0;
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include "aligned_allocator.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "simd.h"
+
+// ===== PACKED GEMM =====
+//
+// C = alpha * A * B + beta * C, organised like BLIS/GotoBLAS:
+//
+//   for each NC-wide column panel of B          (B panel lives in L3)
+//     for each KC-deep slice of k               (pack B slice: KC x NC)
+//       for each MC-tall block of A, in parallel (pack A block: MC x KC, L2)
+//         for each NR-wide sliver of the B panel (KC x NR, L1)
+//           for each MR-tall sliver of the A block
+//             microkernel: MR x NR tile of C held in registers
+//
+// Packing copies each sliver into the exact order the microkernel reads
+// it, so the inner loop streams two contiguous arrays, and zero-pads the
+// edges so the microkernel never branches on the matrix size. The
+// microkernel keeps MR x NR accumulators in vector registers: per k step
+// it loads NR/W vectors of B, broadcasts MR values of A and issues
+// MR * NR/W fused multiply-adds.
+
+template<typename T>
+struct GemmBlocking {
+    using V = native_simd<T>;
+    static constexpr int MR = 6;                 // rows of the register tile
+    static constexpr int NR = 2 * V::size;       // columns of the register tile
+    static constexpr std::size_t KC = 256;       // depth: MR x KC and KC x NR slivers fit L1
+    static constexpr std::size_t MC = 120;       // MC x KC block of A fits L2
+    static constexpr std::size_t NC = 3072;      // KC x NC panel of B fits L3
+};
+
+// Copies rows [0, rows) x cols [0, depth) of A (leading dimension lda) into
+// MR-row slivers stored column by column: sliver s holds A[s*MR + r][p] at
+// packed[s*MR*depth + p*MR + r], with rows past the edge zeroed
+template<typename T>
+void gemm_pack_a(const T* a, std::size_t lda, std::size_t rows, std::size_t depth, T* packed) {
+    constexpr int MR = GemmBlocking<T>::MR;
+    for (std::size_t i = 0; i < rows; i += MR) {
+        std::size_t height = std::min<std::size_t>(MR, rows - i);
+        for (std::size_t p = 0; p < depth; ++p) {
+            for (std::size_t r = 0; r < height; ++r) packed[r] = a[(i + r) * lda + p];
+            for (std::size_t r = height; r < MR; ++r) packed[r] = T(0);
+            packed += MR;
+        }
+    }
+}
+
+// Copies NR-column slivers [first, last) of the depth x cols slice of B
+// into packed, each sliver row by row (B[p][s*NR + c] at s*NR*depth +
+// p*NR + c), with columns past the edge zeroed
+template<typename T>
+void gemm_pack_b(const T* b, std::size_t ldb, std::size_t depth, std::size_t cols, std::size_t first, std::size_t last,
+                 T* packed) {
+    constexpr int NR = GemmBlocking<T>::NR;
+    for (std::size_t s = first; s < last; ++s) {
+        std::size_t j = s * NR;
+        std::size_t width = std::min<std::size_t>(NR, cols - j);
+        T* out = packed + s * NR * depth;
+        for (std::size_t p = 0; p < depth; ++p) {
+            const T* in = b + p * ldb + j;
+            for (std::size_t c = 0; c < width; ++c) out[c] = in[c];
+            for (std::size_t c = width; c < NR; ++c) out[c] = T(0);
+            out += NR;
+        }
+    }
+}
+
+// C tile (rows x cols, at most MR x NR) = alpha * a_sliver * b_sliver + beta * C.
+// The 6 x 2 accumulators are spelled out so they stay in registers; arrays
+// of vectors tend to be kept on the stack. beta == 0 never reads C, so
+// uninitialized output is fine.
+template<typename T>
+void gemm_microkernel(std::size_t depth, const T* a, const T* b, T* c, std::size_t ldc, std::size_t rows,
+                      std::size_t cols, T alpha, T beta) {
+    using V = typename GemmBlocking<T>::V;
+    constexpr int MR = GemmBlocking<T>::MR;
+    constexpr int NR = GemmBlocking<T>::NR;
+    static_assert(MR == 6 && NR == 2 * V::size, "the register tile below is 6 x 2 vectors");
+
+    V c00(T(0)), c01(T(0)), c10(T(0)), c11(T(0)), c20(T(0)), c21(T(0));
+    V c30(T(0)), c31(T(0)), c40(T(0)), c41(T(0)), c50(T(0)), c51(T(0));
+    for (std::size_t p = 0; p < depth; ++p) {
+        V b0 = V::load_aligned(b), b1 = V::load_aligned(b + V::size);
+        V a0(a[0]), a1(a[1]);
+        c00 = fma(a0, b0, c00);
+        c01 = fma(a0, b1, c01);
+        c10 = fma(a1, b0, c10);
+        c11 = fma(a1, b1, c11);
+        a0 = V(a[2]);
+        a1 = V(a[3]);
+        c20 = fma(a0, b0, c20);
+        c21 = fma(a0, b1, c21);
+        c30 = fma(a1, b0, c30);
+        c31 = fma(a1, b1, c31);
+        a0 = V(a[4]);
+        a1 = V(a[5]);
+        c40 = fma(a0, b0, c40);
+        c41 = fma(a0, b1, c41);
+        c50 = fma(a1, b0, c50);
+        c51 = fma(a1, b1, c51);
+        a += MR;
+        b += NR;
+    }
+
+    const V acc[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+    const V valpha(alpha), vbeta(beta);
+    if (rows == MR && cols == std::size_t(NR)) {
+        for (int r = 0; r < MR; ++r) {
+            for (int v = 0; v < 2; ++v) {
+                T* out = c + r * ldc + v * V::size;
+                V result = valpha * acc[r][v];
+                if (beta != T(0)) result = fma(vbeta, V::load(out), result);
+                result.store(out);
+            }
+        }
+        return;
+    }
+    // Edge tile: go through a buffer and copy the valid part
+    alignas(64) T tile[MR][NR];
+    for (int r = 0; r < MR; ++r) {
+        for (int v = 0; v < 2; ++v) (valpha * acc[r][v]).store_aligned(&tile[r][v * V::size]);
+    }
+    for (std::size_t r = 0; r < rows; ++r) {
+        for (std::size_t j = 0; j < cols; ++j) {
+            T& out = c[r * ldc + j];
+            out = beta != T(0) ? tile[r][j] + beta * out : tile[r][j];
+        }
+    }
+}
+
+// Raw-pointer form: A is m x k (leading dimension lda), B is k x n (ldb),
+// C is m x n (ldc), all row-major
+template<typename T>
+void gemm(ThreadPool& pool, std::size_t m, std::size_t n, std::size_t k, T alpha, const T* a, std::size_t lda,
+          const T* b, std::size_t ldb, T beta, T* c, std::size_t ldc) {
+    static_assert(std::is_floating_point_v<T>, "gemm is implemented for float and double");
+    using Blocking = GemmBlocking<T>;
+    constexpr std::size_t MR = Blocking::MR, NR = Blocking::NR;
+    if (m == 0 || n == 0) return;
+    if (k == 0) {
+        for (std::size_t i = 0; i < m; ++i) {
+            for (std::size_t j = 0; j < n; ++j) c[i * ldc + j] = beta != T(0) ? beta * c[i * ldc + j] : T(0);
+        }
+        return;
+    }
+
+    aligned_vector<T> packed_b(Blocking::KC * ((std::min(n, Blocking::NC) + NR - 1) / NR * NR));
+    for (std::size_t jc = 0; jc < n; jc += Blocking::NC) {
+        const std::size_t nc = std::min(Blocking::NC, n - jc);
+        const std::size_t slivers = (nc + NR - 1) / NR;
+        for (std::size_t pc = 0; pc < k; pc += Blocking::KC) {
+            const std::size_t kc = std::min(Blocking::KC, k - pc);
+            // Earlier slices have already applied beta
+            const T beta_slice = pc == 0 ? beta : T(1);
+
+            par_for_chunks(pool, slivers, chunk_per_thread(pool, slivers), [&](std::size_t, std::size_t first, std::size_t last) {
+                gemm_pack_b(b + pc * ldb + jc, ldb, kc, nc, first, last, packed_b.data());
+            });
+
+            // One macro-tile (MC rows of C against the whole B panel) per chunk
+            par_for_chunks(pool, m, Blocking::MC, [&](std::size_t, std::size_t ic, std::size_t ic_end) {
+                thread_local aligned_vector<T> packed_a;
+                const std::size_t mc = ic_end - ic;
+                packed_a.resize(Blocking::MC * Blocking::KC);
+                gemm_pack_a(a + ic * lda + pc, lda, mc, kc, packed_a.data());
+
+                for (std::size_t jr = 0; jr < nc; jr += NR) {
+                    const T* b_sliver = packed_b.data() + (jr / NR) * NR * kc;
+                    for (std::size_t ir = 0; ir < mc; ir += MR) {
+                        gemm_microkernel(kc, packed_a.data() + ir * kc, b_sliver, c + (ic + ir) * ldc + jc + jr, ldc,
+                                         std::min(MR, mc - ir), std::min(NR, nc - jr), alpha, beta_slice);
+                    }
+                }
+            });
+        }
+    }
+}
+
+// C = alpha * A * B + beta * C; C must already be A.rows() x B.cols()
+template<typename T>
+void gemm(ThreadPool& pool, const Matrix<T>& a, const Matrix<T>& b, Matrix<T>& c, T alpha = T(1), T beta = T(0)) {
+    if (a.cols() != b.rows() || c.rows() != a.rows() || c.cols() != b.cols()) {
+        throw std::invalid_argument("gemm: matrix dimensions do not match");
+    }
+    gemm(pool, a.rows(), b.cols(), a.cols(), alpha, a.data(), a.cols(), b.data(), b.cols(), beta, c.data(), c.cols());
+}
+
+template<typename T>
+void gemm(const Matrix<T>& a, const Matrix<T>& b, Matrix<T>& c, T alpha = T(1), T beta = T(0)) {
+    gemm(default_pool(), a, b, c, alpha, beta);
+}
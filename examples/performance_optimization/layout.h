@@ -0,0 +1,393 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "matrix.h"
+#include "parallel.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// ===== CACHE-OBLIVIOUS TRANSPOSE =====
+//
+// The naive out[j][i] = in[i][j] loop writes a new cache line on every
+// element once the matrix outgrows the cache. transpose() instead halves
+// the longer side until a block fits in L1 (at most 32 x 32), so both the
+// rows it reads and the rows it writes stay cached, at every cache level,
+// without tuning a block size. Inside a block, 4- and 8-byte elements move
+// as whole tiles held in registers: 8x8 (AVX) or 4x4 (SSE) for 4 bytes,
+// 4x4 (AVX) or 2x2 (SSE2) for 8 bytes, with the ragged edges done one
+// element at a time. Large inputs are split into bands along the longer
+// side and transposed on the thread pool.
+//
+// Leading dimensions are in elements, so a sub-matrix or an interleaved
+// buffer can be transposed in place of a whole matrix. in and out must not
+// overlap.
+
+// Register tile kernels, by element size and tile edge
+template<std::size_t Bytes, int K>
+struct TransposeTile {
+    static constexpr bool available = false;
+};
+
+#if defined(__SSE2__)
+template<>
+struct TransposeTile<4, 4> {
+    static constexpr bool available = true;
+    static void apply(const void* src, std::size_t ld_in, void* dst, std::size_t ld_out) {
+        const float* in = static_cast<const float*>(src);
+        float* out = static_cast<float*>(dst);
+        __m128 r0 = _mm_loadu_ps(in), r1 = _mm_loadu_ps(in + ld_in);
+        __m128 r2 = _mm_loadu_ps(in + 2 * ld_in), r3 = _mm_loadu_ps(in + 3 * ld_in);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out, r0);
+        _mm_storeu_ps(out + ld_out, r1);
+        _mm_storeu_ps(out + 2 * ld_out, r2);
+        _mm_storeu_ps(out + 3 * ld_out, r3);
+    }
+};
+
+template<>
+struct TransposeTile<8, 2> {
+    static constexpr bool available = true;
+    static void apply(const void* src, std::size_t ld_in, void* dst, std::size_t ld_out) {
+        const double* in = static_cast<const double*>(src);
+        double* out = static_cast<double*>(dst);
+        const __m128d r0 = _mm_loadu_pd(in), r1 = _mm_loadu_pd(in + ld_in);
+        _mm_storeu_pd(out, _mm_unpacklo_pd(r0, r1));
+        _mm_storeu_pd(out + ld_out, _mm_unpackhi_pd(r0, r1));
+    }
+};
+#endif
+
+#if defined(__AVX__)
+template<>
+struct TransposeTile<4, 8> {
+    static constexpr bool available = true;
+    static void apply(const void* src, std::size_t ld_in, void* dst, std::size_t ld_out) {
+        const float* in = static_cast<const float*>(src);
+        float* out = static_cast<float*>(dst);
+        __m256 r[8], t[8];
+        for (int i = 0; i < 8; ++i) r[i] = _mm256_loadu_ps(in + i * ld_in);
+        // Pairs of rows interleaved, then pairs of pairs, then 128-bit halves
+        for (int i = 0; i < 8; i += 2) {
+            t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+            t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+        }
+        for (int i = 0; i < 8; i += 4) {
+            r[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+            r[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+            r[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+            r[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        for (int i = 0; i < 4; ++i) {
+            _mm256_storeu_ps(out + i * ld_out, _mm256_permute2f128_ps(r[i], r[i + 4], 0x20));
+            _mm256_storeu_ps(out + (i + 4) * ld_out, _mm256_permute2f128_ps(r[i], r[i + 4], 0x31));
+        }
+    }
+};
+
+template<>
+struct TransposeTile<8, 4> {
+    static constexpr bool available = true;
+    static void apply(const void* src, std::size_t ld_in, void* dst, std::size_t ld_out) {
+        const double* in = static_cast<const double*>(src);
+        double* out = static_cast<double*>(dst);
+        const __m256d r0 = _mm256_loadu_pd(in), r1 = _mm256_loadu_pd(in + ld_in);
+        const __m256d r2 = _mm256_loadu_pd(in + 2 * ld_in), r3 = _mm256_loadu_pd(in + 3 * ld_in);
+        const __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+        const __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+        _mm256_storeu_pd(out, _mm256_permute2f128_pd(t0, t2, 0x20));
+        _mm256_storeu_pd(out + ld_out, _mm256_permute2f128_pd(t1, t3, 0x20));
+        _mm256_storeu_pd(out + 2 * ld_out, _mm256_permute2f128_pd(t0, t2, 0x31));
+        _mm256_storeu_pd(out + 3 * ld_out, _mm256_permute2f128_pd(t1, t3, 0x31));
+    }
+};
+#endif
+
+// Largest register tile narrower than limit for this element size; 1 means
+// element by element
+template<std::size_t Bytes>
+constexpr int transpose_tile_below(int limit) {
+    if (limit > 8 && TransposeTile<Bytes, 8>::available) return 8;
+    if (limit > 4 && TransposeTile<Bytes, 4>::available) return 4;
+    if (limit > 2 && TransposeTile<Bytes, 2>::available) return 2;
+    return 1;
+}
+
+// Whole K x K tiles first, then the right and bottom strips with the next
+// smaller tile
+template<typename T, int K>
+void transpose_tiles(const T* in, std::size_t ld_in, T* out, std::size_t ld_out, std::size_t rows, std::size_t cols) {
+    if constexpr (K == 1) {
+        for (std::size_t i = 0; i < rows; ++i) {
+            for (std::size_t j = 0; j < cols; ++j) out[j * ld_out + i] = in[i * ld_in + j];
+        }
+    } else {
+        const std::size_t rk = rows / K * K, ck = cols / K * K;
+        for (std::size_t i = 0; i < rk; i += K) {
+            for (std::size_t j = 0; j < ck; j += K) {
+                TransposeTile<sizeof(T), K>::apply(in + i * ld_in + j, ld_in, out + j * ld_out + i, ld_out);
+            }
+        }
+        constexpr int next = transpose_tile_below<sizeof(T)>(K);
+        transpose_tiles<T, next>(in + ck, ld_in, out + ck * ld_out, ld_out, rk, cols - ck);
+        transpose_tiles<T, next>(in + rk * ld_in, ld_in, out + rk, ld_out, rows - rk, cols);
+    }
+}
+
+inline constexpr std::size_t transpose_leaf = 32;
+
+template<typename T>
+void transpose_recursive(const T* in, std::size_t ld_in, T* out, std::size_t ld_out, std::size_t rows,
+                         std::size_t cols) {
+    if (rows <= transpose_leaf && cols <= transpose_leaf) {
+        transpose_tiles<T, transpose_tile_below<sizeof(T)>(16)>(in, ld_in, out, ld_out, rows, cols);
+        return;
+    }
+    // Split on a multiple of 8 so every leaf keeps whole register tiles
+    if (rows >= cols) {
+        const std::size_t half = (rows / 2 + 7) / 8 * 8;
+        transpose_recursive(in, ld_in, out, ld_out, half, cols);
+        transpose_recursive(in + half * ld_in, ld_in, out + half, ld_out, rows - half, cols);
+    } else {
+        const std::size_t half = (cols / 2 + 7) / 8 * 8;
+        transpose_recursive(in, ld_in, out, ld_out, rows, half);
+        transpose_recursive(in + half, ld_in, out + half * ld_out, ld_out, rows, cols - half);
+    }
+}
+
+// Below this many elements the pool isn't worth waking up
+inline constexpr std::size_t transpose_parallel_min = std::size_t(1) << 16;
+
+// out (cols x rows, leading dimension ld_out) = transpose of in (rows x
+// cols, leading dimension ld_in)
+template<typename T>
+void transpose(ThreadPool& pool, const T* in, std::size_t rows, std::size_t cols, std::size_t ld_in, T* out,
+               std::size_t ld_out) {
+    static_assert(std::is_trivially_copyable_v<T>, "transpose: elements are moved as raw bytes");
+    if (ld_in < cols || ld_out < rows) throw std::invalid_argument("transpose: leading dimension too small");
+    if (rows == 0 || cols == 0) return;
+    const bool by_rows = rows >= cols;
+    const std::size_t split = by_rows ? rows : cols;
+    // Bands of 64 lines at least, about four per thread
+    const std::size_t chunk = rows * cols < transpose_parallel_min
+                                  ? split
+                                  : std::max<std::size_t>(64, (split / (4 * par_concurrency(pool)) + 63) / 64 * 64);
+    par_for_chunks(pool, split, chunk, [&](std::size_t, std::size_t begin, std::size_t end) {
+        if (by_rows) {
+            transpose_recursive(in + begin * ld_in, ld_in, out + begin, ld_out, end - begin, cols);
+        } else {
+            transpose_recursive(in + begin, ld_in, out + begin * ld_out, ld_out, rows, end - begin);
+        }
+    });
+}
+
+template<typename T>
+void transpose(const T* in, std::size_t rows, std::size_t cols, std::size_t ld_in, T* out, std::size_t ld_out) {
+    transpose(default_pool(), in, rows, cols, ld_in, out, ld_out);
+}
+
+// out must already be in.cols() x in.rows()
+template<typename T>
+void transpose(ThreadPool& pool, const Matrix<T>& in, Matrix<T>& out) {
+    if (out.rows() != in.cols() || out.cols() != in.rows()) throw std::invalid_argument("transpose: shape mismatch");
+    if (in.data() == out.data()) throw std::invalid_argument("transpose: in and out must not overlap");
+    transpose(pool, in.data(), in.rows(), in.cols(), in.cols(), out.data(), out.cols());
+}
+
+template<typename T>
+void transpose(const Matrix<T>& in, Matrix<T>& out) {
+    transpose(default_pool(), in, out);
+}
+
+// ===== AOS <-> SOA =====
+//
+// A struct field and the array it maps to, e.g.
+//
+//   aos_to_soa(particles, soa_column(&Particle::x, xs), soa_column(&Particle::y, ys));
+//
+// Any subset of the fields, of any types, can be converted. Structs are
+// processed in blocks small enough to stay in L1, one column at a time, so
+// every column is written as one sequential stream instead of each struct
+// scattering a store into every array.
+
+template<typename S, typename F>
+struct SoaColumn {
+    F S::*member;
+    std::span<F> data;
+};
+
+template<typename S, typename F>
+SoaColumn<S, F> soa_column(F S::*member, std::type_identity_t<std::span<F>> data) {
+    return {member, data};
+}
+
+inline constexpr std::size_t layout_block = 256;
+
+// Elements per task: one run per thread in whole blocks, and never so few
+// that waking the pool costs more than the copy
+inline std::size_t layout_grain(ThreadPool& pool, std::size_t n) {
+    return std::max(16 * layout_block, (chunk_per_thread(pool, n) + layout_block - 1) / layout_block * layout_block);
+}
+
+template<typename S, typename... F>
+void check_columns(const char* what, std::size_t n, const SoaColumn<S, F>&... columns) {
+    if (((columns.data.size() < n) || ...)) throw std::invalid_argument(std::string(what) + ": column too short");
+}
+
+template<typename S, typename... F>
+void aos_to_soa(ThreadPool& pool, std::span<const S> in, SoaColumn<S, F>... columns) {
+    check_columns("aos_to_soa", in.size(), columns...);
+    par_for_chunks(pool, in.size(), layout_grain(pool, in.size()), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; b += layout_block) {
+            const std::size_t e = std::min(end, b + layout_block);
+            auto gather = [&](const auto& column) {
+                auto* dst = column.data.data();
+                const auto member = column.member;
+                for (std::size_t i = b; i < e; ++i) dst[i] = in[i].*member;
+            };
+            (gather(columns), ...);
+        }
+    });
+}
+
+template<typename S, typename... F>
+void aos_to_soa(std::span<const S> in, SoaColumn<S, F>... columns) {
+    aos_to_soa(default_pool(), in, columns...);
+}
+
+// Fields without a column are left untouched in out
+template<typename S, typename... F>
+void soa_to_aos(ThreadPool& pool, std::span<S> out, SoaColumn<S, F>... columns) {
+    check_columns("soa_to_aos", out.size(), columns...);
+    par_for_chunks(pool, out.size(), layout_grain(pool, out.size()), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; b += layout_block) {
+            const std::size_t e = std::min(end, b + layout_block);
+            auto scatter = [&](const auto& column) {
+                const auto* src = column.data.data();
+                const auto member = column.member;
+                for (std::size_t i = b; i < e; ++i) out[i].*member = src[i];
+            };
+            (scatter(columns), ...);
+        }
+    });
+}
+
+template<typename S, typename... F>
+void soa_to_aos(std::span<S> out, SoaColumn<S, F>... columns) {
+    soa_to_aos(default_pool(), out, columns...);
+}
+
+// ===== CHANNEL INTERLEAVING =====
+//
+// Interleaved samples (frame after frame, channels adjacent: L R L R ...)
+// to planar ones (one contiguous channel after another) and back. This is
+// a transpose of a frames x channels matrix, and goes through transpose()
+// except for the common stereo case of 4-byte samples, which has its own
+// SSE shuffle: a 2-wide transpose has no full register tile.
+
+#if defined(__SSE2__)
+// Frames [begin, end) of a two-channel stream of any 4-byte T: the vectors
+// move through __m128i loads and stores, which may alias any type, and the
+// tail through T itself
+template<typename T>
+__m128 load4_32(const T* p) {
+    return _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+template<typename T>
+void store4_32(T* p, __m128 v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_castps_si128(v));
+}
+
+template<typename T>
+void deinterleave2_32(const T* in, T* left, T* right, std::size_t begin, std::size_t end) {
+    static_assert(sizeof(T) == 4);
+    std::size_t f = begin;
+    for (; f + 4 <= end; f += 4) {
+        const __m128 a = load4_32(in + 2 * f), b = load4_32(in + 2 * f + 4);
+        store4_32(left + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        store4_32(right + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    for (; f < end; ++f) {
+        left[f] = in[2 * f];
+        right[f] = in[2 * f + 1];
+    }
+}
+
+template<typename T>
+void interleave2_32(const T* left, const T* right, T* out, std::size_t begin, std::size_t end) {
+    static_assert(sizeof(T) == 4);
+    std::size_t f = begin;
+    for (; f + 4 <= end; f += 4) {
+        const __m128 l = load4_32(left + f), r = load4_32(right + f);
+        store4_32(out + 2 * f, _mm_unpacklo_ps(l, r));
+        store4_32(out + 2 * f + 4, _mm_unpackhi_ps(l, r));
+    }
+    for (; f < end; ++f) {
+        out[2 * f] = left[f];
+        out[2 * f + 1] = right[f];
+    }
+}
+#endif
+
+inline std::size_t check_channels(const char* what, std::size_t in, std::size_t out, std::size_t channels) {
+    if (channels == 0 || in % channels != 0) {
+        throw std::invalid_argument(std::string(what) + ": size is not a whole number of frames");
+    }
+    if (out < in) throw std::invalid_argument(std::string(what) + ": output too short");
+    return in / channels;
+}
+
+// planar[c * frames + f] = interleaved[f * channels + c]
+template<typename T>
+void deinterleave(ThreadPool& pool, std::span<const T> interleaved, std::size_t channels, std::span<T> planar) {
+    const std::size_t frames = check_channels("deinterleave", interleaved.size(), planar.size(), channels);
+#if defined(__SSE2__)
+    if constexpr (sizeof(T) == 4 && std::is_trivially_copyable_v<T>) {
+        if (channels == 2) {
+            const T* in = interleaved.data();
+            T* out = planar.data();
+            par_for_chunks(pool, frames, layout_grain(pool, frames), [&](std::size_t, std::size_t begin, std::size_t end) {
+                deinterleave2_32(in, out, out + frames, begin, end);
+            });
+            return;
+        }
+    }
+#endif
+    transpose(pool, interleaved.data(), frames, channels, channels, planar.data(), frames);
+}
+
+template<typename T>
+void deinterleave(std::span<const T> interleaved, std::size_t channels, std::span<T> planar) {
+    deinterleave(default_pool(), interleaved, channels, planar);
+}
+
+// interleaved[f * channels + c] = planar[c * frames + f]
+template<typename T>
+void interleave(ThreadPool& pool, std::span<const T> planar, std::size_t channels, std::span<T> interleaved) {
+    const std::size_t frames = check_channels("interleave", planar.size(), interleaved.size(), channels);
+#if defined(__SSE2__)
+    if constexpr (sizeof(T) == 4 && std::is_trivially_copyable_v<T>) {
+        if (channels == 2) {
+            const T* in = planar.data();
+            T* out = interleaved.data();
+            par_for_chunks(pool, frames, layout_grain(pool, frames), [&](std::size_t, std::size_t begin, std::size_t end) {
+                interleave2_32(in, in + frames, out, begin, end);
+            });
+            return;
+        }
+    }
+#endif
+    transpose(pool, planar.data(), channels, frames, frames, interleaved.data(), channels);
+}
+
+template<typename T>
+void interleave(std::span<const T> planar, std::size_t channels, std::span<T> interleaved) {
+    interleave(default_pool(), planar, channels, interleaved);
+}
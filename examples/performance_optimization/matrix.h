@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include "aligned_allocator.h"
+
+// ===== CONTIGUOUS MATRIX =====
+
+// Row-major rows x cols matrix in one cache-line aligned allocation, so a
+// row is contiguous and row i starts at data() + i * cols()
+template<typename T>
+class Matrix {
+public:
+    Matrix() = default;
+    Matrix(std::size_t rows, std::size_t cols, T value = T()) : rows_(rows), cols_(cols), data_(rows * cols, value) {}
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+
+    T& operator()(std::size_t i, std::size_t j) { return data_[i * cols_ + j]; }
+    const T& operator()(std::size_t i, std::size_t j) const { return data_[i * cols_ + j]; }
+
+    T* data() { return data_.data(); }
+    const T* data() const { return data_.data(); }
+    T* row(std::size_t i) { return data_.data() + i * cols_; }
+    const T* row(std::size_t i) const { return data_.data() + i * cols_; }
+
+private:
+    std::size_t rows_ = 0, cols_ = 0;
+    aligned_vector<T> data_;
+};
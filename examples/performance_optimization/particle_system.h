@@ -0,0 +1,281 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "aligned_allocator.h"
+#include "parallel.h"
+#include "simd.h"
+
+// ===== SOA PARTICLE SYSTEM =====
+//
+// Positions, velocities and masses live in seven separate cache-line
+// aligned arrays, so an integration step streams whole simd<float, N>
+// vectors through aligned loads and never touches a field it doesn't need.
+// Each step is split into chunks that are multiples of the vector width
+// and run on the thread pool:
+//
+//   v += gravity * dt
+//   p += v * dt
+//   p outside [lo, hi]  ->  mirrored back inside, v reversed (* restitution)
+//
+// Neighbour queries use a spatial hash: particles are radix-sorted by
+// the hash of their grid cell (edge = cell_size), and a query scans the 27
+// cells around a particle. Positions are copied in cell order during the
+// build, so the candidates of one cell are contiguous in memory.
+
+class ParticleSystem {
+public:
+    struct Vec3 {
+        float x, y, z;
+    };
+
+    ParticleSystem(Vec3 lo, Vec3 hi, ThreadPool& pool = default_pool()) : lo_(lo), hi_(hi), pool_(&pool) {
+        if (!(lo.x < hi.x && lo.y < hi.y && lo.z < hi.z)) {
+            throw std::invalid_argument("ParticleSystem: empty bounds");
+        }
+    }
+
+    std::size_t size() const { return x_.size(); }
+
+    void add(Vec3 position, Vec3 velocity, float mass) {
+        x_.push_back(position.x);
+        y_.push_back(position.y);
+        z_.push_back(position.z);
+        vx_.push_back(velocity.x);
+        vy_.push_back(velocity.y);
+        vz_.push_back(velocity.z);
+        mass_.push_back(mass);
+        grid_valid_ = false;
+    }
+
+    void resize(std::size_t n) {
+        for (auto* field : {&x_, &y_, &z_, &vx_, &vy_, &vz_, &mass_}) field->resize(n);
+        grid_valid_ = false;
+    }
+
+    // Direct access to the arrays, e.g. to initialise them in bulk
+    std::span<float> x() { return x_; }
+    std::span<float> y() { return y_; }
+    std::span<float> z() { return z_; }
+    std::span<float> vx() { return vx_; }
+    std::span<float> vy() { return vy_; }
+    std::span<float> vz() { return vz_; }
+    std::span<float> mass() { return mass_; }
+    std::span<const float> x() const { return x_; }
+    std::span<const float> y() const { return y_; }
+    std::span<const float> z() const { return z_; }
+    std::span<const float> vx() const { return vx_; }
+    std::span<const float> vy() const { return vy_; }
+    std::span<const float> vz() const { return vz_; }
+    std::span<const float> mass() const { return mass_; }
+
+    Vec3 gravity = {0.0f, -9.81f, 0.0f};
+    // Fraction of the speed kept when bouncing off a wall
+    float restitution = 1.0f;
+
+    // Advances every particle by dt
+    void step(float dt) {
+        using V = native_simd<float>;
+        const std::size_t n = size();
+        const float e = restitution;
+        // Whole cache lines per chunk keep every chunk start vector-aligned
+        const std::size_t chunk = (default_grain(n) + 15) / 16 * 16;
+        par_for_chunks(*pool_, n, chunk, [&](std::size_t, std::size_t begin, std::size_t end) {
+            std::size_t i = begin;
+            for (; i + V::size <= end; i += V::size) {
+                integrate_axis(x_.data() + i, vx_.data() + i, gravity.x * dt, dt, lo_.x, hi_.x, e);
+                integrate_axis(y_.data() + i, vy_.data() + i, gravity.y * dt, dt, lo_.y, hi_.y, e);
+                integrate_axis(z_.data() + i, vz_.data() + i, gravity.z * dt, dt, lo_.z, hi_.z, e);
+            }
+            for (; i < end; ++i) {
+                integrate_axis(x_[i], vx_[i], gravity.x * dt, dt, lo_.x, hi_.x, e);
+                integrate_axis(y_[i], vy_[i], gravity.y * dt, dt, lo_.y, hi_.y, e);
+                integrate_axis(z_[i], vz_[i], gravity.z * dt, dt, lo_.z, hi_.z, e);
+            }
+        });
+        grid_valid_ = false;
+    }
+
+    // Hashes every particle into cells of edge cell_size; queries may then
+    // use any radius up to cell_size until the particles move again
+    void build_neighbor_grid(float cell_size) {
+        if (!(cell_size > 0.0f)) throw std::invalid_argument("ParticleSystem: cell size must be positive");
+        const std::size_t n = size();
+        cell_size_ = cell_size;
+        table_size_ = std::bit_ceil(std::max<std::size_t>(n, 64));
+
+        std::vector<std::uint32_t> cell_of(n);
+        par_for_chunks(*pool_, n, default_grain(n),
+                       [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) cell_of[i] = hash_cell(cell_coords(x_[i], y_[i], z_[i]));
+        });
+
+        // Sort particle indices by cell key with the parallel radix sort;
+        // it is stable, so a cell lists its particles by index. Then every
+        // position where the key changes writes the starts of the cells up
+        // to its key, so each entry of cell_start_ is written exactly once.
+        sorted_index_.resize(n);
+        par_for_chunks(*pool_, n, default_grain(n), [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) sorted_index_[i] = static_cast<std::uint32_t>(i);
+        });
+        par_radix_sort(*pool_, std::span<std::uint32_t>(cell_of), std::span<std::uint32_t>(sorted_index_));
+        cell_start_.resize(table_size_ + 1);
+        par_for_chunks(*pool_, n + 1, default_grain(n + 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k) {
+                const std::size_t first = k == 0 ? 0 : cell_of[k - 1] + 1;
+                const std::size_t last = k == n ? table_size_ : cell_of[k];
+                for (std::size_t key = first; key <= last; ++key) cell_start_[key] = static_cast<std::uint32_t>(k);
+            }
+        });
+
+        sorted_x_.resize(n);
+        sorted_y_.resize(n);
+        sorted_z_.resize(n);
+        par_for_chunks(*pool_, n, default_grain(n),
+                       [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k) {
+                std::uint32_t i = sorted_index_[k];
+                sorted_x_[k] = x_[i];
+                sorted_y_[k] = y_[i];
+                sorted_z_[k] = z_[i];
+            }
+        });
+        grid_valid_ = true;
+    }
+
+    // Calls f(j) for every particle j != i within radius of particle i
+    template<typename F>
+    void for_each_neighbor(std::size_t i, float radius, F&& f) const {
+        check_query(radius);
+        const float r2 = radius * radius;
+        const float px = x_[i], py = y_[i], pz = z_[i];
+        std::array<std::uint32_t, 27> keys = neighbor_keys(cell_coords(px, py, pz));
+        for (std::uint32_t key : keys) {
+            if (key == empty_key) break;
+            for (std::uint32_t k = cell_start_[key]; k < cell_start_[key + 1]; ++k) {
+                float dx = sorted_x_[k] - px, dy = sorted_y_[k] - py, dz = sorted_z_[k] - pz;
+                if (dx * dx + dy * dy + dz * dz <= r2 && sorted_index_[k] != i) f(static_cast<std::size_t>(sorted_index_[k]));
+            }
+        }
+    }
+
+    // Neighbour count within radius for every particle, computed in parallel.
+    // Queries run in cell order, so consecutive queries scan the same cells
+    // and reuse their key list, and each cell is tested a vector at a time.
+    std::vector<std::uint32_t> count_neighbors(float radius) const {
+        check_query(radius);
+        using V = native_simd<float>;
+        std::vector<std::uint32_t> counts(size());
+        const V r2(radius * radius);
+        par_for_chunks(*pool_, size(), default_grain(size()), [&](std::size_t, std::size_t begin, std::size_t end) {
+            CellCoords cell = {0, 0, 0};
+            std::array<std::uint32_t, 27> keys;
+            for (std::size_t k = begin; k < end; ++k) {
+                const float px = sorted_x_[k], py = sorted_y_[k], pz = sorted_z_[k];
+                CellCoords c = cell_coords(px, py, pz);
+                if (k == begin || c != cell) {
+                    cell = c;
+                    keys = neighbor_keys(c);
+                }
+                const V vx(px), vy(py), vz(pz);
+                std::uint32_t count = 0;
+                for (std::uint32_t key : keys) {
+                    if (key == empty_key) break;
+                    std::uint32_t j = cell_start_[key];
+                    const std::uint32_t last = cell_start_[key + 1];
+                    for (; j + V::size <= last; j += V::size) {
+                        V dx = V::load(&sorted_x_[j]) - vx, dy = V::load(&sorted_y_[j]) - vy;
+                        V dz = V::load(&sorted_z_[j]) - vz;
+                        count += (dx * dx + dy * dy + dz * dz <= r2).count();
+                    }
+                    for (; j < last; ++j) {
+                        float dx = sorted_x_[j] - px, dy = sorted_y_[j] - py, dz = sorted_z_[j] - pz;
+                        count += dx * dx + dy * dy + dz * dz <= radius * radius;
+                    }
+                }
+                // The particle itself was counted at distance 0
+                counts[sorted_index_[k]] = count - 1;
+            }
+        });
+        return counts;
+    }
+
+private:
+    using CellCoords = std::array<std::int32_t, 3>;
+    static constexpr std::uint32_t empty_key = ~0u;
+
+    Vec3 lo_, hi_;
+    ThreadPool* pool_;
+    aligned_vector<float> x_, y_, z_, vx_, vy_, vz_, mass_;
+
+    float cell_size_ = 0.0f;
+    std::size_t table_size_ = 0;
+    bool grid_valid_ = false;
+    std::vector<std::uint32_t> cell_start_, sorted_index_;
+    aligned_vector<float> sorted_x_, sorted_y_, sorted_z_;
+
+    // One axis of V::size particles: the vector loop body
+    static void integrate_axis(float* p, float* v, float dv, float dt, float lo, float hi, float e) {
+        using V = native_simd<float>;
+        V vel = V::load(v, vector_aligned) + V(dv);
+        V pos = fma(vel, V(dt), V::load(p, vector_aligned));
+        auto below = pos < V(lo);
+        auto above = pos > V(hi);
+        pos = select(below, V(2.0f * lo) - pos, select(above, V(2.0f * hi) - pos, pos));
+        // A particle faster than the box is wide would still be outside
+        pos = min(max(pos, V(lo)), V(hi));
+        vel = select(below | above, -vel * V(e), vel);
+        pos.store(p, vector_aligned);
+        vel.store(v, vector_aligned);
+    }
+
+    // One axis of one particle: the tail of a chunk
+    static void integrate_axis(float& p, float& v, float dv, float dt, float lo, float hi, float e) {
+        v += dv;
+        p = std::fma(v, dt, p);
+        bool below = p < lo, above = p > hi;
+        if (below) p = 2.0f * lo - p;
+        if (above) p = 2.0f * hi - p;
+        p = std::min(std::max(p, lo), hi);
+        if (below || above) v = -v * e;
+    }
+
+    CellCoords cell_coords(float px, float py, float pz) const {
+        return {static_cast<std::int32_t>(std::floor((px - lo_.x) / cell_size_)),
+                static_cast<std::int32_t>(std::floor((py - lo_.y) / cell_size_)),
+                static_cast<std::int32_t>(std::floor((pz - lo_.z) / cell_size_))};
+    }
+
+    std::uint32_t hash_cell(const CellCoords& c) const {
+        std::uint32_t h = static_cast<std::uint32_t>(c[0]) * 73856093u ^ static_cast<std::uint32_t>(c[1]) * 19349663u ^
+                          static_cast<std::uint32_t>(c[2]) * 83492791u;
+        return h & static_cast<std::uint32_t>(table_size_ - 1);
+    }
+
+    // Distinct keys of the 27 surrounding cells (two cells can share a key),
+    // padded with empty_key
+    std::array<std::uint32_t, 27> neighbor_keys(const CellCoords& c) const {
+        std::array<std::uint32_t, 27> keys;
+        int count = 0;
+        for (int dx = -1; dx <= 1; ++dx) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dz = -1; dz <= 1; ++dz) keys[count++] = hash_cell({c[0] + dx, c[1] + dy, c[2] + dz});
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        auto last = std::unique(keys.begin(), keys.end());
+        std::fill(last, keys.end(), empty_key);
+        return keys;
+    }
+
+    void check_query(float radius) const {
+        if (!grid_valid_) throw std::logic_error("ParticleSystem: build_neighbor_grid() before querying");
+        if (radius > cell_size_) throw std::invalid_argument("ParticleSystem: query radius exceeds the cell size");
+    }
+};
@@ -0,0 +1,200 @@
+#pragma once
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ===== HARDWARE PERFORMANCE COUNTERS =====
+//
+// PerfCounters opens one perf_event_open group for the calling thread:
+// cycles, instructions, L1D read misses, last-level cache misses and branch
+// misses, counted in user space only (what perf_event_paranoid <= 2
+// allows). The group runs from construction; a region is measured as the
+// difference of two read()s, so regions can nest and reading costs one
+// system call. When the kernel multiplexes the group the counts are scaled
+// by time enabled / time running; a difference scales the raw count
+// difference by the enabled and running time of that region alone, not by
+// the ratios since construction.
+//
+// Nothing throws: without permission, without a PMU (common in VMs and
+// containers) or off Linux, available() is false, unavailable_reason()
+// says why, and every sample is empty. A single unsupported event is
+// simply left out of the group.
+
+enum class PerfEvent { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses };
+
+inline constexpr std::size_t perf_event_count = 5;
+
+inline const char* perf_event_name(PerfEvent e) {
+    switch (e) {
+        case PerfEvent::Cycles: return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::L1DMisses: return "L1D misses";
+        case PerfEvent::LLCMisses: return "LLC misses";
+        default: return "branch misses";
+    }
+}
+
+struct PerfSample {
+    std::array<std::uint64_t, perf_event_count> raw{};   // as counted, while the group was running
+    std::uint64_t time_enabled = 0, time_running = 0;    // ns
+    std::array<double, perf_event_count> values{};       // raw scaled to the whole enabled time
+    std::array<bool, perf_event_count> valid{};
+
+    // Sets values from raw and the two times; nothing is valid if the group
+    // never ran
+    void scale() {
+        const double factor = time_running ? double(time_enabled) / double(time_running) : 0.0;
+        for (std::size_t i = 0; i < perf_event_count; ++i) {
+            valid[i] = valid[i] && time_running > 0;
+            values[i] = valid[i] ? double(raw[i]) * factor : 0.0;
+        }
+    }
+
+    bool has(PerfEvent e) const { return valid[static_cast<std::size_t>(e)]; }
+    // NaN when the event isn't counted
+    double operator[](PerfEvent e) const { return has(e) ? values[static_cast<std::size_t>(e)] : NAN; }
+
+    // Instructions per cycle
+    double ipc() const { return (*this)[PerfEvent::Instructions] / (*this)[PerfEvent::Cycles]; }
+    // Events per thousand instructions (misses per kilo-instruction)
+    double per_kilo_instruction(PerfEvent e) const { return 1000.0 * (*this)[e] / (*this)[PerfEvent::Instructions]; }
+
+    // The region between two reads of the same counters (a later than b)
+    friend PerfSample operator-(const PerfSample& a, const PerfSample& b) {
+        PerfSample d;
+        d.time_enabled = a.time_enabled - b.time_enabled;
+        d.time_running = a.time_running - b.time_running;
+        for (std::size_t i = 0; i < perf_event_count; ++i) {
+            d.valid[i] = a.valid[i] && b.valid[i];
+            d.raw[i] = d.valid[i] ? a.raw[i] - b.raw[i] : 0;
+        }
+        d.scale();
+        return d;
+    }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() {
+#if defined(__linux__)
+        const std::pair<std::uint32_t, std::uint64_t> events[perf_event_count] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (std::size_t i = 0; i < perf_event_count; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+            if (fd < 0) {
+                if (leader_ < 0) {
+                    reason_ = std::string("perf_event_open: ") + std::strerror(errno);
+                    if (errno == EACCES || errno == EPERM) reason_ += " (check /proc/sys/kernel/perf_event_paranoid)";
+                    if (errno == ENOENT || errno == EOPNOTSUPP) reason_ += " (no hardware PMU, e.g. in a VM)";
+                    return;
+                }
+                continue;
+            }
+            if (leader_ < 0) leader_ = fd;
+            fds_[count_] = fd;
+            slot_[count_++] = i;
+        }
+#else
+        reason_ = "hardware counters need Linux perf_event_open";
+#endif
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (std::size_t i = 0; i < count_; ++i) close(fds_[i]);
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return leader_ >= 0; }
+    const std::string& unavailable_reason() const { return reason_; }
+
+    // Counts since construction, for the constructing thread
+    PerfSample read() const {
+        PerfSample sample;
+#if defined(__linux__)
+        if (!available()) return sample;
+        std::uint64_t buffer[3 + perf_event_count];
+        if (::read(leader_, buffer, sizeof buffer) < static_cast<ssize_t>((3 + count_) * sizeof(std::uint64_t))) {
+            return sample;
+        }
+        sample.time_enabled = buffer[1];
+        sample.time_running = buffer[2];
+        for (std::size_t i = 0; i < count_ && i < buffer[0]; ++i) {
+            sample.raw[slot_[i]] = buffer[3 + i];
+            sample.valid[slot_[i]] = true;
+        }
+        sample.scale();
+#endif
+        return sample;
+    }
+
+    // Counts for one call of f
+    template<typename F>
+    PerfSample measure(F&& f) const {
+        PerfSample before = read();
+        f();
+        return read() - before;
+    }
+
+    // The calling thread's counters, opened on first use
+    static const PerfCounters& local() {
+        thread_local PerfCounters counters;
+        return counters;
+    }
+
+private:
+    int leader_ = -1;
+    std::size_t count_ = 0;
+    std::array<int, perf_event_count> fds_{};
+    std::array<std::size_t, perf_event_count> slot_{};
+    std::string reason_;
+};
+
+// "IPC 2.41 | L1D 12.3 LLC 0.4 branch 1.1 misses/kinstr"; events that
+// aren't counted are left out, and an empty sample gives ""
+inline std::string perf_summary(const PerfSample& s) {
+    std::string out;
+    char part[48];
+    if (s.has(PerfEvent::Cycles) && s.has(PerfEvent::Instructions) && s[PerfEvent::Cycles] > 0) {
+        std::snprintf(part, sizeof part, "IPC %.2f", s.ipc());
+        out += part;
+    }
+    if (!s.has(PerfEvent::Instructions) || s[PerfEvent::Instructions] <= 0) return out;
+    std::string misses;
+    for (auto [e, label] : {std::pair{PerfEvent::L1DMisses, "L1D"}, std::pair{PerfEvent::LLCMisses, "LLC"},
+                            std::pair{PerfEvent::BranchMisses, "branch"}}) {
+        if (!s.has(e)) continue;
+        std::snprintf(part, sizeof part, "%s%s %.1f", misses.empty() ? "" : " ", label, s.per_kilo_instruction(e));
+        misses += part;
+    }
+    if (!misses.empty()) out += (out.empty() ? "" : " | ") + misses + " misses/kinstr";
+    return out;
+}
@@ -6,23 +6,52 @@
 #include <algorithm>
 #include <numeric>
 #include <cstring>
+#include <cstdint>
+#include <iomanip>
+#include <string>
+#include <fstream>
+#include <optional>
+#include "aligned_allocator.h"
+#include "gemm.h"
+#include "layout.h"
+#include "particle_system.h"
+#include "perf_counters.h"
+#include "profiler.h"
+#include "simd.h"
 using namespace std;
 
+// Widest vectors the compile-time target supports (see simd.h)
+using floatv = native_simd<float>;
+using intv = native_simd<int32_t>;
+
 // ===== PROFILING UTILITIES =====
+
+// Prints each benchmark region as it closes, with IPC and misses per
+// thousand instructions when hardware counters are available (see
+// perf_counters.h). The region is also a trace scope (see profiler.h), so
+// it shows up in the aggregated report and the Chrome trace written at the
+// end; hot loops use TRACE_SCOPE directly.
 class Profiler {
 private:
-    chrono::high_resolution_clock::time_point start_time;
+    optional<TraceScope> scope;
     string name;
+    PerfSample start_counters;
+    uint64_t start_ticks;
 
 public:
     Profiler(const string& name) : name(name) {
-        start_time = chrono::high_resolution_clock::now();
+        scope.emplace(name);
+        start_counters = PerfCounters::local().read();
+        start_ticks = TscClock::now();
     }
 
     ~Profiler() {
-        auto end_time = chrono::high_resolution_clock::now();
-        auto duration = chrono::duration_cast<chrono::microseconds>(end_time - start_time);
-        cout << name << " took " << duration.count() << " microseconds" << endl;
+        double us = TscClock::to_ns(TscClock::now() - start_ticks) / 1e3;
+        string counters = perf_summary(PerfCounters::local().read() - start_counters);
+        scope.reset();
+        cout << name << " took " << static_cast<long long>(us) << " microseconds";
+        if (!counters.empty()) cout << " [" << counters << "]";
+        cout << endl;
     }
 };
 
@@ -37,33 +66,31 @@ struct ParticleAOS {
     float mass;       // Mass
 };
 
-// Cache-friendly: Struct of arrays
+// Cache-friendly: Struct of arrays, each array cache-line aligned so
+// whole SIMD vectors load without splitting lines
 struct ParticleSOA {
-    vector<float> x, y, z;
-    vector<float> vx, vy, vz;
-    vector<float> mass;
+    aligned_vector<float> x, y, z;
+    aligned_vector<float> vx, vy, vz;
+    aligned_vector<float> mass;
 };
 
 // ===== MATRIX OPERATIONS =====
 
 // Naive matrix multiplication (cache-unfriendly)
-void matrixMultiplyNaive(const vector<vector<float>>& A,
-                        const vector<vector<float>>& B,
-                        vector<vector<float>>& C, int N) {
+void matrixMultiplyNaive(const Matrix<float>& A, const Matrix<float>& B, Matrix<float>& C, int N) {
     for (int i = 0; i < N; ++i) {
         for (int j = 0; j < N; ++j) {
-            C[i][j] = 0;
+            C(i, j) = 0;
             for (int k = 0; k < N; ++k) {
-                C[i][j] += A[i][k] * B[k][j];
+                C(i, j) += A(i, k) * B(k, j);
             }
         }
     }
 }
 
 // Cache-friendly matrix multiplication (blocked)
-void matrixMultiplyBlocked(const vector<vector<float>>& A,
-                          const vector<vector<float>>& B,
-                          vector<vector<float>>& C, int N, int blockSize = 64) {
+void matrixMultiplyBlocked(const Matrix<float>& A, const Matrix<float>& B, Matrix<float>& C, int N,
+                           int blockSize = 64) {
     for (int ii = 0; ii < N; ii += blockSize) {
         for (int jj = 0; jj < N; jj += blockSize) {
             for (int kk = 0; kk < N; kk += blockSize) {
@@ -74,11 +101,11 @@ void matrixMultiplyBlocked(const vector<vector<float>>& A,
 
                 for (int i = ii; i < iEnd; ++i) {
                     for (int j = jj; j < jEnd; ++j) {
-                        float sum = C[i][j];
+                        float sum = C(i, j);
                         for (int k = kk; k < kEnd; ++k) {
-                            sum += A[i][k] * B[k][j];
+                            sum += A(i, k) * B(k, j);
                         }
-                        C[i][j] = sum;
+                        C(i, j) = sum;
                     }
                 }
             }
@@ -86,10 +113,30 @@ void matrixMultiplyBlocked(const vector<vector<float>>& A,
     }
 }
 
+// Vectorized multiplication: i-k-j order so the inner loop streams a row of
+// B and a row of C, with A(i, k) broadcast across the lanes
+void matrixMultiplySimd(const Matrix<float>& A, const Matrix<float>& B, Matrix<float>& C, int N) {
+    for (int i = 0; i < N; ++i) {
+        float* c = C.row(i);
+        fill(c, c + N, 0.0f);
+        for (int k = 0; k < N; ++k) {
+            floatv a(A(i, k));
+            const float* b = B.row(k);
+            int j = 0;
+            for (; j + floatv::size <= N; j += floatv::size) {
+                (floatv::load(c + j) + a * floatv::load(b + j)).store(c + j);
+            }
+            for (; j < N; ++j) {
+                c[j] += A(i, k) * b[j];
+            }
+        }
+    }
+}
+
 // ===== BRANCH PREDICTION OPTIMIZATION =====
 
 // Branchy version (hard to predict)
-int sumWithBranches(const vector<int>& data) {
+int sumWithBranches(const aligned_vector<int>& data) {
     int sum = 0;
     for (int x : data) {
         if (x > 0) {        // Branch based on data
@@ -102,7 +149,7 @@ int sumWithBranches(const vector<int>& data) {
 }
 
 // Branchless version (predictable)
-int sumBranchless(const vector<int>& data) {
+int sumBranchless(const aligned_vector<int>& data) {
     int sum = 0;
     for (int x : data) {
         // Use arithmetic instead of branches
@@ -112,17 +159,36 @@ int sumBranchless(const vector<int>& data) {
     return sum;
 }
 
+// SIMD version: both sides of the branch are computed and a compare mask
+// picks per lane. Lanes wrap on overflow exactly like the scalar int sum.
+int sumSimd(const aligned_vector<int>& data) {
+    const int32_t* p = data.data();
+    size_t n = data.size(), i = 0;
+    intv lanes(0);
+    simd_with_alignment<intv>([&](auto flags) {
+        for (; i + intv::size <= n; i += intv::size) {
+            intv x = intv::load(p + i, flags);
+            lanes += select(x > intv(0), x, -x);
+        }
+    }, p);
+    uint32_t sum = static_cast<uint32_t>(reduce_add(lanes));
+    for (; i < n; ++i) {
+        sum += static_cast<uint32_t>(p[i] > 0 ? p[i] : -p[i]);
+    }
+    return static_cast<int>(sum);
+}
+
 // ===== LOOP OPTIMIZATION =====
 
 // Inefficient loop (multiple array accesses per iteration)
-void processDataInefficient(vector<int>& data) {
+void processDataInefficient(aligned_vector<int>& data) {
     for (size_t i = 0; i < data.size(); ++i) {
         data[i] = data[i] * 2 + data[(i + 1) % data.size()];
     }
 }
 
 // Optimized loop (single pass, cache-friendly)
-void processDataOptimized(vector<int>& data) {
+void processDataOptimized(aligned_vector<int>& data) {
     if (data.empty()) return;
 
     int next = data[0]; // Cache first element
@@ -136,6 +202,25 @@ void processDataOptimized(vector<int>& data) {
     data.back() = data.back() * 2 + data[0];
 }
 
+// SIMD version: both loads of a block happen before its store, and the store
+// never reaches the element the next block reads first. The p + i + 1 load
+// is never aligned; the other load and the store are on aligned storage.
+void processDataSimd(aligned_vector<int>& data) {
+    if (data.empty()) return;
+
+    int32_t* p = data.data();
+    size_t n = data.size(), i = 0;
+    simd_with_alignment<intv>([&](auto flags) {
+        for (; i + intv::size < n; i += intv::size) {
+            (intv::load(p + i, flags) * intv(2) + intv::load(p + i + 1)).store(p + i, flags);
+        }
+    }, p);
+    for (; i + 1 < n; ++i) {
+        p[i] = p[i] * 2 + p[i + 1];
+    }
+    data.back() = data.back() * 2 + data[0];
+}
+
 // ===== MEMORY ACCESS PATTERNS =====
 
 // Strided access (cache-unfriendly)
@@ -158,7 +243,55 @@ long long sumSequential(const vector<int>& data) {
 
 // ===== DEMONSTRATION =====
 
+void demonstrateInstrumentationOverhead() {
+    cout << "=== Instrumentation ===\n" << endl;
+
+    const int SCOPES = 1'000'000;
+    volatile uint64_t sink = 0;
+    auto perIteration = [&](auto&& body) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < SCOPES; ++i) body();
+        return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / SCOPES;
+    };
+    auto emptyScope = [&] {
+        TRACE_SCOPE("empty scope");
+        sink = sink + 1;
+    };
+
+    const PerfCounters& counters = PerfCounters::local();
+    if (counters.available()) {
+        PerfSample sample = counters.read();
+        cout << "Hardware counters:";
+        for (PerfEvent e : {PerfEvent::Cycles, PerfEvent::Instructions, PerfEvent::L1DMisses, PerfEvent::LLCMisses,
+                            PerfEvent::BranchMisses}) {
+            if (sample.has(e)) cout << " " << perf_event_name(e) << ";";
+        }
+        cout << endl;
+    } else {
+        cout << "Hardware counters unavailable, timing only: " << counters.unavailable_reason() << endl;
+    }
+
+    // The first pass allocates the thread's buffer blocks; reset keeps them
+    perIteration(emptyScope);
+    trace_reset();
+    double loop = perIteration([&] { sink = sink + 1; });
+    double tscRead = perIteration([&] { sink = TscClock::now(); }) - loop;
+    double scope = perIteration(emptyScope) - loop;
+
+    cout << "TSC rate: " << fixed << setprecision(3) << 1.0 / TscClock::ns_per_tick() << " GHz" << endl;
+    cout << setprecision(1) << "TSC read: " << tscRead << " ns" << endl;
+    cout << "TRACE_SCOPE overhead: " << scope << " ns per scope (two TSC reads + one buffer append)" << endl;
+    for (const ScopeStats& s : trace_statistics()) {
+        cout << "  " << s.name() << " as recorded: p50 " << s.p50_ns << " ns, p99 " << s.p99_ns << " ns" << endl;
+    }
+    cout << defaultfloat;
+    // Keep the million empty scopes out of the report and trace below
+    trace_reset();
+    cout << endl;
+}
+
 void demonstrateCacheFriendlyDataStructures() {
+    TRACE_SCOPE("demonstrateCacheFriendlyDataStructures");
     cout << "=== Cache-Friendly Data Structures ===\n" << endl;
 
     const int NUM_PARTICLES = 10000;
@@ -212,18 +345,116 @@ void demonstrateCacheFriendlyDataStructures() {
             sum += x;
         }
     }
+
+    // SOA with simd<float, N>: contiguous x values fill whole vectors
+    {
+        PROFILE_SCOPE("SOA - Process X coordinates (simd<float, " + to_string(floatv::size) + ">)");
+        floatv lanes(0.0f);
+        int i = 0;
+        for (; i + floatv::size <= NUM_PARTICLES; i += floatv::size) {
+            lanes += floatv::load_aligned(&particlesSOA.x[i]);
+        }
+        float sum = reduce_add(lanes);
+        for (; i < NUM_PARTICLES; ++i) {
+            sum += particlesSOA.x[i];
+        }
+    }
+}
+
+void demonstrateParticleSystem() {
+    TRACE_SCOPE("demonstrateParticleSystem");
+    cout << "\n=== SoA Particle System ===\n" << endl;
+
+    const size_t N = 10'000'000;
+    const int STEPS = 5;
+    const float dt = 0.001f;
+    const ParticleSystem::Vec3 lo = {0.0f, 0.0f, 0.0f}, hi = {100.0f, 100.0f, 100.0f};
+
+    mt19937 gen(42);
+    uniform_real_distribution<float> position(0.0f, 100.0f), velocity(-10.0f, 10.0f);
+    ParticleSystem system(lo, hi);
+    system.resize(N);
+    vector<ParticleAOS> particlesAOS(N);
+    for (size_t i = 0; i < N; ++i) {
+        ParticleAOS& p = particlesAOS[i];
+        p = {position(gen), position(gen), position(gen), velocity(gen), velocity(gen), velocity(gen), 1.0f};
+        system.x()[i] = p.x;
+        system.y()[i] = p.y;
+        system.z()[i] = p.z;
+        system.vx()[i] = p.vx;
+        system.vy()[i] = p.vy;
+        system.vz()[i] = p.vz;
+        system.mass()[i] = p.mass;
+    }
+
+    auto nsPerParticleStep = [&](const string& name, auto&& step) {
+        auto start = chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE(name);
+            for (int s = 0; s < STEPS; ++s) step();
+        }
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        cout << "  " << fixed << setprecision(2) << ns / (double(N) * STEPS) << " ns/particle/step" << defaultfloat
+             << endl;
+    };
+
+    // Same physics, one particle at a time over the array of structs
+    auto bounce = [](float& p, float& v, float lo, float hi) {
+        if (p < lo || p > hi) {
+            p = clamp(p < lo ? 2.0f * lo - p : 2.0f * hi - p, lo, hi);
+            v = -v;
+        }
+    };
+    nsPerParticleStep("AOS scalar integration (" + to_string(N) + " particles)", [&] {
+        for (ParticleAOS& p : particlesAOS) {
+            p.vy += system.gravity.y * dt;
+            p.x += p.vx * dt;
+            p.y += p.vy * dt;
+            p.z += p.vz * dt;
+            bounce(p.x, p.vx, lo.x, hi.x);
+            bounce(p.y, p.vy, lo.y, hi.y);
+            bounce(p.z, p.vz, lo.z, hi.z);
+        }
+    });
+    nsPerParticleStep("SOA ParticleSystem::step (simd<float, " + to_string(floatv::size) + ">, " +
+                          to_string(par_concurrency(default_pool())) + " threads)",
+                      [&] { system.step(dt); });
+
+    // Spatial hash on a smaller, denser set: about 30 particles per cell
+    const size_t M = 1'000'000;
+    ParticleSystem cloud(lo, {50.0f, 50.0f, 50.0f});
+    cloud.resize(M);
+    uniform_real_distribution<float> inside(0.0f, 50.0f);
+    for (size_t i = 0; i < M; ++i) {
+        cloud.x()[i] = inside(gen);
+        cloud.y()[i] = inside(gen);
+        cloud.z()[i] = inside(gen);
+    }
+    auto start = chrono::steady_clock::now();
+    {
+        PROFILE_SCOPE("Spatial hash build (" + to_string(M) + " particles)");
+        cloud.build_neighbor_grid(1.5f);
+    }
+    vector<uint32_t> counts;
+    {
+        PROFILE_SCOPE("Neighbour counts within r = 1.5");
+        counts = cloud.count_neighbors(1.5f);
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    cout << "  " << fixed << setprecision(2) << ns / double(M) << " ns/particle, average "
+         << double(accumulate(counts.begin(), counts.end(), uint64_t(0))) / double(M) << " neighbours"
+         << defaultfloat << endl;
 }
 
 void demonstrateMatrixMultiplication() {
+    TRACE_SCOPE("demonstrateMatrixMultiplication");
     cout << "\n=== Matrix Multiplication Optimization ===\n" << endl;
 
     const int N = 256; // Matrix size
 
-    // Initialize matrices
-    vector<vector<float>> A(N, vector<float>(N));
-    vector<vector<float>> B(N, vector<float>(N));
-    vector<vector<float>> C1(N, vector<float>(N, 0));
-    vector<vector<float>> C2(N, vector<float>(N, 0));
+    // Initialize matrices: contiguous row-major storage, one allocation each
+    Matrix<float> A(N, N), B(N, N);
+    Matrix<float> C1(N, N), C2(N, N), C3(N, N), C4(N, N);
 
     // Fill with random data
     random_device rd;
@@ -232,38 +463,63 @@ void demonstrateMatrixMultiplication() {
 
     for (int i = 0; i < N; ++i) {
         for (int j = 0; j < N; ++j) {
-            A[i][j] = dist(gen);
-            B[i][j] = dist(gen);
+            A(i, j) = dist(gen);
+            B(i, j) = dist(gen);
         }
     }
 
-    // Benchmark naive multiplication
-    {
-        PROFILE_SCOPE("Naive Matrix Multiplication");
-        matrixMultiplyNaive(A, B, C1, N);
-    }
+    // 2 * N^3 floating-point operations per product
+    auto gflops = [](size_t n, chrono::steady_clock::duration elapsed) {
+        return 2.0 * double(n) * double(n) * double(n) / chrono::duration<double>(elapsed).count() / 1e9;
+    };
+    auto timed = [&](const string& name, size_t n, auto&& multiply) {
+        auto start = chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE(name);
+            multiply();
+        }
+        cout << "  " << fixed << setprecision(2) << gflops(n, chrono::steady_clock::now() - start) << " GFLOP/s"
+             << defaultfloat << endl;
+    };
 
-    // Benchmark blocked multiplication
-    {
-        PROFILE_SCOPE("Blocked Matrix Multiplication");
-        matrixMultiplyBlocked(A, B, C2, N);
-    }
+    timed("Naive Matrix Multiplication", N, [&] { matrixMultiplyNaive(A, B, C1, N); });
+    timed("Blocked Matrix Multiplication", N, [&] { matrixMultiplyBlocked(A, B, C2, N); });
+    timed("SIMD Matrix Multiplication (simd<float, " + to_string(floatv::size) + ">)", N,
+          [&] { matrixMultiplySimd(A, B, C3, N); });
+    timed("Packed GEMM (" + to_string(par_concurrency(default_pool())) + " threads)", N, [&] { gemm(A, B, C4); });
 
     // Verify results are similar
     float maxDiff = 0;
     for (int i = 0; i < N; ++i) {
         for (int j = 0; j < N; ++j) {
-            maxDiff = max(maxDiff, abs(C1[i][j] - C2[i][j]));
+            maxDiff = max(maxDiff, abs(C1(i, j) - C2(i, j)));
+            maxDiff = max(maxDiff, abs(C1(i, j) - C3(i, j)));
+            maxDiff = max(maxDiff, abs(C1(i, j) - C4(i, j)));
         }
     }
     cout << "Maximum difference between methods: " << maxDiff << endl;
+
+    // Only the packed GEMM is practical at these sizes; 8192 works the same
+    // way but takes about a TFLOP of work
+    cout << "\nPacked GEMM on larger matrices:" << endl;
+    for (int n : {1024, 2048, 4096}) {
+        Matrix<float> X(n, n), Y(n, n), Z(n, n);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                X(i, j) = dist(gen);
+                Y(i, j) = dist(gen);
+            }
+        }
+        timed("GEMM " + to_string(n) + "x" + to_string(n), n, [&] { gemm(X, Y, Z); });
+    }
 }
 
 void demonstrateBranchPrediction() {
+    TRACE_SCOPE("demonstrateBranchPrediction");
     cout << "\n=== Branch Prediction Optimization ===\n" << endl;
 
     const int SIZE = 1000000;
-    vector<int> data(SIZE);
+    aligned_vector<int> data(SIZE);
 
     // Create data with pattern (mostly positive, some negative)
     for (int i = 0; i < SIZE; ++i) {
@@ -284,12 +540,21 @@ void demonstrateBranchPrediction() {
         result2 = sumBranchless(data);
     }
 
+    // Benchmark SIMD version
+    int result3;
+    {
+        PROFILE_SCOPE("SIMD sum (simd<int32_t, " + to_string(intv::size) + ">)");
+        result3 = sumSimd(data);
+    }
+
     cout << "Branchy result: " << result1 << endl;
     cout << "Branchless result: " << result2 << endl;
-    cout << "Results match: " << (result1 == result2 ? "Yes" : "No") << endl;
+    cout << "SIMD result: " << result3 << endl;
+    cout << "Results match: " << (result1 == result2 && result1 == result3 ? "Yes" : "No") << endl;
 }
 
 void demonstrateMemoryAccessPatterns() {
+    TRACE_SCOPE("demonstrateMemoryAccessPatterns");
     cout << "\n=== Memory Access Patterns ===\n" << endl;
 
     const int SIZE = 1000000;
@@ -315,17 +580,89 @@ void demonstrateMemoryAccessPatterns() {
     cout << "Sequential sum: " << result1 << endl;
     cout << "Strided sum: " << result2 << endl;
     cout << "Results match: " << (result1 == result2 ? "Yes" : "No") << endl;
+
+    // Layout changes are pure data movement: bytes read + bytes written per
+    // second, best of a few runs
+    const int RUNS = 3;
+    auto gbPerSecond = [&](const string& name, double bytes, auto&& kernel) {
+        double best = 1e300;
+        {
+            PROFILE_SCOPE(name);
+            for (int r = 0; r < RUNS; ++r) {
+                auto start = chrono::steady_clock::now();
+                kernel();
+                best = min(best, chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+            }
+        }
+        cout << "  " << fixed << setprecision(2) << bytes / best << " GB/s" << defaultfloat << endl;
+    };
+    const string threads = to_string(par_concurrency(default_pool())) + " threads";
+
+    const size_t T = 4096;
+    Matrix<float> square(T, T), transposed(T, T), reference(T, T);
+    for (size_t i = 0; i < T * T; ++i) square.data()[i] = float(i);
+    gbPerSecond("Naive transpose (" + to_string(T) + "x" + to_string(T) + " float)", 2.0 * T * T * sizeof(float), [&] {
+        for (size_t i = 0; i < T; ++i) {
+            for (size_t j = 0; j < T; ++j) reference(j, i) = square(i, j);
+        }
+    });
+    gbPerSecond("Cache-oblivious transpose, register tiles (" + threads + ")", 2.0 * T * T * sizeof(float),
+                [&] { transpose(square, transposed); });
+    cout << "Transposes match: "
+         << (memcmp(reference.data(), transposed.data(), T * T * sizeof(float)) == 0 ? "Yes" : "No") << endl;
+
+    const size_t P = 4'000'000;
+    vector<ParticleAOS> particles(P);
+    for (size_t i = 0; i < P; ++i) particles[i] = {float(i), 1, 2, 3, 4, 5, 6};
+    ParticleSOA naiveSoa, soa;
+    for (ParticleSOA* s : {&naiveSoa, &soa}) {
+        for (auto* field : {&s->x, &s->y, &s->z, &s->vx, &s->vy, &s->vz, &s->mass}) field->resize(P);
+    }
+    gbPerSecond("Naive AoS -> SoA (" + to_string(P) + " particles)", 2.0 * P * sizeof(ParticleAOS), [&] {
+        for (size_t i = 0; i < P; ++i) {
+            const ParticleAOS& p = particles[i];
+            naiveSoa.x[i] = p.x;
+            naiveSoa.y[i] = p.y;
+            naiveSoa.z[i] = p.z;
+            naiveSoa.vx[i] = p.vx;
+            naiveSoa.vy[i] = p.vy;
+            naiveSoa.vz[i] = p.vz;
+            naiveSoa.mass[i] = p.mass;
+        }
+    });
+    gbPerSecond("Blocked aos_to_soa (" + threads + ")", 2.0 * P * sizeof(ParticleAOS), [&] {
+        aos_to_soa(span<const ParticleAOS>(particles), soa_column(&ParticleAOS::x, soa.x),
+                   soa_column(&ParticleAOS::y, soa.y), soa_column(&ParticleAOS::z, soa.z),
+                   soa_column(&ParticleAOS::vx, soa.vx), soa_column(&ParticleAOS::vy, soa.vy),
+                   soa_column(&ParticleAOS::vz, soa.vz), soa_column(&ParticleAOS::mass, soa.mass));
+    });
+    cout << "Conversions match: " << (naiveSoa.x == soa.x && naiveSoa.mass == soa.mass ? "Yes" : "No") << endl;
+
+    const size_t FRAMES = 16'000'000;
+    aligned_vector<float> stereo(2 * FRAMES), naivePlanar(2 * FRAMES), planar(2 * FRAMES);
+    for (size_t i = 0; i < stereo.size(); ++i) stereo[i] = float(i);
+    gbPerSecond("Naive stereo deinterleave (" + to_string(FRAMES) + " frames)", 2.0 * stereo.size() * sizeof(float), [&] {
+        for (size_t f = 0; f < FRAMES; ++f) {
+            naivePlanar[f] = stereo[2 * f];
+            naivePlanar[FRAMES + f] = stereo[2 * f + 1];
+        }
+    });
+    gbPerSecond("SSE deinterleave (" + threads + ")", 2.0 * stereo.size() * sizeof(float),
+                [&] { deinterleave(span<const float>(stereo), 2, span<float>(planar)); });
+    cout << "Deinterleaves match: " << (naivePlanar == planar ? "Yes" : "No") << endl;
 }
 
 void demonstrateLoopOptimization() {
+    TRACE_SCOPE("demonstrateLoopOptimization");
     cout << "\n=== Loop Optimization ===\n" << endl;
 
     const int SIZE = 100000;
-    vector<int> data1(SIZE), data2(SIZE);
+    aligned_vector<int> data1(SIZE), data2(SIZE), data3(SIZE);
 
     // Initialize test data
     iota(data1.begin(), data1.end(), 0);
     iota(data2.begin(), data2.end(), 0);
+    iota(data3.begin(), data3.end(), 0);
 
     // Benchmark inefficient version
     {
@@ -339,26 +676,47 @@ void demonstrateLoopOptimization() {
         processDataOptimized(data2);
     }
 
+    // Benchmark SIMD version
+    {
+        PROFILE_SCOPE("SIMD loop (simd<int32_t, " + to_string(intv::size) + ">)");
+        processDataSimd(data3);
+    }
+
     // Verify results are the same
-    bool resultsMatch = equal(data1.begin(), data1.end(), data2.begin());
+    bool resultsMatch = data1 == data2 && data1 == data3;
     cout << "Results match: " << (resultsMatch ? "Yes" : "No") << endl;
 }
 
 int main() {
     cout << "=== C++ Performance Optimization Demo ===\n" << endl;
 
+    demonstrateInstrumentationOverhead();
     demonstrateCacheFriendlyDataStructures();
+    demonstrateParticleSystem();
     demonstrateMatrixMultiplication();
     demonstrateBranchPrediction();
     demonstrateMemoryAccessPatterns();
     demonstrateLoopOptimization();
 
+    cout << "\n=== Aggregated Profile ===\n" << endl;
+    trace_report(cout);
+    const char* tracePath = "performance_optimization_trace.json";
+    ofstream trace(tracePath);
+    trace_write_chrome_json(trace);
+    cout << "Chrome trace written to " << tracePath << " (open in chrome://tracing or ui.perfetto.dev)" << endl;
+
     cout << "\n=== Performance Optimization Summary ===" << endl;
     cout << "• Cache-Friendly Data: SOA often faster than AOS for specific operations" << endl;
+    cout << "• Particle System: aligned SoA + simd + threads stream a step at memory bandwidth; a spatial hash finds neighbours" << endl;
     cout << "• Matrix Multiplication: Blocking improves cache utilization" << endl;
+    cout << "• GEMM: packed panels + register-blocked FMA microkernel + threads reach tens of GFLOP/s" << endl;
     cout << "• Branch Prediction: Avoid branches when possible, use arithmetic" << endl;
     cout << "• Memory Access: Sequential access is much faster than strided access" << endl;
+    cout << "• Data Layout: cache-oblivious transpose with register tiles; blocked AoS<->SoA and channel (de)interleaving" << endl;
     cout << "• Loop Optimization: Minimize array accesses, cache values in registers" << endl;
+    cout << "• SIMD: simd<T, N> kernels process 4-8 elements per instruction" << endl;
+    cout << "• Profiling: TSC-stamped scopes in per-thread buffers cost nanoseconds; aggregate and trace offline" << endl;
+    cout << "• Hardware Counters: IPC and misses/kinstr tell cache misses apart from branch mispredictions" << endl;
     cout << "• Always profile your code to identify actual bottlenecks!" << endl;
 
     return 0;
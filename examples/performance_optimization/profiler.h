@@ -0,0 +1,320 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_HAVE_TSC 1
+#endif
+
+// ===== TSC CLOCK =====
+//
+// now() reads the time-stamp counter: a handful of cycles, no system call,
+// and constant-rate on every x86 CPU of the last decade. Ticks are turned
+// into nanoseconds with a rate measured once against steady_clock. Other
+// architectures fall back to steady_clock, so a tick is a nanosecond.
+
+struct TscClock {
+    static std::uint64_t now() {
+#if defined(PROFILER_HAVE_TSC)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    static double ns_per_tick() {
+        static const double rate = calibrate();
+        return rate;
+    }
+
+    static double to_ns(std::uint64_t ticks) { return static_cast<double>(ticks) * ns_per_tick(); }
+
+private:
+    // Spins for about 20 ms; runs on first use
+    static double calibrate() {
+#if defined(PROFILER_HAVE_TSC)
+        using clock = std::chrono::steady_clock;
+        const auto t0 = clock::now();
+        const std::uint64_t c0 = now();
+        auto t1 = t0;
+        while (t1 - t0 < std::chrono::milliseconds(20)) t1 = clock::now();
+        const std::uint64_t c1 = now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(c1 - c0);
+#else
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::duration(1)).count();
+#endif
+    }
+};
+
+// ===== PER-THREAD TRACE BUFFERS =====
+//
+// A TraceScope records one event when it closes: name, start and end ticks,
+// and its nesting depth on that thread. Each thread appends to its own
+// buffer, so the hot path takes no lock and shares no cache line; the
+// buffer publishes its length with a release store, so a report can read
+// every finished event while other threads keep recording. Buffers grow in
+// fixed blocks (nothing is ever moved) and stay registered after their
+// thread exits. A full buffer counts the events it drops.
+
+struct TraceEvent {
+    const char* name;
+    std::uint64_t start, end;
+    std::uint32_t depth;
+};
+
+class TraceBuffer {
+public:
+    static constexpr std::size_t block_size = 4096;
+    static constexpr std::size_t max_blocks = 1024;   // 4M events per thread
+
+    explicit TraceBuffer(std::uint32_t thread_index) : thread_index_(thread_index) {}
+
+    std::uint32_t thread_index() const { return thread_index_; }
+    std::size_t size() const { return size_.load(std::memory_order_acquire); }
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    const TraceEvent& operator[](std::size_t i) const { return blocks_[i / block_size][i % block_size]; }
+
+    void record(const char* name, std::uint64_t start, std::uint64_t end, std::uint32_t depth) {
+        const std::size_t n = size_.load(std::memory_order_relaxed);
+        const std::size_t block = n / block_size;
+        if (n % block_size == 0) {
+            if (block == max_blocks) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (!blocks_[block]) blocks_[block] = std::make_unique_for_overwrite<TraceEvent[]>(block_size);
+        }
+        blocks_[block][n % block_size] = {name, start, end, depth};
+        size_.store(n + 1, std::memory_order_release);
+    }
+
+    // Forgets recorded events but keeps the blocks for reuse
+    void clear() {
+        size_.store(0, std::memory_order_release);
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+    // Current nesting depth; only touched by the owning thread
+    std::uint32_t depth = 0;
+
+private:
+    std::uint32_t thread_index_;
+    std::atomic<std::size_t> size_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::array<std::unique_ptr<TraceEvent[]>, max_blocks> blocks_;
+};
+
+class TraceRegistry {
+public:
+    static TraceRegistry& instance() {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    // The calling thread's buffer, registered on first use
+    static TraceBuffer& local() {
+        thread_local TraceBuffer* buffer = instance().add_buffer();
+        return *buffer;
+    }
+
+    // Stable copy of a dynamic scope name; literals can be passed directly
+    const char* intern(std::string_view name) {
+        std::lock_guard<std::mutex> lk(m_);
+        return names_.emplace(name).first->c_str();
+    }
+
+    template<typename F>
+    void for_each_buffer(F&& f) const {
+        std::lock_guard<std::mutex> lk(m_);
+        for (const auto& buffer : buffers_) f(*buffer);
+    }
+
+    // Only valid while no thread is inside a traced scope
+    void clear() {
+        std::lock_guard<std::mutex> lk(m_);
+        for (auto& buffer : buffers_) buffer->clear();
+    }
+
+private:
+    TraceRegistry() = default;
+
+    TraceBuffer* add_buffer() {
+        std::lock_guard<std::mutex> lk(m_);
+        buffers_.push_back(std::make_unique<TraceBuffer>(static_cast<std::uint32_t>(buffers_.size())));
+        return buffers_.back().get();
+    }
+
+    mutable std::mutex m_;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+    std::unordered_set<std::string> names_;
+};
+
+// RAII scope: two TSC reads and one buffer append. name must outlive the
+// trace (a literal, or the result of trace_intern)
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : buffer_(TraceRegistry::local()), name_(name) {
+        depth_ = buffer_.depth++;
+        start_ = TscClock::now();
+    }
+    explicit TraceScope(const std::string& name) : TraceScope(TraceRegistry::instance().intern(name)) {}
+
+    ~TraceScope() {
+        const std::uint64_t end = TscClock::now();
+        buffer_.depth = depth_;
+        buffer_.record(name_, start_, end, depth_);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceBuffer& buffer_;
+    const char* name_;
+    std::uint64_t start_;
+    std::uint32_t depth_;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+inline const char* trace_intern(std::string_view name) { return TraceRegistry::instance().intern(name); }
+
+// Drops every recorded event; call while no thread is inside a traced scope
+inline void trace_reset() { TraceRegistry::instance().clear(); }
+
+// ===== AGGREGATED STATISTICS =====
+
+// Timings of one call path ("outer/inner"), over every thread
+struct ScopeStats {
+    std::vector<std::string> path;   // outermost scope first
+    std::uint64_t count = 0;
+    double total_ns = 0, min_ns = 0, p50_ns = 0, p99_ns = 0, max_ns = 0;
+
+    const std::string& name() const { return path.back(); }
+    std::size_t depth() const { return path.size() - 1; }
+};
+
+// Merges all buffers into per-path statistics, in tree order: every path
+// is followed by its children. A scope's path comes from the scopes that
+// enclosed it on its own thread.
+inline std::vector<ScopeStats> trace_statistics() {
+    std::map<std::vector<std::string>, std::vector<std::uint64_t>> durations;
+    TraceRegistry::instance().for_each_buffer([&](const TraceBuffer& buffer) {
+        std::vector<TraceEvent> events(buffer.size());
+        for (std::size_t i = 0; i < events.size(); ++i) events[i] = buffer[i];
+        // Events are recorded as scopes close, children before parents;
+        // in start order each event's parent is the last one a level up
+        std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+            return a.start != b.start ? a.start < b.start : a.depth < b.depth;
+        });
+        std::vector<std::string> path;
+        for (const TraceEvent& e : events) {
+            path.resize(std::min<std::size_t>(path.size(), e.depth));
+            // A parent still open when the report runs has no event yet
+            while (path.size() < e.depth) path.emplace_back("?");
+            path.emplace_back(e.name);
+            durations[path].push_back(e.end - e.start);
+        }
+    });
+
+    std::vector<ScopeStats> stats;
+    for (auto& [path, ticks] : durations) {
+        std::sort(ticks.begin(), ticks.end());
+        ScopeStats s;
+        s.path = path;
+        s.count = ticks.size();
+        std::uint64_t total = 0;
+        for (std::uint64_t t : ticks) total += t;
+        auto percentile = [&](double p) { return TscClock::to_ns(ticks[static_cast<std::size_t>(p * (ticks.size() - 1))]); };
+        s.total_ns = TscClock::to_ns(total);
+        s.min_ns = TscClock::to_ns(ticks.front());
+        s.p50_ns = percentile(0.50);
+        s.p99_ns = percentile(0.99);
+        s.max_ns = TscClock::to_ns(ticks.back());
+        stats.push_back(std::move(s));
+    }
+    return stats;
+}
+
+inline std::uint64_t trace_dropped_events() {
+    std::uint64_t dropped = 0;
+    TraceRegistry::instance().for_each_buffer([&](const TraceBuffer& buffer) { dropped += buffer.dropped(); });
+    return dropped;
+}
+
+// Indented table of trace_statistics(), times in microseconds
+inline void trace_report(std::ostream& out) {
+    char line[256];
+    std::snprintf(line, sizeof line, "%-44s %9s %12s %10s %10s %10s %10s\n", "scope", "count", "total us", "min us",
+                  "p50 us", "p99 us", "max us");
+    out << line;
+    for (const ScopeStats& s : trace_statistics()) {
+        std::string label = std::string(2 * s.depth(), ' ') + s.name();
+        if (label.size() > 44) label = label.substr(0, 41) + "...";
+        std::snprintf(line, sizeof line, "%-44s %9llu %12.1f %10.3f %10.3f %10.3f %10.3f\n", label.c_str(),
+                      static_cast<unsigned long long>(s.count), s.total_ns / 1e3, s.min_ns / 1e3, s.p50_ns / 1e3,
+                      s.p99_ns / 1e3, s.max_ns / 1e3);
+        out << line;
+    }
+    if (std::uint64_t dropped = trace_dropped_events()) out << dropped << " events dropped (buffers full)\n";
+}
+
+// ===== CHROME TRACE EXPORT =====
+
+inline void trace_write_json_string(std::ostream& out, std::string_view s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof escaped, "\\u%04x", static_cast<unsigned>(c));
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// Trace-event JSON ("X" complete events, one track per thread) for
+// chrome://tracing, Perfetto or speedscope; nesting shows as a flame chart
+inline void trace_write_chrome_json(std::ostream& out) {
+    std::uint64_t origin = UINT64_MAX;
+    TraceRegistry::instance().for_each_buffer([&](const TraceBuffer& buffer) {
+        for (std::size_t i = 0; i < buffer.size(); ++i) origin = std::min(origin, buffer[i].start);
+    });
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    TraceRegistry::instance().for_each_buffer([&](const TraceBuffer& buffer) {
+        const std::size_t n = buffer.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            const TraceEvent& e = buffer[i];
+            char timing[96];
+            std::snprintf(timing, sizeof timing, ",\"ts\":%.3f,\"dur\":%.3f", TscClock::to_ns(e.start - origin) / 1e3,
+                          TscClock::to_ns(e.end - e.start) / 1e3);
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            trace_write_json_string(out, e.name);
+            out << ",\"ph\":\"X\"" << timing << ",\"pid\":1,\"tid\":" << buffer.thread_index() << '}';
+            first = false;
+        }
+    });
+    out << "\n]}\n";
+}
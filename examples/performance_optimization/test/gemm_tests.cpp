@@ -0,0 +1,64 @@
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include "../gemm.h"
+
+// Every shape is compared against a plain triple loop in long double;
+// sizes straddle MR, NR, KC, MC and NC so all edge paths run
+template<typename T>
+void check_gemm(ThreadPool& pool, std::size_t m, std::size_t n, std::size_t k, T alpha, T beta) {
+    std::mt19937 rng(static_cast<unsigned>(m * 131 + n * 17 + k));
+    std::uniform_real_distribution<T> dist(T(-1), T(1));
+    Matrix<T> a(m, k), b(k, n), c(m, n);
+    for (std::size_t i = 0; i < m; ++i) for (std::size_t p = 0; p < k; ++p) a(i, p) = dist(rng);
+    for (std::size_t p = 0; p < k; ++p) for (std::size_t j = 0; j < n; ++j) b(p, j) = dist(rng);
+    for (std::size_t i = 0; i < m; ++i) for (std::size_t j = 0; j < n; ++j) c(i, j) = dist(rng);
+    Matrix<T> original = c;
+
+    gemm(pool, a, b, c, alpha, beta);
+
+    [[maybe_unused]] const long double tolerance = (std::is_same_v<T, float> ? 1e-5L : 1e-13L) * (k + 1);
+    for (std::size_t i = 0; i < m; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            long double expected = beta * static_cast<long double>(original(i, j));
+            long double dot = 0;
+            for (std::size_t p = 0; p < k; ++p) dot += static_cast<long double>(a(i, p)) * b(p, j);
+            expected += alpha * dot;
+            assert(std::fabs(static_cast<long double>(c(i, j)) - expected) <= tolerance);
+        }
+    }
+}
+
+template<typename T>
+void test_shapes(ThreadPool& pool) {
+    const std::size_t sizes[][3] = {{1, 1, 1}, {5, 7, 3}, {6, 16, 8}, {13, 33, 17}, {121, 70, 257},
+                                    {250, 3100, 40}, {64, 64, 600}, {7, 1, 300}, {1, 9, 1}};
+    for (const auto& s : sizes) {
+        check_gemm<T>(pool, s[0], s[1], s[2], T(1), T(0));
+        check_gemm<T>(pool, s[0], s[1], s[2], T(0.5), T(-2));
+    }
+    check_gemm<T>(pool, 9, 11, 0, T(1), T(3));
+}
+
+int main() {
+    ThreadPool pool(3);
+    test_shapes<float>(pool);
+    test_shapes<double>(pool);
+    check_gemm<float>(default_pool(), 200, 200, 200, 1.0f, 1.0f);
+
+    // beta == 0 ignores whatever C held, NaN included
+    Matrix<float> a(4, 4, 1.0f), b(4, 4, 2.0f), c(4, 4, NAN);
+    gemm(a, b, c);
+    assert(c(3, 3) == 8.0f);
+
+    [[maybe_unused]] bool thrown = false;
+    try {
+        Matrix<float> wrong(3, 4);
+        gemm(a, wrong, c);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+    return 0;
+}
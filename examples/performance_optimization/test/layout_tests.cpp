@@ -0,0 +1,180 @@
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include "../layout.h"
+
+// Every kernel against the index formula it implements; shapes straddle
+// the register tiles (8, 4, 2), the 32 x 32 leaf and the parallel bands
+
+struct Rgb {
+    std::uint8_t r, g, b;
+    friend bool operator==(const Rgb&, const Rgb&) = default;
+};
+
+template<typename T>
+T element(std::size_t i) {
+    if constexpr (std::is_same_v<T, Rgb>) {
+        return {std::uint8_t(i), std::uint8_t(i >> 8), std::uint8_t(i >> 16)};
+    } else {
+        return static_cast<T>(i % 100003);
+    }
+}
+
+template<typename T>
+void check_transpose(ThreadPool& pool, std::size_t rows, std::size_t cols, std::size_t pad) {
+    const std::size_t ld_in = cols + pad, ld_out = rows + pad;
+    std::vector<T> in(rows * ld_in), out(cols * ld_out, element<T>(7));
+    for (std::size_t i = 0; i < in.size(); ++i) in[i] = element<T>(i);
+    transpose(pool, in.data(), rows, cols, ld_in, out.data(), ld_out);
+    for (std::size_t j = 0; j < cols; ++j) {
+        for (std::size_t i = 0; i < rows; ++i) assert(out[j * ld_out + i] == in[i * ld_in + j]);
+        // Padding past each output row is left alone
+        for (std::size_t i = rows; i < ld_out; ++i) assert(out[j * ld_out + i] == element<T>(7));
+    }
+}
+
+template<typename T>
+void test_transpose(ThreadPool& pool) {
+    const std::size_t shapes[][2] = {{1, 1}, {2, 2}, {4, 4}, {8, 8}, {7, 13}, {13, 7}, {33, 65}, {100, 3},
+                                     {3, 100}, {257, 129}, {64, 1100}, {1500, 90}};
+    for (const auto& s : shapes) {
+        check_transpose<T>(pool, s[0], s[1], 0);
+        check_transpose<T>(pool, s[0], s[1], 5);
+    }
+}
+
+void test_matrix() {
+    ThreadPool pool(3);
+    Matrix<float> a(300, 170), t(170, 300), back(300, 170);
+    for (std::size_t i = 0; i < a.rows(); ++i) for (std::size_t j = 0; j < a.cols(); ++j) a(i, j) = float(i * 1000 + j);
+    transpose(pool, a, t);
+    transpose(pool, t, back);
+    for (std::size_t i = 0; i < a.rows(); ++i) {
+        for (std::size_t j = 0; j < a.cols(); ++j) assert(t(j, i) == a(i, j) && back(i, j) == a(i, j));
+    }
+
+    [[maybe_unused]] bool threw = false;
+    try {
+        transpose(a, back);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    threw = false;
+    try {
+        transpose(a.data(), 300, 170, 100, t.data(), 300);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+struct Particle {
+    float x, y, z;
+    double charge;
+    std::int32_t id;
+};
+
+void test_aos_soa() {
+    ThreadPool pool(3);
+    const std::size_t n = 100'003;
+    std::vector<Particle> aos(n);
+    for (std::size_t i = 0; i < n; ++i) aos[i] = {float(i), float(2 * i), float(3 * i), 0.5 * double(i), std::int32_t(i)};
+
+    std::vector<float> x(n), z(n);
+    std::vector<double> charge(n);
+    std::vector<std::int32_t> id(n);
+    aos_to_soa(pool, std::span<const Particle>(aos), soa_column(&Particle::x, x), soa_column(&Particle::z, z),
+               soa_column(&Particle::charge, charge), soa_column(&Particle::id, id));
+    for (std::size_t i = 0; i < n; ++i) {
+        assert(x[i] == float(i) && z[i] == float(3 * i) && charge[i] == 0.5 * double(i) && id[i] == std::int32_t(i));
+    }
+
+    // Back into fresh structs: only the listed fields are written
+    std::vector<Particle> back(n, Particle{-1, -1, -1, -1, -1});
+    for (float& v : z) v += 1;
+    soa_to_aos(pool, std::span<Particle>(back), soa_column(&Particle::x, x), soa_column(&Particle::z, z),
+               soa_column(&Particle::charge, charge), soa_column(&Particle::id, id));
+    for (std::size_t i = 0; i < n; ++i) {
+        assert(back[i].x == aos[i].x && back[i].y == -1 && back[i].z == aos[i].z + 1);
+        assert(back[i].charge == aos[i].charge && back[i].id == aos[i].id);
+    }
+
+    // Small inputs stay on the calling thread and take the same path
+    std::vector<float> y(3);
+    aos_to_soa(std::span<const Particle>(aos.data(), 3), soa_column(&Particle::y, y));
+    assert(y[0] == 0 && y[1] == 2 && y[2] == 4);
+
+    [[maybe_unused]] bool threw = false;
+    try {
+        aos_to_soa(std::span<const Particle>(aos.data(), 4), soa_column(&Particle::y, y));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+template<typename T>
+void check_channels(ThreadPool& pool, std::size_t frames, std::size_t channels) {
+    std::vector<T> interleaved(frames * channels), planar(frames * channels), back(frames * channels);
+    for (std::size_t i = 0; i < interleaved.size(); ++i) interleaved[i] = static_cast<T>(i);
+    deinterleave(pool, std::span<const T>(interleaved), channels, std::span<T>(planar));
+    for (std::size_t c = 0; c < channels; ++c) {
+        for (std::size_t f = 0; f < frames; ++f) assert(planar[c * frames + f] == interleaved[f * channels + c]);
+    }
+    interleave(pool, std::span<const T>(planar), channels, std::span<T>(back));
+    assert(back == interleaved);
+}
+
+void test_channels() {
+    ThreadPool pool(3);
+    for (std::size_t channels : {1, 2, 3, 4, 6, 8, 11}) {
+        for (std::size_t frames : {0, 1, 3, 4, 5, 31, 1000, 70'001}) {
+            check_channels<float>(pool, frames, channels);
+            check_channels<std::int32_t>(pool, frames, channels);
+            check_channels<double>(pool, frames, channels);
+            check_channels<std::int16_t>(pool, frames, channels);
+        }
+    }
+
+    std::vector<float> samples(7), out(7);
+    [[maybe_unused]] bool threw = false;
+    try {
+        deinterleave(std::span<const float>(samples), 2, std::span<float>(out));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        interleave(std::span<const float>(samples), 7, std::span<float>(out.data(), 6));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+int main() {
+    // Variants built for a wider ISA skip (exit code 77, SKIP_RETURN_CODE
+    // in CMake) on a CPU that can't run them
+    if (const char* missing = simd_missing_build_feature()) {
+        std::printf("%s not supported, skipping\n", missing);
+        return 77;
+    }
+    ThreadPool serial(0), pool(3);
+    for (ThreadPool* p : {&serial, &pool}) {
+        test_transpose<float>(*p);
+        test_transpose<std::int32_t>(*p);
+        test_transpose<double>(*p);
+        test_transpose<std::int16_t>(*p);
+        test_transpose<Rgb>(*p);
+    }
+    test_matrix();
+    test_aos_soa();
+    test_channels();
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "../particle_system.h"
+
+// Integration is checked against a plain per-particle loop, neighbour
+// queries against an all-pairs scan
+
+ParticleSystem random_system(ThreadPool& pool, std::size_t n, float speed, unsigned seed) {
+    ParticleSystem system({-1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}, pool);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f), velocity(-speed, speed);
+    for (std::size_t i = 0; i < n; ++i) {
+        system.add({position(rng), position(rng), position(rng)}, {velocity(rng), velocity(rng), velocity(rng)}, 1.0f);
+    }
+    return system;
+}
+
+void reference_axis(float& p, float& v, float accel, float dt, float lo, float hi, float e) {
+    v += accel * dt;
+    p += v * dt;
+    bool bounced = p < lo || p > hi;
+    if (p < lo) p = 2.0f * lo - p;
+    if (p > hi) p = 2.0f * hi - p;
+    p = std::clamp(p, lo, hi);
+    if (bounced) v = -v * e;
+}
+
+void test_step(ThreadPool& pool) {
+    // Sizes that leave a scalar tail in the last chunk
+    for (std::size_t n : {0u, 1u, 7u, 100u, 4099u, 50001u}) {
+        ParticleSystem system = random_system(pool, n, 3.0f, static_cast<unsigned>(n));
+        system.gravity = {0.5f, -9.81f, 0.0f};
+        system.restitution = 0.8f;
+        std::vector<float> x(system.x().begin(), system.x().end()), y(system.y().begin(), system.y().end());
+        std::vector<float> z(system.z().begin(), system.z().end());
+        std::vector<float> vx(system.vx().begin(), system.vx().end()), vy(system.vy().begin(), system.vy().end());
+        std::vector<float> vz(system.vz().begin(), system.vz().end());
+
+        const float dt = 0.01f;
+        for (int step = 0; step < 20; ++step) {
+            system.step(dt);
+            for (std::size_t i = 0; i < n; ++i) {
+                reference_axis(x[i], vx[i], 0.5f, dt, -1.0f, 1.0f, 0.8f);
+                reference_axis(y[i], vy[i], -9.81f, dt, -1.0f, 1.0f, 0.8f);
+                reference_axis(z[i], vz[i], 0.0f, dt, -1.0f, 1.0f, 0.8f);
+            }
+        }
+        // fma and separate multiply-add round differently; a particle right
+        // at a wall can bounce one step apart, so allow a few outliers
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            bool close = std::fabs(system.x()[i] - x[i]) < 1e-3f && std::fabs(system.y()[i] - y[i]) < 1e-3f &&
+                         std::fabs(system.z()[i] - z[i]) < 1e-3f && std::fabs(system.vy()[i] - vy[i]) < 1e-2f;
+            mismatches += !close;
+        }
+        assert(mismatches <= n / 1000);
+    }
+}
+
+void test_bounds(ThreadPool& pool) {
+    // Fast particles and a huge time step: everything stays inside the box
+    ParticleSystem system = random_system(pool, 10000, 50.0f, 7);
+    for (int step = 0; step < 10; ++step) system.step(0.1f);
+    for (std::size_t i = 0; i < system.size(); ++i) {
+        assert(system.x()[i] >= -1.0f && system.x()[i] <= 1.0f);
+        assert(system.y()[i] >= -1.0f && system.y()[i] <= 1.0f);
+        assert(system.z()[i] >= -1.0f && system.z()[i] <= 1.0f);
+    }
+
+    // A wall bounce reverses the velocity
+    ParticleSystem single({0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, pool);
+    single.gravity = {0.0f, 0.0f, 0.0f};
+    single.add({0.95f, 0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}, 1.0f);
+    single.step(0.1f);
+    assert(std::fabs(single.x()[0] - 0.95f) < 1e-6f);
+    assert(single.vx()[0] == -1.0f);
+}
+
+void test_neighbors(ThreadPool& pool) {
+    ParticleSystem system = random_system(pool, 3000, 1.0f, 11);
+    const float cell = 0.2f;
+    system.build_neighbor_grid(cell);
+    for (float radius : {0.05f, 0.13f, 0.2f}) {
+        std::vector<std::uint32_t> counts = system.count_neighbors(radius);
+        for (std::size_t i = 0; i < system.size(); i += 7) {
+            std::vector<std::size_t> expected, found;
+            for (std::size_t j = 0; j < system.size(); ++j) {
+                float dx = system.x()[j] - system.x()[i], dy = system.y()[j] - system.y()[i];
+                float dz = system.z()[j] - system.z()[i];
+                if (j != i && dx * dx + dy * dy + dz * dz <= radius * radius) expected.push_back(j);
+            }
+            system.for_each_neighbor(i, radius, [&](std::size_t j) { found.push_back(j); });
+            std::sort(found.begin(), found.end());
+            assert(found == expected);
+            assert(counts[i] == expected.size());
+        }
+    }
+
+    [[maybe_unused]] bool thrown = false;
+    try {
+        system.count_neighbors(2 * cell);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Moving the particles invalidates the grid
+    system.step(0.01f);
+    thrown = false;
+    try {
+        system.count_neighbors(cell);
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+// Enough particles for the grid's radix sort to split into several chunks
+void test_large_grid(ThreadPool& pool) {
+    ParticleSystem system = random_system(pool, 40000, 1.0f, 13);
+    const float radius = 0.05f;
+    system.build_neighbor_grid(radius);
+    std::vector<std::uint32_t> counts = system.count_neighbors(radius);
+    for (std::size_t i = 0; i < system.size(); i += 997) {
+        std::vector<std::size_t> expected, found;
+        for (std::size_t j = 0; j < system.size(); ++j) {
+            float dx = system.x()[j] - system.x()[i], dy = system.y()[j] - system.y()[i];
+            float dz = system.z()[j] - system.z()[i];
+            if (j != i && dx * dx + dy * dy + dz * dz <= radius * radius) expected.push_back(j);
+        }
+        system.for_each_neighbor(i, radius, [&](std::size_t j) { found.push_back(j); });
+        std::sort(found.begin(), found.end());
+        assert(found == expected);
+        assert(counts[i] == expected.size());
+    }
+}
+
+int main() {
+    ThreadPool pool(3);
+    test_step(pool);
+    test_step(default_pool());
+    test_bounds(pool);
+    test_neighbors(pool);
+    test_neighbors(default_pool());
+    test_large_grid(pool);
+
+    [[maybe_unused]] bool thrown = false;
+    try {
+        ParticleSystem empty({0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 1.0f});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+    return 0;
+}
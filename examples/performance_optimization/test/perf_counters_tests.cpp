@@ -0,0 +1,81 @@
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "../perf_counters.h"
+
+// Formatting and arithmetic use hand-built samples; the live counters are
+// checked when the machine allows them and must otherwise degrade cleanly
+
+// Counted the whole time it was enabled unless running says otherwise
+PerfSample sample(std::uint64_t cycles, std::uint64_t instructions, std::uint64_t l1d, std::uint64_t llc,
+                  std::uint64_t branch, std::uint64_t enabled = 1000, std::uint64_t running = 1000) {
+    PerfSample s;
+    s.raw = {cycles, instructions, l1d, llc, branch};
+    s.time_enabled = enabled;
+    s.time_running = running;
+    s.valid = {true, true, true, true, true};
+    s.scale();
+    return s;
+}
+
+void test_derived_metrics() {
+    PerfSample s = sample(1000, 2500, 50, 5, 10);
+    assert(s.ipc() == 2.5);
+    assert(s.per_kilo_instruction(PerfEvent::L1DMisses) == 20.0);
+    assert(perf_summary(s) == "IPC 2.50 | L1D 20.0 LLC 2.0 branch 4.0 misses/kinstr");
+
+    [[maybe_unused]] PerfSample d = sample(3000, 4500, 80, 5, 10, 2000, 2000) - s;
+    assert(d[PerfEvent::Cycles] == 2000 && d[PerfEvent::Instructions] == 2000 && d[PerfEvent::LLCMisses] == 0);
+
+    // Multiplexed: the group ran all of the first 1000 ns but only 500 of
+    // the next 1000, so the region's 200 counted cycles stand for 400.
+    // Subtracting the two totals, each scaled since construction, would
+    // give 300 * 2000 / 1500 - 100 = 300.
+    const PerfSample before = sample(100, 100, 0, 0, 0, 1000, 1000);
+    const PerfSample after = sample(300, 300, 0, 0, 0, 2000, 1500);
+    assert(after[PerfEvent::Cycles] == 400);
+    d = after - before;
+    assert(d.raw[0] == 200 && d.time_enabled == 1000 && d.time_running == 500);
+    assert(d[PerfEvent::Cycles] == 400 && d.ipc() == 1.0);
+
+    // A region in which the group never ran has no counts
+    assert(!(sample(300, 300, 0, 0, 0, 2000, 1500) - after).has(PerfEvent::Cycles));
+
+    // Missing events are left out; a difference is only valid where both are
+    s.valid[static_cast<std::size_t>(PerfEvent::LLCMisses)] = false;
+    assert(std::isnan(s[PerfEvent::LLCMisses]));
+    assert(perf_summary(s) == "IPC 2.50 | L1D 20.0 branch 4.0 misses/kinstr");
+    [[maybe_unused]] const PerfSample partial = sample(2000, 3000, 60, 6, 20, 2000, 2000) - s;
+    assert(partial.has(PerfEvent::Cycles) && !partial.has(PerfEvent::LLCMisses));
+    assert(perf_summary(PerfSample()) == "");
+}
+
+void test_live_counters() {
+    const PerfCounters& counters = PerfCounters::local();
+    volatile double x = 0;
+    PerfSample s = counters.measure([&] {
+        for (int i = 0; i < 1000000; ++i) x = x + i;
+    });
+    if (!counters.available()) {
+        std::printf("counters unavailable: %s\n", counters.unavailable_reason().c_str());
+        assert(!counters.unavailable_reason().empty());
+        for ([[maybe_unused]] PerfEvent e : {PerfEvent::Cycles, PerfEvent::Instructions, PerfEvent::BranchMisses}) assert(!s.has(e));
+        assert(perf_summary(s).empty());
+        return;
+    }
+    std::printf("counters: %s\n", perf_summary(s).c_str());
+    if (s.has(PerfEvent::Instructions)) assert(s[PerfEvent::Instructions] > 1e6);
+    if (s.has(PerfEvent::Cycles)) assert(s[PerfEvent::Cycles] > 0 && s.ipc() > 0);
+    // Counters only grow
+    [[maybe_unused]] PerfSample a = counters.read(), b = counters.read();
+    for (std::size_t i = 0; i < perf_event_count; ++i) assert(!a.valid[i] || b.raw[i] >= a.raw[i]);
+    assert(b.time_enabled >= a.time_enabled && b.time_running >= a.time_running);
+}
+
+int main() {
+    test_derived_metrics();
+    test_live_counters();
+    return 0;
+}
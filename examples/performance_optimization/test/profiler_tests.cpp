@@ -0,0 +1,115 @@
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../profiler.h"
+
+// Statistics are checked for paths and counts (timings only for ordering),
+// the trace for one well-formed event per scope
+
+const ScopeStats* find_path(const std::vector<ScopeStats>& stats, const std::vector<std::string>& path) {
+    for (const ScopeStats& s : stats) {
+        if (s.path == path) return &s;
+    }
+    return nullptr;
+}
+
+void test_calibration() {
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    const std::uint64_t c0 = TscClock::now();
+    while (clock::now() - t0 < std::chrono::milliseconds(50)) {
+    }
+    [[maybe_unused]] const double elapsed = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+    [[maybe_unused]] const double measured = TscClock::to_ns(TscClock::now() - c0);
+    assert(std::fabs(measured - elapsed) < 0.1 * elapsed);
+}
+
+void test_nesting() {
+    trace_reset();
+    for (int i = 0; i < 10; ++i) {
+        TRACE_SCOPE("outer");
+        for (int j = 0; j < 3; ++j) {
+            TRACE_SCOPE("inner");
+            TRACE_SCOPE(std::string("leaf ") + std::to_string(j % 2));
+        }
+        TRACE_SCOPE("sibling");
+    }
+    {
+        TRACE_SCOPE("inner");   // same name, different path
+    }
+
+    std::vector<ScopeStats> stats = trace_statistics();
+    assert(stats.size() == 6);
+    assert(find_path(stats, {"outer"})->count == 10);
+    assert(find_path(stats, {"outer", "inner"})->count == 30);
+    assert(find_path(stats, {"outer", "inner", "leaf 0"})->count == 20);
+    assert(find_path(stats, {"outer", "inner", "leaf 1"})->count == 10);
+    assert(find_path(stats, {"outer", "sibling"})->count == 10);
+    assert(find_path(stats, {"inner"})->count == 1);
+
+    // Tree order: children directly follow their parent
+    assert(stats[0].path == std::vector<std::string>{"inner"});
+    assert(stats[1].path == std::vector<std::string>{"outer"});
+    assert(stats[2].path == (std::vector<std::string>{"outer", "inner"}));
+    assert(stats[2].depth() == 1);
+
+    for ([[maybe_unused]] const ScopeStats& s : stats) {
+        assert(s.min_ns <= s.p50_ns && s.p50_ns <= s.p99_ns && s.p99_ns <= s.max_ns);
+        assert(s.total_ns >= s.max_ns);
+    }
+    // A parent lasts at least as long as everything inside it
+    assert(find_path(stats, {"outer"})->total_ns >= find_path(stats, {"outer", "inner"})->total_ns);
+
+    std::ostringstream report;
+    trace_report(report);
+    assert(report.str().find("    leaf 1") != std::string::npos);
+}
+
+void test_threads() {
+    trace_reset();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 5000; ++i) {
+                TRACE_SCOPE("work");
+                TRACE_SCOPE("step");
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    // Buffers outlive their threads
+    std::vector<ScopeStats> stats = trace_statistics();
+    assert(find_path(stats, {"work"})->count == 20000);
+    assert(find_path(stats, {"work", "step"})->count == 20000);
+    assert(trace_dropped_events() == 0);
+}
+
+void test_chrome_json() {
+    trace_reset();
+    {
+        TRACE_SCOPE("quote \" and \\ backslash");
+        TRACE_SCOPE("child");
+    }
+    std::ostringstream out;
+    trace_write_chrome_json(out);
+    const std::string json = out.str();
+    assert(json.find("\"traceEvents\":[") != std::string::npos);
+    assert(json.find("\"name\":\"quote \\\" and \\\\ backslash\"") != std::string::npos);
+    assert(json.find("\"name\":\"child\"") != std::string::npos);
+    std::size_t events = 0;
+    for (std::size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1)) ++events;
+    assert(events == 2);
+    assert(json.rfind("]}") != std::string::npos);
+}
+
+int main() {
+    test_calibration();
+    test_nesting();
+    test_threads();
+    test_chrome_json();
+    return 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// ===== ALIGNED ALLOCATION =====
+//
+// std::vector<float> only guarantees alignof(std::max_align_t), usually 16
+// bytes, so a 32-byte AVX load from it may straddle two cache lines.
+// aligned_allocator<T, Align> hands out storage aligned to Align (32 for
+// AVX, 64 for a full cache line / AVX-512), which lets simd<T, N> kernels
+// take their load_aligned path (see simd_with_alignment in simd.h):
+//
+//   aligned_vector<float> a(n);        // 64-byte aligned
+//   aligned_vector<float, 32> b(n);    // 32-byte aligned
+//   huge_page_vector<float> big(n);    // 2 MiB pages for large buffers
+//
+// With HugePages set, allocations of at least huge_page_size are placed on
+// 2 MiB boundaries and marked MADV_HUGEPAGE (Linux transparent huge pages)
+// before they are touched, which cuts TLB misses when streaming through
+// hundreds of megabytes. Elsewhere, or when THP is disabled, the hint is
+// ignored and the buffer is simply aligned.
+
+template<typename T, std::size_t Align = 64, bool HugePages = false>
+struct aligned_allocator {
+    static_assert(Align >= alignof(T) && (Align & (Align - 1)) == 0, "Align must be a power of two and at least alignof(T)");
+
+    using value_type = T;
+    static constexpr std::size_t alignment = Align;
+    static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+    template<typename U>
+    struct rebind { using other = aligned_allocator<U, Align, HugePages>; };
+
+    aligned_allocator() noexcept = default;
+    template<typename U>
+    aligned_allocator(const aligned_allocator<U, Align, HugePages>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+        std::size_t bytes = n * sizeof(T);
+        if (!use_huge_pages(bytes)) {
+            return static_cast<T*>(::operator new(bytes, std::align_val_t(Align)));
+        }
+        // Whole huge pages, so the kernel can back every page of the buffer
+        std::size_t rounded = (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+        void* p = ::operator new(rounded, std::align_val_t(huge_page_size));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        madvise(p, rounded, MADV_HUGEPAGE);
+#endif
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        // n is the count passed to allocate, so the same path is chosen
+        std::size_t bytes = n * sizeof(T);
+        ::operator delete(p, std::align_val_t(use_huge_pages(bytes) ? huge_page_size : Align));
+    }
+
+    template<typename U>
+    bool operator==(const aligned_allocator<U, Align, HugePages>&) const noexcept { return true; }
+
+private:
+    static constexpr bool use_huge_pages(std::size_t bytes) { return HugePages && bytes >= huge_page_size; }
+};
+
+template<typename T, std::size_t Align = 64>
+using aligned_vector = std::vector<T, aligned_allocator<T, Align>>;
+
+template<typename T>
+using huge_page_vector = std::vector<T, aligned_allocator<T, 64, true>>;
+
+// True when p is a multiple of align
+inline bool is_aligned(const void* p, std::size_t align) {
+    return reinterpret_cast<std::uintptr_t>(p) % align == 0;
+}
@@ -0,0 +1,845 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// ===== SIMD VECTOR WRAPPER =====
+//
+// simd<T, N> holds N lanes of T and maps every operation onto one SSE/AVX
+// instruction (or a short sequence) when the target supports that shape,
+// and onto plain loops over an array otherwise. Kernels are written once:
+//
+//   using V = native_simd<float>;
+//   for (; i + V::size <= n; i += V::size) {
+//       V x = V::load(a + i);
+//       (x * x + V(1.0f)).store(out + i);
+//   }
+//
+// The ISA is chosen at compile time (-msse4.1, -mavx2, -march=native...).
+// For picking an implementation at run time see simd_dispatch.h.
+
+// Shuffle tables for compress_store: for every lane mask, the indices of
+// the selected lanes moved to the front
+struct simd_compress_lut {
+    // 8 x 32-bit lanes: one 4-bit lane index per output lane
+    static constexpr std::array<std::uint32_t, 256> lanes8 = [] {
+        std::array<std::uint32_t, 256> table{};
+        for (unsigned mask = 0; mask < 256; ++mask) {
+            unsigned k = 0;
+            for (unsigned lane = 0; lane < 8; ++lane) {
+                if (mask >> lane & 1) table[mask] |= lane << (4 * k++);
+            }
+        }
+        return table;
+    }();
+    // 4 x 64-bit lanes as pairs of 32-bit indices, same packing
+    static constexpr std::array<std::uint32_t, 16> pairs4 = [] {
+        std::array<std::uint32_t, 16> table{};
+        for (unsigned mask = 0; mask < 16; ++mask) {
+            unsigned k = 0;
+            for (unsigned lane = 0; lane < 4; ++lane) {
+                if (mask >> lane & 1) {
+                    table[mask] |= (2 * lane) << (4 * k++);
+                    table[mask] |= (2 * lane + 1) << (4 * k++);
+                }
+            }
+        }
+        return table;
+    }();
+    // 128-bit registers: pshufb byte indices for LaneBytes-wide lanes
+    template<unsigned LaneBytes>
+    static constexpr std::array<std::array<std::uint8_t, 16>, (1u << (16 / LaneBytes))> bytes = [] {
+        std::array<std::array<std::uint8_t, 16>, (1u << (16 / LaneBytes))> table{};
+        for (unsigned mask = 0; mask < table.size(); ++mask) {
+            unsigned k = 0;
+            for (unsigned lane = 0; lane < 16 / LaneBytes; ++lane) {
+                if (mask >> lane & 1) {
+                    for (unsigned b = 0; b < LaneBytes; ++b) table[mask][k++] = std::uint8_t(lane * LaneBytes + b);
+                }
+            }
+            while (k < 16) table[mask][k++] = 0x80;
+        }
+        return table;
+    }();
+};
+
+// Writes every lane, advancing only past the selected ones: no branches,
+// and never more than n elements
+template<typename T>
+int simd_compress_lanes(const T* lanes, unsigned mask, T* out, int n) {
+    int k = 0;
+    for (int i = 0; i < n; ++i) {
+        out[k] = lanes[i];
+        k += mask >> i & 1u;
+    }
+    return k;
+}
+
+// Storage and operations for one (T, N) shape. The primary template is the
+// scalar fallback; the specializations below replace it with intrinsics.
+template<typename T, int N>
+struct simd_traits {
+    using reg = std::array<T, N>;
+    using mask_reg = std::array<bool, N>;
+
+    static reg load(const T* p) {
+        reg r;
+        std::copy(p, p + N, r.begin());
+        return r;
+    }
+    static reg load_aligned(const T* p) { return load(p); }
+    static void store(T* p, const reg& r) { std::copy(r.begin(), r.end(), p); }
+    static void store_aligned(T* p, const reg& r) { store(p, r); }
+    static reg broadcast(T v) {
+        reg r;
+        r.fill(v);
+        return r;
+    }
+
+    template<typename F>
+    static reg map(const reg& a, const reg& b, F f) {
+        reg r;
+        for (int i = 0; i < N; ++i) r[i] = f(a[i], b[i]);
+        return r;
+    }
+    static reg add(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return T(x + y); }); }
+    static reg sub(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return T(x - y); }); }
+    static reg mul(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return T(x * y); }); }
+    static reg div(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return T(x / y); }); }
+    static reg min(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return std::min(x, y); }); }
+    static reg max(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return std::max(x, y); }); }
+    static reg abs(const reg& a) {
+        reg r;
+        for (int i = 0; i < N; ++i) {
+            if constexpr (std::is_floating_point_v<T>) {
+                r[i] = std::fabs(a[i]);
+            } else {
+                r[i] = a[i] < T(0) ? T(-a[i]) : a[i];
+            }
+        }
+        return r;
+    }
+    static reg sqrt(const reg& a) {
+        reg r;
+        for (int i = 0; i < N; ++i) r[i] = static_cast<T>(std::sqrt(a[i]));
+        return r;
+    }
+
+    template<typename F>
+    static mask_reg compare(const reg& a, const reg& b, F f) {
+        mask_reg m;
+        for (int i = 0; i < N; ++i) m[i] = f(a[i], b[i]);
+        return m;
+    }
+    static mask_reg cmp_eq(const reg& a, const reg& b) { return compare(a, b, [](T x, T y) { return x == y; }); }
+    static mask_reg cmp_lt(const reg& a, const reg& b) { return compare(a, b, [](T x, T y) { return x < y; }); }
+    static mask_reg cmp_le(const reg& a, const reg& b) { return compare(a, b, [](T x, T y) { return x <= y; }); }
+
+    static mask_reg mask_and(const mask_reg& a, const mask_reg& b) {
+        mask_reg m;
+        for (int i = 0; i < N; ++i) m[i] = a[i] && b[i];
+        return m;
+    }
+    static mask_reg mask_or(const mask_reg& a, const mask_reg& b) {
+        mask_reg m;
+        for (int i = 0; i < N; ++i) m[i] = a[i] || b[i];
+        return m;
+    }
+    static mask_reg mask_not(const mask_reg& a) {
+        mask_reg m;
+        for (int i = 0; i < N; ++i) m[i] = !a[i];
+        return m;
+    }
+    static unsigned mask_bits(const mask_reg& a) {
+        unsigned bits = 0;
+        for (int i = 0; i < N; ++i) bits |= unsigned(a[i]) << i;
+        return bits;
+    }
+    static reg select(const mask_reg& m, const reg& a, const reg& b) {
+        reg r;
+        for (int i = 0; i < N; ++i) r[i] = m[i] ? a[i] : b[i];
+        return r;
+    }
+
+    static reg gather(const T* base, const std::int32_t* index) {
+        reg r;
+        for (int i = 0; i < N; ++i) r[i] = base[index[i]];
+        return r;
+    }
+
+    // Bitwise operations act on each lane's object representation
+    using bits = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::uint32_t>;
+    template<typename F>
+    static reg map_bits(const reg& a, const reg& b, F f) {
+        reg r;
+        for (int i = 0; i < N; ++i) {
+            bits x, y;
+            std::memcpy(&x, &a[i], sizeof(T));
+            std::memcpy(&y, &b[i], sizeof(T));
+            bits z = f(x, y);
+            std::memcpy(&r[i], &z, sizeof(T));
+        }
+        return r;
+    }
+    static reg bit_and(const reg& a, const reg& b) { return map_bits(a, b, [](bits x, bits y) { return x & y; }); }
+    static reg bit_or(const reg& a, const reg& b) { return map_bits(a, b, [](bits x, bits y) { return x | y; }); }
+    static reg bit_xor(const reg& a, const reg& b) { return map_bits(a, b, [](bits x, bits y) { return x ^ y; }); }
+    static reg shift_left(const reg& a, int k) { return map_bits(a, a, [k](bits x, bits) { return bits(x << k); }); }
+    static reg shift_right(const reg& a, int k) { return map_bits(a, a, [k](bits x, bits) { return bits(x >> k); }); }
+
+    static int compress(const reg& v, unsigned mask, T* out) { return simd_compress_lanes(v.data(), mask, out, N); }
+};
+
+#if defined(__SSE2__)
+template<>
+struct simd_traits<float, 4> {
+    using reg = __m128;
+    using mask_reg = __m128;
+
+    static reg load(const float* p) { return _mm_loadu_ps(p); }
+    static reg load_aligned(const float* p) { return _mm_load_ps(p); }
+    static void store(float* p, reg r) { _mm_storeu_ps(p, r); }
+    static void store_aligned(float* p, reg r) { _mm_store_ps(p, r); }
+    static reg broadcast(float v) { return _mm_set1_ps(v); }
+
+    static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+#if defined(__FMA__)
+    static reg fma(reg a, reg b, reg c) { return _mm_fmadd_ps(a, b, c); }
+#endif
+    static reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+    static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+    static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+    static reg abs(reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+
+    static mask_reg cmp_eq(reg a, reg b) { return _mm_cmpeq_ps(a, b); }
+    static mask_reg cmp_lt(reg a, reg b) { return _mm_cmplt_ps(a, b); }
+    static mask_reg cmp_le(reg a, reg b) { return _mm_cmple_ps(a, b); }
+    static mask_reg mask_and(mask_reg a, mask_reg b) { return _mm_and_ps(a, b); }
+    static mask_reg mask_or(mask_reg a, mask_reg b) { return _mm_or_ps(a, b); }
+    static mask_reg mask_not(mask_reg a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+    static unsigned mask_bits(mask_reg a) { return static_cast<unsigned>(_mm_movemask_ps(a)); }
+    // (m & a) | (~m & b): SSE4.1 has blendv, SSE2 needs the three ops
+    static reg select(mask_reg m, reg a, reg b) {
+#if defined(__SSE4_1__)
+        return _mm_blendv_ps(b, a, m);
+#else
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+#endif
+    }
+
+    static reg gather(const float* base, const std::int32_t* index) {
+        return _mm_setr_ps(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+    }
+
+    static reg bit_and(reg a, reg b) { return _mm_and_ps(a, b); }
+    static reg bit_or(reg a, reg b) { return _mm_or_ps(a, b); }
+    static reg bit_xor(reg a, reg b) { return _mm_xor_ps(a, b); }
+    static reg shift_left(reg a, int k) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_castps_si128(a), k)); }
+    static reg shift_right(reg a, int k) { return _mm_castsi128_ps(_mm_srli_epi32(_mm_castps_si128(a), k)); }
+
+    static int compress(reg v, unsigned mask, float* out) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+        _mm_storeu_ps(out, _mm_maskz_compress_ps(__mmask8(mask), v));
+#elif defined(__SSSE3__)
+        __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(simd_compress_lut::bytes<4>[mask].data()));
+        _mm_storeu_ps(out, _mm_castsi128_ps(_mm_shuffle_epi8(_mm_castps_si128(v), shuffle)));
+#else
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, v);
+        return simd_compress_lanes(lanes, mask, out, 4);
+#endif
+        return __builtin_popcount(mask);
+    }
+};
+
+template<>
+struct simd_traits<double, 2> {
+    using reg = __m128d;
+    using mask_reg = __m128d;
+
+    static reg load(const double* p) { return _mm_loadu_pd(p); }
+    static reg load_aligned(const double* p) { return _mm_load_pd(p); }
+    static void store(double* p, reg r) { _mm_storeu_pd(p, r); }
+    static void store_aligned(double* p, reg r) { _mm_store_pd(p, r); }
+    static reg broadcast(double v) { return _mm_set1_pd(v); }
+
+    static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+#if defined(__FMA__)
+    static reg fma(reg a, reg b, reg c) { return _mm_fmadd_pd(a, b, c); }
+#endif
+    static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+    static reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+    static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+    static reg abs(reg a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+
+    static mask_reg cmp_eq(reg a, reg b) { return _mm_cmpeq_pd(a, b); }
+    static mask_reg cmp_lt(reg a, reg b) { return _mm_cmplt_pd(a, b); }
+    static mask_reg cmp_le(reg a, reg b) { return _mm_cmple_pd(a, b); }
+    static mask_reg mask_and(mask_reg a, mask_reg b) { return _mm_and_pd(a, b); }
+    static mask_reg mask_or(mask_reg a, mask_reg b) { return _mm_or_pd(a, b); }
+    static mask_reg mask_not(mask_reg a) { return _mm_xor_pd(a, _mm_castsi128_pd(_mm_set1_epi32(-1))); }
+    static unsigned mask_bits(mask_reg a) { return static_cast<unsigned>(_mm_movemask_pd(a)); }
+    static reg select(mask_reg m, reg a, reg b) {
+#if defined(__SSE4_1__)
+        return _mm_blendv_pd(b, a, m);
+#else
+        return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+#endif
+    }
+
+    static reg gather(const double* base, const std::int32_t* index) {
+        return _mm_setr_pd(base[index[0]], base[index[1]]);
+    }
+
+    static reg bit_and(reg a, reg b) { return _mm_and_pd(a, b); }
+    static reg bit_or(reg a, reg b) { return _mm_or_pd(a, b); }
+    static reg bit_xor(reg a, reg b) { return _mm_xor_pd(a, b); }
+    static reg shift_left(reg a, int k) { return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(a), k)); }
+    static reg shift_right(reg a, int k) { return _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(a), k)); }
+
+    static int compress(reg v, unsigned mask, double* out) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+        _mm_storeu_pd(out, _mm_maskz_compress_pd(__mmask8(mask), v));
+#elif defined(__SSSE3__)
+        __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(simd_compress_lut::bytes<8>[mask].data()));
+        _mm_storeu_pd(out, _mm_castsi128_pd(_mm_shuffle_epi8(_mm_castpd_si128(v), shuffle)));
+#else
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, v);
+        return simd_compress_lanes(lanes, mask, out, 2);
+#endif
+        return __builtin_popcount(mask);
+    }
+};
+#endif
+
+// Packed 32-bit multiply, min and max arrived with SSE4.1
+#if defined(__SSE4_1__)
+template<>
+struct simd_traits<std::int32_t, 4> {
+    using reg = __m128i;
+    using mask_reg = __m128i;
+
+    static reg load(const std::int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static reg load_aligned(const std::int32_t* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(std::int32_t* p, reg r) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), r); }
+    static void store_aligned(std::int32_t* p, reg r) { _mm_store_si128(reinterpret_cast<__m128i*>(p), r); }
+    static reg broadcast(std::int32_t v) { return _mm_set1_epi32(v); }
+
+    static reg add(reg a, reg b) { return _mm_add_epi32(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_epi32(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mullo_epi32(a, b); }
+    static reg min(reg a, reg b) { return _mm_min_epi32(a, b); }
+    static reg max(reg a, reg b) { return _mm_max_epi32(a, b); }
+    static reg abs(reg a) { return _mm_abs_epi32(a); }
+
+    static mask_reg cmp_eq(reg a, reg b) { return _mm_cmpeq_epi32(a, b); }
+    static mask_reg cmp_lt(reg a, reg b) { return _mm_cmplt_epi32(a, b); }
+    static mask_reg cmp_le(reg a, reg b) { return mask_not(_mm_cmpgt_epi32(a, b)); }
+    static mask_reg mask_and(mask_reg a, mask_reg b) { return _mm_and_si128(a, b); }
+    static mask_reg mask_or(mask_reg a, mask_reg b) { return _mm_or_si128(a, b); }
+    static mask_reg mask_not(mask_reg a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+    static unsigned mask_bits(mask_reg a) { return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(a))); }
+    static reg select(mask_reg m, reg a, reg b) { return _mm_blendv_epi8(b, a, m); }
+
+    static reg gather(const std::int32_t* base, const std::int32_t* index) {
+        return _mm_setr_epi32(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+    }
+
+    static reg bit_and(reg a, reg b) { return _mm_and_si128(a, b); }
+    static reg bit_or(reg a, reg b) { return _mm_or_si128(a, b); }
+    static reg bit_xor(reg a, reg b) { return _mm_xor_si128(a, b); }
+    static reg shift_left(reg a, int k) { return _mm_slli_epi32(a, k); }
+    static reg shift_right(reg a, int k) { return _mm_srli_epi32(a, k); }
+
+    static int compress(reg v, unsigned mask, std::int32_t* out) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_maskz_compress_epi32(__mmask8(mask), v));
+#else
+        __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(simd_compress_lut::bytes<4>[mask].data()));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(v, shuffle));
+#endif
+        return __builtin_popcount(mask);
+    }
+};
+#endif
+
+#if defined(__AVX__)
+// AVX1 has no 256-bit integer shifts; without AVX2 shift each 128-bit half
+#if defined(__AVX2__)
+#define SIMD_SHIFT256(op, a, k) _mm256_##op(a, k)
+#else
+#define SIMD_SHIFT256(op, a, k)                                                          \
+    _mm256_insertf128_si256(_mm256_castsi128_si256(_mm_##op(_mm256_castsi256_si128(a), k)), \
+                            _mm_##op(_mm256_extractf128_si256(a, 1), k), 1)
+#endif
+
+#if defined(__AVX2__)
+// Unpacks eight 4-bit lane indices into a permutevar8x32 index vector
+inline __m256i simd_compress_index8(std::uint32_t packed) {
+    return _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(packed)), _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28));
+}
+#endif
+
+template<>
+struct simd_traits<float, 8> {
+    using reg = __m256;
+    using mask_reg = __m256;
+
+    static reg load(const float* p) { return _mm256_loadu_ps(p); }
+    static reg load_aligned(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, reg r) { _mm256_storeu_ps(p, r); }
+    static void store_aligned(float* p, reg r) { _mm256_store_ps(p, r); }
+    static reg broadcast(float v) { return _mm256_set1_ps(v); }
+
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+#if defined(__FMA__)
+    static reg fma(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+#endif
+    static reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+    static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+    static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+    static reg abs(reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+
+    static mask_reg cmp_eq(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static mask_reg cmp_lt(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static mask_reg cmp_le(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static mask_reg mask_and(mask_reg a, mask_reg b) { return _mm256_and_ps(a, b); }
+    static mask_reg mask_or(mask_reg a, mask_reg b) { return _mm256_or_ps(a, b); }
+    static mask_reg mask_not(mask_reg a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+    static unsigned mask_bits(mask_reg a) { return static_cast<unsigned>(_mm256_movemask_ps(a)); }
+    static reg select(mask_reg m, reg a, reg b) { return _mm256_blendv_ps(b, a, m); }
+
+    static reg gather(const float* base, const std::int32_t* index) {
+#if defined(__AVX2__)
+        return _mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index)), 4);
+#else
+        return _mm256_setr_ps(base[index[0]], base[index[1]], base[index[2]], base[index[3]],
+                              base[index[4]], base[index[5]], base[index[6]], base[index[7]]);
+#endif
+    }
+
+    static reg bit_and(reg a, reg b) { return _mm256_and_ps(a, b); }
+    static reg bit_or(reg a, reg b) { return _mm256_or_ps(a, b); }
+    static reg bit_xor(reg a, reg b) { return _mm256_xor_ps(a, b); }
+    static reg shift_left(reg a, int k) { return _mm256_castsi256_ps(SIMD_SHIFT256(slli_epi32, _mm256_castps_si256(a), k)); }
+    static reg shift_right(reg a, int k) { return _mm256_castsi256_ps(SIMD_SHIFT256(srli_epi32, _mm256_castps_si256(a), k)); }
+
+    static int compress(reg v, unsigned mask, float* out) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+        _mm256_storeu_ps(out, _mm256_maskz_compress_ps(__mmask8(mask), v));
+#elif defined(__AVX2__)
+        _mm256_storeu_ps(out, _mm256_permutevar8x32_ps(v, simd_compress_index8(simd_compress_lut::lanes8[mask])));
+#else
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, v);
+        return simd_compress_lanes(lanes, mask, out, 8);
+#endif
+        return __builtin_popcount(mask);
+    }
+};
+
+template<>
+struct simd_traits<double, 4> {
+    using reg = __m256d;
+    using mask_reg = __m256d;
+
+    static reg load(const double* p) { return _mm256_loadu_pd(p); }
+    static reg load_aligned(const double* p) { return _mm256_load_pd(p); }
+    static void store(double* p, reg r) { _mm256_storeu_pd(p, r); }
+    static void store_aligned(double* p, reg r) { _mm256_store_pd(p, r); }
+    static reg broadcast(double v) { return _mm256_set1_pd(v); }
+
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+#if defined(__FMA__)
+    static reg fma(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+#endif
+    static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+    static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+    static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+    static reg abs(reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+
+    static mask_reg cmp_eq(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static mask_reg cmp_lt(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static mask_reg cmp_le(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+    static mask_reg mask_and(mask_reg a, mask_reg b) { return _mm256_and_pd(a, b); }
+    static mask_reg mask_or(mask_reg a, mask_reg b) { return _mm256_or_pd(a, b); }
+    static mask_reg mask_not(mask_reg a) { return _mm256_xor_pd(a, _mm256_castsi256_pd(_mm256_set1_epi32(-1))); }
+    static unsigned mask_bits(mask_reg a) { return static_cast<unsigned>(_mm256_movemask_pd(a)); }
+    static reg select(mask_reg m, reg a, reg b) { return _mm256_blendv_pd(b, a, m); }
+
+    static reg gather(const double* base, const std::int32_t* index) {
+#if defined(__AVX2__)
+        // The masked form with an explicit source avoids GCC's uninitialized-source warning
+        __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base,
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(index)), all, 8);
+#else
+        return _mm256_setr_pd(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+#endif
+    }
+
+    static reg bit_and(reg a, reg b) { return _mm256_and_pd(a, b); }
+    static reg bit_or(reg a, reg b) { return _mm256_or_pd(a, b); }
+    static reg bit_xor(reg a, reg b) { return _mm256_xor_pd(a, b); }
+    static reg shift_left(reg a, int k) { return _mm256_castsi256_pd(SIMD_SHIFT256(slli_epi64, _mm256_castpd_si256(a), k)); }
+    static reg shift_right(reg a, int k) { return _mm256_castsi256_pd(SIMD_SHIFT256(srli_epi64, _mm256_castpd_si256(a), k)); }
+
+    static int compress(reg v, unsigned mask, double* out) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+        _mm256_storeu_pd(out, _mm256_maskz_compress_pd(__mmask8(mask), v));
+#elif defined(__AVX2__)
+        __m256i index = simd_compress_index8(simd_compress_lut::pairs4[mask]);
+        _mm256_storeu_pd(out, _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(v), index)));
+#else
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, v);
+        return simd_compress_lanes(lanes, mask, out, 4);
+#endif
+        return __builtin_popcount(mask);
+    }
+};
+#undef SIMD_SHIFT256
+#endif
+
+#if defined(__AVX2__)
+template<>
+struct simd_traits<std::int32_t, 8> {
+    using reg = __m256i;
+    using mask_reg = __m256i;
+
+    static reg load(const std::int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static reg load_aligned(const std::int32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(std::int32_t* p, reg r) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+    static void store_aligned(std::int32_t* p, reg r) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), r); }
+    static reg broadcast(std::int32_t v) { return _mm256_set1_epi32(v); }
+
+    static reg add(reg a, reg b) { return _mm256_add_epi32(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_epi32(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mullo_epi32(a, b); }
+    static reg min(reg a, reg b) { return _mm256_min_epi32(a, b); }
+    static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+    static reg abs(reg a) { return _mm256_abs_epi32(a); }
+
+    static mask_reg cmp_eq(reg a, reg b) { return _mm256_cmpeq_epi32(a, b); }
+    static mask_reg cmp_lt(reg a, reg b) { return _mm256_cmpgt_epi32(b, a); }
+    static mask_reg cmp_le(reg a, reg b) { return mask_not(_mm256_cmpgt_epi32(a, b)); }
+    static mask_reg mask_and(mask_reg a, mask_reg b) { return _mm256_and_si256(a, b); }
+    static mask_reg mask_or(mask_reg a, mask_reg b) { return _mm256_or_si256(a, b); }
+    static mask_reg mask_not(mask_reg a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+    static unsigned mask_bits(mask_reg a) { return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(a))); }
+    static reg select(mask_reg m, reg a, reg b) { return _mm256_blendv_epi8(b, a, m); }
+
+    static reg gather(const std::int32_t* base, const std::int32_t* index) {
+        return _mm256_i32gather_epi32(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index)), 4);
+    }
+
+    static reg bit_and(reg a, reg b) { return _mm256_and_si256(a, b); }
+    static reg bit_or(reg a, reg b) { return _mm256_or_si256(a, b); }
+    static reg bit_xor(reg a, reg b) { return _mm256_xor_si256(a, b); }
+    static reg shift_left(reg a, int k) { return _mm256_slli_epi32(a, k); }
+    static reg shift_right(reg a, int k) { return _mm256_srli_epi32(a, k); }
+
+    static int compress(reg v, unsigned mask, std::int32_t* out) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_maskz_compress_epi32(__mmask8(mask), v));
+#else
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_permutevar8x32_epi32(v, simd_compress_index8(simd_compress_lut::lanes8[mask])));
+#endif
+        return __builtin_popcount(mask);
+    }
+};
+
+// AVX2 has 64-bit add, compare and shifts but no 64-bit multiply, min, max
+// or abs; those are built from compares or done per lane
+template<>
+struct simd_traits<std::int64_t, 4> {
+    using reg = __m256i;
+    using mask_reg = __m256i;
+
+    static reg load(const std::int64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static reg load_aligned(const std::int64_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(std::int64_t* p, reg r) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+    static void store_aligned(std::int64_t* p, reg r) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), r); }
+    static reg broadcast(std::int64_t v) { return _mm256_set1_epi64x(v); }
+
+    static reg add(reg a, reg b) { return _mm256_add_epi64(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_epi64(a, b); }
+    static reg mul(reg a, reg b) {
+#if defined(__AVX512DQ__) && defined(__AVX512VL__)
+        return _mm256_mullo_epi64(a, b);
+#else
+        alignas(32) std::int64_t x[4], y[4];
+        store_aligned(x, a);
+        store_aligned(y, b);
+        for (int i = 0; i < 4; ++i) {
+            x[i] = static_cast<std::int64_t>(static_cast<std::uint64_t>(x[i]) * static_cast<std::uint64_t>(y[i]));
+        }
+        return load_aligned(x);
+#endif
+    }
+    static reg min(reg a, reg b) { return select(cmp_lt(a, b), a, b); }
+    static reg max(reg a, reg b) { return select(cmp_lt(a, b), b, a); }
+    static reg abs(reg a) { return select(cmp_lt(a, _mm256_setzero_si256()), sub(_mm256_setzero_si256(), a), a); }
+
+    static mask_reg cmp_eq(reg a, reg b) { return _mm256_cmpeq_epi64(a, b); }
+    static mask_reg cmp_lt(reg a, reg b) { return _mm256_cmpgt_epi64(b, a); }
+    static mask_reg cmp_le(reg a, reg b) { return mask_not(_mm256_cmpgt_epi64(a, b)); }
+    static mask_reg mask_and(mask_reg a, mask_reg b) { return _mm256_and_si256(a, b); }
+    static mask_reg mask_or(mask_reg a, mask_reg b) { return _mm256_or_si256(a, b); }
+    static mask_reg mask_not(mask_reg a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+    static unsigned mask_bits(mask_reg a) { return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(a))); }
+    static reg select(mask_reg m, reg a, reg b) { return _mm256_blendv_epi8(b, a, m); }
+
+    static reg gather(const std::int64_t* base, const std::int32_t* index) {
+        __m256i all = _mm256_set1_epi64x(-1);
+        return _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), reinterpret_cast<const long long*>(base),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(index)), all, 8);
+    }
+
+    static reg bit_and(reg a, reg b) { return _mm256_and_si256(a, b); }
+    static reg bit_or(reg a, reg b) { return _mm256_or_si256(a, b); }
+    static reg bit_xor(reg a, reg b) { return _mm256_xor_si256(a, b); }
+    static reg shift_left(reg a, int k) { return _mm256_slli_epi64(a, k); }
+    static reg shift_right(reg a, int k) { return _mm256_srli_epi64(a, k); }
+
+    static int compress(reg v, unsigned mask, std::int64_t* out) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_maskz_compress_epi64(__mmask8(mask), v));
+#else
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_permutevar8x32_epi32(v, simd_compress_index8(simd_compress_lut::pairs4[mask])));
+#endif
+        return __builtin_popcount(mask);
+    }
+};
+#endif
+
+template<typename T, int N>
+class simd;
+
+// Load/store flags: element_aligned only assumes alignof(T), vector_aligned
+// promises simd<T, N>::alignment. Kernels take the flag as a template
+// argument so the aligned instructions are picked at compile time.
+struct element_aligned_tag {};
+struct vector_aligned_tag {};
+inline constexpr element_aligned_tag element_aligned{};
+inline constexpr vector_aligned_tag vector_aligned{};
+
+// Per-lane booleans produced by comparisons
+template<typename T, int N>
+class simd_mask {
+    using traits = simd_traits<T, N>;
+    typename traits::mask_reg m_;
+
+public:
+    simd_mask() = default;
+    explicit simd_mask(typename traits::mask_reg m) : m_(m) {}
+
+    typename traits::mask_reg native() const { return m_; }
+
+    // Bit i set when lane i is true
+    unsigned bits() const { return traits::mask_bits(m_); }
+    bool any() const { return bits() != 0; }
+    bool all() const { return bits() == (N == 32 ? ~0u : (1u << N) - 1); }
+    bool none() const { return bits() == 0; }
+    int count() const { return __builtin_popcount(bits()); }
+
+    friend simd_mask operator&(simd_mask a, simd_mask b) { return simd_mask(traits::mask_and(a.m_, b.m_)); }
+    friend simd_mask operator|(simd_mask a, simd_mask b) { return simd_mask(traits::mask_or(a.m_, b.m_)); }
+    friend simd_mask operator!(simd_mask a) { return simd_mask(traits::mask_not(a.m_)); }
+};
+
+template<typename T, int N>
+class simd {
+    using traits = simd_traits<T, N>;
+    typename traits::reg v_;
+
+public:
+    using value_type = T;
+    using mask_type = simd_mask<T, N>;
+    static constexpr int size = N;
+    // Alignment load_aligned/store_aligned expect
+    static constexpr std::size_t alignment = sizeof(T) * N;
+
+    simd() : v_(traits::broadcast(T(0))) {}
+    simd(T value) : v_(traits::broadcast(value)) {}
+    explicit simd(typename traits::reg v) : v_(v) {}
+
+    static simd load(const T* p) { return simd(traits::load(p)); }
+    static simd load_aligned(const T* p) { return simd(traits::load_aligned(p)); }
+    void store(T* p) const { traits::store(p, v_); }
+    void store_aligned(T* p) const { traits::store_aligned(p, v_); }
+    static simd load(const T* p, element_aligned_tag) { return load(p); }
+    static simd load(const T* p, vector_aligned_tag) { return load_aligned(p); }
+    void store(T* p, element_aligned_tag) const { store(p); }
+    void store(T* p, vector_aligned_tag) const { store_aligned(p); }
+
+    static bool is_aligned(const void* p) { return reinterpret_cast<std::uintptr_t>(p) % alignment == 0; }
+
+    // lanes[i] = base[index[i]]
+    static simd gather(const T* base, const simd<std::int32_t, N>& index) {
+        alignas(64) std::int32_t lanes[N];
+        index.store(lanes);
+        return simd(traits::gather(base, lanes));
+    }
+
+    typename traits::reg native() const { return v_; }
+
+    T operator[](int lane) const {
+        alignas(64) T lanes[N];
+        store(lanes);
+        return lanes[lane];
+    }
+
+    friend simd operator+(simd a, simd b) { return simd(traits::add(a.v_, b.v_)); }
+    friend simd operator-(simd a, simd b) { return simd(traits::sub(a.v_, b.v_)); }
+    friend simd operator*(simd a, simd b) { return simd(traits::mul(a.v_, b.v_)); }
+    friend simd operator/(simd a, simd b) { return simd(traits::div(a.v_, b.v_)); }
+    friend simd operator-(simd a) { return simd(T(0)) - a; }
+
+    // a * b + c, as one fused instruction (single rounding) when the target
+    // has FMA, as a multiply and an add otherwise
+    friend simd fma(simd a, simd b, simd c) {
+        if constexpr (requires { traits::fma(a.v_, b.v_, c.v_); }) {
+            return simd(traits::fma(a.v_, b.v_, c.v_));
+        } else {
+            return a * b + c;
+        }
+    }
+    simd& operator+=(simd b) { return *this = *this + b; }
+    simd& operator-=(simd b) { return *this = *this - b; }
+    simd& operator*=(simd b) { return *this = *this * b; }
+    simd& operator/=(simd b) { return *this = *this / b; }
+
+    friend mask_type operator==(simd a, simd b) { return mask_type(traits::cmp_eq(a.v_, b.v_)); }
+    friend mask_type operator!=(simd a, simd b) { return !(a == b); }
+    friend mask_type operator<(simd a, simd b) { return mask_type(traits::cmp_lt(a.v_, b.v_)); }
+    friend mask_type operator<=(simd a, simd b) { return mask_type(traits::cmp_le(a.v_, b.v_)); }
+    friend mask_type operator>(simd a, simd b) { return b < a; }
+    friend mask_type operator>=(simd a, simd b) { return b <= a; }
+
+    friend simd min(simd a, simd b) { return simd(traits::min(a.v_, b.v_)); }
+    friend simd max(simd a, simd b) { return simd(traits::max(a.v_, b.v_)); }
+    friend simd abs(simd a) { return simd(traits::abs(a.v_)); }
+    friend simd sqrt(simd a) { return simd(traits::sqrt(a.v_)); }
+
+    // mask ? a : b, lane by lane
+    friend simd select(mask_type m, simd a, simd b) { return simd(traits::select(m.native(), a.v_, b.v_)); }
+
+    // Bitwise operations on each lane's bit pattern, also for floating-point
+    // lanes (sign/exponent tricks); shifts are logical
+    using bits_type = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::uint32_t>;
+    static simd from_bits(bits_type pattern) {
+        T value;
+        std::memcpy(&value, &pattern, sizeof(T));
+        return simd(value);
+    }
+    friend simd bit_and(simd a, simd b) { return simd(traits::bit_and(a.v_, b.v_)); }
+    friend simd bit_or(simd a, simd b) { return simd(traits::bit_or(a.v_, b.v_)); }
+    friend simd bit_xor(simd a, simd b) { return simd(traits::bit_xor(a.v_, b.v_)); }
+    friend simd shift_left(simd a, int k) { return simd(traits::shift_left(a.v_, k)); }
+    friend simd shift_right(simd a, int k) { return simd(traits::shift_right(a.v_, k)); }
+
+    // Stores the lanes selected by m contiguously at out and returns their
+    // count. Lanes past the count may be overwritten too, so out needs room
+    // for a full vector.
+    friend int compress_store(simd v, mask_type m, T* out) { return traits::compress(v.v_, m.bits(), out); }
+
+    // Horizontal reductions, pairwise across lanes
+    friend T reduce_add(simd a) { return a.reduce([](T x, T y) { return T(x + y); }); }
+    friend T reduce_min(simd a) { return a.reduce([](T x, T y) { return std::min(x, y); }); }
+    friend T reduce_max(simd a) { return a.reduce([](T x, T y) { return std::max(x, y); }); }
+
+private:
+    template<typename F>
+    T reduce(F f) const {
+        alignas(64) T lanes[N];
+        store(lanes);
+        for (int width = N; width > 1;) {
+            int half = (width + 1) / 2;
+            for (int i = 0; i + half < width; ++i) lanes[i] = f(lanes[i], lanes[i + half]);
+            width = half;
+        }
+        return lanes[0];
+    }
+};
+
+// Widest shape the compile-time target handles in one register
+template<typename T>
+struct native_simd_width {
+    static constexpr int value = 16 / sizeof(T) > 0 ? int(16 / sizeof(T)) : 1;
+};
+#if defined(__AVX__)
+template<> struct native_simd_width<float> { static constexpr int value = 8; };
+template<> struct native_simd_width<double> { static constexpr int value = 4; };
+#endif
+#if defined(__AVX2__)
+template<> struct native_simd_width<std::int32_t> { static constexpr int value = 8; };
+template<> struct native_simd_width<std::int64_t> { static constexpr int value = 4; };
+#endif
+
+template<typename T>
+using native_simd = simd<T, native_simd_width<T>::value>;
+
+// Runs f(vector_aligned) when every pointer meets V::alignment (aligned_vector
+// storage, for instance) and f(element_aligned) otherwise, so one generic
+// kernel body gets an aligned-load instantiation as its fast path
+template<typename V, typename F, typename... Pointers>
+decltype(auto) simd_with_alignment(F&& f, const Pointers*... pointers) {
+    if ((V::is_aligned(pointers) && ...)) return f(vector_aligned);
+    return f(element_aligned);
+}
+
+// The first instruction set this translation unit was compiled for (by
+// -mavx2, -march=native...) that the running CPU lacks, or nullptr. Code
+// built for a wider ISA than the baseline, like the AVX test variants,
+// checks it before running anything else.
+inline const char* simd_missing_build_feature() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+#if defined(__AVX__)
+    if (!__builtin_cpu_supports("avx")) return "avx";
+#endif
+#if defined(__AVX2__)
+    if (!__builtin_cpu_supports("avx2")) return "avx2";
+#endif
+#if defined(__FMA__)
+    if (!__builtin_cpu_supports("fma")) return "fma";
+#endif
+#if defined(__AVX512F__)
+    if (!__builtin_cpu_supports("avx512f")) return "avx512f";
+#endif
+#if defined(__AVX512VL__)
+    if (!__builtin_cpu_supports("avx512vl")) return "avx512vl";
+#endif
+#if defined(__AVX512DQ__)
+    if (!__builtin_cpu_supports("avx512dq")) return "avx512dq";
+#endif
+#if defined(__AVX512BW__)
+    if (!__builtin_cpu_supports("avx512bw")) return "avx512bw";
+#endif
+#endif
+    return nullptr;
+}
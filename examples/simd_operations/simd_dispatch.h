@@ -0,0 +1,372 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SIMD_DISPATCH_X86 1
+#endif
+
+// ===== CPU FEATURE DETECTION =====
+
+// Instruction set tiers, in increasing order of width
+enum class SimdTier { Scalar, SSE2, AVX2, AVX512 };
+
+inline const char* simd_tier_name(SimdTier tier) {
+    switch (tier) {
+        case SimdTier::SSE2: return "SSE2";
+        case SimdTier::AVX2: return "AVX2";
+        case SimdTier::AVX512: return "AVX-512";
+        default: return "Scalar";
+    }
+}
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx = false;     // CPU supports it AND the OS saves YMM state
+    bool avx2 = false;
+    bool fma = false;
+    bool avx512f = false; // CPU supports it AND the OS saves ZMM state
+};
+
+// Reads CPUID and XCR0. A CPUID bit alone isn't enough for AVX/AVX-512:
+// the OS must also have enabled saving the wider registers on context
+// switches, which XGETBV reports.
+inline CpuFeatures detect_cpu_features() {
+    CpuFeatures f;
+#if defined(SIMD_DISPATCH_X86)
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return f;
+    f.sse2 = edx & (1u << 26);
+    const bool osxsave = ecx & (1u << 27);
+    const bool cpu_avx = ecx & (1u << 28);
+    const bool cpu_fma = ecx & (1u << 12);
+
+    unsigned long long xcr0 = 0;
+    if (osxsave) {
+        unsigned lo = 0, hi = 0;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = (static_cast<unsigned long long>(hi) << 32) | lo;
+    }
+    const bool os_ymm = (xcr0 & 0x6) == 0x6;     // SSE + AVX state
+    const bool os_zmm = (xcr0 & 0xE6) == 0xE6;   // + opmask, ZMM0-15 upper, ZMM16-31
+
+    f.avx = cpu_avx && os_ymm;
+    f.fma = cpu_fma && os_ymm;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        f.avx2 = f.avx && (ebx & (1u << 5));
+        f.avx512f = os_zmm && (ebx & (1u << 16));
+    }
+#endif
+    return f;
+}
+
+inline const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = detect_cpu_features();
+    return features;
+}
+
+inline bool simd_tier_supported(SimdTier tier) {
+    const CpuFeatures& f = cpu_features();
+    switch (tier) {
+        case SimdTier::Scalar: return true;
+        case SimdTier::SSE2: return f.sse2;
+        case SimdTier::AVX2: return f.avx2 && f.fma;
+        case SimdTier::AVX512: return f.avx512f;
+    }
+    return false;
+}
+
+inline SimdTier best_simd_tier() {
+    for (SimdTier tier : {SimdTier::AVX512, SimdTier::AVX2, SimdTier::SSE2}) {
+        if (simd_tier_supported(tier)) return tier;
+    }
+    return SimdTier::Scalar;
+}
+
+// ===== KERNEL IMPLEMENTATIONS =====
+
+// One struct per tier with the same static functions. The wider tiers are
+// compiled with per-function target attributes, so a baseline x86-64
+// build still contains them; they're only ever called after CPUID says so.
+struct ScalarKernels {
+    static void add(const float* a, const float* b, float* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = a[i] + b[i];
+    }
+    static void multiply(const float* a, const float* b, float* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = a[i] * b[i];
+    }
+    static void abs(const float* in, float* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = std::fabs(in[i]);
+    }
+    static float sum(const float* in, std::size_t n) {
+        float total = 0.0f;
+        for (std::size_t i = 0; i < n; ++i) total += in[i];
+        return total;
+    }
+    static float dot(const float* a, const float* b, std::size_t n) {
+        float total = 0.0f;
+        for (std::size_t i = 0; i < n; ++i) total += a[i] * b[i];
+        return total;
+    }
+};
+
+#if defined(SIMD_DISPATCH_X86)
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+
+struct Sse2Kernels {
+    SIMD_TARGET("sse2") static void add(const float* a, const float* b, float* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        for (; i < n; ++i) out[i] = a[i] + b[i];
+    }
+    SIMD_TARGET("sse2") static void multiply(const float* a, const float* b, float* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        for (; i < n; ++i) out[i] = a[i] * b[i];
+    }
+    SIMD_TARGET("sse2") static void abs(const float* in, float* out, std::size_t n) {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, _mm_andnot_ps(sign, _mm_loadu_ps(in + i)));
+        for (; i < n; ++i) out[i] = std::fabs(in[i]);
+    }
+    SIMD_TARGET("sse2") static float sum(const float* in, std::size_t n) {
+        __m128 acc = _mm_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_loadu_ps(in + i));
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        float total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (; i < n; ++i) total += in[i];
+        return total;
+    }
+    SIMD_TARGET("sse2") static float dot(const float* a, const float* b, std::size_t n) {
+        __m128 acc = _mm_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        float total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (; i < n; ++i) total += a[i] * b[i];
+        return total;
+    }
+};
+
+struct Avx2Kernels {
+    SIMD_TARGET("avx2,fma") static float horizontal_sum(__m256 v) {
+        __m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+        x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+        return _mm_cvtss_f32(x);
+    }
+    SIMD_TARGET("avx2,fma") static void add(const float* a, const float* b, float* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+        for (; i < n; ++i) out[i] = a[i] + b[i];
+    }
+    SIMD_TARGET("avx2,fma") static void multiply(const float* a, const float* b, float* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+        for (; i < n; ++i) out[i] = a[i] * b[i];
+    }
+    SIMD_TARGET("avx2,fma") static void abs(const float* in, float* out, std::size_t n) {
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_andnot_ps(sign, _mm256_loadu_ps(in + i)));
+        for (; i < n; ++i) out[i] = std::fabs(in[i]);
+    }
+    // Two accumulators hide the latency of dependent adds
+    SIMD_TARGET("avx2,fma") static float sum(const float* in, std::size_t n) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(in + i));
+            acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(in + i + 8));
+        }
+        for (; i + 8 <= n; i += 8) acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(in + i));
+        float total = horizontal_sum(_mm256_add_ps(acc0, acc1));
+        for (; i < n; ++i) total += in[i];
+        return total;
+    }
+    SIMD_TARGET("avx2,fma") static float dot(const float* a, const float* b, std::size_t n) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        }
+        for (; i + 8 <= n; i += 8) acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        float total = horizontal_sum(_mm256_add_ps(acc0, acc1));
+        for (; i < n; ++i) total += a[i] * b[i];
+        return total;
+    }
+};
+
+// AVX-512 handles the tail with a masked load/store instead of a scalar loop
+struct Avx512Kernels {
+    SIMD_TARGET("avx512f") static __mmask16 tail_mask(std::size_t remaining) {
+        return static_cast<__mmask16>((1u << remaining) - 1);
+    }
+    // Pairwise over the 16 lanes (_mm512_reduce_add_ps trips a bogus
+    // -Wuninitialized in GCC 12's headers)
+    SIMD_TARGET("avx512f") static float horizontal_sum(__m512 v) {
+        alignas(64) float lanes[16];
+        _mm512_store_ps(lanes, v);
+        for (int width = 8; width > 0; width /= 2) {
+            for (int i = 0; i < width; ++i) lanes[i] += lanes[i + width];
+        }
+        return lanes[0];
+    }
+    SIMD_TARGET("avx512f") static void add(const float* a, const float* b, float* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+        }
+        if (i < n) {
+            __mmask16 m = tail_mask(n - i);
+            _mm512_mask_storeu_ps(out + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i)));
+        }
+    }
+    SIMD_TARGET("avx512f") static void multiply(const float* a, const float* b, float* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+        }
+        if (i < n) {
+            __mmask16 m = tail_mask(n - i);
+            _mm512_mask_storeu_ps(out + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i)));
+        }
+    }
+    SIMD_TARGET("avx512f") static void abs(const float* in, float* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) _mm512_storeu_ps(out + i, _mm512_abs_ps(_mm512_loadu_ps(in + i)));
+        if (i < n) {
+            __mmask16 m = tail_mask(n - i);
+            _mm512_mask_storeu_ps(out + i, m, _mm512_abs_ps(_mm512_maskz_loadu_ps(m, in + i)));
+        }
+    }
+    SIMD_TARGET("avx512f") static float sum(const float* in, std::size_t n) {
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(in + i));
+            acc1 = _mm512_add_ps(acc1, _mm512_loadu_ps(in + i + 16));
+        }
+        for (; i + 16 <= n; i += 16) acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(in + i));
+        if (i < n) acc1 = _mm512_add_ps(acc1, _mm512_maskz_loadu_ps(tail_mask(n - i), in + i));
+        return horizontal_sum(_mm512_add_ps(acc0, acc1));
+    }
+    SIMD_TARGET("avx512f") static float dot(const float* a, const float* b, std::size_t n) {
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+        }
+        for (; i + 16 <= n; i += 16) acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        if (i < n) {
+            __mmask16 m = tail_mask(n - i);
+            acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), acc1);
+        }
+        return horizontal_sum(_mm512_add_ps(acc0, acc1));
+    }
+};
+
+#undef SIMD_TARGET
+#endif
+
+// ===== DISPATCH TABLE =====
+
+// Function pointers bound to one tier's kernels
+struct SimdKernels {
+    SimdTier tier = SimdTier::Scalar;
+    void (*add)(const float* a, const float* b, float* out, std::size_t n) = nullptr;
+    void (*multiply)(const float* a, const float* b, float* out, std::size_t n) = nullptr;
+    void (*abs)(const float* in, float* out, std::size_t n) = nullptr;
+    float (*sum)(const float* in, std::size_t n) = nullptr;
+    float (*dot)(const float* a, const float* b, std::size_t n) = nullptr;
+};
+
+template<typename Impl>
+SimdKernels make_simd_kernels(SimdTier tier) {
+    return {tier, &Impl::add, &Impl::multiply, &Impl::abs, &Impl::sum, &Impl::dot};
+}
+
+inline SimdKernels simd_kernels_for(SimdTier tier) {
+    switch (tier) {
+#if defined(SIMD_DISPATCH_X86)
+        case SimdTier::SSE2: return make_simd_kernels<Sse2Kernels>(tier);
+        case SimdTier::AVX2: return make_simd_kernels<Avx2Kernels>(tier);
+        case SimdTier::AVX512: return make_simd_kernels<Avx512Kernels>(tier);
+#endif
+        default: return make_simd_kernels<ScalarKernels>(SimdTier::Scalar);
+    }
+}
+
+// Tier requested through the SIMD_TIER environment variable (scalar, sse2,
+// avx2 or avx512), capped at what the CPU supports; otherwise the best one
+inline SimdTier initial_simd_tier() {
+    SimdTier tier = best_simd_tier();
+    if (const char* env = std::getenv("SIMD_TIER")) {
+        const std::string name = env;
+        SimdTier requested = tier;
+        if (name == "scalar") requested = SimdTier::Scalar;
+        else if (name == "sse2") requested = SimdTier::SSE2;
+        else if (name == "avx2") requested = SimdTier::AVX2;
+        else if (name == "avx512") requested = SimdTier::AVX512;
+        while (!simd_tier_supported(requested)) requested = static_cast<SimdTier>(static_cast<int>(requested) - 1);
+        tier = requested;
+    }
+    return tier;
+}
+
+// The active table; CPUID is read and the pointers bound on first use
+inline SimdKernels& simd_kernels() {
+    static SimdKernels kernels = simd_kernels_for(initial_simd_tier());
+    return kernels;
+}
+
+// Rebinds every kernel to `tier`, e.g. to test each implementation in
+// turn. Throws if the CPU can't run it. Not safe while other threads are
+// calling kernels.
+inline void force_simd_tier(SimdTier tier) {
+    if (!simd_tier_supported(tier)) {
+        throw std::invalid_argument(std::string("force_simd_tier: CPU does not support ") + simd_tier_name(tier));
+    }
+    simd_kernels() = simd_kernels_for(tier);
+}
+
+inline SimdTier active_simd_tier() {
+    return simd_kernels().tier;
+}
+
+// ===== DISPATCHED KERNELS =====
+
+inline void simd_add(const float* a, const float* b, float* out, std::size_t n) {
+    simd_kernels().add(a, b, out, n);
+}
+
+inline void simd_multiply(const float* a, const float* b, float* out, std::size_t n) {
+    simd_kernels().multiply(a, b, out, n);
+}
+
+inline void simd_abs(const float* in, float* out, std::size_t n) {
+    simd_kernels().abs(in, out, n);
+}
+
+inline float simd_sum(const float* in, std::size_t n) {
+    return simd_kernels().sum(in, n);
+}
+
+inline float simd_dot(const float* a, const float* b, std::size_t n) {
+    return simd_kernels().dot(a, b, n);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include "simd.h"
+
+// ===== VECTORIZED FILTER (STREAM COMPACTION) =====
+//
+// simd_filter copies the elements of in that satisfy pred to the front of
+// out, preserving order, and returns how many it kept. The predicate is
+// evaluated on whole native_simd<T> vectors to produce a lane mask, and
+// compress_store packs the selected lanes with AVX-512 compress, an AVX2
+// permute table or an SSSE3 byte shuffle, whichever the target has. There
+// is no branch on the data, so the cost per element is the same at 1% and
+// at 99% selectivity.
+//
+// pred must accept both native_simd<T> (returning a mask) and T (returning
+// bool, used for the tail), e.g. [](auto x) { return x > 0; }. Each vector
+// store writes a full register, so out must be at least as long as in; the
+// elements past the returned count are unspecified. in and out may be the
+// same span.
+
+template<typename T, typename Pred>
+std::size_t simd_filter(std::span<const T> in, std::span<T> out, Pred pred) {
+    if (out.size() < in.size()) {
+        throw std::invalid_argument("simd_filter: output span is shorter than the input");
+    }
+    using V = native_simd<T>;
+    const std::size_t n = in.size();
+    std::size_t i = 0, kept = 0;
+    // kept <= i, so the full-width store at kept never passes i + V::size
+    // and never reaches input that has not been loaded yet
+    simd_with_alignment<V>([&](auto flags) {
+        for (; i + V::size <= n; i += V::size) {
+            V v = V::load(in.data() + i, flags);
+            kept += compress_store(v, pred(v), out.data() + kept);
+        }
+    }, in.data());
+    for (; i < n; ++i) {
+        T x = in[i];
+        out[kept] = x;
+        kept += pred(x) ? 1 : 0;
+    }
+    return kept;
+}
@@ -7,9 +7,20 @@
 #include <algorithm>
 #include <cstring>
 #include <functional>
+#include <iomanip>
+#include <random>
+#include <unistd.h>
+#include "aligned_allocator.h"
+#include "simd.h"
+#include "simd_filter.h"
+#include "simd_math.h"
+#include "simd_dispatch.h"
 using namespace std;
 using namespace chrono;
 
+// Widest float vector the compile-time target supports
+using floatv = native_simd<float>;
+
 // ===== BASIC SIMD CONCEPTS =====
 
 // Demonstrate SIMD concepts without intrinsics
@@ -26,7 +37,7 @@ void demonstrate_simd_concepts() {
 
     // Simple vectorizable loop
     const int SIZE = 1000000;
-    vector<float> a(SIZE), b(SIZE), c(SIZE);
+    aligned_vector<float> a(SIZE), b(SIZE), c(SIZE);
 
     // Initialize data
     for (int i = 0; i < SIZE; ++i) {
@@ -45,7 +56,22 @@ void demonstrate_simd_concepts() {
 
     cout << "Time: " << duration.count() << " microseconds" << endl;
     cout << "Sample results: c[0] = " << c[0] << ", c[1] = " << c[1] << ", c[999999] = " << c[999999] << endl;
-    cout << "Note: Modern compilers may auto-vectorize this loop." << endl << endl;
+    cout << "Note: Modern compilers may auto-vectorize this loop." << endl;
+
+    // The same loop written with simd<float, N>: vectorized regardless of the optimizer
+    aligned_vector<float> c_simd(SIZE);
+    start = high_resolution_clock::now();
+    int i = 0;
+    for (; i + floatv::size <= SIZE; i += floatv::size) {
+        (floatv::load(&a[i]) + floatv::load(&b[i])).store(&c_simd[i]);
+    }
+    for (; i < SIZE; ++i) {
+        c_simd[i] = a[i] + b[i];
+    }
+    end = high_resolution_clock::now();
+
+    cout << "simd<float, " << floatv::size << "> time: " << duration_cast<microseconds>(end - start).count()
+         << " microseconds (results " << (c_simd == c ? "match" : "differ") << ")" << endl << endl;
 }
 
 // ===== COMPILER VECTORIZATION =====
@@ -55,14 +81,14 @@ void demonstrate_compiler_vectorization() {
     cout << "=== Compiler Vectorization ===\n" << endl;
 
     const int SIZE = 1000000;
-    vector<float> data(SIZE);
+    aligned_vector<float> data(SIZE);
 
     // Initialize with some pattern
     for (int i = 0; i < SIZE; ++i) {
         data[i] = sin(static_cast<float>(i) * 0.01f);
     }
 
-    vector<float> result(SIZE);
+    aligned_vector<float> result(SIZE);
 
     cout << "Computing element-wise operations that can be vectorized..." << endl;
 
@@ -76,8 +102,29 @@ void demonstrate_compiler_vectorization() {
 
     cout << "Vectorizable computation time: " << duration.count() << " microseconds" << endl;
 
+    aligned_vector<float> result_simd(SIZE);
+    start = high_resolution_clock::now();
+    int i = 0;
+    for (; i + floatv::size <= SIZE; i += floatv::size) {
+        floatv x = floatv::load(&data[i]);
+        (x * x + 2.0f * x + 1.0f).store(&result_simd[i]);
+    }
+    for (; i < SIZE; ++i) {
+        result_simd[i] = data[i] * data[i] + 2.0f * data[i] + 1.0f;
+    }
+    end = high_resolution_clock::now();
+
+    // The compiler may contract the scalar loop into FMAs, so compare with a tolerance
+    float max_diff = 0.0f;
+    for (int j = 0; j < SIZE; ++j) {
+        max_diff = max(max_diff, abs(result_simd[j] - result[j]));
+    }
+    cout << "simd<float, " << floatv::size << "> computation time: "
+         << duration_cast<microseconds>(end - start).count() << " microseconds (max difference "
+         << max_diff << ")" << endl;
+
     // Non-vectorizable version (with dependencies)
-    vector<float> result2(SIZE);
+    aligned_vector<float> result2(SIZE);
     start = high_resolution_clock::now();
     float accumulator = 0.0f;
     for (int i = 0; i < SIZE; ++i) {
@@ -88,7 +135,9 @@ void demonstrate_compiler_vectorization() {
     duration = duration_cast<microseconds>(end - start);
 
     cout << "Non-vectorizable computation time: " << duration.count() << " microseconds" << endl;
-    cout << "Note: The second loop has dependencies that prevent vectorization." << endl << endl;
+    cout << "Note: The second loop has dependencies that prevent auto-vectorization." << endl;
+    cout << "A log-step scan inside a register (shift + add, log2(lanes) times) vectorizes it by hand;" << endl;
+    cout << "see par_inclusive_scan in examples/parallel_algorithms/parallel.h." << endl << endl;
 }
 
 // ===== SIMD WITH ARRAYS =====
@@ -98,7 +147,8 @@ void demonstrate_simd_arrays() {
     cout << "=== SIMD with Arrays ===\n" << endl;
 
     const int SIZE = 1000000;
-    array<float, 1000000> a{}, b{}, c{};
+    // static: three 4MB arrays would overflow a default 8MB stack
+    static array<float, 1000000> a{}, b{}, c{};
 
     // Initialize
     for (int i = 0; i < SIZE; ++i) {
@@ -117,7 +167,19 @@ void demonstrate_simd_arrays() {
 
     cout << "Time: " << duration.count() << " microseconds" << endl;
     cout << "Sample: a[0] * b[0] - 1 = " << c[0] << " (should be ~0)" << endl;
-    cout << "Sample: a[999] * b[999] - 1 = " << c[999] << " (should be ~0)" << endl << endl;
+    cout << "Sample: a[999] * b[999] - 1 = " << c[999] << " (should be ~0)" << endl;
+
+    // 1000000 is a multiple of every vector width, so no scalar tail is needed
+    static_assert(SIZE % floatv::size == 0, "SIZE must be a whole number of vectors");
+    static array<float, 1000000> c_simd{};
+    start = high_resolution_clock::now();
+    for (int i = 0; i < SIZE; i += floatv::size) {
+        (floatv::load(&a[i]) * floatv::load(&b[i]) - 1.0f).store(&c_simd[i]);
+    }
+    end = high_resolution_clock::now();
+
+    cout << "simd<float, " << floatv::size << "> time: " << duration_cast<microseconds>(end - start).count()
+         << " microseconds (results " << (c_simd == c ? "match" : "differ") << ")" << endl << endl;
 }
 
 // ===== STRUCTURE OF ARRAYS =====
@@ -136,7 +198,7 @@ void demonstrate_soa_aos() {
 
     // Structure of Arrays (SoA)
     struct Particles_SoA {
-        vector<float> x, y, z, mass;
+        aligned_vector<float> x, y, z, mass;
     };
     Particles_SoA particles_soa;
     particles_soa.x.resize(SIZE);
@@ -180,6 +242,25 @@ void demonstrate_soa_aos() {
 
     cout << "SoA time: " << soa_duration.count() << " microseconds" << endl;
 
+    // SoA with simd<float, N>: one mass load feeds three vector adds
+    start = high_resolution_clock::now();
+    int i = 0;
+    for (; i + floatv::size <= SIZE; i += floatv::size) {
+        floatv mass = floatv::load(&particles_soa.mass[i]);
+        (floatv::load(&particles_soa.x[i]) + mass).store(&particles_soa.x[i]);
+        (floatv::load(&particles_soa.y[i]) + mass).store(&particles_soa.y[i]);
+        (floatv::load(&particles_soa.z[i]) + mass).store(&particles_soa.z[i]);
+    }
+    for (; i < SIZE; ++i) {
+        particles_soa.x[i] += particles_soa.mass[i];
+        particles_soa.y[i] += particles_soa.mass[i];
+        particles_soa.z[i] += particles_soa.mass[i];
+    }
+    end = high_resolution_clock::now();
+
+    cout << "SoA simd<float, " << floatv::size << "> time: " << duration_cast<microseconds>(end - start).count()
+         << " microseconds" << endl;
+
     double speedup = static_cast<double>(aos_duration.count()) / soa_duration.count();
     cout << "SoA speedup: " << speedup << "x" << endl;
     cout << "SoA is often faster due to better memory access patterns for SIMD." << endl << endl;
@@ -187,12 +268,66 @@ void demonstrate_soa_aos() {
 
 // ===== SIMD-FRIENDLY ALGORITHMS =====
 
+// Keeps the elements below a threshold three ways: a branchy scalar loop
+// (fast when the branch predicts, slow near 50%), a branchless scalar loop
+// (flat, one store per element) and simd_filter (flat, one store per vector)
+template<typename T>
+void benchmark_filter(const char* type_name) {
+    const int SIZE = 1000000;
+    const int RUNS = 5;
+    aligned_vector<T> data(SIZE), out(SIZE);
+    mt19937 rng(42);
+    uniform_int_distribution<int> value(0, 9999);
+    for (T& x : data) x = static_cast<T>(value(rng));
+
+    auto best_ns_per_element = [&](auto&& filter, size_t& kept) {
+        auto best = nanoseconds::max();
+        for (int run = 0; run < RUNS; ++run) {
+            auto start = high_resolution_clock::now();
+            kept = filter();
+            best = min(best, duration_cast<nanoseconds>(high_resolution_clock::now() - start));
+        }
+        return static_cast<double>(best.count()) / SIZE;
+    };
+
+    cout << type_name << " (ns/element)\n";
+    cout << "  selectivity   branchy  branchless  simd_filter" << endl;
+    for (int percent : {1, 10, 25, 50, 75, 90, 99}) {
+        const T threshold = static_cast<T>(percent * 100);
+        size_t kept_branchy = 0, kept_branchless = 0, kept_simd = 0;
+
+        double branchy = best_ns_per_element([&] {
+            size_t k = 0;
+            for (int i = 0; i < SIZE; ++i) {
+                if (data[i] < threshold) out[k++] = data[i];
+            }
+            return k;
+        }, kept_branchy);
+        double branchless = best_ns_per_element([&] {
+            size_t k = 0;
+            for (int i = 0; i < SIZE; ++i) {
+                out[k] = data[i];
+                k += data[i] < threshold;
+            }
+            return k;
+        }, kept_branchless);
+        double vectorized = best_ns_per_element([&] {
+            return simd_filter<T>(data, out, [threshold](auto x) { return x < threshold; });
+        }, kept_simd);
+
+        cout << "  " << setw(10) << percent << "%" << fixed << setprecision(2) << setw(10) << branchy << setw(12)
+             << branchless << setw(13) << vectorized;
+        if (kept_branchy != kept_branchless || kept_branchy != kept_simd) cout << "  (count mismatch)";
+        cout << defaultfloat << endl;
+    }
+}
+
 // Algorithms designed for SIMD processing
 void demonstrate_simd_friendly_algorithms() {
     cout << "=== SIMD-Friendly Algorithms ===\n" << endl;
 
     const int SIZE = 1000000;
-    vector<float> data(SIZE);
+    aligned_vector<float> data(SIZE);
 
     // Initialize with alternating positive/negative values
     for (int i = 0; i < SIZE; ++i) {
@@ -202,7 +337,7 @@ void demonstrate_simd_friendly_algorithms() {
     // Branchless absolute value (SIMD-friendly)
     cout << "Computing absolute values (branchless vs branching)..." << endl;
 
-    vector<float> abs_branchless(SIZE);
+    aligned_vector<float> abs_branchless(SIZE);
     auto start = high_resolution_clock::now();
     for (int i = 0; i < SIZE; ++i) {
         // Branchless: using sign bit manipulation
@@ -215,7 +350,7 @@ void demonstrate_simd_friendly_algorithms() {
 
     cout << "Branchless absolute value: " << branchless_duration.count() << " microseconds" << endl;
 
-    vector<float> abs_branching(SIZE);
+    aligned_vector<float> abs_branching(SIZE);
     start = high_resolution_clock::now();
     for (int i = 0; i < SIZE; ++i) {
         // Branching version
@@ -226,8 +361,22 @@ void demonstrate_simd_friendly_algorithms() {
 
     cout << "Branching absolute value: " << branching_duration.count() << " microseconds" << endl;
 
+    aligned_vector<float> abs_simd(SIZE);
+    start = high_resolution_clock::now();
+    int i = 0;
+    for (; i + floatv::size <= SIZE; i += floatv::size) {
+        abs(floatv::load(&data[i])).store(&abs_simd[i]);
+    }
+    for (; i < SIZE; ++i) {
+        abs_simd[i] = abs(data[i]);
+    }
+    end = high_resolution_clock::now();
+
+    cout << "simd<float, " << floatv::size << "> absolute value: " << duration_cast<microseconds>(end - start).count()
+         << " microseconds" << endl;
+
     // Verify results match
-    bool results_match = true;
+    bool results_match = abs_simd == abs_branching;
     for (int i = 0; i < SIZE; ++i) {
         if (abs(abs_branchless[i] - abs_branching[i]) > 1e-6f) {
             results_match = false;
@@ -247,11 +396,63 @@ void demonstrate_simd_friendly_algorithms() {
     auto sum_duration = duration_cast<microseconds>(end - start);
 
     cout << "Sum computation: " << sum_duration.count() << " microseconds" << endl;
-    cout << "Sum result: " << sum << endl << endl;
+    cout << "Sum result: " << sum << endl;
+
+    // Vector accumulator, reduced horizontally once at the end. The lanes add
+    // in a different order, so the result differs in the last bits.
+    start = high_resolution_clock::now();
+    floatv lanes(0.0f);
+    i = 0;
+    for (; i + floatv::size <= SIZE; i += floatv::size) {
+        lanes += abs(floatv::load(&data[i]));
+    }
+    float simd_sum = reduce_add(lanes);
+    for (; i < SIZE; ++i) {
+        simd_sum += abs(data[i]);
+    }
+    end = high_resolution_clock::now();
+
+    cout << "simd<float, " << floatv::size << "> sum: " << duration_cast<microseconds>(end - start).count()
+         << " microseconds (result " << simd_sum << ")" << endl << endl;
+
+    // Stream compaction: predicate to lane mask, then compress_store
+    cout << "Filtering 1M elements (keep x < threshold)..." << endl;
+    benchmark_filter<int32_t>("int32");
+    benchmark_filter<float>("float");
+    benchmark_filter<int64_t>("int64");
+    cout << endl;
 }
 
 // ===== MEMORY ALIGNMENT =====
 
+// Streams over n floats `passes` times with four independent accumulators,
+// so the loop is bound by the loads; Flags picks aligned or unaligned ones
+template<typename Flags>
+float stream_sum(const float* p, size_t n, int passes, Flags flags) {
+    const size_t STEP = 4 * floatv::size;
+    floatv acc0(0.0f), acc1(0.0f), acc2(0.0f), acc3(0.0f);
+    for (int pass = 0; pass < passes; ++pass) {
+        for (size_t i = 0; i + STEP <= n; i += STEP) {
+            acc0 += floatv::load(p + i, flags);
+            acc1 += floatv::load(p + i + floatv::size, flags);
+            acc2 += floatv::load(p + i + 2 * floatv::size, flags);
+            acc3 += floatv::load(p + i + 3 * floatv::size, flags);
+        }
+    }
+    return reduce_add((acc0 + acc1) + (acc2 + acc3));
+}
+
+// Data cache size in bytes as reported by the OS, or the fallback
+size_t cache_size(int level, size_t fallback) {
+    long bytes = 0;
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+    if (level == 1) bytes = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    if (level == 2) bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (level == 3) bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    return bytes > 0 ? static_cast<size_t>(bytes) : fallback;
+}
+
 // Demonstrate memory alignment for SIMD
 void demonstrate_memory_alignment() {
     cout << "=== Memory Alignment for SIMD ===\n" << endl;
@@ -261,9 +462,10 @@ void demonstrate_memory_alignment() {
     const int SIZE = 1000000;
     const int ALIGNMENT = 32;  // AVX alignment requirement
 
-    // Aligned allocation
-    float* aligned_data = static_cast<float*>(aligned_alloc(ALIGNMENT, SIZE * sizeof(float)));
-    float* unaligned_data = new float[SIZE];
+    // Aligned allocation; the second buffer is deliberately offset by one float
+    aligned_vector<float, ALIGNMENT> aligned_storage(SIZE), unaligned_storage(SIZE + 1);
+    float* aligned_data = aligned_storage.data();
+    float* unaligned_data = unaligned_storage.data() + 1;
 
     // Initialize
     for (int i = 0; i < SIZE; ++i) {
@@ -274,11 +476,11 @@ void demonstrate_memory_alignment() {
     cout << "Aligned data pointer: " << aligned_data << endl;
     cout << "Unaligned data pointer: " << unaligned_data << endl;
     cout << "Alignment requirement: " << ALIGNMENT << " bytes" << endl;
-    cout << "Aligned data is " << ((reinterpret_cast<uintptr_t>(aligned_data) % ALIGNMENT == 0) ? "" : "not ") << "aligned" << endl;
-    cout << "Unaligned data is " << ((reinterpret_cast<uintptr_t>(unaligned_data) % ALIGNMENT == 0) ? "" : "not ") << "aligned" << endl;
+    cout << "Aligned data is " << (is_aligned(aligned_data, ALIGNMENT) ? "" : "not ") << "aligned" << endl;
+    cout << "Unaligned data is " << (is_aligned(unaligned_data, ALIGNMENT) ? "" : "not ") << "aligned" << endl;
 
     // Computation on aligned data
-    vector<float> result_aligned(SIZE);
+    aligned_vector<float> result_aligned(SIZE);
     auto start = high_resolution_clock::now();
     for (int i = 0; i < SIZE; ++i) {
         result_aligned[i] = sqrt(aligned_data[i] * aligned_data[i] + 1.0f);
@@ -289,7 +491,7 @@ void demonstrate_memory_alignment() {
     cout << "Aligned computation: " << aligned_duration.count() << " microseconds" << endl;
 
     // Computation on unaligned data
-    vector<float> result_unaligned(SIZE);
+    aligned_vector<float> result_unaligned(SIZE);
     start = high_resolution_clock::now();
     for (int i = 0; i < SIZE; ++i) {
         result_unaligned[i] = sqrt(unaligned_data[i] * unaligned_data[i] + 1.0f);
@@ -299,9 +501,65 @@ void demonstrate_memory_alignment() {
 
     cout << "Unaligned computation: " << unaligned_duration.count() << " microseconds" << endl;
 
-    // Cleanup
-    free(aligned_data);
-    delete[] unaligned_data;
+    // simd<float, N> with aligned loads on the aligned buffer, unaligned loads on the other
+    aligned_vector<float> result_simd(SIZE);
+    static_assert(ALIGNMENT % floatv::alignment == 0, "aligned_vector must satisfy load_aligned");
+    start = high_resolution_clock::now();
+    for (int i = 0; i < SIZE; i += floatv::size) {
+        floatv x = floatv::load_aligned(aligned_data + i);
+        sqrt(x * x + 1.0f).store_aligned(&result_simd[i]);
+    }
+    end = high_resolution_clock::now();
+    cout << "simd<float, " << floatv::size << "> aligned loads: " << duration_cast<microseconds>(end - start).count()
+         << " microseconds" << endl;
+
+    start = high_resolution_clock::now();
+    for (int i = 0; i < SIZE; i += floatv::size) {
+        floatv x = floatv::load(unaligned_data + i);
+        sqrt(x * x + 1.0f).store(&result_simd[i]);
+    }
+    end = high_resolution_clock::now();
+    cout << "simd<float, " << floatv::size << "> unaligned loads: " << duration_cast<microseconds>(end - start).count()
+         << " microseconds (results " << (result_simd == result_unaligned ? "match" : "differ") << ")" << endl;
+
+    // Load bandwidth per cache level. Unaligned vectors split a cache line
+    // every 64 / alignment loads; that costs most where the loads themselves
+    // are cheapest (L1) and disappears behind DRAM latency.
+    cout << "\nStreaming load bandwidth, aligned vs offset by one float (GB/s):" << endl;
+    cout << "  level        size   aligned  unaligned  ratio" << endl;
+    // Virtual machines sometimes report the whole host's L3, so it is capped
+    const size_t l1 = cache_size(1, 32 << 10), l2 = cache_size(2, 1 << 20);
+    const size_t l3 = min<size_t>(cache_size(3, 8 << 20), 32 << 20);
+    struct Level { const char* name; size_t bytes; };
+    const Level levels[] = {{"L1", l1 / 2}, {"L2", l2 / 2}, {"L3", l3 / 2}, {"DRAM", max<size_t>(4 * l3, 64 << 20)}};
+    const size_t BYTES_PER_RUN = size_t(512) << 20;
+    volatile float sink = 0.0f;
+    auto bandwidth = [&](const float* p, size_t n, auto flags) {
+        int passes = static_cast<int>(max<size_t>(1, BYTES_PER_RUN / (n * sizeof(float))));
+        double best = 0.0;
+        for (int run = 0; run < 3; ++run) {
+            auto t0 = high_resolution_clock::now();
+            sink = stream_sum(p, n, passes, flags);
+            double seconds = duration<double>(high_resolution_clock::now() - t0).count();
+            best = max(best, double(n) * sizeof(float) * passes / seconds / 1e9);
+        }
+        return best;
+    };
+    for (const Level& level : levels) {
+        size_t n = level.bytes / sizeof(float);
+        aligned_vector<float> buffer(n + floatv::size, 1.0f);
+        double aligned_gbs = bandwidth(buffer.data(), n, vector_aligned);
+        double unaligned_gbs = bandwidth(buffer.data() + 1, n, element_aligned);
+        cout << "  " << left << setw(6) << level.name << right << setw(10) << (level.bytes >> 10) << "K" << fixed
+             << setprecision(1) << setw(10) << aligned_gbs << setw(11) << unaligned_gbs << setprecision(2)
+             << setw(7) << aligned_gbs / unaligned_gbs << defaultfloat << endl;
+    }
+
+    // Same DRAM stream on 2 MiB pages: far fewer TLB misses per byte
+    size_t dram = levels[3].bytes / sizeof(float);
+    huge_page_vector<float> huge(dram + floatv::size, 1.0f);
+    cout << "  DRAM on huge pages (madvise): " << fixed << setprecision(1)
+         << bandwidth(huge.data(), dram, vector_aligned) << " GB/s aligned" << defaultfloat << endl;
 
     cout << "Note: Alignment benefits vary by CPU and compiler." << endl << endl;
 }
@@ -318,10 +576,62 @@ void demonstrate_simd_detection() {
     cout << "• AVX-512: 512-bit (16 floats, 8 doubles)" << endl;
     cout << "• NEON: ARM SIMD (varies by architecture)" << endl << endl;
 
-    // In a real implementation, you would use CPUID or similar
-    // to detect available instruction sets at runtime
-    cout << "Runtime SIMD detection would check CPU capabilities." << endl;
-    cout << "This allows choosing optimal code paths for different hardware." << endl << endl;
+    // Compile-time macros only describe what the compiler was allowed to use
+    cout << "Compiled for:";
+#ifdef __AVX512F__
+    cout << " AVX-512";
+#endif
+#ifdef __AVX2__
+    cout << " AVX2";
+#endif
+#ifdef __SSE2__
+    cout << " SSE2";
+#endif
+    cout << endl;
+
+    // CPUID says what this machine can actually run
+    const CpuFeatures& f = cpu_features();
+    cout << "CPU supports (CPUID + OS state):"
+         << (f.sse2 ? " SSE2" : "") << (f.avx ? " AVX" : "") << (f.avx2 ? " AVX2" : "")
+         << (f.fma ? " FMA" : "") << (f.avx512f ? " AVX-512F" : "") << endl;
+    cout << "Dispatching kernels to: " << simd_tier_name(active_simd_tier())
+         << " (set SIMD_TIER=scalar|sse2|avx2|avx512 to override)" << endl << endl;
+
+    // Same binary, every tier this CPU supports; cache-resident data so the
+    // kernels aren't just waiting on memory
+    const size_t SIZE = 1 << 13;
+    const int REPEAT = 5000;
+    aligned_vector<float> a(SIZE), b(SIZE), c(SIZE);
+    for (size_t i = 0; i < SIZE; ++i) {
+        a[i] = static_cast<float>(i % 1000) * 0.001f - 0.5f;
+        b[i] = static_cast<float>(i % 7) * 0.25f;
+    }
+
+    const SimdTier selected = active_simd_tier();
+    cout << "Kernel time per call on " << SIZE << " floats (μs):" << endl;
+    cout << "  tier      add   multiply    abs     sum     dot" << endl;
+    for (SimdTier tier : {SimdTier::Scalar, SimdTier::SSE2, SimdTier::AVX2, SimdTier::AVX512}) {
+        if (!simd_tier_supported(tier)) continue;
+        force_simd_tier(tier);
+
+        auto time_kernel = [&](auto&& kernel) {
+            auto start = high_resolution_clock::now();
+            for (int r = 0; r < REPEAT; ++r) kernel();
+            auto end = high_resolution_clock::now();
+            return duration_cast<nanoseconds>(end - start).count() / 1000.0 / REPEAT;
+        };
+        volatile float sink = 0.0f;
+        double add_us = time_kernel([&] { simd_add(a.data(), b.data(), c.data(), SIZE); });
+        double mul_us = time_kernel([&] { simd_multiply(a.data(), b.data(), c.data(), SIZE); });
+        double abs_us = time_kernel([&] { simd_abs(a.data(), c.data(), SIZE); });
+        double sum_us = time_kernel([&] { sink = simd_sum(a.data(), SIZE); });
+        double dot_us = time_kernel([&] { sink = simd_dot(a.data(), b.data(), SIZE); });
+
+        cout << "  " << simd_tier_name(tier) << "\t" << add_us << "\t" << mul_us << "\t" << abs_us
+             << "\t" << sum_us << "\t" << dot_us << endl;
+    }
+    force_simd_tier(selected);
+    cout << endl;
 }
 
 // ===== PERFORMANCE COMPARISON =====
@@ -331,6 +641,7 @@ void demonstrate_performance_comparison() {
     cout << "=== SIMD Performance Comparison ===\n" << endl;
 
     const int SIZE = 2000000;
+    static_assert(SIZE % floatv::size == 0, "SIZE must be a whole number of vectors");
 
     // Test different data types and operations
     struct TestCase {
@@ -340,51 +651,55 @@ void demonstrate_performance_comparison() {
 
     vector<TestCase> tests;
 
+    // The kernels capture these by reference, so they live for the whole function
+    aligned_vector<float> add_a(SIZE), add_b(SIZE), add_c(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        add_a[i] = add_b[i] = static_cast<float>(i % 1000);
+    }
+    aligned_vector<float> mul_a(SIZE), mul_b(SIZE), mul_c(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        mul_a[i] = static_cast<float>(i) * 0.001f;
+        mul_b[i] = static_cast<float>(i) * 0.002f;
+    }
+    aligned_vector<float> sin_a(SIZE), sin_b(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        sin_a[i] = static_cast<float>(i) * 0.01f;
+    }
+
     // Float addition
-    {
-        vector<float> a(SIZE), b(SIZE), c(SIZE);
+    tests.push_back({"Float Addition", [&]() {
         for (int i = 0; i < SIZE; ++i) {
-            a[i] = b[i] = static_cast<float>(i % 1000);
+            add_c[i] = add_a[i] + add_b[i];
         }
-
-        TestCase tc{"Float Addition", [&]() {
-            for (int i = 0; i < SIZE; ++i) {
-                c[i] = a[i] + b[i];
-            }
-        }};
-        tests.push_back(tc);
-    }
+    }});
+    tests.push_back({"Float Addition (simd<float, " + to_string(floatv::size) + ">)", [&]() {
+        for (int i = 0; i < SIZE; i += floatv::size) {
+            (floatv::load(&add_a[i]) + floatv::load(&add_b[i])).store(&add_c[i]);
+        }
+    }});
 
     // Float multiplication
-    {
-        vector<float> a(SIZE), b(SIZE), c(SIZE);
+    tests.push_back({"Float Multiplication", [&]() {
         for (int i = 0; i < SIZE; ++i) {
-            a[i] = static_cast<float>(i) * 0.001f;
-            b[i] = static_cast<float>(i) * 0.002f;
+            mul_c[i] = mul_a[i] * mul_b[i];
         }
-
-        TestCase tc{"Float Multiplication", [&]() {
-            for (int i = 0; i < SIZE; ++i) {
-                c[i] = a[i] * b[i];
-            }
-        }};
-        tests.push_back(tc);
-    }
+    }});
+    tests.push_back({"Float Multiplication (simd<float, " + to_string(floatv::size) + ">)", [&]() {
+        for (int i = 0; i < SIZE; i += floatv::size) {
+            (floatv::load(&mul_a[i]) * floatv::load(&mul_b[i])).store(&mul_c[i]);
+        }
+    }});
 
     // Trigonometric functions
-    {
-        vector<float> a(SIZE), b(SIZE);
+    tests.push_back({"Sine Computation", [&]() {
         for (int i = 0; i < SIZE; ++i) {
-            a[i] = static_cast<float>(i) * 0.01f;
+            sin_b[i] = sin(sin_a[i]);
         }
-
-        TestCase tc{"Sine Computation", [&]() {
-            for (int i = 0; i < SIZE; ++i) {
-                b[i] = sin(a[i]);
-            }
-        }};
-        tests.push_back(tc);
-    }
+    }});
+    // Polynomial sine over the whole batch instead of one libm call per element
+    tests.push_back({"Sine Computation (vsin)", [&]() {
+        vsin(sin_a, sin_b);
+    }});
 
     // Run tests
     for (auto& test : tests) {
@@ -426,6 +741,11 @@ int main() {
     cout << "• Memory alignment is crucial for optimal SIMD performance" << endl;
     cout << "• Avoid branches and loop-carried dependencies" << endl;
     cout << "• Use -march=native and -O3 for best SIMD utilization" << endl;
+    cout << "• Runtime dispatch lets one baseline binary use AVX2/AVX-512 where available" << endl;
+    cout << "• simd<T, N> writes a kernel once and maps it to SSE/AVX or a scalar fallback" << endl;
+    cout << "• Batch vsin/vcos/vexp/vlog replace per-element libm calls that block vectorization" << endl;
+    cout << "• aligned_vector keeps SIMD buffers on cache-line boundaries; huge pages help large streams" << endl;
+    cout << "• Mask + compress filtering costs the same at every selectivity; branches do not" << endl;
     cout << "• Profile and measure to ensure SIMD is actually being used" << endl;
 
     return 0;
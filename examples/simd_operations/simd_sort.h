@@ -0,0 +1,252 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include "simd_dispatch.h"
+
+// ===== SIMD SORTING NETWORKS =====
+//
+// simd_sort_small sorts up to 64 int32/float values with a bitonic network
+// held entirely in AVX2 registers: every register is sorted with six
+// compare-exchange steps (shuffle, min, max, blend), then sorted runs are
+// merged register against register. The input is padded with the largest
+// value to 8, 16, 32 or 64 elements. A network does the same work for
+// every input, so unlike insertion sort it never mispredicts a branch.
+//
+// Floats are sorted as int32 keys in IEEE totalOrder (-NaN < -inf < -0 <
+// +0 < +inf < +NaN). Float min/max return their second operand when one
+// is NaN and can't tell -0 from +0, so a float network would duplicate
+// and lose values; the integer keys keep every output a permutation of
+// the input.
+//
+// simd_hybrid_sort is an introsort (median-of-3, Hoare partition, heapsort
+// when recursion gets too deep) that hands every partition of 64 or fewer
+// elements to simd_sort_small. It is not stable. For floats, NaNs end up
+// in unspecified positions, as with std::sort.
+//
+// The AVX2 code is compiled with a target attribute, like the kernels in
+// simd_dispatch.h, and used when the active dispatch tier is AVX2 or
+// above; otherwise small ranges fall back to insertion sort.
+
+inline constexpr std::size_t simd_sort_network_max = 64;
+
+// Lanes that keep the larger value when step (block, distance) of a
+// bitonic sort compares lane i with lane i ^ distance
+constexpr int bitonic_max_lanes(int block, int distance) {
+    int mask = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+        bool ascending = (lane & block) == 0;
+        bool lower = (lane & distance) == 0;
+        if (lower != ascending) mask |= 1 << lane;
+    }
+    return mask;
+}
+
+// Flips the magnitude bits of negative floats, so that signed comparison
+// of the results follows IEEE totalOrder; the mapping is its own inverse
+inline std::int32_t float_sort_key(std::int32_t bits) {
+    return bits ^ ((bits >> 31) & 0x7fffffff);
+}
+
+template<typename T>
+void insertion_sort(T* first, T* last) {
+    for (T* i = first + (first != last); i < last; ++i) {
+        T value = *i;
+        T* j = i;
+        for (; j > first && value < j[-1]; --j) *j = j[-1];
+        *j = value;
+    }
+}
+
+#if defined(SIMD_DISPATCH_X86)
+#define SIMD_SORT_TARGET __attribute__((target("avx2")))
+
+template<typename T>
+struct BitonicAvx2Ops;
+
+template<>
+struct BitonicAvx2Ops<std::int32_t> {
+    using reg = __m256i;
+    SIMD_SORT_TARGET static reg load(const std::int32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+    SIMD_SORT_TARGET static void store(std::int32_t* p, reg v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+    SIMD_SORT_TARGET static reg min(reg a, reg b) { return _mm256_min_epi32(a, b); }
+    SIMD_SORT_TARGET static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+    // Lane i gets lane i ^ Distance
+    template<int Distance>
+    SIMD_SORT_TARGET static reg swap(reg v) {
+        if constexpr (Distance == 1) return _mm256_shuffle_epi32(v, 0xB1);
+        else if constexpr (Distance == 2) return _mm256_shuffle_epi32(v, 0x4E);
+        else return _mm256_permute2x128_si256(v, v, 1);
+    }
+    template<int Mask>
+    SIMD_SORT_TARGET static reg blend(reg a, reg b) { return _mm256_blend_epi32(a, b, Mask); }
+    SIMD_SORT_TARGET static reg reverse(reg v) {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+    static std::int32_t padding() { return std::numeric_limits<std::int32_t>::max(); }
+};
+
+template<typename T>
+struct BitonicAvx2 {
+    using Ops = BitonicAvx2Ops<T>;
+    using reg = typename Ops::reg;
+
+    template<int Block, int Distance>
+    SIMD_SORT_TARGET static reg exchange(reg v) {
+        reg partner = Ops::template swap<Distance>(v);
+        return Ops::template blend<bitonic_max_lanes(Block, Distance)>(Ops::min(v, partner), Ops::max(v, partner));
+    }
+
+    SIMD_SORT_TARGET static reg sort8(reg v) {
+        v = exchange<2, 1>(v);
+        v = exchange<4, 2>(v);
+        v = exchange<4, 1>(v);
+        return merge8(v);
+    }
+
+    // Sorts a register holding a bitonic sequence
+    SIMD_SORT_TARGET static reg merge8(reg v) {
+        v = exchange<8, 4>(v);
+        v = exchange<8, 2>(v);
+        return exchange<8, 1>(v);
+    }
+
+    // Sorts Count registers that together hold a bitonic sequence
+    template<int Count>
+    SIMD_SORT_TARGET static void merge(reg* v) {
+        for (int distance = Count / 2; distance > 0; distance /= 2) {
+            for (int i = 0; i < Count; ++i) {
+                if (i & distance) continue;
+                reg lo = Ops::min(v[i], v[i + distance]);
+                v[i + distance] = Ops::max(v[i], v[i + distance]);
+                v[i] = lo;
+            }
+        }
+        for (int i = 0; i < Count; ++i) v[i] = merge8(v[i]);
+    }
+
+    // Merges the sorted runs v[0, Count/2) and v[Count/2, Count): reversing
+    // the second run makes the whole range bitonic
+    template<int Count>
+    SIMD_SORT_TARGET static void merge_runs(reg* v) {
+        constexpr int half = Count / 2;
+        for (int i = 0; i < half / 2; ++i) std::swap(v[half + i], v[Count - 1 - i]);
+        for (int i = half; i < Count; ++i) v[i] = Ops::reverse(v[i]);
+        merge<Count>(v);
+    }
+
+    template<int Count>
+    SIMD_SORT_TARGET static void sort_registers(reg* v) {
+        for (int i = 0; i < Count; ++i) v[i] = sort8(v[i]);
+        if constexpr (Count >= 2) {
+            for (int i = 0; i < Count; i += 2) merge_runs<2>(v + i);
+        }
+        if constexpr (Count >= 4) {
+            for (int i = 0; i < Count; i += 4) merge_runs<4>(v + i);
+        }
+        if constexpr (Count >= 8) merge_runs<8>(v);
+    }
+
+    template<int Count>
+    SIMD_SORT_TARGET static void sort_buffer(T* buffer) {
+        reg v[Count];
+        for (int i = 0; i < Count; ++i) v[i] = Ops::load(buffer + 8 * i);
+        sort_registers<Count>(v);
+        for (int i = 0; i < Count; ++i) Ops::store(buffer + 8 * i, v[i]);
+    }
+
+    SIMD_SORT_TARGET static void sort(T* p, std::size_t n) {
+        alignas(32) T buffer[simd_sort_network_max];
+        std::size_t padded = n <= 8 ? 8 : n <= 16 ? 16 : n <= 32 ? 32 : 64;
+        std::copy(p, p + n, buffer);
+        std::fill(buffer + n, buffer + padded, Ops::padding());
+        switch (padded) {
+            case 8: sort_buffer<1>(buffer); break;
+            case 16: sort_buffer<2>(buffer); break;
+            case 32: sort_buffer<4>(buffer); break;
+            default: sort_buffer<8>(buffer); break;
+        }
+        std::copy(buffer, buffer + n, p);
+    }
+};
+
+#undef SIMD_SORT_TARGET
+#endif
+
+// True when the network path is available and selected by the dispatcher
+inline bool simd_sort_uses_network() {
+#if defined(SIMD_DISPATCH_X86)
+    return simd_kernels().tier >= SimdTier::AVX2;
+#else
+    return false;
+#endif
+}
+
+// Sorts n <= simd_sort_network_max elements at p
+template<typename T>
+void simd_sort_small(T* p, std::size_t n) {
+    static_assert(std::is_same_v<T, std::int32_t> || std::is_same_v<T, float>, "networks exist for int32_t and float");
+    if (n < 2) return;
+    if constexpr (std::is_same_v<T, float>) {
+        std::int32_t keys[simd_sort_network_max];
+        std::transform(p, p + n, keys, [](float x) { return float_sort_key(std::bit_cast<std::int32_t>(x)); });
+        simd_sort_small(keys, n);
+        std::transform(keys, keys + n, p, [](std::int32_t k) { return std::bit_cast<float>(float_sort_key(k)); });
+    } else {
+#if defined(SIMD_DISPATCH_X86)
+        if (simd_sort_uses_network()) {
+            BitonicAvx2<T>::sort(p, n);
+            return;
+        }
+#endif
+        insertion_sort(p, p + n);
+    }
+}
+
+template<typename T>
+void simd_hybrid_sort_range(T* first, T* last, int depth_limit, bool network) {
+    while (static_cast<std::size_t>(last - first) > simd_sort_network_max) {
+        if (depth_limit-- == 0) {
+            std::make_heap(first, last);
+            std::sort_heap(first, last);
+            return;
+        }
+        // Median of three as pivot; it is in the range, so both scans stop
+        T a = *first, b = first[(last - first) / 2], c = last[-1];
+        T pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+        T* i = first - 1;
+        T* j = last;
+        for (;;) {
+            do ++i; while (*i < pivot);
+            do --j; while (pivot < *j);
+            if (i >= j) break;
+            std::swap(*i, *j);
+        }
+        // [first, j] <= pivot <= (j, last); recurse into the smaller side
+        T* middle = j + 1;
+        if (middle - first < last - middle) {
+            simd_hybrid_sort_range(first, middle, depth_limit, network);
+            first = middle;
+        } else {
+            simd_hybrid_sort_range(middle, last, depth_limit, network);
+            last = middle;
+        }
+    }
+    if (network) {
+        simd_sort_small(first, static_cast<std::size_t>(last - first));
+    } else {
+        insertion_sort(first, last);
+    }
+}
+
+template<typename T>
+void simd_hybrid_sort(std::span<T> data) {
+    static_assert(std::is_same_v<T, std::int32_t> || std::is_same_v<T, float>, "networks exist for int32_t and float");
+    int depth_limit = 0;
+    for (std::size_t n = data.size(); n > 1; n >>= 1) depth_limit += 2;
+    simd_hybrid_sort_range(data.data(), data.data() + data.size(), depth_limit, simd_sort_uses_network());
+}
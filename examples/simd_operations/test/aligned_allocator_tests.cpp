@@ -0,0 +1,81 @@
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include "../aligned_allocator.h"
+#include "../simd.h"
+#include "../simd_math.h"
+
+// Every allocation, including regrowth, honours the requested alignment
+template<std::size_t Align>
+void test_alignment() {
+    for (std::size_t n : {1u, 3u, 17u, 1000u, 100000u}) {
+        aligned_vector<float, Align> v(n);
+        assert(is_aligned(v.data(), Align));
+    }
+    aligned_vector<double, Align> grown;
+    for (int i = 0; i < 5000; ++i) {
+        grown.push_back(i);
+        assert(is_aligned(grown.data(), Align));
+    }
+    for (int i = 0; i < 5000; ++i) assert(grown[i] == i);
+
+    // Rebinding keeps the alignment (std::vector<bool> and node containers
+    // allocate other types through it)
+    using Rebound = typename std::allocator_traits<aligned_allocator<float, Align>>::template rebind_alloc<std::int64_t>;
+    static_assert(Rebound::alignment == Align);
+    Rebound rebound;
+    std::int64_t* p = rebound.allocate(7);
+    assert(is_aligned(p, Align));
+    rebound.deallocate(p, 7);
+    assert((aligned_allocator<float, Align>() == Rebound()));
+}
+
+void test_huge_pages() {
+    // Small buffers take the normal path, large ones start on a 2 MiB boundary
+    huge_page_vector<float> small(100);
+    assert(is_aligned(small.data(), 64));
+    const std::size_t page = aligned_allocator<float, 64, true>::huge_page_size;
+    huge_page_vector<float> large(3 * page / sizeof(float) + 5);
+    assert(is_aligned(large.data(), page));
+    std::iota(large.begin(), large.end(), 0.0f);
+    assert(large[12345] == 12345.0f);
+}
+
+// The vector_aligned instantiation is taken for aligned storage and gives the
+// same results as the unaligned one
+void test_alignment_dispatch() {
+    using V = native_simd<float>;
+    aligned_vector<float> buffer(1025);
+    assert(V::is_aligned(buffer.data()));
+    assert(!V::is_aligned(buffer.data() + 1));
+
+    bool aligned_path = false;
+    simd_with_alignment<V>([&](auto flags) {
+        aligned_path = std::is_same_v<decltype(flags), vector_aligned_tag>;
+    }, buffer.data());
+    assert(aligned_path);
+    simd_with_alignment<V>([&](auto flags) {
+        aligned_path = std::is_same_v<decltype(flags), vector_aligned_tag>;
+    }, buffer.data(), buffer.data() + 1);
+    assert(!aligned_path);
+
+    for (std::size_t i = 0; i < buffer.size(); ++i) buffer[i] = 0.01f * float(i);
+    aligned_vector<float> aligned_out(1024);
+    std::vector<float> unaligned_out(1025);
+    vexp(std::span<const float>(buffer.data(), 1024), aligned_out);
+    vexp(std::span<const float>(buffer.data(), 1024), std::span<float>(unaligned_out.data() + 1, 1024));
+    for (std::size_t i = 0; i < 1024; ++i) assert(aligned_out[i] == unaligned_out[i + 1]);
+}
+
+int main() {
+    test_alignment<32>();
+    test_alignment<64>();
+    test_alignment<4096>();
+    test_huge_pages();
+    test_alignment_dispatch();
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "../simd_dispatch.h"
+
+bool close(float a, float b) {
+    return std::fabs(a - b) <= 1e-4f * std::max(1.0f, std::fabs(b));
+}
+
+// Every tier the CPU can run must agree with the scalar kernels, including
+// on lengths that leave a tail after the last full vector
+void test_tier(SimdTier tier) {
+    force_simd_tier(tier);
+    assert(active_simd_tier() == tier);
+
+    for (std::size_t n : {0u, 1u, 3u, 7u, 15u, 16u, 17u, 33u, 100u, 100003u}) {
+        std::vector<float> a(n), b(n), out(n, -1.0f), expected(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            a[i] = static_cast<float>(static_cast<int>(i % 17) - 8) * 0.5f;
+            b[i] = static_cast<float>(i % 5) * 0.25f;
+        }
+
+        simd_add(a.data(), b.data(), out.data(), n);
+        ScalarKernels::add(a.data(), b.data(), expected.data(), n);
+        assert(out == expected);
+
+        simd_multiply(a.data(), b.data(), out.data(), n);
+        ScalarKernels::multiply(a.data(), b.data(), expected.data(), n);
+        assert(out == expected);
+
+        simd_abs(a.data(), out.data(), n);
+        ScalarKernels::abs(a.data(), expected.data(), n);
+        assert(out == expected);
+
+        // Reductions add in a different order, so only agree approximately
+        assert(close(simd_sum(a.data(), n), ScalarKernels::sum(a.data(), n)));
+        assert(close(simd_dot(a.data(), b.data(), n), ScalarKernels::dot(a.data(), b.data(), n)));
+
+        // Nothing is written past the end
+        std::vector<float> guarded(n + 16, 42.0f);
+        simd_add(a.data(), b.data(), guarded.data(), n);
+        for (std::size_t i = n; i < guarded.size(); ++i) assert(guarded[i] == 42.0f);
+    }
+}
+
+int main() {
+    assert(simd_tier_supported(SimdTier::Scalar));
+    assert(simd_tier_supported(best_simd_tier()));
+    assert(active_simd_tier() == initial_simd_tier());
+
+    for (SimdTier tier : {SimdTier::Scalar, SimdTier::SSE2, SimdTier::AVX2, SimdTier::AVX512}) {
+        if (simd_tier_supported(tier)) {
+            test_tier(tier);
+        } else {
+            [[maybe_unused]] bool thrown = false;
+            try {
+                force_simd_tier(tier);
+            } catch (const std::invalid_argument&) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "../simd_filter.h"
+
+// simd_filter must agree with std::copy_if for every length (so every tail
+// size), every selectivity and in-place use
+template<typename T>
+void test_filter() {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> value(0, 999);
+
+    for (std::size_t n : {0u, 1u, 3u, 7u, 8u, 9u, 31u, 64u, 100u, 1000u, 4099u}) {
+        std::vector<T> in(n);
+        for (T& x : in) x = static_cast<T>(value(rng));
+
+        for (int threshold : {0, 10, 250, 500, 900, 1000}) {
+            auto pred = [threshold](auto x) { return x < T(threshold); };
+            std::vector<T> expected;
+            std::copy_if(in.begin(), in.end(), std::back_inserter(expected), [&](T x) { return x < T(threshold); });
+
+            std::vector<T> out(n);
+            [[maybe_unused]] std::size_t kept = simd_filter<T>(in, out, pred);
+            assert(kept == expected.size());
+            assert(std::equal(expected.begin(), expected.end(), out.begin()));
+
+            std::vector<T> in_place = in;
+            kept = simd_filter<T>(in_place, in_place, pred);
+            assert(kept == expected.size());
+            assert(std::equal(expected.begin(), expected.end(), in_place.begin()));
+        }
+    }
+
+    // Negative values and compound predicates
+    std::vector<T> in;
+    for (int i = -50; i < 50; ++i) in.push_back(static_cast<T>(i));
+    std::vector<T> out(in.size());
+    std::size_t kept = simd_filter<T>(in, out, [](auto x) { return (x > T(-10)) & (x <= T(10)); });
+    assert(kept == 20);
+    for (std::size_t i = 0; i < kept; ++i) assert(out[i] == static_cast<T>(int(i) - 9));
+
+    [[maybe_unused]] bool thrown = false;
+    try {
+        std::vector<T> shorter(in.size() - 1);
+        simd_filter<T>(in, shorter, [](auto x) { return x > T(0); });
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+int main() {
+    // Variants built for a wider ISA skip (exit code 77, SKIP_RETURN_CODE
+    // in CMake) on a CPU that can't run them
+    if (const char* missing = simd_missing_build_feature()) {
+        std::printf("%s not supported, skipping\n", missing);
+        return 77;
+    }
+    test_filter<std::int32_t>();
+    test_filter<float>();
+    test_filter<std::int64_t>();
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../simd_math.h"
+
+// Accuracy harness: every result is compared with libm evaluated one
+// precision higher (double for float, long double for double), which is
+// the correctly rounded answer to well under 0.01 ULP. Run with
+// --exhaustive to check every one of the 2^32 float inputs.
+
+template<typename T>
+using wide_t = std::conditional_t<std::is_same_v<T, float>, double, long double>;
+
+template<typename T>
+double ulp_error(T got, wide_t<T> exact) {
+    const double inf = std::numeric_limits<double>::infinity();
+    if (std::isnan(exact)) return std::isnan(got) ? 0.0 : inf;
+    T rounded = static_cast<T>(exact);
+    if (std::isinf(rounded)) return got == rounded ? 0.0 : inf;
+    if (std::isnan(got)) return inf;
+
+    wide_t<T> ulp = std::numeric_limits<T>::denorm_min();
+    if (rounded != 0) {
+        int e;
+        std::frexp(rounded, &e);
+        ulp = std::max(ulp, std::ldexp(wide_t<T>(1), e - std::numeric_limits<T>::digits));
+    }
+    return static_cast<double>(std::fabs(static_cast<wide_t<T>>(got) - exact) / ulp);
+}
+
+struct Function {
+    const char* name;
+    void (*vf)(std::span<const float>, std::span<float>);
+    void (*vd)(std::span<const double>, std::span<double>);
+    double (*ref_float)(double);
+    long double (*ref_double)(long double);
+    float lo_float, hi_float;
+    double lo_double, hi_double;
+};
+
+double ref_sin(double x) { return std::sin(x); }
+double ref_cos(double x) { return std::cos(x); }
+double ref_exp(double x) { return std::exp(x); }
+double ref_log(double x) { return std::log(x); }
+long double ref_sinl(long double x) { return std::sin(x); }
+long double ref_cosl(long double x) { return std::cos(x); }
+long double ref_expl(long double x) { return std::exp(x); }
+long double ref_logl(long double x) { return std::log(x); }
+
+const Function functions[] = {
+    {"vsin", vsin, vsin, ref_sin, ref_sinl, -65536.0f, 65536.0f, -0x1p19, 0x1p19},
+    {"vcos", vcos, vcos, ref_cos, ref_cosl, -65536.0f, 65536.0f, -0x1p19, 0x1p19},
+    {"vexp", vexp, vexp, ref_exp, ref_expl, -87.3f, 88.37f, -708.3, 709.0},
+    {"vlog", vlog, vlog, ref_log, ref_logl, 0.0f, 16.0f, 0.0, 16.0},
+};
+
+// The bound documented in simd_math.h
+const double max_ulp = 1.5;
+
+template<typename T>
+double check(const Function& fn, const std::vector<T>& inputs) {
+    std::vector<T> out(inputs.size());
+    if constexpr (std::is_same_v<T, float>) {
+        fn.vf(inputs, out);
+    } else {
+        fn.vd(inputs, out);
+    }
+    double worst = 0.0;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        wide_t<T> exact;
+        if constexpr (std::is_same_v<T, float>) {
+            exact = fn.ref_float(inputs[i]);
+        } else {
+            exact = fn.ref_double(inputs[i]);
+        }
+        double err = ulp_error(out[i], exact);
+        if (err > max_ulp) {
+            std::printf("%s(%a) = %a, expected %La (%.2f ULP)\n", fn.name, double(inputs[i]), double(out[i]),
+                        static_cast<long double>(exact), err);
+        }
+        worst = std::max(worst, err);
+    }
+    return worst;
+}
+
+// Inputs spread over every bit pattern (so every binade, both signs, inf and
+// NaN) plus a uniform sweep of the fast domain, where the polynomials run
+template<typename T>
+std::vector<T> sample_inputs(const Function& fn, std::size_t count) {
+    using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+    std::vector<T> inputs;
+    inputs.reserve(2 * count);
+
+    std::mt19937_64 rng(12345);
+    for (std::size_t i = 0; i < count; ++i) {
+        Bits pattern = static_cast<Bits>(rng());
+        T value;
+        std::memcpy(&value, &pattern, sizeof(T));
+        inputs.push_back(value);
+    }
+
+    T lo = std::is_same_v<T, float> ? T(fn.lo_float) : T(fn.lo_double);
+    T hi = std::is_same_v<T, float> ? T(fn.hi_float) : T(fn.hi_double);
+    std::uniform_real_distribution<T> uniform(lo, hi);
+    for (std::size_t i = 0; i < count; ++i) inputs.push_back(uniform(rng));
+    return inputs;
+}
+
+template<typename T>
+void check_special_values(const Function& fn) {
+    const T inf = std::numeric_limits<T>::infinity();
+    std::vector<T> inputs = {T(0), -T(0), inf, -inf, std::numeric_limits<T>::quiet_NaN(),
+                             std::numeric_limits<T>::denorm_min(), -std::numeric_limits<T>::denorm_min(),
+                             std::numeric_limits<T>::min(), std::numeric_limits<T>::max(),
+                             -std::numeric_limits<T>::max(), T(1), T(-1), T(0.5), T(2)};
+    std::vector<T> out(inputs.size());
+    if constexpr (std::is_same_v<T, float>) {
+        fn.vf(inputs, out);
+    } else {
+        fn.vd(inputs, out);
+    }
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        T expected;
+        if constexpr (std::is_same_v<T, float>) {
+            expected = static_cast<T>(fn.ref_float(inputs[i]));
+        } else {
+            expected = static_cast<T>(fn.ref_double(inputs[i]));
+        }
+        // Same class of answer as libm, including the sign of zero
+        assert(std::isnan(out[i]) == std::isnan(expected));
+        if (!std::isnan(expected)) {
+            assert(ulp_error(out[i], static_cast<wide_t<T>>(expected)) <= max_ulp);
+            if (expected == 0) assert(std::signbit(out[i]) == std::signbit(expected));
+        }
+    }
+}
+
+// Any length (tail handling) and in-place evaluation give the same answers
+template<typename T>
+void check_lengths(const Function& fn) {
+    std::vector<T> all(100);
+    for (std::size_t i = 0; i < all.size(); ++i) all[i] = static_cast<T>(0.37 * double(i) + 0.01);
+    std::vector<T> expected(all.size());
+    auto run = [&](std::span<const T> in, std::span<T> out) {
+        if constexpr (std::is_same_v<T, float>) {
+            fn.vf(in, out);
+        } else {
+            fn.vd(in, out);
+        }
+    };
+    run(all, expected);
+
+    for (std::size_t n = 0; n <= 37; ++n) {
+        std::vector<T> out(n + 1, T(-7));
+        run(std::span<const T>(all.data(), n), std::span<T>(out.data(), n));
+        for (std::size_t i = 0; i < n; ++i) assert(out[i] == expected[i]);
+        assert(out[n] == T(-7));
+
+        std::vector<T> in_place(all.begin(), all.begin() + n);
+        run(in_place, in_place);
+        for (std::size_t i = 0; i < n; ++i) assert(in_place[i] == expected[i]);
+    }
+
+    [[maybe_unused]] bool thrown = false;
+    try {
+        std::vector<T> shorter(10);
+        run(std::span<const T>(all.data(), 11), shorter);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void exhaustive_float(const Function& fn) {
+    const std::size_t BLOCK = 1 << 16;
+    std::vector<float> inputs(BLOCK);
+    double worst = 0.0;
+    for (std::uint64_t base = 0; base < (std::uint64_t(1) << 32); base += BLOCK) {
+        for (std::size_t i = 0; i < BLOCK; ++i) {
+            std::uint32_t pattern = static_cast<std::uint32_t>(base + i);
+            std::memcpy(&inputs[i], &pattern, sizeof(float));
+        }
+        worst = std::max(worst, check(fn, inputs));
+    }
+    std::printf("%s float exhaustive: max %.3f ULP\n", fn.name, worst);
+    assert(worst <= max_ulp);
+}
+
+int main(int argc, char** argv) {
+    // Variants built for a wider ISA skip (exit code 77, SKIP_RETURN_CODE
+    // in CMake) on a CPU that can't run them
+    if (const char* missing = simd_missing_build_feature()) {
+        std::printf("%s not supported, skipping\n", missing);
+        return 77;
+    }
+    bool exhaustive = argc > 1 && std::string(argv[1]) == "--exhaustive";
+    const std::size_t SAMPLES = 1 << 17;
+
+    for (const Function& fn : functions) {
+        double worst_float = check(fn, sample_inputs<float>(fn, SAMPLES));
+        double worst_double = check(fn, sample_inputs<double>(fn, SAMPLES));
+        std::printf("%s: max %.3f ULP (float), %.3f ULP (double)\n", fn.name, worst_float, worst_double);
+        assert(worst_float <= max_ulp);
+        assert(worst_double <= max_ulp);
+
+        check_special_values<float>(fn);
+        check_special_values<double>(fn);
+        check_lengths<float>(fn);
+        check_lengths<double>(fn);
+
+        if (exhaustive) exhaustive_float(fn);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <compare>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+#include "../simd_sort.h"
+
+// Networks and hybrid sort are checked against std::sort; every tier the CPU
+// supports is forced in turn so the insertion-sort fallback is covered too
+
+template<typename T>
+std::vector<T> random_values(std::size_t n, int range, std::mt19937& rng) {
+    std::uniform_int_distribution<int> value(-range, range);
+    std::vector<T> out(n);
+    for (T& x : out) x = static_cast<T>(value(rng));
+    return out;
+}
+
+template<typename T>
+void check_sorted_like_std(std::vector<T> data, bool small) {
+    std::vector<T> expected = data;
+    std::sort(expected.begin(), expected.end());
+    if (small) {
+        simd_sort_small(data.data(), data.size());
+    } else {
+        simd_hybrid_sort<T>(data);
+    }
+    assert(data == expected);
+}
+
+template<typename T>
+void test_networks() {
+    std::mt19937 rng(3);
+    for (std::size_t n = 0; n <= simd_sort_network_max; ++n) {
+        for (int trial = 0; trial < 50; ++trial) {
+            check_sorted_like_std(random_values<T>(n, trial < 25 ? 1000 : 3, rng), true);
+        }
+        // Values equal to the padding must survive
+        std::vector<T> extremes(n, std::numeric_limits<T>::max());
+        if (n > 0) extremes[0] = std::numeric_limits<T>::lowest();
+        check_sorted_like_std(extremes, true);
+    }
+}
+
+template<typename T>
+void test_hybrid() {
+    std::mt19937 rng(5);
+    for (std::size_t n : {0u, 1u, 65u, 100u, 1000u, 4097u, 100000u}) {
+        std::vector<T> values = random_values<T>(n, 1 << 20, rng);
+        check_sorted_like_std(values, false);
+
+        std::vector<T> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        check_sorted_like_std(sorted, false);
+        std::reverse(sorted.begin(), sorted.end());
+        check_sorted_like_std(sorted, false);
+
+        check_sorted_like_std(random_values<T>(n, 4, rng), false);
+        check_sorted_like_std(std::vector<T>(n, T(7)), false);
+
+        // Organ pipe: ascending then descending
+        std::vector<T> pipe(n);
+        for (std::size_t i = 0; i < n; ++i) pipe[i] = static_cast<T>(std::min(i, n - i));
+        check_sorted_like_std(pipe, false);
+    }
+}
+
+void test_float_specials() {
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> data = {3.5f, -inf, 0.0f, inf, -1.25f, inf, 1e-40f, -3.5f, 2.0f, -inf};
+    std::vector<float> expected = data;
+    std::sort(expected.begin(), expected.end());
+    simd_sort_small(data.data(), data.size());
+    assert(data == expected);
+
+    // NaNs and signed zeros: the result is the input in IEEE totalOrder,
+    // bit for bit, so nothing is lost or duplicated. == can't tell -0 from
+    // +0, so bit patterns are compared.
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    [[maybe_unused]] auto bits = [](const std::vector<float>& v) {
+        std::vector<std::uint32_t> out;
+        for (float x : v) out.push_back(std::bit_cast<std::uint32_t>(x));
+        return out;
+    };
+    std::vector<float> zeros;
+    for (int i = 0; i < 8; ++i) zeros.insert(zeros.end(), {0.0f, -0.0f});
+    for (std::vector<float> special : {
+             std::vector<float>{10.0f, 3.0f, nan, 0.0f, -2.0f, 7.0f, 1.0f, 5.0f,
+                                -8.0f, 4.0f, 6.0f, 9.0f, -1.0f, 2.0f, 8.0f, -3.0f},
+             zeros,
+             std::vector<float>{nan, -nan, 1.0f, -0.0f, inf, 0.0f, -inf, nan, -1.0f},
+         }) {
+        std::vector<float> total_order = special;
+        std::sort(total_order.begin(), total_order.end(),
+                  [](float a, float b) { return std::is_lt(std::strong_order(a, b)); });
+        simd_sort_small(special.data(), special.size());
+        assert(bits(special) == bits(total_order));
+    }
+    std::vector<float> sorted_zeros = zeros;
+    simd_sort_small(sorted_zeros.data(), sorted_zeros.size());
+    for (std::size_t i = 0; i < sorted_zeros.size(); ++i) assert(std::signbit(sorted_zeros[i]) == (i < 8));
+}
+
+int main() {
+    for (SimdTier tier : {SimdTier::Scalar, SimdTier::AVX2}) {
+        if (!simd_tier_supported(tier)) continue;
+        force_simd_tier(tier);
+        std::printf("%s: %s\n", simd_tier_name(tier), simd_sort_uses_network() ? "bitonic networks" : "insertion sort");
+        test_networks<std::int32_t>();
+        test_networks<float>();
+        test_hybrid<std::int32_t>();
+        test_hybrid<float>();
+        test_float_specials();
+    }
+    return 0;
+}
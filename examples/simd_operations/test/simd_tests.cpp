@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include "../simd.h"
+
+// Every operation is checked lane by lane against the plain scalar result,
+// so the same test covers the intrinsic specializations and the fallback
+template<typename T, int N>
+void test_shape() {
+    using V = simd<T, N>;
+    alignas(64) T a[N], b[N], out[N];
+    for (int i = 0; i < N; ++i) {
+        a[i] = static_cast<T>(i * 3 - N);
+        b[i] = static_cast<T>(N - i * 2 + 1);
+    }
+
+    V va = V::load(a), vb = V::load_aligned(b);
+    for (int i = 0; i < N; ++i) assert(va[i] == a[i] && vb[i] == b[i]);
+
+    (va + vb).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == T(a[i] + b[i]));
+    (va - vb).store_aligned(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == T(a[i] - b[i]));
+    (va * vb).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == T(a[i] * b[i]));
+    (va * T(2) + T(1)).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == T(a[i] * 2 + 1));
+    (-va).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == T(-a[i]));
+
+    min(va, vb).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == std::min(a[i], b[i]));
+    max(va, vb).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == std::max(a[i], b[i]));
+    abs(va).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == (a[i] < 0 ? T(-a[i]) : a[i]));
+
+    unsigned lt = 0, le = 0, eq = 0;
+    for (int i = 0; i < N; ++i) {
+        lt |= unsigned(a[i] < b[i]) << i;
+        le |= unsigned(a[i] <= b[i]) << i;
+        eq |= unsigned(a[i] == b[i]) << i;
+    }
+    assert((va < vb).bits() == lt);
+    assert((va <= vb).bits() == le);
+    assert((va == vb).bits() == eq);
+    assert((va >= vb).bits() == (~lt & ((1u << N) - 1)));
+    assert((va != vb).bits() == (~eq & ((1u << N) - 1)));
+    assert(((va < vb) & (va == vb)).none());
+    assert(((va < vb) | (va >= vb)).all());
+    assert((va == va).count() == N);
+
+    select(va < vb, va, vb).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == std::min(a[i], b[i]));
+
+    T sum = 0, lo = a[0], hi = a[0];
+    for (int i = 0; i < N; ++i) {
+        sum += a[i];
+        lo = std::min(lo, a[i]);
+        hi = std::max(hi, a[i]);
+    }
+    assert(reduce_add(va) == sum);
+    assert(reduce_min(va) == lo);
+    assert(reduce_max(va) == hi);
+
+    // Reversed and repeated indices
+    T table[64];
+    for (int i = 0; i < 64; ++i) table[i] = static_cast<T>(i * 7);
+    std::int32_t index[N];
+    for (int i = 0; i < N; ++i) index[i] = (N - 1 - i) * 5 % 64;
+    index[0] = index[N - 1];
+    V::gather(table, simd<std::int32_t, N>::load(index)).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == table[index[i]]);
+
+    // Unaligned load/store really are unaligned-safe
+    T buffer[N + 1];
+    std::fill(buffer, buffer + N + 1, T(0));
+    va.store(buffer + 1);
+    assert(buffer[0] == 0);
+    for (int i = 0; i < N; ++i) assert(buffer[i + 1] == a[i]);
+}
+
+// Bit operations are checked against memcpy'd integers of the same width
+template<typename T, int N>
+void test_bits() {
+    using V = simd<T, N>;
+    using U = typename V::bits_type;
+    T a[N], b[N], out[N];
+    for (int i = 0; i < N; ++i) {
+        a[i] = static_cast<T>(i * 5 - 7);
+        b[i] = static_cast<T>(i + 1);
+    }
+    [[maybe_unused]] auto bits_of = [](T x) { U u; std::memcpy(&u, &x, sizeof(T)); return u; };
+
+    V va = V::load(a), vb = V::load(b);
+    bit_and(va, vb).store(out);
+    for (int i = 0; i < N; ++i) assert(bits_of(out[i]) == (bits_of(a[i]) & bits_of(b[i])));
+    bit_or(va, vb).store(out);
+    for (int i = 0; i < N; ++i) assert(bits_of(out[i]) == (bits_of(a[i]) | bits_of(b[i])));
+    bit_xor(va, vb).store(out);
+    for (int i = 0; i < N; ++i) assert(bits_of(out[i]) == (bits_of(a[i]) ^ bits_of(b[i])));
+    for (int k : {1, 3, int(sizeof(T) * 8 - 1)}) {
+        shift_left(va, k).store(out);
+        for (int i = 0; i < N; ++i) assert(bits_of(out[i]) == U(bits_of(a[i]) << k));
+        shift_right(va, k).store(out);
+        for (int i = 0; i < N; ++i) assert(bits_of(out[i]) == U(bits_of(a[i]) >> k));
+    }
+
+    // XOR with the sign bit negates
+    bit_xor(va, V::from_bits(U(1) << (sizeof(T) * 8 - 1))).store(out);
+    if (std::is_floating_point_v<T>) {
+        for (int i = 0; i < N; ++i) assert(out[i] == -a[i]);
+    }
+}
+
+template<typename T, int N>
+void test_floating() {
+    using V = simd<T, N>;
+    T a[N], out[N];
+    for (int i = 0; i < N; ++i) a[i] = static_cast<T>(i * i + 1);
+
+    sqrt(V::load(a)).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == std::sqrt(a[i]));
+    // Small integers: fused or not, the result is exact
+    fma(V::load(a), V(T(3)), V(T(-2))).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == a[i] * 3 - 2);
+    (V::load(a) / V(T(4))).store(out);
+    for (int i = 0; i < N; ++i) assert(out[i] == a[i] / 4);
+
+    // abs clears the sign of -0.0 too
+    abs(V(T(-0.0))).store(out);
+    assert(!std::signbit(out[0]));
+}
+
+// Every mask: the selected lanes come out in order and the count matches
+template<typename T, int N>
+void test_compress() {
+    using V = simd<T, N>;
+    T a[N];
+    for (int i = 0; i < N; ++i) a[i] = static_cast<T>(i * 11 + 3);
+    V va = V::load(a);
+    for (unsigned mask = 0; mask < (1u << N); ++mask) {
+        T keys[N], out[N + 1];
+        for (int i = 0; i < N; ++i) keys[i] = static_cast<T>(mask >> i & 1);
+        std::fill(out, out + N + 1, T(-1));
+        [[maybe_unused]] int count = compress_store(va, V::load(keys) == V(T(1)), out);
+        assert(count == __builtin_popcount(mask));
+        int k = 0;
+        for (int i = 0; i < N; ++i) {
+            if (mask >> i & 1) {
+                assert(out[k] == a[i]);
+                ++k;
+            }
+        }
+        assert(out[N] == T(-1));
+    }
+}
+
+int main() {
+    // Variants built for a wider ISA skip (exit code 77, SKIP_RETURN_CODE
+    // in CMake) on a CPU that can't run them
+    if (const char* missing = simd_missing_build_feature()) {
+        std::printf("%s not supported, skipping\n", missing);
+        return 77;
+    }
+    test_shape<float, 4>();
+    test_shape<float, 8>();
+    test_shape<double, 2>();
+    test_shape<double, 4>();
+    test_shape<std::int32_t, 4>();
+    test_shape<std::int32_t, 8>();
+    test_shape<std::int64_t, 2>();
+    test_shape<std::int64_t, 4>();
+    test_shape<float, 3>();
+
+    test_bits<float, 4>();
+    test_bits<float, 8>();
+    test_bits<double, 2>();
+    test_bits<double, 4>();
+    test_bits<std::int32_t, 4>();
+    test_bits<std::int32_t, 8>();
+    test_bits<std::int64_t, 4>();
+    test_bits<float, 3>();
+
+    test_floating<float, 4>();
+    test_floating<float, 8>();
+    test_floating<double, 2>();
+    test_floating<double, 4>();
+
+    test_compress<float, 4>();
+    test_compress<float, 8>();
+    test_compress<double, 2>();
+    test_compress<double, 4>();
+    test_compress<std::int32_t, 4>();
+    test_compress<std::int32_t, 8>();
+    test_compress<std::int64_t, 2>();
+    test_compress<std::int64_t, 4>();
+    test_compress<float, 3>();
+
+    static_assert(native_simd<float>::size >= 4, "native float vectors hold at least four lanes");
+    test_shape<float, native_simd<float>::size>();
+    return 0;
+}
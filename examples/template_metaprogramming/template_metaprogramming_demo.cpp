@@ -1,6 +1,7 @@
 #include <iostream>
 #include <type_traits>
 #include <utility>
+#include <tuple>
 #include <string>
 #include <vector>
 #include <array>